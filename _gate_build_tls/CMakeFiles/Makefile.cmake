@@ -0,0 +1,146 @@
+# CMAKE generated file: DO NOT EDIT!
+# Generated by "Unix Makefiles" Generator, CMake Version 3.25
+
+# The generator used is:
+set(CMAKE_DEPENDS_GENERATOR "Unix Makefiles")
+
+# The top level Makefile was generated from the following files:
+set(CMAKE_MAKEFILE_DEPENDS
+  "CMakeCache.txt"
+  "/root/repo/CMakeLists.txt"
+  "CMakeFiles/3.25.1/CMakeCCompiler.cmake"
+  "CMakeFiles/3.25.1/CMakeCXXCompiler.cmake"
+  "CMakeFiles/3.25.1/CMakeSystem.cmake"
+  "/root/repo/cmake/EnableStdCXX11.cmake"
+  "/root/repo/cmake/FindRAGEL.cmake"
+  "/root/repo/install/pkgconfig/served.pc.in"
+  "/root/repo/src/CMakeLists.txt"
+  "/root/repo/src/examples/CMakeLists.txt"
+  "/root/repo/src/examples/binary_data/CMakeLists.txt"
+  "/root/repo/src/examples/form_data/CMakeLists.txt"
+  "/root/repo/src/examples/handlers/CMakeLists.txt"
+  "/root/repo/src/examples/hello_world/CMakeLists.txt"
+  "/root/repo/src/examples/hello_world_no_blocking/CMakeLists.txt"
+  "/root/repo/src/examples/json_data/CMakeLists.txt"
+  "/root/repo/src/examples/list_endpoints/CMakeLists.txt"
+  "/root/repo/src/examples/query_params/CMakeLists.txt"
+  "/root/repo/src/examples/request_logger_plugin/CMakeLists.txt"
+  "/root/repo/src/examples/rest_resource/CMakeLists.txt"
+  "/root/repo/src/served/CMakeLists.txt"
+  "/root/repo/src/served/version.hpp.in.cmake"
+  "/usr/lib/x86_64-linux-gnu/cmake/Boost-1.74.0/BoostConfig.cmake"
+  "/usr/lib/x86_64-linux-gnu/cmake/Boost-1.74.0/BoostConfigVersion.cmake"
+  "/usr/lib/x86_64-linux-gnu/cmake/BoostDetectToolset-1.74.0.cmake"
+  "/usr/lib/x86_64-linux-gnu/cmake/boost_headers-1.74.0/boost_headers-config-version.cmake"
+  "/usr/lib/x86_64-linux-gnu/cmake/boost_headers-1.74.0/boost_headers-config.cmake"
+  "/usr/lib/x86_64-linux-gnu/cmake/boost_system-1.74.0/boost_system-config-version.cmake"
+  "/usr/lib/x86_64-linux-gnu/cmake/boost_system-1.74.0/boost_system-config.cmake"
+  "/usr/lib/x86_64-linux-gnu/cmake/boost_system-1.74.0/libboost_system-variant-shared.cmake"
+  "/usr/lib/x86_64-linux-gnu/cmake/boost_system-1.74.0/libboost_system-variant-static.cmake"
+  "/usr/share/cmake-3.25/Modules/CMakeCInformation.cmake"
+  "/usr/share/cmake-3.25/Modules/CMakeCXXInformation.cmake"
+  "/usr/share/cmake-3.25/Modules/CMakeCheckCompilerFlagCommonPatterns.cmake"
+  "/usr/share/cmake-3.25/Modules/CMakeCommonLanguageInclude.cmake"
+  "/usr/share/cmake-3.25/Modules/CMakeGenericSystem.cmake"
+  "/usr/share/cmake-3.25/Modules/CMakeInitializeConfigs.cmake"
+  "/usr/share/cmake-3.25/Modules/CMakeLanguageInformation.cmake"
+  "/usr/share/cmake-3.25/Modules/CMakeSystemSpecificInformation.cmake"
+  "/usr/share/cmake-3.25/Modules/CMakeSystemSpecificInitialize.cmake"
+  "/usr/share/cmake-3.25/Modules/CPack.cmake"
+  "/usr/share/cmake-3.25/Modules/CPackComponent.cmake"
+  "/usr/share/cmake-3.25/Modules/CheckCSourceCompiles.cmake"
+  "/usr/share/cmake-3.25/Modules/CheckCXXCompilerFlag.cmake"
+  "/usr/share/cmake-3.25/Modules/CheckCXXSourceCompiles.cmake"
+  "/usr/share/cmake-3.25/Modules/CheckIncludeFile.cmake"
+  "/usr/share/cmake-3.25/Modules/CheckLibraryExists.cmake"
+  "/usr/share/cmake-3.25/Modules/Compiler/CMakeCommonCompilerMacros.cmake"
+  "/usr/share/cmake-3.25/Modules/Compiler/GNU-C.cmake"
+  "/usr/share/cmake-3.25/Modules/Compiler/GNU-CXX.cmake"
+  "/usr/share/cmake-3.25/Modules/Compiler/GNU.cmake"
+  "/usr/share/cmake-3.25/Modules/FindBoost.cmake"
+  "/usr/share/cmake-3.25/Modules/FindOpenSSL.cmake"
+  "/usr/share/cmake-3.25/Modules/FindPackageHandleStandardArgs.cmake"
+  "/usr/share/cmake-3.25/Modules/FindPackageMessage.cmake"
+  "/usr/share/cmake-3.25/Modules/FindPkgConfig.cmake"
+  "/usr/share/cmake-3.25/Modules/FindThreads.cmake"
+  "/usr/share/cmake-3.25/Modules/Internal/CheckCompilerFlag.cmake"
+  "/usr/share/cmake-3.25/Modules/Internal/CheckFlagCommonConfig.cmake"
+  "/usr/share/cmake-3.25/Modules/Internal/CheckSourceCompiles.cmake"
+  "/usr/share/cmake-3.25/Modules/Platform/Linux-GNU-C.cmake"
+  "/usr/share/cmake-3.25/Modules/Platform/Linux-GNU-CXX.cmake"
+  "/usr/share/cmake-3.25/Modules/Platform/Linux-GNU.cmake"
+  "/usr/share/cmake-3.25/Modules/Platform/Linux.cmake"
+  "/usr/share/cmake-3.25/Modules/Platform/UnixPaths.cmake"
+  "/usr/share/cmake-3.25/Templates/CPackConfig.cmake.in"
+  )
+
+# The corresponding makefile is:
+set(CMAKE_MAKEFILE_OUTPUTS
+  "Makefile"
+  "CMakeFiles/cmake.check_cache"
+  )
+
+# Byproducts of CMake generate step:
+set(CMAKE_MAKEFILE_PRODUCTS
+  "/root/repo/src/served/version.hpp"
+  "/root/repo/lib/pkgconfig/served.pc"
+  "CPackConfig.cmake"
+  "CPackSourceConfig.cmake"
+  "CMakeFiles/CMakeDirectoryInformation.cmake"
+  "src/CMakeFiles/CMakeDirectoryInformation.cmake"
+  "src/served/CMakeFiles/CMakeDirectoryInformation.cmake"
+  "src/examples/CMakeFiles/CMakeDirectoryInformation.cmake"
+  "src/examples/binary_data/CMakeFiles/CMakeDirectoryInformation.cmake"
+  "src/examples/form_data/CMakeFiles/CMakeDirectoryInformation.cmake"
+  "src/examples/handlers/CMakeFiles/CMakeDirectoryInformation.cmake"
+  "src/examples/hello_world/CMakeFiles/CMakeDirectoryInformation.cmake"
+  "src/examples/hello_world_no_blocking/CMakeFiles/CMakeDirectoryInformation.cmake"
+  "src/examples/json_data/CMakeFiles/CMakeDirectoryInformation.cmake"
+  "src/examples/query_params/CMakeFiles/CMakeDirectoryInformation.cmake"
+  "src/examples/list_endpoints/CMakeFiles/CMakeDirectoryInformation.cmake"
+  "src/examples/request_logger_plugin/CMakeFiles/CMakeDirectoryInformation.cmake"
+  "src/examples/rest_resource/CMakeFiles/CMakeDirectoryInformation.cmake"
+  )
+
+# Dependency information for all targets:
+set(CMAKE_DEPEND_INFO_FILES
+  "src/served/CMakeFiles/served.dir/DependInfo.cmake"
+  "src/served/CMakeFiles/coroutine_test.dir/DependInfo.cmake"
+  "src/served/CMakeFiles/deferred_response_test.dir/DependInfo.cmake"
+  "src/served/CMakeFiles/handler_executor_test.dir/DependInfo.cmake"
+  "src/served/CMakeFiles/header_scan_test.dir/DependInfo.cmake"
+  "src/served/CMakeFiles/hpack_test.dir/DependInfo.cmake"
+  "src/served/CMakeFiles/methods_handler_test.dir/DependInfo.cmake"
+  "src/served/CMakeFiles/multiplexer_test.dir/DependInfo.cmake"
+  "src/served/CMakeFiles/matchers_test.dir/DependInfo.cmake"
+  "src/served/CMakeFiles/buffer_pool_test.dir/DependInfo.cmake"
+  "src/served/CMakeFiles/connection_test.dir/DependInfo.cmake"
+  "src/served/CMakeFiles/connection_manager_test.dir/DependInfo.cmake"
+  "src/served/CMakeFiles/connection_pool_test.dir/DependInfo.cmake"
+  "src/served/CMakeFiles/http2_session_test.dir/DependInfo.cmake"
+  "src/served/CMakeFiles/server_test.dir/DependInfo.cmake"
+  "src/served/CMakeFiles/timer_wheel_test.dir/DependInfo.cmake"
+  "src/served/CMakeFiles/tls_context_test.dir/DependInfo.cmake"
+  "src/served/CMakeFiles/parameters_test.dir/DependInfo.cmake"
+  "src/served/CMakeFiles/file_server_test.dir/DependInfo.cmake"
+  "src/served/CMakeFiles/request_test.dir/DependInfo.cmake"
+  "src/served/CMakeFiles/request_error_test.dir/DependInfo.cmake"
+  "src/served/CMakeFiles/request_parser_test.dir/DependInfo.cmake"
+  "src/served/CMakeFiles/request_parser_impl_test.dir/DependInfo.cmake"
+  "src/served/CMakeFiles/response_test.dir/DependInfo.cmake"
+  "src/served/CMakeFiles/response_stream_test.dir/DependInfo.cmake"
+  "src/served/CMakeFiles/sse_test.dir/DependInfo.cmake"
+  "src/served/CMakeFiles/status_test.dir/DependInfo.cmake"
+  "src/served/CMakeFiles/uri_test.dir/DependInfo.cmake"
+  "src/served/CMakeFiles/websocket_test.dir/DependInfo.cmake"
+  "src/examples/binary_data/CMakeFiles/eg_binary_data.dir/DependInfo.cmake"
+  "src/examples/form_data/CMakeFiles/eg_form_data.dir/DependInfo.cmake"
+  "src/examples/handlers/CMakeFiles/eg_handlers.dir/DependInfo.cmake"
+  "src/examples/hello_world/CMakeFiles/eg_hello_world.dir/DependInfo.cmake"
+  "src/examples/hello_world_no_blocking/CMakeFiles/eg_hello_world_no_blocking.dir/DependInfo.cmake"
+  "src/examples/json_data/CMakeFiles/json_data.dir/DependInfo.cmake"
+  "src/examples/query_params/CMakeFiles/eg_query_params.dir/DependInfo.cmake"
+  "src/examples/list_endpoints/CMakeFiles/eg_list_endpoints.dir/DependInfo.cmake"
+  "src/examples/request_logger_plugin/CMakeFiles/eg_request_logger_plugin.dir/DependInfo.cmake"
+  "src/examples/rest_resource/CMakeFiles/eg_rest_resource.dir/DependInfo.cmake"
+  )
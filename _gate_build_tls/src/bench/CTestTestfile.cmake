@@ -0,0 +1,8 @@
+# CMake generated Testfile for 
+# Source directory: /root/repo/src/bench
+# Build directory: /root/repo/_gate_build_tls/src/bench
+# 
+# This file includes the relevant testing commands required for 
+# testing this directory and lists subdirectories to be tested as well.
+subdirs("http_throughput")
+subdirs("tls_handshake")
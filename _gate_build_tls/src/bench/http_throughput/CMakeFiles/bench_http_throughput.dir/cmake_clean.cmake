@@ -0,0 +1,11 @@
+file(REMOVE_RECURSE
+  "/root/repo/bin/bench_http_throughput"
+  "/root/repo/bin/bench_http_throughput.pdb"
+  "CMakeFiles/bench_http_throughput.dir/main.cpp.o"
+  "CMakeFiles/bench_http_throughput.dir/main.cpp.o.d"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang CXX)
+  include(CMakeFiles/bench_http_throughput.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
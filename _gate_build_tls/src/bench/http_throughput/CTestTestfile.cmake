@@ -0,0 +1,6 @@
+# CMake generated Testfile for 
+# Source directory: /root/repo/src/bench/http_throughput
+# Build directory: /root/repo/_gate_build_tls/src/bench/http_throughput
+# 
+# This file includes the relevant testing commands required for 
+# testing this directory and lists subdirectories to be tested as well.
@@ -0,0 +1,11 @@
+file(REMOVE_RECURSE
+  "/root/repo/bin/bench_tls_handshake"
+  "/root/repo/bin/bench_tls_handshake.pdb"
+  "CMakeFiles/bench_tls_handshake.dir/main.cpp.o"
+  "CMakeFiles/bench_tls_handshake.dir/main.cpp.o.d"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang CXX)
+  include(CMakeFiles/bench_tls_handshake.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
@@ -0,0 +1,6 @@
+# CMake generated Testfile for 
+# Source directory: /root/repo/src/bench/tls_handshake
+# Build directory: /root/repo/_gate_build_tls/src/bench/tls_handshake
+# 
+# This file includes the relevant testing commands required for 
+# testing this directory and lists subdirectories to be tested as well.
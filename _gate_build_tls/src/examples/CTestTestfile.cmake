@@ -0,0 +1,16 @@
+# CMake generated Testfile for 
+# Source directory: /root/repo/src/examples
+# Build directory: /root/repo/_gate_build_tls/src/examples
+# 
+# This file includes the relevant testing commands required for 
+# testing this directory and lists subdirectories to be tested as well.
+subdirs("binary_data")
+subdirs("form_data")
+subdirs("handlers")
+subdirs("hello_world")
+subdirs("hello_world_no_blocking")
+subdirs("json_data")
+subdirs("query_params")
+subdirs("list_endpoints")
+subdirs("request_logger_plugin")
+subdirs("rest_resource")
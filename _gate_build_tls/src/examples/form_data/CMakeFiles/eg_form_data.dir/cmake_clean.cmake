@@ -0,0 +1,11 @@
+file(REMOVE_RECURSE
+  "/root/repo/bin/eg_form_data"
+  "/root/repo/bin/eg_form_data.pdb"
+  "CMakeFiles/eg_form_data.dir/main.cpp.o"
+  "CMakeFiles/eg_form_data.dir/main.cpp.o.d"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang CXX)
+  include(CMakeFiles/eg_form_data.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
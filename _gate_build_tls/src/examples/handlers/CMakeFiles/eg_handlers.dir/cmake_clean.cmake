@@ -0,0 +1,11 @@
+file(REMOVE_RECURSE
+  "/root/repo/bin/eg_handlers"
+  "/root/repo/bin/eg_handlers.pdb"
+  "CMakeFiles/eg_handlers.dir/main.cpp.o"
+  "CMakeFiles/eg_handlers.dir/main.cpp.o.d"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang CXX)
+  include(CMakeFiles/eg_handlers.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
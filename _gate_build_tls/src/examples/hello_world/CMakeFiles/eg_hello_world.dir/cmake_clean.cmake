@@ -0,0 +1,11 @@
+file(REMOVE_RECURSE
+  "/root/repo/bin/eg_hello_world"
+  "/root/repo/bin/eg_hello_world.pdb"
+  "CMakeFiles/eg_hello_world.dir/main.cpp.o"
+  "CMakeFiles/eg_hello_world.dir/main.cpp.o.d"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang CXX)
+  include(CMakeFiles/eg_hello_world.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
@@ -0,0 +1,11 @@
+file(REMOVE_RECURSE
+  "/root/repo/bin/eg_hello_world_no_blocking"
+  "/root/repo/bin/eg_hello_world_no_blocking.pdb"
+  "CMakeFiles/eg_hello_world_no_blocking.dir/main.cpp.o"
+  "CMakeFiles/eg_hello_world_no_blocking.dir/main.cpp.o.d"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang CXX)
+  include(CMakeFiles/eg_hello_world_no_blocking.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
@@ -0,0 +1,6 @@
+# CMake generated Testfile for 
+# Source directory: /root/repo/src/examples/hello_world_no_blocking
+# Build directory: /root/repo/_gate_build_tls/src/examples/hello_world_no_blocking
+# 
+# This file includes the relevant testing commands required for 
+# testing this directory and lists subdirectories to be tested as well.
@@ -0,0 +1,11 @@
+file(REMOVE_RECURSE
+  "/root/repo/bin/json_data"
+  "/root/repo/bin/json_data.pdb"
+  "CMakeFiles/json_data.dir/main.cpp.o"
+  "CMakeFiles/json_data.dir/main.cpp.o.d"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang CXX)
+  include(CMakeFiles/json_data.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
@@ -0,0 +1,11 @@
+file(REMOVE_RECURSE
+  "/root/repo/bin/eg_list_endpoints"
+  "/root/repo/bin/eg_list_endpoints.pdb"
+  "CMakeFiles/eg_list_endpoints.dir/main.cpp.o"
+  "CMakeFiles/eg_list_endpoints.dir/main.cpp.o.d"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang CXX)
+  include(CMakeFiles/eg_list_endpoints.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
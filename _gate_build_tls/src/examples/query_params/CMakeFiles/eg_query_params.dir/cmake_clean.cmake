@@ -0,0 +1,11 @@
+file(REMOVE_RECURSE
+  "/root/repo/bin/eg_query_params"
+  "/root/repo/bin/eg_query_params.pdb"
+  "CMakeFiles/eg_query_params.dir/main.cpp.o"
+  "CMakeFiles/eg_query_params.dir/main.cpp.o.d"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang CXX)
+  include(CMakeFiles/eg_query_params.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
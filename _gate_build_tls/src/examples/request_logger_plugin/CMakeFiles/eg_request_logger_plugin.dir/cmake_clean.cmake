@@ -0,0 +1,11 @@
+file(REMOVE_RECURSE
+  "/root/repo/bin/eg_request_logger_plugin"
+  "/root/repo/bin/eg_request_logger_plugin.pdb"
+  "CMakeFiles/eg_request_logger_plugin.dir/main.cpp.o"
+  "CMakeFiles/eg_request_logger_plugin.dir/main.cpp.o.d"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang CXX)
+  include(CMakeFiles/eg_request_logger_plugin.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
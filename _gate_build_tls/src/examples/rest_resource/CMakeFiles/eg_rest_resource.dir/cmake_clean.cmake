@@ -0,0 +1,11 @@
+file(REMOVE_RECURSE
+  "/root/repo/bin/eg_rest_resource"
+  "/root/repo/bin/eg_rest_resource.pdb"
+  "CMakeFiles/eg_rest_resource.dir/main.cpp.o"
+  "CMakeFiles/eg_rest_resource.dir/main.cpp.o.d"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang CXX)
+  include(CMakeFiles/eg_rest_resource.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
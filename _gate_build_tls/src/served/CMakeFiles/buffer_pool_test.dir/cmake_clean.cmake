@@ -0,0 +1,13 @@
+file(REMOVE_RECURSE
+  "/root/repo/bin/buffer_pool_test"
+  "/root/repo/bin/buffer_pool_test.pdb"
+  "CMakeFiles/buffer_pool_test.dir/__/test/catch.cpp.o"
+  "CMakeFiles/buffer_pool_test.dir/__/test/catch.cpp.o.d"
+  "CMakeFiles/buffer_pool_test.dir/net/buffer_pool.test.cpp.o"
+  "CMakeFiles/buffer_pool_test.dir/net/buffer_pool.test.cpp.o.d"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang CXX)
+  include(CMakeFiles/buffer_pool_test.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
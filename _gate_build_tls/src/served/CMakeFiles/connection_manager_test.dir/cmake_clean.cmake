@@ -0,0 +1,13 @@
+file(REMOVE_RECURSE
+  "/root/repo/bin/connection_manager_test"
+  "/root/repo/bin/connection_manager_test.pdb"
+  "CMakeFiles/connection_manager_test.dir/__/test/catch.cpp.o"
+  "CMakeFiles/connection_manager_test.dir/__/test/catch.cpp.o.d"
+  "CMakeFiles/connection_manager_test.dir/net/connection_manager.test.cpp.o"
+  "CMakeFiles/connection_manager_test.dir/net/connection_manager.test.cpp.o.d"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang CXX)
+  include(CMakeFiles/connection_manager_test.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
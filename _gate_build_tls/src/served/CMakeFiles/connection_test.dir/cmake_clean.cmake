@@ -0,0 +1,13 @@
+file(REMOVE_RECURSE
+  "/root/repo/bin/connection_test"
+  "/root/repo/bin/connection_test.pdb"
+  "CMakeFiles/connection_test.dir/__/test/catch.cpp.o"
+  "CMakeFiles/connection_test.dir/__/test/catch.cpp.o.d"
+  "CMakeFiles/connection_test.dir/net/connection.test.cpp.o"
+  "CMakeFiles/connection_test.dir/net/connection.test.cpp.o.d"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang CXX)
+  include(CMakeFiles/connection_test.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
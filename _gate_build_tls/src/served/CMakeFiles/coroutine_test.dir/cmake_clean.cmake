@@ -0,0 +1,13 @@
+file(REMOVE_RECURSE
+  "/root/repo/bin/coroutine_test"
+  "/root/repo/bin/coroutine_test.pdb"
+  "CMakeFiles/coroutine_test.dir/__/test/catch.cpp.o"
+  "CMakeFiles/coroutine_test.dir/__/test/catch.cpp.o.d"
+  "CMakeFiles/coroutine_test.dir/coroutine.test.cpp.o"
+  "CMakeFiles/coroutine_test.dir/coroutine.test.cpp.o.d"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang CXX)
+  include(CMakeFiles/coroutine_test.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
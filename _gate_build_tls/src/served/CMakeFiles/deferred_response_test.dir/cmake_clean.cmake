@@ -0,0 +1,13 @@
+file(REMOVE_RECURSE
+  "/root/repo/bin/deferred_response_test"
+  "/root/repo/bin/deferred_response_test.pdb"
+  "CMakeFiles/deferred_response_test.dir/__/test/catch.cpp.o"
+  "CMakeFiles/deferred_response_test.dir/__/test/catch.cpp.o.d"
+  "CMakeFiles/deferred_response_test.dir/deferred_response.test.cpp.o"
+  "CMakeFiles/deferred_response_test.dir/deferred_response.test.cpp.o.d"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang CXX)
+  include(CMakeFiles/deferred_response_test.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
@@ -0,0 +1,13 @@
+file(REMOVE_RECURSE
+  "/root/repo/bin/file_server_test"
+  "/root/repo/bin/file_server_test.pdb"
+  "CMakeFiles/file_server_test.dir/__/test/catch.cpp.o"
+  "CMakeFiles/file_server_test.dir/__/test/catch.cpp.o.d"
+  "CMakeFiles/file_server_test.dir/plugins/file_server.test.cpp.o"
+  "CMakeFiles/file_server_test.dir/plugins/file_server.test.cpp.o.d"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang CXX)
+  include(CMakeFiles/file_server_test.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
@@ -0,0 +1,13 @@
+file(REMOVE_RECURSE
+  "/root/repo/bin/handler_executor_test"
+  "/root/repo/bin/handler_executor_test.pdb"
+  "CMakeFiles/handler_executor_test.dir/__/test/catch.cpp.o"
+  "CMakeFiles/handler_executor_test.dir/__/test/catch.cpp.o.d"
+  "CMakeFiles/handler_executor_test.dir/handler_executor.test.cpp.o"
+  "CMakeFiles/handler_executor_test.dir/handler_executor.test.cpp.o.d"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang CXX)
+  include(CMakeFiles/handler_executor_test.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
@@ -0,0 +1,13 @@
+file(REMOVE_RECURSE
+  "/root/repo/bin/header_scan_test"
+  "/root/repo/bin/header_scan_test.pdb"
+  "CMakeFiles/header_scan_test.dir/__/test/catch.cpp.o"
+  "CMakeFiles/header_scan_test.dir/__/test/catch.cpp.o.d"
+  "CMakeFiles/header_scan_test.dir/header_scan.test.cpp.o"
+  "CMakeFiles/header_scan_test.dir/header_scan.test.cpp.o.d"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang CXX)
+  include(CMakeFiles/header_scan_test.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
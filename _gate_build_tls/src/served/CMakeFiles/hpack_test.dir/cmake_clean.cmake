@@ -0,0 +1,13 @@
+file(REMOVE_RECURSE
+  "/root/repo/bin/hpack_test"
+  "/root/repo/bin/hpack_test.pdb"
+  "CMakeFiles/hpack_test.dir/__/test/catch.cpp.o"
+  "CMakeFiles/hpack_test.dir/__/test/catch.cpp.o.d"
+  "CMakeFiles/hpack_test.dir/hpack.test.cpp.o"
+  "CMakeFiles/hpack_test.dir/hpack.test.cpp.o.d"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang CXX)
+  include(CMakeFiles/hpack_test.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
@@ -0,0 +1,13 @@
+file(REMOVE_RECURSE
+  "/root/repo/bin/http2_session_test"
+  "/root/repo/bin/http2_session_test.pdb"
+  "CMakeFiles/http2_session_test.dir/__/test/catch.cpp.o"
+  "CMakeFiles/http2_session_test.dir/__/test/catch.cpp.o.d"
+  "CMakeFiles/http2_session_test.dir/net/http2_session.test.cpp.o"
+  "CMakeFiles/http2_session_test.dir/net/http2_session.test.cpp.o.d"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang CXX)
+  include(CMakeFiles/http2_session_test.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
@@ -0,0 +1,13 @@
+file(REMOVE_RECURSE
+  "/root/repo/bin/matchers_test"
+  "/root/repo/bin/matchers_test.pdb"
+  "CMakeFiles/matchers_test.dir/__/test/catch.cpp.o"
+  "CMakeFiles/matchers_test.dir/__/test/catch.cpp.o.d"
+  "CMakeFiles/matchers_test.dir/mux/matchers.test.cpp.o"
+  "CMakeFiles/matchers_test.dir/mux/matchers.test.cpp.o.d"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang CXX)
+  include(CMakeFiles/matchers_test.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
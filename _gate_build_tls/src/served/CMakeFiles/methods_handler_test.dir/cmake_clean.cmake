@@ -0,0 +1,13 @@
+file(REMOVE_RECURSE
+  "/root/repo/bin/methods_handler_test"
+  "/root/repo/bin/methods_handler_test.pdb"
+  "CMakeFiles/methods_handler_test.dir/__/test/catch.cpp.o"
+  "CMakeFiles/methods_handler_test.dir/__/test/catch.cpp.o.d"
+  "CMakeFiles/methods_handler_test.dir/methods_handler.test.cpp.o"
+  "CMakeFiles/methods_handler_test.dir/methods_handler.test.cpp.o.d"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang CXX)
+  include(CMakeFiles/methods_handler_test.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
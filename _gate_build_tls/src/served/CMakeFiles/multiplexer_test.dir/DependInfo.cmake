@@ -0,0 +1,21 @@
+
+# Consider dependencies only in project.
+set(CMAKE_DEPENDS_IN_PROJECT_ONLY OFF)
+
+# The set of languages for which implicit dependencies are needed:
+set(CMAKE_DEPENDS_LANGUAGES
+  )
+
+# The set of dependency files which are needed:
+set(CMAKE_DEPENDS_DEPENDENCY_FILES
+  "/root/repo/src/test/catch.cpp" "src/served/CMakeFiles/multiplexer_test.dir/__/test/catch.cpp.o" "gcc" "src/served/CMakeFiles/multiplexer_test.dir/__/test/catch.cpp.o.d"
+  "/root/repo/src/served/multiplexer.test.cpp" "src/served/CMakeFiles/multiplexer_test.dir/multiplexer.test.cpp.o" "gcc" "src/served/CMakeFiles/multiplexer_test.dir/multiplexer.test.cpp.o.d"
+  )
+
+# Targets to which this target links.
+set(CMAKE_TARGET_LINKED_INFO_FILES
+  "/root/repo/_gate_build_tls/src/served/CMakeFiles/served.dir/DependInfo.cmake"
+  )
+
+# Fortran module output directory.
+set(CMAKE_Fortran_TARGET_MODULE_DIR "")
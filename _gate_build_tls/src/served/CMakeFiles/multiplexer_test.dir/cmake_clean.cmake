@@ -0,0 +1,13 @@
+file(REMOVE_RECURSE
+  "/root/repo/bin/multiplexer_test"
+  "/root/repo/bin/multiplexer_test.pdb"
+  "CMakeFiles/multiplexer_test.dir/__/test/catch.cpp.o"
+  "CMakeFiles/multiplexer_test.dir/__/test/catch.cpp.o.d"
+  "CMakeFiles/multiplexer_test.dir/multiplexer.test.cpp.o"
+  "CMakeFiles/multiplexer_test.dir/multiplexer.test.cpp.o.d"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang CXX)
+  include(CMakeFiles/multiplexer_test.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
@@ -0,0 +1,13 @@
+file(REMOVE_RECURSE
+  "/root/repo/bin/parameters_test"
+  "/root/repo/bin/parameters_test.pdb"
+  "CMakeFiles/parameters_test.dir/__/test/catch.cpp.o"
+  "CMakeFiles/parameters_test.dir/__/test/catch.cpp.o.d"
+  "CMakeFiles/parameters_test.dir/parameters.test.cpp.o"
+  "CMakeFiles/parameters_test.dir/parameters.test.cpp.o.d"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang CXX)
+  include(CMakeFiles/parameters_test.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
@@ -0,0 +1,13 @@
+file(REMOVE_RECURSE
+  "/root/repo/bin/request_error_test"
+  "/root/repo/bin/request_error_test.pdb"
+  "CMakeFiles/request_error_test.dir/__/test/catch.cpp.o"
+  "CMakeFiles/request_error_test.dir/__/test/catch.cpp.o.d"
+  "CMakeFiles/request_error_test.dir/request_error.test.cpp.o"
+  "CMakeFiles/request_error_test.dir/request_error.test.cpp.o.d"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang CXX)
+  include(CMakeFiles/request_error_test.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
@@ -0,0 +1,13 @@
+file(REMOVE_RECURSE
+  "/root/repo/bin/request_parser_impl_test"
+  "/root/repo/bin/request_parser_impl_test.pdb"
+  "CMakeFiles/request_parser_impl_test.dir/__/test/catch.cpp.o"
+  "CMakeFiles/request_parser_impl_test.dir/__/test/catch.cpp.o.d"
+  "CMakeFiles/request_parser_impl_test.dir/request_parser_impl.test.cpp.o"
+  "CMakeFiles/request_parser_impl_test.dir/request_parser_impl.test.cpp.o.d"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang CXX)
+  include(CMakeFiles/request_parser_impl_test.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
@@ -0,0 +1,13 @@
+file(REMOVE_RECURSE
+  "/root/repo/bin/request_test"
+  "/root/repo/bin/request_test.pdb"
+  "CMakeFiles/request_test.dir/__/test/catch.cpp.o"
+  "CMakeFiles/request_test.dir/__/test/catch.cpp.o.d"
+  "CMakeFiles/request_test.dir/request.test.cpp.o"
+  "CMakeFiles/request_test.dir/request.test.cpp.o.d"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang CXX)
+  include(CMakeFiles/request_test.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
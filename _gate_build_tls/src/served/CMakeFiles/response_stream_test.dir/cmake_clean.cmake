@@ -0,0 +1,13 @@
+file(REMOVE_RECURSE
+  "/root/repo/bin/response_stream_test"
+  "/root/repo/bin/response_stream_test.pdb"
+  "CMakeFiles/response_stream_test.dir/__/test/catch.cpp.o"
+  "CMakeFiles/response_stream_test.dir/__/test/catch.cpp.o.d"
+  "CMakeFiles/response_stream_test.dir/response_stream.test.cpp.o"
+  "CMakeFiles/response_stream_test.dir/response_stream.test.cpp.o.d"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang CXX)
+  include(CMakeFiles/response_stream_test.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
@@ -0,0 +1,13 @@
+file(REMOVE_RECURSE
+  "/root/repo/bin/response_test"
+  "/root/repo/bin/response_test.pdb"
+  "CMakeFiles/response_test.dir/__/test/catch.cpp.o"
+  "CMakeFiles/response_test.dir/__/test/catch.cpp.o.d"
+  "CMakeFiles/response_test.dir/response.test.cpp.o"
+  "CMakeFiles/response_test.dir/response.test.cpp.o.d"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang CXX)
+  include(CMakeFiles/response_test.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
@@ -0,0 +1,53 @@
+
+# Consider dependencies only in project.
+set(CMAKE_DEPENDS_IN_PROJECT_ONLY OFF)
+
+# The set of languages for which implicit dependencies are needed:
+set(CMAKE_DEPENDS_LANGUAGES
+  )
+
+# The set of dependency files which are needed:
+set(CMAKE_DEPENDS_DEPENDENCY_FILES
+  "/root/repo/src/served/deferred_response.cpp" "src/served/CMakeFiles/served.dir/deferred_response.cpp.o" "gcc" "src/served/CMakeFiles/served.dir/deferred_response.cpp.o.d"
+  "/root/repo/src/served/handler_executor.cpp" "src/served/CMakeFiles/served.dir/handler_executor.cpp.o" "gcc" "src/served/CMakeFiles/served.dir/handler_executor.cpp.o.d"
+  "/root/repo/src/served/header_scan.cpp" "src/served/CMakeFiles/served.dir/header_scan.cpp.o" "gcc" "src/served/CMakeFiles/served.dir/header_scan.cpp.o.d"
+  "/root/repo/src/served/hpack.cpp" "src/served/CMakeFiles/served.dir/hpack.cpp.o" "gcc" "src/served/CMakeFiles/served.dir/hpack.cpp.o.d"
+  "/root/repo/src/served/methods_handler.cpp" "src/served/CMakeFiles/served.dir/methods_handler.cpp.o" "gcc" "src/served/CMakeFiles/served.dir/methods_handler.cpp.o.d"
+  "/root/repo/src/served/multiplexer.cpp" "src/served/CMakeFiles/served.dir/multiplexer.cpp.o" "gcc" "src/served/CMakeFiles/served.dir/multiplexer.cpp.o.d"
+  "/root/repo/src/served/mux/regex_matcher.cpp" "src/served/CMakeFiles/served.dir/mux/regex_matcher.cpp.o" "gcc" "src/served/CMakeFiles/served.dir/mux/regex_matcher.cpp.o.d"
+  "/root/repo/src/served/mux/static_matcher.cpp" "src/served/CMakeFiles/served.dir/mux/static_matcher.cpp.o" "gcc" "src/served/CMakeFiles/served.dir/mux/static_matcher.cpp.o.d"
+  "/root/repo/src/served/mux/variable_matcher.cpp" "src/served/CMakeFiles/served.dir/mux/variable_matcher.cpp.o" "gcc" "src/served/CMakeFiles/served.dir/mux/variable_matcher.cpp.o.d"
+  "/root/repo/src/served/net/buffer_pool.cpp" "src/served/CMakeFiles/served.dir/net/buffer_pool.cpp.o" "gcc" "src/served/CMakeFiles/served.dir/net/buffer_pool.cpp.o.d"
+  "/root/repo/src/served/net/connection.cpp" "src/served/CMakeFiles/served.dir/net/connection.cpp.o" "gcc" "src/served/CMakeFiles/served.dir/net/connection.cpp.o.d"
+  "/root/repo/src/served/net/connection_manager.cpp" "src/served/CMakeFiles/served.dir/net/connection_manager.cpp.o" "gcc" "src/served/CMakeFiles/served.dir/net/connection_manager.cpp.o.d"
+  "/root/repo/src/served/net/connection_pool.cpp" "src/served/CMakeFiles/served.dir/net/connection_pool.cpp.o" "gcc" "src/served/CMakeFiles/served.dir/net/connection_pool.cpp.o.d"
+  "/root/repo/src/served/net/http2_session.cpp" "src/served/CMakeFiles/served.dir/net/http2_session.cpp.o" "gcc" "src/served/CMakeFiles/served.dir/net/http2_session.cpp.o.d"
+  "/root/repo/src/served/net/server.cpp" "src/served/CMakeFiles/served.dir/net/server.cpp.o" "gcc" "src/served/CMakeFiles/served.dir/net/server.cpp.o.d"
+  "/root/repo/src/served/net/timer_wheel.cpp" "src/served/CMakeFiles/served.dir/net/timer_wheel.cpp.o" "gcc" "src/served/CMakeFiles/served.dir/net/timer_wheel.cpp.o.d"
+  "/root/repo/src/served/net/tls_context.cpp" "src/served/CMakeFiles/served.dir/net/tls_context.cpp.o" "gcc" "src/served/CMakeFiles/served.dir/net/tls_context.cpp.o.d"
+  "/root/repo/src/served/parameters.cpp" "src/served/CMakeFiles/served.dir/parameters.cpp.o" "gcc" "src/served/CMakeFiles/served.dir/parameters.cpp.o.d"
+  "/root/repo/src/served/plugins/access_log.cpp" "src/served/CMakeFiles/served.dir/plugins/access_log.cpp.o" "gcc" "src/served/CMakeFiles/served.dir/plugins/access_log.cpp.o.d"
+  "/root/repo/src/served/plugins/file_server.cpp" "src/served/CMakeFiles/served.dir/plugins/file_server.cpp.o" "gcc" "src/served/CMakeFiles/served.dir/plugins/file_server.cpp.o.d"
+  "/root/repo/src/served/request.cpp" "src/served/CMakeFiles/served.dir/request.cpp.o" "gcc" "src/served/CMakeFiles/served.dir/request.cpp.o.d"
+  "/root/repo/src/served/request_parser.cpp" "src/served/CMakeFiles/served.dir/request_parser.cpp.o" "gcc" "src/served/CMakeFiles/served.dir/request_parser.cpp.o.d"
+  "/root/repo/src/served/request_parser_impl.cpp" "src/served/CMakeFiles/served.dir/request_parser_impl.cpp.o" "gcc" "src/served/CMakeFiles/served.dir/request_parser_impl.cpp.o.d"
+  "/root/repo/src/served/response.cpp" "src/served/CMakeFiles/served.dir/response.cpp.o" "gcc" "src/served/CMakeFiles/served.dir/response.cpp.o.d"
+  "/root/repo/src/served/response_stream.cpp" "src/served/CMakeFiles/served.dir/response_stream.cpp.o" "gcc" "src/served/CMakeFiles/served.dir/response_stream.cpp.o.d"
+  "/root/repo/src/served/sse.cpp" "src/served/CMakeFiles/served.dir/sse.cpp.o" "gcc" "src/served/CMakeFiles/served.dir/sse.cpp.o.d"
+  "/root/repo/src/served/status.cpp" "src/served/CMakeFiles/served.dir/status.cpp.o" "gcc" "src/served/CMakeFiles/served.dir/status.cpp.o.d"
+  "/root/repo/src/served/uri.cpp" "src/served/CMakeFiles/served.dir/uri.cpp.o" "gcc" "src/served/CMakeFiles/served.dir/uri.cpp.o.d"
+  "/root/repo/src/served/websocket.cpp" "src/served/CMakeFiles/served.dir/websocket.cpp.o" "gcc" "src/served/CMakeFiles/served.dir/websocket.cpp.o.d"
+  )
+
+# Pairs of files generated by the same build rule.
+set(CMAKE_MULTIPLE_OUTPUT_PAIRS
+  "/root/repo/lib/libserved.so" "/root/repo/lib/libserved.so.1.4"
+  )
+
+
+# Targets to which this target links.
+set(CMAKE_TARGET_LINKED_INFO_FILES
+  )
+
+# Fortran module output directory.
+set(CMAKE_Fortran_TARGET_MODULE_DIR "")
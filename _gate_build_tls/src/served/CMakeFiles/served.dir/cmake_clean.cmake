@@ -0,0 +1,68 @@
+file(REMOVE_RECURSE
+  "/root/repo/lib/libserved.pdb"
+  "/root/repo/lib/libserved.so"
+  "/root/repo/lib/libserved.so.1.4"
+  "CMakeFiles/served.dir/deferred_response.cpp.o"
+  "CMakeFiles/served.dir/deferred_response.cpp.o.d"
+  "CMakeFiles/served.dir/handler_executor.cpp.o"
+  "CMakeFiles/served.dir/handler_executor.cpp.o.d"
+  "CMakeFiles/served.dir/header_scan.cpp.o"
+  "CMakeFiles/served.dir/header_scan.cpp.o.d"
+  "CMakeFiles/served.dir/hpack.cpp.o"
+  "CMakeFiles/served.dir/hpack.cpp.o.d"
+  "CMakeFiles/served.dir/methods_handler.cpp.o"
+  "CMakeFiles/served.dir/methods_handler.cpp.o.d"
+  "CMakeFiles/served.dir/multiplexer.cpp.o"
+  "CMakeFiles/served.dir/multiplexer.cpp.o.d"
+  "CMakeFiles/served.dir/mux/regex_matcher.cpp.o"
+  "CMakeFiles/served.dir/mux/regex_matcher.cpp.o.d"
+  "CMakeFiles/served.dir/mux/static_matcher.cpp.o"
+  "CMakeFiles/served.dir/mux/static_matcher.cpp.o.d"
+  "CMakeFiles/served.dir/mux/variable_matcher.cpp.o"
+  "CMakeFiles/served.dir/mux/variable_matcher.cpp.o.d"
+  "CMakeFiles/served.dir/net/buffer_pool.cpp.o"
+  "CMakeFiles/served.dir/net/buffer_pool.cpp.o.d"
+  "CMakeFiles/served.dir/net/connection.cpp.o"
+  "CMakeFiles/served.dir/net/connection.cpp.o.d"
+  "CMakeFiles/served.dir/net/connection_manager.cpp.o"
+  "CMakeFiles/served.dir/net/connection_manager.cpp.o.d"
+  "CMakeFiles/served.dir/net/connection_pool.cpp.o"
+  "CMakeFiles/served.dir/net/connection_pool.cpp.o.d"
+  "CMakeFiles/served.dir/net/http2_session.cpp.o"
+  "CMakeFiles/served.dir/net/http2_session.cpp.o.d"
+  "CMakeFiles/served.dir/net/server.cpp.o"
+  "CMakeFiles/served.dir/net/server.cpp.o.d"
+  "CMakeFiles/served.dir/net/timer_wheel.cpp.o"
+  "CMakeFiles/served.dir/net/timer_wheel.cpp.o.d"
+  "CMakeFiles/served.dir/net/tls_context.cpp.o"
+  "CMakeFiles/served.dir/net/tls_context.cpp.o.d"
+  "CMakeFiles/served.dir/parameters.cpp.o"
+  "CMakeFiles/served.dir/parameters.cpp.o.d"
+  "CMakeFiles/served.dir/plugins/access_log.cpp.o"
+  "CMakeFiles/served.dir/plugins/access_log.cpp.o.d"
+  "CMakeFiles/served.dir/plugins/file_server.cpp.o"
+  "CMakeFiles/served.dir/plugins/file_server.cpp.o.d"
+  "CMakeFiles/served.dir/request.cpp.o"
+  "CMakeFiles/served.dir/request.cpp.o.d"
+  "CMakeFiles/served.dir/request_parser.cpp.o"
+  "CMakeFiles/served.dir/request_parser.cpp.o.d"
+  "CMakeFiles/served.dir/request_parser_impl.cpp.o"
+  "CMakeFiles/served.dir/request_parser_impl.cpp.o.d"
+  "CMakeFiles/served.dir/response.cpp.o"
+  "CMakeFiles/served.dir/response.cpp.o.d"
+  "CMakeFiles/served.dir/response_stream.cpp.o"
+  "CMakeFiles/served.dir/response_stream.cpp.o.d"
+  "CMakeFiles/served.dir/sse.cpp.o"
+  "CMakeFiles/served.dir/sse.cpp.o.d"
+  "CMakeFiles/served.dir/status.cpp.o"
+  "CMakeFiles/served.dir/status.cpp.o.d"
+  "CMakeFiles/served.dir/uri.cpp.o"
+  "CMakeFiles/served.dir/uri.cpp.o.d"
+  "CMakeFiles/served.dir/websocket.cpp.o"
+  "CMakeFiles/served.dir/websocket.cpp.o.d"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang CXX)
+  include(CMakeFiles/served.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
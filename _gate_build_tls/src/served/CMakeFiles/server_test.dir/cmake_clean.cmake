@@ -0,0 +1,13 @@
+file(REMOVE_RECURSE
+  "/root/repo/bin/server_test"
+  "/root/repo/bin/server_test.pdb"
+  "CMakeFiles/server_test.dir/__/test/catch.cpp.o"
+  "CMakeFiles/server_test.dir/__/test/catch.cpp.o.d"
+  "CMakeFiles/server_test.dir/net/server.test.cpp.o"
+  "CMakeFiles/server_test.dir/net/server.test.cpp.o.d"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang CXX)
+  include(CMakeFiles/server_test.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
@@ -0,0 +1,13 @@
+file(REMOVE_RECURSE
+  "/root/repo/bin/sse_test"
+  "/root/repo/bin/sse_test.pdb"
+  "CMakeFiles/sse_test.dir/__/test/catch.cpp.o"
+  "CMakeFiles/sse_test.dir/__/test/catch.cpp.o.d"
+  "CMakeFiles/sse_test.dir/sse.test.cpp.o"
+  "CMakeFiles/sse_test.dir/sse.test.cpp.o.d"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang CXX)
+  include(CMakeFiles/sse_test.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
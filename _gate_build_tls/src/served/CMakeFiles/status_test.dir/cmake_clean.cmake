@@ -0,0 +1,13 @@
+file(REMOVE_RECURSE
+  "/root/repo/bin/status_test"
+  "/root/repo/bin/status_test.pdb"
+  "CMakeFiles/status_test.dir/__/test/catch.cpp.o"
+  "CMakeFiles/status_test.dir/__/test/catch.cpp.o.d"
+  "CMakeFiles/status_test.dir/status.test.cpp.o"
+  "CMakeFiles/status_test.dir/status.test.cpp.o.d"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang CXX)
+  include(CMakeFiles/status_test.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
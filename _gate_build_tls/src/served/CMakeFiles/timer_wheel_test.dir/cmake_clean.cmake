@@ -0,0 +1,13 @@
+file(REMOVE_RECURSE
+  "/root/repo/bin/timer_wheel_test"
+  "/root/repo/bin/timer_wheel_test.pdb"
+  "CMakeFiles/timer_wheel_test.dir/__/test/catch.cpp.o"
+  "CMakeFiles/timer_wheel_test.dir/__/test/catch.cpp.o.d"
+  "CMakeFiles/timer_wheel_test.dir/net/timer_wheel.test.cpp.o"
+  "CMakeFiles/timer_wheel_test.dir/net/timer_wheel.test.cpp.o.d"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang CXX)
+  include(CMakeFiles/timer_wheel_test.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
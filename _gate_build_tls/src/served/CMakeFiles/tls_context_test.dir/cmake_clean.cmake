@@ -0,0 +1,13 @@
+file(REMOVE_RECURSE
+  "/root/repo/bin/tls_context_test"
+  "/root/repo/bin/tls_context_test.pdb"
+  "CMakeFiles/tls_context_test.dir/__/test/catch.cpp.o"
+  "CMakeFiles/tls_context_test.dir/__/test/catch.cpp.o.d"
+  "CMakeFiles/tls_context_test.dir/net/tls_context.test.cpp.o"
+  "CMakeFiles/tls_context_test.dir/net/tls_context.test.cpp.o.d"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang CXX)
+  include(CMakeFiles/tls_context_test.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
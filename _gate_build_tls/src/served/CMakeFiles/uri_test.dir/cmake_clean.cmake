@@ -0,0 +1,13 @@
+file(REMOVE_RECURSE
+  "/root/repo/bin/uri_test"
+  "/root/repo/bin/uri_test.pdb"
+  "CMakeFiles/uri_test.dir/__/test/catch.cpp.o"
+  "CMakeFiles/uri_test.dir/__/test/catch.cpp.o.d"
+  "CMakeFiles/uri_test.dir/uri.test.cpp.o"
+  "CMakeFiles/uri_test.dir/uri.test.cpp.o.d"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang CXX)
+  include(CMakeFiles/uri_test.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
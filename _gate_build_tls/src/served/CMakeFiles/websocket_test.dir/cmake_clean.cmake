@@ -0,0 +1,13 @@
+file(REMOVE_RECURSE
+  "/root/repo/bin/websocket_test"
+  "/root/repo/bin/websocket_test.pdb"
+  "CMakeFiles/websocket_test.dir/__/test/catch.cpp.o"
+  "CMakeFiles/websocket_test.dir/__/test/catch.cpp.o.d"
+  "CMakeFiles/websocket_test.dir/websocket.test.cpp.o"
+  "CMakeFiles/websocket_test.dir/websocket.test.cpp.o.d"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang CXX)
+  include(CMakeFiles/websocket_test.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
@@ -0,0 +1,62 @@
+# CMake generated Testfile for 
+# Source directory: /root/repo/src/served
+# Build directory: /root/repo/_gate_build_tls/src/served
+# 
+# This file includes the relevant testing commands required for 
+# testing this directory and lists subdirectories to be tested as well.
+add_test(coroutine_test "/root/repo/bin/coroutine_test")
+set_tests_properties(coroutine_test PROPERTIES  _BACKTRACE_TRIPLES "/root/repo/src/served/CMakeLists.txt;117;ADD_TEST;/root/repo/src/served/CMakeLists.txt;0;")
+add_test(deferred_response_test "/root/repo/bin/deferred_response_test")
+set_tests_properties(deferred_response_test PROPERTIES  _BACKTRACE_TRIPLES "/root/repo/src/served/CMakeLists.txt;117;ADD_TEST;/root/repo/src/served/CMakeLists.txt;0;")
+add_test(handler_executor_test "/root/repo/bin/handler_executor_test")
+set_tests_properties(handler_executor_test PROPERTIES  _BACKTRACE_TRIPLES "/root/repo/src/served/CMakeLists.txt;117;ADD_TEST;/root/repo/src/served/CMakeLists.txt;0;")
+add_test(header_scan_test "/root/repo/bin/header_scan_test")
+set_tests_properties(header_scan_test PROPERTIES  _BACKTRACE_TRIPLES "/root/repo/src/served/CMakeLists.txt;117;ADD_TEST;/root/repo/src/served/CMakeLists.txt;0;")
+add_test(hpack_test "/root/repo/bin/hpack_test")
+set_tests_properties(hpack_test PROPERTIES  _BACKTRACE_TRIPLES "/root/repo/src/served/CMakeLists.txt;117;ADD_TEST;/root/repo/src/served/CMakeLists.txt;0;")
+add_test(methods_handler_test "/root/repo/bin/methods_handler_test")
+set_tests_properties(methods_handler_test PROPERTIES  _BACKTRACE_TRIPLES "/root/repo/src/served/CMakeLists.txt;117;ADD_TEST;/root/repo/src/served/CMakeLists.txt;0;")
+add_test(multiplexer_test "/root/repo/bin/multiplexer_test")
+set_tests_properties(multiplexer_test PROPERTIES  _BACKTRACE_TRIPLES "/root/repo/src/served/CMakeLists.txt;117;ADD_TEST;/root/repo/src/served/CMakeLists.txt;0;")
+add_test(matchers_test "/root/repo/bin/matchers_test")
+set_tests_properties(matchers_test PROPERTIES  _BACKTRACE_TRIPLES "/root/repo/src/served/CMakeLists.txt;117;ADD_TEST;/root/repo/src/served/CMakeLists.txt;0;")
+add_test(buffer_pool_test "/root/repo/bin/buffer_pool_test")
+set_tests_properties(buffer_pool_test PROPERTIES  _BACKTRACE_TRIPLES "/root/repo/src/served/CMakeLists.txt;117;ADD_TEST;/root/repo/src/served/CMakeLists.txt;0;")
+add_test(connection_test "/root/repo/bin/connection_test")
+set_tests_properties(connection_test PROPERTIES  _BACKTRACE_TRIPLES "/root/repo/src/served/CMakeLists.txt;117;ADD_TEST;/root/repo/src/served/CMakeLists.txt;0;")
+add_test(connection_manager_test "/root/repo/bin/connection_manager_test")
+set_tests_properties(connection_manager_test PROPERTIES  _BACKTRACE_TRIPLES "/root/repo/src/served/CMakeLists.txt;117;ADD_TEST;/root/repo/src/served/CMakeLists.txt;0;")
+add_test(connection_pool_test "/root/repo/bin/connection_pool_test")
+set_tests_properties(connection_pool_test PROPERTIES  _BACKTRACE_TRIPLES "/root/repo/src/served/CMakeLists.txt;117;ADD_TEST;/root/repo/src/served/CMakeLists.txt;0;")
+add_test(http2_session_test "/root/repo/bin/http2_session_test")
+set_tests_properties(http2_session_test PROPERTIES  _BACKTRACE_TRIPLES "/root/repo/src/served/CMakeLists.txt;117;ADD_TEST;/root/repo/src/served/CMakeLists.txt;0;")
+add_test(server_test "/root/repo/bin/server_test")
+set_tests_properties(server_test PROPERTIES  _BACKTRACE_TRIPLES "/root/repo/src/served/CMakeLists.txt;117;ADD_TEST;/root/repo/src/served/CMakeLists.txt;0;")
+add_test(timer_wheel_test "/root/repo/bin/timer_wheel_test")
+set_tests_properties(timer_wheel_test PROPERTIES  _BACKTRACE_TRIPLES "/root/repo/src/served/CMakeLists.txt;117;ADD_TEST;/root/repo/src/served/CMakeLists.txt;0;")
+add_test(tls_context_test "/root/repo/bin/tls_context_test")
+set_tests_properties(tls_context_test PROPERTIES  _BACKTRACE_TRIPLES "/root/repo/src/served/CMakeLists.txt;117;ADD_TEST;/root/repo/src/served/CMakeLists.txt;0;")
+add_test(parameters_test "/root/repo/bin/parameters_test")
+set_tests_properties(parameters_test PROPERTIES  _BACKTRACE_TRIPLES "/root/repo/src/served/CMakeLists.txt;117;ADD_TEST;/root/repo/src/served/CMakeLists.txt;0;")
+add_test(file_server_test "/root/repo/bin/file_server_test")
+set_tests_properties(file_server_test PROPERTIES  _BACKTRACE_TRIPLES "/root/repo/src/served/CMakeLists.txt;117;ADD_TEST;/root/repo/src/served/CMakeLists.txt;0;")
+add_test(request_test "/root/repo/bin/request_test")
+set_tests_properties(request_test PROPERTIES  _BACKTRACE_TRIPLES "/root/repo/src/served/CMakeLists.txt;117;ADD_TEST;/root/repo/src/served/CMakeLists.txt;0;")
+add_test(request_error_test "/root/repo/bin/request_error_test")
+set_tests_properties(request_error_test PROPERTIES  _BACKTRACE_TRIPLES "/root/repo/src/served/CMakeLists.txt;117;ADD_TEST;/root/repo/src/served/CMakeLists.txt;0;")
+add_test(request_parser_test "/root/repo/bin/request_parser_test")
+set_tests_properties(request_parser_test PROPERTIES  _BACKTRACE_TRIPLES "/root/repo/src/served/CMakeLists.txt;117;ADD_TEST;/root/repo/src/served/CMakeLists.txt;0;")
+add_test(request_parser_impl_test "/root/repo/bin/request_parser_impl_test")
+set_tests_properties(request_parser_impl_test PROPERTIES  _BACKTRACE_TRIPLES "/root/repo/src/served/CMakeLists.txt;117;ADD_TEST;/root/repo/src/served/CMakeLists.txt;0;")
+add_test(response_test "/root/repo/bin/response_test")
+set_tests_properties(response_test PROPERTIES  _BACKTRACE_TRIPLES "/root/repo/src/served/CMakeLists.txt;117;ADD_TEST;/root/repo/src/served/CMakeLists.txt;0;")
+add_test(response_stream_test "/root/repo/bin/response_stream_test")
+set_tests_properties(response_stream_test PROPERTIES  _BACKTRACE_TRIPLES "/root/repo/src/served/CMakeLists.txt;117;ADD_TEST;/root/repo/src/served/CMakeLists.txt;0;")
+add_test(sse_test "/root/repo/bin/sse_test")
+set_tests_properties(sse_test PROPERTIES  _BACKTRACE_TRIPLES "/root/repo/src/served/CMakeLists.txt;117;ADD_TEST;/root/repo/src/served/CMakeLists.txt;0;")
+add_test(status_test "/root/repo/bin/status_test")
+set_tests_properties(status_test PROPERTIES  _BACKTRACE_TRIPLES "/root/repo/src/served/CMakeLists.txt;117;ADD_TEST;/root/repo/src/served/CMakeLists.txt;0;")
+add_test(uri_test "/root/repo/bin/uri_test")
+set_tests_properties(uri_test PROPERTIES  _BACKTRACE_TRIPLES "/root/repo/src/served/CMakeLists.txt;117;ADD_TEST;/root/repo/src/served/CMakeLists.txt;0;")
+add_test(websocket_test "/root/repo/bin/websocket_test")
+set_tests_properties(websocket_test PROPERTIES  _BACKTRACE_TRIPLES "/root/repo/src/served/CMakeLists.txt;117;ADD_TEST;/root/repo/src/served/CMakeLists.txt;0;")
@@ -0,0 +1,48 @@
+#  ====================================================================
+#  Copyright (C) 2021 QM Ltd.
+#
+#  Permission is hereby granted, free of charge, to any person obtaining a copy
+#  of this software and associated documentation files (the "Software"), to deal
+#  in the Software without restriction, including without limitation the rights
+#  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+#  copies of the Software, and to permit persons to whom the Software is
+#  furnished to do so, subject to the following conditions:
+#
+#  The above copyright notice and this permission notice shall be included in all
+#  copies or substantial portions of the Software.
+#
+#  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+#  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+#  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+#  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+#  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+#  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+#  SOFTWARE.
+#  ====================================================================
+
+include(CheckCXXCompilerFlag)
+
+macro(ENABLE_STDCXX20)
+	CHECK_CXX_COMPILER_FLAG("-std=c++20" COMPILER_SUPPORTS_CXX20)
+	CHECK_CXX_COMPILER_FLAG("-std=c++2a" COMPILER_SUPPORTS_CXX2A)
+	CHECK_CXX_COMPILER_FLAG("-fcoroutines" COMPILER_SUPPORTS_FCOROUTINES)
+	CHECK_CXX_COMPILER_FLAG("-fno-char8_t" COMPILER_SUPPORTS_FNO_CHAR8_T)
+
+	if(COMPILER_SUPPORTS_CXX20)
+		set(CMAKE_CXX_FLAGS "${CMAKE_CXX_FLAGS} -std=c++20")
+	elseif(COMPILER_SUPPORTS_CXX2A)
+		set(CMAKE_CXX_FLAGS "${CMAKE_CXX_FLAGS} -std=c++2a")
+	else()
+		message(FATAL_ERROR "The compiler ${CMAKE_CXX_COMPILER} has no C++20 support, which SERVED_COROUTINES requires.")
+	endif()
+
+	# GCC 10 only enables coroutines when asked to, later versions enable them with C++20.
+	if(COMPILER_SUPPORTS_FCOROUTINES)
+		set(CMAKE_CXX_FLAGS "${CMAKE_CXX_FLAGS} -fcoroutines")
+	endif()
+
+	# The sources are C++11, where u8 string literals are arrays of char.
+	if(COMPILER_SUPPORTS_FNO_CHAR8_T)
+		set(CMAKE_CXX_FLAGS "${CMAKE_CXX_FLAGS} -fno-char8_t")
+	endif()
+endmacro()
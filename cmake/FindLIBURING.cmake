@@ -0,0 +1,50 @@
+# - Find liburing, the userspace library for the Linux io_uring interface
+# The module defines the following variables:
+#
+#  LIBURING_INCLUDE_DIRS - where to find liburing.h
+#  LIBURING_LIBRARIES - the libraries to link against to use liburing
+#  LIBURING_FOUND - true if liburing was found
+#
+#  ====================================================================
+#  Example:
+#
+#   find_package(LIBURING REQUIRED)
+#   include_directories(${LIBURING_INCLUDE_DIRS})
+#   target_link_libraries(Foo ${LIBURING_LIBRARIES})
+#  ====================================================================
+
+#  ====================================================================
+#  Copyright (C) 2021 QM Ltd.
+#
+#  Permission is hereby granted, free of charge, to any person obtaining a copy
+#  of this software and associated documentation files (the "Software"), to deal
+#  in the Software without restriction, including without limitation the rights
+#  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+#  copies of the Software, and to permit persons to whom the Software is
+#  furnished to do so, subject to the following conditions:
+#
+#  The above copyright notice and this permission notice shall be included in all
+#  copies or substantial portions of the Software.
+#
+#  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+#  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+#  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+#  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+#  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+#  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+#  SOFTWARE.
+#  ====================================================================
+
+find_path(LIBURING_INCLUDE_DIR NAMES liburing.h DOC "path to the liburing headers")
+find_library(LIBURING_LIBRARY NAMES uring DOC "path to the liburing library")
+mark_as_advanced(LIBURING_INCLUDE_DIR LIBURING_LIBRARY)
+
+include(FindPackageHandleStandardArgs)
+FIND_PACKAGE_HANDLE_STANDARD_ARGS(LIBURING REQUIRED_VARS LIBURING_LIBRARY LIBURING_INCLUDE_DIR)
+
+if(LIBURING_FOUND)
+  set(LIBURING_INCLUDE_DIRS ${LIBURING_INCLUDE_DIR})
+  set(LIBURING_LIBRARIES ${LIBURING_LIBRARY})
+endif()
+
+# FindLIBURING.cmake ends here
@@ -0,0 +1,159 @@
+/*
+ * Copyright (C) 2021 QM Ltd.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <served/served.hpp>
+
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+/* http_throughput benchmark
+ *
+ * Measures requests per second over persistent, pipelined loopback connections. Build the
+ * library once with and once without SERVED_IO_URING and run both to compare the io_uring and
+ * epoll backends.
+ *
+ * usage: bench_http_throughput [connections] [seconds] [server threads] [pipeline depth]
+ */
+namespace {
+
+const char * backend_name()
+{
+#if defined(BOOST_ASIO_HAS_IO_URING) && defined(BOOST_ASIO_DISABLE_EPOLL)
+	return "io_uring";
+#elif defined(BOOST_ASIO_HAS_EPOLL)
+	return "epoll";
+#else
+	return "select/kqueue";
+#endif
+}
+
+int arg_or(int argc, char const** argv, int index, int fallback)
+{
+	return argc > index ? std::atoi(argv[index]) : fallback;
+}
+
+} // anonymous namespace
+
+int main(int argc, char const** argv)
+{
+	const int n_connections  = arg_or(argc, argv, 1, 64);
+	const int n_seconds      = arg_or(argc, argv, 2, 5);
+	const int n_threads      = arg_or(argc, argv, 3, 4);
+	const int pipeline_depth = arg_or(argc, argv, 4, 1);
+	const std::string port   = "8124";
+
+	served::multiplexer mux;
+	mux.handle("/hello")
+		.get([](served::response & res, const served::request &) {
+			res << "Hello world";
+		});
+
+	served::net::server server("127.0.0.1", port, mux, false);
+	std::thread server_thread([&]() { server.run(n_threads); });
+
+	std::string request;
+	for ( int i = 0; i < pipeline_depth; i++ )
+	{
+		request += "GET /hello HTTP/1.1\r\nHost: localhost\r\n\r\n";
+	}
+
+	std::atomic<bool>     running(true);
+	std::atomic<uint64_t> completed(0);
+	std::vector<std::thread> clients;
+
+	for ( int c = 0; c < n_connections; c++ )
+	{
+		clients.push_back(std::thread([&]() {
+			boost::asio::io_service io_service;
+			boost::asio::ip::tcp::socket socket(io_service);
+			boost::system::error_code ec;
+
+			// The server may still be starting, retry until it accepts.
+			for ( int i = 0; i < 100; i++ )
+			{
+				socket.connect(boost::asio::ip::tcp::endpoint(
+					boost::asio::ip::address::from_string("127.0.0.1"), std::stoi(port)), ec);
+				if ( !ec )
+				{
+					break;
+				}
+				socket.close();
+				std::this_thread::sleep_for(std::chrono::milliseconds(10));
+			}
+			if ( ec )
+			{
+				return;
+			}
+			socket.set_option(boost::asio::ip::tcp::no_delay(true));
+
+			// Every response is identical, so measure one and then read whole batches.
+			boost::asio::streambuf buf;
+			boost::asio::write(socket, boost::asio::buffer(request.data(), request.length() / pipeline_depth));
+			size_t header_len = boost::asio::read_until(socket, buf, "\r\n\r\n");
+			const size_t response_len = header_len + std::string("Hello world").length();
+			boost::asio::read(socket, buf, boost::asio::transfer_exactly(response_len - buf.size()));
+
+			std::vector<char> batch(response_len * pipeline_depth);
+
+			while ( running )
+			{
+				boost::asio::write(socket, boost::asio::buffer(request), ec);
+				if ( !ec )
+				{
+					boost::asio::read(socket, boost::asio::buffer(batch), ec);
+				}
+				if ( ec )
+				{
+					return;
+				}
+				completed += pipeline_depth;
+			}
+		}));
+	}
+
+	auto start = std::chrono::steady_clock::now();
+	std::this_thread::sleep_for(std::chrono::seconds(n_seconds));
+	running = false;
+
+	for ( auto & client : clients )
+	{
+		client.join();
+	}
+	auto elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+	server.stop();
+	server_thread.join();
+
+	std::cout << "backend:        " << backend_name()                 << std::endl;
+	std::cout << "connections:    " << n_connections                  << std::endl;
+	std::cout << "server threads: " << n_threads                      << std::endl;
+	std::cout << "pipeline depth: " << pipeline_depth                 << std::endl;
+	std::cout << "requests:       " << completed                      << std::endl;
+	std::cout << "requests/sec:   " << ( completed / elapsed )        << std::endl;
+
+	return 0;
+}
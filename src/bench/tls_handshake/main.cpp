@@ -0,0 +1,259 @@
+/*
+ * Copyright (C) 2021 QM Ltd.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+#include <served/served.hpp>
+#include <served/net/tls_context.hpp>
+
+#include <boost/asio/ssl.hpp>
+#include <openssl/pem.h>
+#include <openssl/rsa.h>
+#include <openssl/x509.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+/* tls_handshake benchmark
+ *
+ * Measures TLS handshakes per second over loopback, first with a full handshake for every
+ * connection and then with every connection resuming the session of the previous one. Each
+ * connection sends one request before closing, so that TLS 1.3 session tickets are received.
+ * A self-signed RSA 2048 certificate is generated for the run.
+ *
+ * usage: bench_tls_handshake [client threads] [seconds per mode] [server threads]
+ */
+namespace {
+
+int arg_or(int argc, char const** argv, int index, int fallback)
+{
+	return argc > index ? std::atoi(argv[index]) : fallback;
+}
+
+/*
+ * Writes a PEM file in the temporary directory, removed when destroyed.
+ */
+struct pem_file
+{
+	std::string path;
+
+	template <typename Writer>
+	explicit pem_file(Writer write)
+	{
+		char name[] = "/tmp/bench_tls_XXXXXX";
+		int fd = ::mkstemp(name);
+		FILE * f = fd < 0 ? nullptr : ::fdopen(fd, "w");
+		if ( ! f || ! write(f) )
+		{
+			throw std::runtime_error("failed to write PEM file");
+		}
+		::fclose(f);
+		path = name;
+	}
+
+	~pem_file()
+	{
+		std::remove(path.c_str());
+	}
+};
+
+/*
+ * Generates a key and a self-signed certificate for localhost.
+ */
+void generate_certificate(std::unique_ptr<pem_file> & cert, std::unique_ptr<pem_file> & key)
+{
+	EVP_PKEY *     pkey = nullptr;
+	EVP_PKEY_CTX * kctx = EVP_PKEY_CTX_new_id(EVP_PKEY_RSA, nullptr);
+	if ( ! kctx || EVP_PKEY_keygen_init(kctx) <= 0 || EVP_PKEY_CTX_set_rsa_keygen_bits(kctx, 2048) <= 0
+	  || EVP_PKEY_keygen(kctx, &pkey) <= 0 )
+	{
+		throw std::runtime_error("failed to generate key");
+	}
+	EVP_PKEY_CTX_free(kctx);
+
+	X509 * x509 = X509_new();
+	ASN1_INTEGER_set(X509_get_serialNumber(x509), 1);
+	X509_gmtime_adj(X509_getm_notBefore(x509), 0);
+	X509_gmtime_adj(X509_getm_notAfter(x509), 24 * 60 * 60);
+	X509_set_pubkey(x509, pkey);
+	X509_NAME * name = X509_get_subject_name(x509);
+	X509_NAME_add_entry_by_txt(name, "CN", MBSTRING_ASC, reinterpret_cast<const unsigned char *>("localhost"), -1, -1, 0);
+	X509_set_issuer_name(x509, name);
+	X509_sign(x509, pkey, EVP_sha256());
+
+	cert.reset(new pem_file([x509](FILE * f) { return PEM_write_X509(f, x509) == 1; }));
+	key.reset(new pem_file([pkey](FILE * f) {
+		return PEM_write_PrivateKey(f, pkey, nullptr, nullptr, 0, nullptr, nullptr) == 1;
+	}));
+
+	X509_free(x509);
+	EVP_PKEY_free(pkey);
+}
+
+struct result
+{
+	uint64_t handshakes = 0;
+	uint64_t resumed    = 0;
+	double   elapsed    = 0;
+};
+
+/*
+ * Opens connections from every client thread until the time is up.
+ */
+result run_clients(int n_clients, int n_seconds, int port, bool resume)
+{
+	std::atomic<bool>     running(true);
+	std::atomic<uint64_t> handshakes(0);
+	std::atomic<uint64_t> resumed(0);
+	std::vector<std::thread> clients;
+
+	const std::string request = "GET /hello HTTP/1.1\r\nHost: localhost\r\nConnection: close\r\n\r\n";
+	const auto endpoint = boost::asio::ip::tcp::endpoint(boost::asio::ip::address::from_string("127.0.0.1"), port);
+
+	for ( int c = 0; c < n_clients; c++ )
+	{
+		clients.push_back(std::thread([&]() {
+			boost::asio::io_service   io_service;
+			boost::asio::ssl::context context(boost::asio::ssl::context::tls_client);
+			SSL_SESSION *             session = nullptr;
+
+			while ( running )
+			{
+				boost::asio::ssl::stream<boost::asio::ip::tcp::socket> stream(io_service, context);
+				boost::system::error_code ec;
+
+				stream.lowest_layer().connect(endpoint, ec);
+				if ( ec )
+				{
+					return;
+				}
+				if ( session )
+				{
+					SSL_set_session(stream.native_handle(), session);
+				}
+				stream.handshake(boost::asio::ssl::stream_base::client, ec);
+				if ( !ec )
+				{
+					boost::asio::write(stream, boost::asio::buffer(request), ec);
+				}
+				std::string response;
+				boost::asio::read(stream, boost::asio::dynamic_buffer(response), ec);
+				if ( response.compare(0, 12, "HTTP/1.1 200") != 0 )
+				{
+					return;
+				}
+
+				handshakes++;
+				if ( SSL_session_reused(stream.native_handle()) )
+				{
+					resumed++;
+				}
+
+				if ( resume )
+				{
+					// Each connection resumes with the most recent ticket, as browsers do.
+					SSL_SESSION_free(session);
+					session = SSL_get1_session(stream.native_handle());
+				}
+
+				// The server closes without a close_notify, which would mark the session unusable.
+				SSL_set_shutdown(stream.native_handle(), SSL_SENT_SHUTDOWN | SSL_RECEIVED_SHUTDOWN);
+			}
+			SSL_SESSION_free(session);
+		}));
+	}
+
+	auto start = std::chrono::steady_clock::now();
+	std::this_thread::sleep_for(std::chrono::seconds(n_seconds));
+	running = false;
+
+	for ( auto & client : clients )
+	{
+		client.join();
+	}
+
+	result r;
+	r.handshakes = handshakes;
+	r.resumed    = resumed;
+	r.elapsed    = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	return r;
+}
+
+void print_result(const std::string & mode, const result & r)
+{
+	std::cout << std::left << std::setw(24) << ( mode + " handshakes:" )     << r.handshakes                << std::endl;
+	std::cout << std::left << std::setw(24) << ( mode + " resumed:" )        << r.resumed                   << std::endl;
+	std::cout << std::left << std::setw(24) << ( mode + " handshakes/sec:" ) << ( r.handshakes / r.elapsed ) << std::endl;
+}
+
+} // anonymous namespace
+
+int main(int argc, char const** argv)
+{
+	const int n_clients = arg_or(argc, argv, 1, 4);
+	const int n_seconds = arg_or(argc, argv, 2, 5);
+	const int n_threads = arg_or(argc, argv, 3, 4);
+	const int port      = 8125;
+
+	std::unique_ptr<pem_file> cert, key;
+	generate_certificate(cert, key);
+
+	served::multiplexer mux;
+	mux.handle("/hello")
+		.get([](served::response & res, const served::request &) {
+			res << "Hello world";
+		});
+
+	served::net::server server("127.0.0.1", std::to_string(port), mux, false);
+	server.set_tls_context(std::make_shared<served::net::tls_context>(cert->path, key->path));
+	std::thread server_thread([&]() { server.run(n_threads); });
+
+	// Give the server a moment to start accepting.
+	std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+	result full    = run_clients(n_clients, n_seconds, port, false);
+	result resumed = run_clients(n_clients, n_seconds, port, true);
+
+	server.stop();
+	server_thread.join();
+
+	std::cout << "client threads:         " << n_clients << std::endl;
+	std::cout << "server threads:         " << n_threads << std::endl;
+	print_result("full", full);
+	print_result("resumed", resumed);
+	if ( full.handshakes > 0 )
+	{
+		std::cout << "speedup:                "
+		          << ( ( resumed.handshakes / resumed.elapsed ) / ( full.handshakes / full.elapsed ) ) << "x" << std::endl;
+	}
+
+	return 0;
+}
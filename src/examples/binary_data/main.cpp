@@ -23,33 +23,24 @@
 #include <served/served.hpp>
 #include <served/plugins.hpp>
 
-#include <fstream>
-#include <sstream>
-
 /* binary_data example
  *
- * This example is a quick demo of sending a binary file over HTTP. Notice that you do not have to
- * explicitly set the Content-Length header because if this value is omitted then served calculates
- * it for you based on the response length.
+ * This example is a quick demo of sending binary files over HTTP. The file_server plugin serves
+ * the files of a directory, sending each straight from the file to the socket without reading it
+ * into memory. The Content-Length and Content-Type headers are set for you.
  */
 int main(int, char const**)
 {
 	served::multiplexer mux;
 	mux.use_after(served::plugin::access_log);
 
-	const std::string image_name("served-logo.png");
+	auto files = served::plugin::file_server(".", "/static");
 
-	mux.handle("/picture")
-		.get([&](served::response & res, const served::request &) {
-			std::ifstream ifs(image_name);
-			res.set_body(std::string(
-				(std::istreambuf_iterator<char>(ifs) ),
-				(std::istreambuf_iterator<char>()    )
-			));
-			res.set_header("content-type", "image/png");
-		});
+	mux.handle("/static")
+		.get(files)
+		.head(files);
 
-	std::cout << "Try this example by opening http://localhost:8123/picture in a browser" << std::endl;
+	std::cout << "Try this example by opening http://localhost:8123/static/served-logo.png in a browser" << std::endl;
 
 	served::net::server server("0.0.0.0", "8123", mux);
 	server.run(10);
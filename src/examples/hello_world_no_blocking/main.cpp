@@ -51,7 +51,7 @@ int main(int, char const**)
 	}
 
 	std::cout << "Time to stop the server" << std::endl;
-	server.stop();
+	server.drain(5000); // Finish requests in progress for up to 5 seconds, then join the threads
 
 	return 0;
 }
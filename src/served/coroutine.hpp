@@ -0,0 +1,105 @@
+/*
+ * Copyright (C) 2021 QM Ltd.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef SERVED_COROUTINE_HPP
+#define SERVED_COROUTINE_HPP
+
+#include <served/deferred_response.hpp>
+#include <served/methods_handler.hpp>
+#include <served/net/connection.hpp>
+
+#include <boost/asio/awaitable.hpp>
+#include <boost/asio/co_spawn.hpp>
+#include <boost/asio/use_awaitable.hpp>
+
+#include <functional>
+#include <stdexcept>
+
+#if ! defined(BOOST_ASIO_HAS_CO_AWAIT)
+#error "served/coroutine.hpp requires C++20 coroutines, configure served with SERVED_COROUTINES"
+#endif
+
+namespace served {
+
+/*
+ * The result of a coroutine handler, an awaitable run on the io_service of the connection.
+ *
+ * Within a handler, co_await boost::asio::this_coro::executor gives the executor of that
+ * io_service, which timers and sockets can be created on. Asynchronous operations are awaited
+ * with boost::asio::use_awaitable as their completion token.
+ */
+template <typename T = void>
+using task = boost::asio::awaitable<T>;
+
+typedef std::function<task<void>(response &, const request &)> served_co_req_handler;
+
+/*
+ * Adapts a coroutine request handler for registering as an asynchronous handler.
+ *
+ * For example:
+ *
+ *   mux.handle("/wait").get_async(served::co_handler(
+ *       [](served::response & res, const served::request &) -> served::task<void> {
+ *           boost::asio::steady_timer timer(co_await boost::asio::this_coro::executor);
+ *           timer.expires_after(std::chrono::seconds(1));
+ *           co_await timer.async_wait(boost::asio::use_awaitable);
+ *           res << "waited";
+ *       }));
+ *
+ * The coroutine is started on the I/O thread of the connection and the response is written once
+ * it returns. An exception escaping the coroutine fails the request like one thrown from any
+ * other handler. Coroutine handlers cannot be used on endpoints with an executor.
+ *
+ * @param handler the coroutine handler
+ *
+ * @return a handler for methods_handler::get_async and the related methods
+ */
+inline served_async_req_handler
+co_handler(served_co_req_handler handler)
+{
+	return [handler](response & res, const request & req, deferred_response deferred) {
+		auto io_service = net::connection::current_io_service();
+		if ( ! io_service )
+		{
+			throw std::logic_error("Coroutine handlers must be called from an I/O thread");
+		}
+
+		boost::asio::co_spawn(*io_service,
+			[handler, &res, &req]() {
+				return handler(res, req);
+			},
+			[deferred](std::exception_ptr error) mutable {
+				if ( error )
+				{
+					deferred.fail(error);
+				}
+				else
+				{
+					deferred.complete();
+				}
+			});
+	};
+}
+
+} // served
+
+#endif // SERVED_COROUTINE_HPP
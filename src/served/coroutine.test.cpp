@@ -0,0 +1,95 @@
+/*
+ * Copyright (C) 2021 QM Ltd.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <test/catch.hpp>
+
+#include <utility>
+#include <boost/asio/detail/config.hpp>
+
+// Coroutine handlers are only available when served is configured with SERVED_COROUTINES.
+#if defined(BOOST_ASIO_HAS_CO_AWAIT)
+
+#include <served/coroutine.hpp>
+#include <served/net/server.hpp>
+#include <served/request_error.hpp>
+
+#include <boost/asio/steady_timer.hpp>
+#include <chrono>
+#include <thread>
+
+TEST_CASE("coroutine handlers", "[coroutine]")
+{
+	served::multiplexer mux;
+	mux.handle("/wait")
+		.get_async(served::co_handler([](served::response & res, const served::request &) -> served::task<void> {
+			boost::asio::steady_timer timer(co_await boost::asio::this_coro::executor);
+			timer.expires_after(std::chrono::milliseconds(50));
+			co_await timer.async_wait(boost::asio::use_awaitable);
+			res << "waited";
+		}));
+	mux.handle("/fail")
+		.get_async(served::co_handler([](served::response &, const served::request &) -> served::task<void> {
+			co_await boost::asio::post(co_await boost::asio::this_coro::executor, boost::asio::use_awaitable);
+			throw served::request_error(503, "Unavailable");
+		}));
+	mux.handle("/hello")
+		.get([](served::response & res, const served::request &) {
+			res << "hello";
+		});
+
+	served::net::server server("127.0.0.1", "42814", mux, false);
+	std::thread server_thread([&]() { server.run(); });
+
+	boost::asio::io_service io_service;
+	auto endpoint = boost::asio::ip::tcp::endpoint(boost::asio::ip::address::from_string("127.0.0.1"), 42814);
+	boost::asio::ip::tcp::socket wait_socket(io_service);
+	boost::asio::ip::tcp::socket other_socket(io_service);
+	wait_socket.connect(endpoint);
+	other_socket.connect(endpoint);
+
+	boost::asio::write(wait_socket, boost::asio::buffer(std::string("GET /wait HTTP/1.1\r\nConnection: close\r\n\r\n")));
+
+	// The single I/O thread keeps serving while the coroutine is suspended.
+	boost::asio::write(other_socket, boost::asio::buffer(std::string("GET /hello HTTP/1.1\r\nConnection: close\r\n\r\n")));
+	std::string hello, waited;
+	boost::system::error_code ec;
+	boost::asio::read(other_socket, boost::asio::dynamic_buffer(hello), ec);
+	CHECK(hello.find("HTTP/1.1 200") == 0);
+	CHECK(hello.substr(hello.length() - 5) == "hello");
+
+	boost::asio::read(wait_socket, boost::asio::dynamic_buffer(waited), ec);
+	CHECK(waited.find("HTTP/1.1 200") == 0);
+	CHECK(waited.substr(waited.length() - 6) == "waited");
+
+	// An exception escaping the coroutine fails the request.
+	boost::asio::ip::tcp::socket fail_socket(io_service);
+	fail_socket.connect(endpoint);
+	boost::asio::write(fail_socket, boost::asio::buffer(std::string("GET /fail HTTP/1.1\r\nConnection: close\r\n\r\n")));
+	std::string failed;
+	boost::asio::read(fail_socket, boost::asio::dynamic_buffer(failed), ec);
+	CHECK(failed.find("HTTP/1.1 503") == 0);
+
+	server.stop();
+	server_thread.join();
+}
+
+#endif // BOOST_ASIO_HAS_CO_AWAIT
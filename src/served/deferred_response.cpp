@@ -0,0 +1,87 @@
+/*
+ * Copyright (C) 2021 QM Ltd.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <served/deferred_response.hpp>
+
+#include <atomic>
+#include <stdexcept>
+
+using namespace served;
+
+struct deferred_response::state
+{
+	served_handler_completion done;
+	std::atomic<bool>         completed;
+
+	explicit state(served_handler_completion done)
+		: done(std::move(done))
+		, completed(false)
+	{
+	}
+
+	~state()
+	{
+		if ( ! completed )
+		{
+			// Abandoned by the handler, report an error rather than leaving the client waiting.
+			done(std::make_exception_ptr(std::runtime_error("Deferred response was never completed")));
+		}
+	}
+
+	void finish(std::exception_ptr error)
+	{
+		if ( ! completed.exchange(true) )
+		{
+			// Copies of the deferred response may outlive the request, so release whatever the
+			// completion holds on to.
+			auto callback = std::move(done);
+			callback(error);
+		}
+	}
+};
+
+//  -----  constructors  -----
+
+deferred_response::deferred_response(served_handler_completion done)
+	: _state(std::make_shared<state>(std::move(done)))
+{
+}
+
+//  -----  completion  -----
+
+void
+deferred_response::complete()
+{
+	_state->finish(nullptr);
+}
+
+void
+deferred_response::fail(std::exception_ptr error)
+{
+	_state->finish(error ? error : std::make_exception_ptr(std::runtime_error("Request failed")));
+}
+
+bool
+deferred_response::completed() const
+{
+	return _state->completed;
+}
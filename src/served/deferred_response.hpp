@@ -0,0 +1,92 @@
+/*
+ * Copyright (C) 2021 QM Ltd.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef SERVED_DEFERRED_RESPONSE_HPP
+#define SERVED_DEFERRED_RESPONSE_HPP
+
+#include <exception>
+#include <functional>
+#include <memory>
+
+namespace served {
+
+typedef std::function<void(std::exception_ptr)> served_handler_completion;
+
+/*
+ * A handle used by an asynchronous request handler to finish its response later.
+ *
+ * An asynchronous handler receives a deferred response alongside the response and request
+ * objects. It may return straight away, keep a copy of the deferred response along with a
+ * reference to the response object, and call complete once the response is ready. complete may
+ * be called from any thread, and the connection then writes the response from its I/O thread.
+ *
+ * The response and request objects remain valid, and the connection stays open, until the
+ * response is completed. The response must not be modified after calling complete.
+ *
+ * Only the first call to complete or fail has any effect. If every copy of a deferred response is
+ * destroyed before either is called, the client receives 500 Internal Server Error. Outstanding
+ * deferred responses must be completed or destroyed before the server is destroyed.
+ */
+class deferred_response
+{
+	struct state;
+
+	std::shared_ptr<state> _state;
+
+public:
+	//  -----  constructors  -----
+
+	/*
+	 * Constructs a deferred response.
+	 *
+	 * @param done called once, when the response is completed or abandoned
+	 */
+	explicit deferred_response(served_handler_completion done);
+
+	//  -----  completion  -----
+
+	/*
+	 * Marks the response as ready to be written to the client.
+	 */
+	void complete();
+
+	/*
+	 * Completes the response with an error instead of its current contents.
+	 *
+	 * A served::request_error sets the status and body sent to the client, any other exception
+	 * results in 500 Internal Server Error.
+	 *
+	 * @param error the error the request failed with
+	 */
+	void fail(std::exception_ptr error);
+
+	/*
+	 * Indicates whether complete or fail has been called.
+	 *
+	 * @return true if the response is completed
+	 */
+	bool completed() const;
+};
+
+} // served
+
+#endif // SERVED_DEFERRED_RESPONSE_HPP
@@ -0,0 +1,93 @@
+/*
+ * Copyright (C) 2021 QM Ltd.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <test/catch.hpp>
+
+#include <served/deferred_response.hpp>
+#include <served/request_error.hpp>
+
+#include <thread>
+
+TEST_CASE("deferred response completion", "[deferred_response]")
+{
+	int                calls = 0;
+	std::exception_ptr result;
+	auto done = [&](std::exception_ptr error) {
+		calls++;
+		result = error;
+	};
+
+	SECTION("completes once")
+	{
+		served::deferred_response deferred(done);
+		CHECK_FALSE(deferred.completed());
+
+		auto copy = deferred;
+		copy.complete();
+		deferred.complete();
+		deferred.fail(std::make_exception_ptr(std::runtime_error("late")));
+
+		CHECK(deferred.completed());
+		CHECK(calls == 1);
+		CHECK_FALSE(result);
+	}
+
+	SECTION("completes from another thread")
+	{
+		served::deferred_response deferred(done);
+		std::thread([deferred]() mutable { deferred.complete(); }).join();
+
+		CHECK(calls == 1);
+		CHECK_FALSE(result);
+	}
+
+	SECTION("fails with an error")
+	{
+		{
+			served::deferred_response deferred(done);
+			deferred.fail(std::make_exception_ptr(served::request_error(502, "Bad gateway")));
+		}
+
+		CHECK(calls == 1);
+		int status = 0;
+		try
+		{
+			std::rethrow_exception(result);
+		}
+		catch (const served::request_error & e)
+		{
+			status = e.get_status_code();
+		}
+		CHECK(status == 502);
+	}
+
+	SECTION("abandoned responses fail")
+	{
+		{
+			served::deferred_response deferred(done);
+			auto copy = deferred;
+		}
+
+		CHECK(calls == 1);
+		CHECK(result);
+	}
+}
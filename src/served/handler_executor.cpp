@@ -0,0 +1,199 @@
+/*
+ * Copyright (C) 2021 QM Ltd.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <served/handler_executor.hpp>
+
+#include <algorithm>
+
+using namespace served;
+
+namespace {
+
+// The executor and queue of the calling worker thread, so that tasks submitted by a handler are
+// queued for the same worker.
+thread_local const handler_executor * current_executor = nullptr;
+thread_local size_t                   current_queue    = 0;
+
+} // anonymous namespace
+
+handler_executor::handler_executor(size_t n_threads /* = 0 */, size_t queue_capacity /* = 1024 */)
+	: _queue_capacity(queue_capacity > 0 ? queue_capacity : 1)
+	, _queues()
+	, _threads()
+	, _next_queue(0)
+	, _pending(0)
+	, _stopping(false)
+	, _sleep_mutex()
+	, _wake()
+{
+	if ( n_threads == 0 )
+	{
+		n_threads = std::max(std::thread::hardware_concurrency(), 1u);
+	}
+
+	for ( size_t i = 0; i < n_threads; i++ )
+	{
+		_queues.push_back(std::unique_ptr<worker_queue>(new worker_queue()));
+	}
+	for ( size_t i = 0; i < n_threads; i++ )
+	{
+		_threads.push_back(std::thread([this, i]() {
+			run_worker(i);
+		}));
+	}
+}
+
+handler_executor::~handler_executor()
+{
+	stop();
+}
+
+bool
+handler_executor::submit(std::function<void()> task)
+{
+	if ( _stopping )
+	{
+		return false;
+	}
+
+	const size_t n_queues = _queues.size();
+	const size_t first    = current_executor == this ? current_queue : _next_queue++ % n_queues;
+
+	for ( size_t i = 0; i < n_queues; i++ )
+	{
+		if ( push_task((first + i) % n_queues, task) )
+		{
+			// Taking the sleep mutex ensures a worker about to sleep sees the new task.
+			{
+				std::lock_guard<std::mutex> lock(_sleep_mutex);
+			}
+			_wake.notify_one();
+			return true;
+		}
+	}
+	return false;
+}
+
+void
+handler_executor::stop()
+{
+	{
+		std::lock_guard<std::mutex> lock(_sleep_mutex);
+		_stopping = true;
+	}
+	_wake.notify_all();
+
+	for ( auto & thread : _threads )
+	{
+		if ( thread.joinable() )
+		{
+			thread.join();
+		}
+	}
+	_threads.clear();
+}
+
+size_t
+handler_executor::pending() const
+{
+	return _pending;
+}
+
+size_t
+handler_executor::size() const
+{
+	return _queues.size();
+}
+
+void
+handler_executor::run_worker(size_t index)
+{
+	current_executor = this;
+	current_queue    = index;
+
+	std::function<void()> task;
+	for (;;)
+	{
+		if ( take_task(index, task) )
+		{
+			task();
+			task = nullptr;
+			continue;
+		}
+
+		std::unique_lock<std::mutex> lock(_sleep_mutex);
+		if ( _pending == 0 )
+		{
+			if ( _stopping )
+			{
+				return;
+			}
+			_wake.wait(lock, [this]() { return _pending > 0 || _stopping; });
+		}
+	}
+}
+
+bool
+handler_executor::take_task(size_t index, std::function<void()> & task)
+{
+	const size_t n_queues = _queues.size();
+
+	// Own tasks are taken from the front, tasks stolen from other workers from the back.
+	for ( size_t i = 0; i < n_queues; i++ )
+	{
+		worker_queue & q = *_queues[(index + i) % n_queues];
+
+		std::lock_guard<std::mutex> lock(q.mutex);
+		if ( q.tasks.empty() )
+		{
+			continue;
+		}
+		if ( i == 0 )
+		{
+			task = std::move(q.tasks.front());
+			q.tasks.pop_front();
+		}
+		else
+		{
+			task = std::move(q.tasks.back());
+			q.tasks.pop_back();
+		}
+		_pending--;
+		return true;
+	}
+	return false;
+}
+
+bool
+handler_executor::push_task(size_t index, std::function<void()> & task)
+{
+	worker_queue & q = *_queues[index];
+
+	std::lock_guard<std::mutex> lock(q.mutex);
+	if ( q.tasks.size() >= _queue_capacity )
+	{
+		return false;
+	}
+	q.tasks.push_back(std::move(task));
+	_pending++;
+	return true;
+}
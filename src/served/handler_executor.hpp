@@ -0,0 +1,122 @@
+/*
+ * Copyright (C) 2021 QM Ltd.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef SERVED_HANDLER_EXECUTOR_HPP
+#define SERVED_HANDLER_EXECUTOR_HPP
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace served {
+
+/*
+ * A thread pool for running request handlers away from the I/O threads.
+ *
+ * Routes registered with an executor have their handlers run on the pool, so that slow handlers
+ * do not hold up the other connections of an I/O thread. Each worker has a bounded queue of
+ * tasks. Tasks are submitted to the queues in turn, and a worker with an empty queue steals
+ * from the back of the others before sleeping.
+ *
+ * Submitting fails once every queue is full, which the server answers with 503 Service
+ * Unavailable. Queued tasks are still run when the executor is stopped.
+ */
+class handler_executor
+{
+	struct worker_queue
+	{
+		std::mutex                        mutex;
+		std::deque<std::function<void()>> tasks;
+	};
+
+	const size_t                               _queue_capacity;
+	std::vector<std::unique_ptr<worker_queue>> _queues;
+	std::vector<std::thread>                   _threads;
+	std::atomic<size_t>                        _next_queue;
+	std::atomic<size_t>                        _pending;
+	std::atomic<bool>                          _stopping;
+	std::mutex                                 _sleep_mutex;
+	std::condition_variable                    _wake;
+
+public:
+	handler_executor(const handler_executor&) = delete;
+
+	handler_executor& operator=(const handler_executor&) = delete;
+
+	/*
+	 * Constructs an executor and starts its worker threads.
+	 *
+	 * @param n_threads the number of worker threads, 0 uses one per hardware thread
+	 * @param queue_capacity the maximum number of tasks queued for each worker
+	 */
+	explicit handler_executor(size_t n_threads = 0, size_t queue_capacity = 1024);
+
+	/*
+	 * Stops the executor, see stop.
+	 */
+	~handler_executor();
+
+	/*
+	 * Queues a task to be run by a worker thread.
+	 *
+	 * @param task the task to run
+	 * @return false if the queues are full or the executor is stopped, the task is not run
+	 */
+	bool submit(std::function<void()> task);
+
+	/*
+	 * Stops the worker threads once all queued tasks have been run, and joins them.
+	 */
+	void stop();
+
+	/*
+	 * Get the number of tasks waiting to be run.
+	 *
+	 * @return the number of queued tasks
+	 */
+	size_t pending() const;
+
+	/*
+	 * Get the number of worker threads.
+	 *
+	 * @return the number of threads
+	 */
+	size_t size() const;
+
+private:
+	void run_worker(size_t index);
+
+	bool take_task(size_t index, std::function<void()> & task);
+
+	bool push_task(size_t index, std::function<void()> & task);
+};
+
+typedef std::shared_ptr<handler_executor> handler_executor_ptr;
+
+} // served
+
+#endif // SERVED_HANDLER_EXECUTOR_HPP
@@ -0,0 +1,102 @@
+/*
+ * Copyright (C) 2021 QM Ltd.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <test/catch.hpp>
+
+#include <served/handler_executor.hpp>
+
+#include <future>
+#include <set>
+
+TEST_CASE("handler executor runs tasks", "[handler_executor]")
+{
+	SECTION("tasks run on the worker threads")
+	{
+		served::handler_executor executor(2);
+		CHECK(executor.size() == 2);
+
+		std::mutex                  mutex;
+		std::set<std::thread::id>   threads;
+		std::vector<std::future<void>> done;
+		for ( int i = 0; i < 100; i++ )
+		{
+			auto p = std::make_shared<std::promise<void>>();
+			done.push_back(p->get_future());
+			REQUIRE(executor.submit([&, p]() {
+				{
+					std::lock_guard<std::mutex> lock(mutex);
+					threads.insert(std::this_thread::get_id());
+				}
+				p->set_value();
+			}));
+		}
+		for ( auto & f : done )
+		{
+			f.wait();
+		}
+		CHECK(threads.count(std::this_thread::get_id()) == 0);
+	}
+
+	SECTION("submitting fails once the queues are full")
+	{
+		served::handler_executor executor(1, 2);
+
+		std::promise<void> started, release;
+		auto release_future = release.get_future().share();
+		REQUIRE(executor.submit([&]() {
+			started.set_value();
+			release_future.wait();
+		}));
+		started.get_future().wait();
+
+		std::atomic<int> ran(0);
+		CHECK(executor.submit([&]() { ran++; }));
+		CHECK(executor.submit([&]() { ran++; }));
+		CHECK_FALSE(executor.submit([&]() { ran++; }));
+		CHECK(executor.pending() == 2);
+
+		release.set_value();
+		executor.stop();
+
+		// Queued tasks are run before the executor stops.
+		CHECK(ran == 2);
+		CHECK_FALSE(executor.submit([&]() { ran++; }));
+	}
+
+	SECTION("idle workers steal queued tasks")
+	{
+		served::handler_executor executor(2);
+
+		std::promise<void> release, stolen;
+		auto release_future = release.get_future().share();
+
+		// A task submitted from a worker is queued for that worker, which then stays busy.
+		REQUIRE(executor.submit([&]() {
+			executor.submit([&]() { stolen.set_value(); });
+			release_future.wait();
+		}));
+
+		auto stolen_future = stolen.get_future();
+		CHECK(stolen_future.wait_for(std::chrono::seconds(5)) == std::future_status::ready);
+		release.set_value();
+	}
+}
@@ -0,0 +1,436 @@
+/*
+ * Copyright (C) 2021 QM Ltd.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <served/header_scan.hpp>
+
+#include <atomic>
+#include <cstring>
+
+// Vector kernels are built with function target attributes, so that the library runs on any x86
+// CPU and each kernel is only called once the CPU is known to support it.
+#if defined(__GNUC__) && ( defined(__x86_64__) || defined(__i386__) ) \
+ && ( defined(__clang__) || __GNUC__ > 4 || ( __GNUC__ == 4 && __GNUC_MINOR__ >= 9 ) )
+#define SERVED_HEADER_SCAN_X86 1
+#include <immintrin.h>
+#endif
+
+namespace served { namespace header_scan {
+
+namespace {
+
+// The characters of a token, which field names are made of
+struct token_table
+{
+	bool allowed[256];
+
+	token_table()
+	{
+		const char * separators = "()<>@,;:\\\"/[]?={} \t";
+		for ( int c = 0; c < 256; ++c )
+		{
+			allowed[c] = c > 31 && c < 127 && std::strchr(separators, c) == nullptr;
+		}
+	}
+};
+
+inline bool
+is_token(char c)
+{
+	static const token_table table;
+	return table.allowed[static_cast<unsigned char>(c)];
+}
+
+inline bool
+is_value_byte(char c)
+{
+	const unsigned char u = static_cast<unsigned char>(c);
+	return ( u > 31 || u == '\t' ) && u != 127;
+}
+
+// Checks for an empty line after the line feed at i
+inline size_t
+empty_line_after(const char * data, size_t len, size_t i)
+{
+	if ( i + 1 < len && data[i + 1] == '\n' )
+	{
+		return i + 1;
+	}
+	if ( i + 2 < len && data[i + 1] == '\r' && data[i + 2] == '\n' )
+	{
+		return i + 1;
+	}
+	return npos;
+}
+
+//  -----  scalar kernels  -----
+
+const char *
+find_char_scalar(const char * begin, const char * end, char c)
+{
+	const void * found = std::memchr(begin, c, end - begin);
+	return found ? static_cast<const char *>(found) : end;
+}
+
+const char *
+find_value_end_scalar(const char * begin, const char * end)
+{
+	while ( begin < end && is_value_byte(*begin) )
+	{
+		++begin;
+	}
+	return begin;
+}
+
+size_t
+find_empty_line_scalar(const char * data, size_t len, size_t from)
+{
+	while ( from < len )
+	{
+		const char * lf = find_char_scalar(data + from, data + len, '\n');
+		if ( lf == data + len )
+		{
+			break;
+		}
+
+		const size_t line = empty_line_after(data, len, lf - data);
+		if ( line != npos )
+		{
+			return line;
+		}
+		from = lf - data + 1;
+	}
+	return npos;
+}
+
+#if defined(SERVED_HEADER_SCAN_X86)
+
+//  -----  SSE4.2 kernels  -----
+
+__attribute__((target("sse4.2"))) const char *
+find_char_sse42(const char * begin, const char * end, char c)
+{
+	const __m128i needle = _mm_set1_epi8(c);
+	for ( ; end - begin >= 16; begin += 16 )
+	{
+		const __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i *>(begin));
+		const unsigned mask = _mm_movemask_epi8(_mm_cmpeq_epi8(block, needle));
+		if ( mask != 0 )
+		{
+			return begin + __builtin_ctz(mask);
+		}
+	}
+	return find_char_scalar(begin, end, c);
+}
+
+__attribute__((target("sse4.2"))) const char *
+find_value_end_sse42(const char * begin, const char * end)
+{
+	// The ranges of bytes that cannot be part of a value, every control character but tab.
+	const __m128i ranges = _mm_setr_epi8(0x00, 0x08, 0x0a, 0x1f, 0x7f, 0x7f, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0);
+	for ( ; end - begin >= 16; begin += 16 )
+	{
+		const __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i *>(begin));
+		const int index = _mm_cmpestri(ranges, 6, block, 16,
+			_SIDD_UBYTE_OPS | _SIDD_CMP_RANGES | _SIDD_LEAST_SIGNIFICANT);
+		if ( index < 16 )
+		{
+			return begin + index;
+		}
+	}
+	return find_value_end_scalar(begin, end);
+}
+
+__attribute__((target("sse4.2"))) size_t
+find_empty_line_sse42(const char * data, size_t len, size_t from)
+{
+	const __m128i lf = _mm_set1_epi8('\n');
+	const __m128i cr = _mm_set1_epi8('\r');
+
+	// Each line feed is compared with the two bytes that follow it.
+	for ( ; from + 2 + 16 <= len; from += 16 )
+	{
+		const __m128i b0 = _mm_loadu_si128(reinterpret_cast<const __m128i *>(data + from));
+		const __m128i b1 = _mm_loadu_si128(reinterpret_cast<const __m128i *>(data + from + 1));
+		const __m128i b2 = _mm_loadu_si128(reinterpret_cast<const __m128i *>(data + from + 2));
+
+		const __m128i empty = _mm_or_si128(_mm_cmpeq_epi8(b1, lf),
+			_mm_and_si128(_mm_cmpeq_epi8(b1, cr), _mm_cmpeq_epi8(b2, lf)));
+		const unsigned mask = _mm_movemask_epi8(_mm_and_si128(_mm_cmpeq_epi8(b0, lf), empty));
+		if ( mask != 0 )
+		{
+			return from + __builtin_ctz(mask) + 1;
+		}
+	}
+	return find_empty_line_scalar(data, len, from);
+}
+
+//  -----  AVX2 kernels  -----
+
+__attribute__((target("avx2"))) const char *
+find_char_avx2(const char * begin, const char * end, char c)
+{
+	const __m256i needle = _mm256_set1_epi8(c);
+	for ( ; end - begin >= 32; begin += 32 )
+	{
+		const __m256i block = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(begin));
+		const unsigned mask = _mm256_movemask_epi8(_mm256_cmpeq_epi8(block, needle));
+		if ( mask != 0 )
+		{
+			return begin + __builtin_ctz(mask);
+		}
+	}
+	return find_char_sse42(begin, end, c);
+}
+
+__attribute__((target("avx2"))) const char *
+find_value_end_avx2(const char * begin, const char * end)
+{
+	const __m256i ctl = _mm256_set1_epi8(0x1f);
+	const __m256i tab = _mm256_set1_epi8('\t');
+	const __m256i del = _mm256_set1_epi8(0x7f);
+	for ( ; end - begin >= 32; begin += 32 )
+	{
+		const __m256i block = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(begin));
+
+		// A byte is a control character if it is unchanged by an unsigned min with 0x1f.
+		const __m256i control = _mm256_cmpeq_epi8(_mm256_min_epu8(block, ctl), block);
+		const __m256i invalid = _mm256_or_si256(
+			_mm256_andnot_si256(_mm256_cmpeq_epi8(block, tab), control),
+			_mm256_cmpeq_epi8(block, del));
+
+		const unsigned mask = _mm256_movemask_epi8(invalid);
+		if ( mask != 0 )
+		{
+			return begin + __builtin_ctz(mask);
+		}
+	}
+	return find_value_end_sse42(begin, end);
+}
+
+__attribute__((target("avx2"))) size_t
+find_empty_line_avx2(const char * data, size_t len, size_t from)
+{
+	const __m256i lf = _mm256_set1_epi8('\n');
+	const __m256i cr = _mm256_set1_epi8('\r');
+
+	for ( ; from + 2 + 32 <= len; from += 32 )
+	{
+		const __m256i b0 = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(data + from));
+		const __m256i b1 = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(data + from + 1));
+		const __m256i b2 = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(data + from + 2));
+
+		const __m256i empty = _mm256_or_si256(_mm256_cmpeq_epi8(b1, lf),
+			_mm256_and_si256(_mm256_cmpeq_epi8(b1, cr), _mm256_cmpeq_epi8(b2, lf)));
+		const unsigned mask = _mm256_movemask_epi8(_mm256_and_si256(_mm256_cmpeq_epi8(b0, lf), empty));
+		if ( mask != 0 )
+		{
+			return from + __builtin_ctz(mask) + 1;
+		}
+	}
+	return find_empty_line_sse42(data, len, from);
+}
+
+#endif // SERVED_HEADER_SCAN_X86
+
+//  -----  dispatch  -----
+
+struct kernels
+{
+	isa set;
+	const char * (*find_char)(const char *, const char *, char);
+	const char * (*find_value_end)(const char *, const char *);
+	size_t       (*find_empty_line)(const char *, size_t, size_t);
+};
+
+const kernels scalar_kernels = {
+	isa::scalar, find_char_scalar, find_value_end_scalar, find_empty_line_scalar
+};
+
+#if defined(SERVED_HEADER_SCAN_X86)
+const kernels sse42_kernels = {
+	isa::sse42, find_char_sse42, find_value_end_sse42, find_empty_line_sse42
+};
+
+const kernels avx2_kernels = {
+	isa::avx2, find_char_avx2, find_value_end_avx2, find_empty_line_avx2
+};
+#endif
+
+const kernels *
+kernels_for(isa set)
+{
+	switch ( set )
+	{
+#if defined(SERVED_HEADER_SCAN_X86)
+	case isa::avx2:
+		return &avx2_kernels;
+	case isa::sse42:
+		return &sse42_kernels;
+#endif
+	case isa::scalar:
+		return &scalar_kernels;
+	default:
+		return nullptr;
+	}
+}
+
+// The kernels in use, chosen when first needed
+std::atomic<const kernels *> active_kernels(nullptr);
+
+const kernels &
+active()
+{
+	const kernels * k = active_kernels.load(std::memory_order_acquire);
+	if ( k == nullptr )
+	{
+		// Racing threads all choose the same kernels.
+		k = &scalar_kernels;
+		for ( isa set : { isa::avx2, isa::sse42 } )
+		{
+			if ( supports(set) )
+			{
+				k = kernels_for(set);
+				break;
+			}
+		}
+		active_kernels.store(k, std::memory_order_release);
+	}
+	return *k;
+}
+
+} // anonymous namespace
+
+bool
+supports(isa set)
+{
+	switch ( set )
+	{
+	case isa::scalar:
+		return true;
+#if defined(SERVED_HEADER_SCAN_X86)
+	case isa::sse42:
+		__builtin_cpu_init();
+		return __builtin_cpu_supports("sse4.2");
+	case isa::avx2:
+		__builtin_cpu_init();
+		return __builtin_cpu_supports("avx2");
+#endif
+	default:
+		return false;
+	}
+}
+
+isa
+active_isa()
+{
+	return active().set;
+}
+
+bool
+set_isa(isa set)
+{
+	if ( ! supports(set) )
+	{
+		return false;
+	}
+	active_kernels.store(kernels_for(set), std::memory_order_release);
+	return true;
+}
+
+const char *
+isa_name(isa set)
+{
+	switch ( set )
+	{
+	case isa::sse42:
+		return "sse4.2";
+	case isa::avx2:
+		return "avx2";
+	default:
+		return "scalar";
+	}
+}
+
+const char *
+find_char(const char * begin, const char * end, char c)
+{
+	return active().find_char(begin, end, c);
+}
+
+const char *
+find_value_end(const char * begin, const char * end)
+{
+	return active().find_value_end(begin, end);
+}
+
+size_t
+find_empty_line(const char * data, size_t len, size_t from)
+{
+	return active().find_empty_line(data, len, from);
+}
+
+bool
+split_fields(const char * data, size_t begin, size_t end, std::vector<field> & fields)
+{
+	const kernels & k    = active();
+	const char *    line = data + begin;
+	const char *    stop = data + end;
+
+	while ( line < stop )
+	{
+		const char * colon = k.find_char(line, stop, ':');
+		if ( colon == line || colon == stop )
+		{
+			return false;
+		}
+		for ( const char * c = line; c < colon; ++c )
+		{
+			if ( ! is_token(*c) )
+			{
+				return false;
+			}
+		}
+
+		const char * value = colon + 1;
+		while ( value < stop && ( *value == ' ' || *value == '\t' ) )
+		{
+			++value;
+		}
+
+		// The value runs to the first control character, which must be the CRLF ending the line.
+		const char * value_end = k.find_value_end(value, stop);
+		if ( stop - value_end < 2 || value_end[0] != '\r' || value_end[1] != '\n' )
+		{
+			return false;
+		}
+		const char * next = value_end + 2;
+
+		fields.push_back(field {
+			static_cast<size_t>(line - data),  static_cast<size_t>(colon - line),
+			static_cast<size_t>(value - data), static_cast<size_t>(value_end - value)
+		});
+		line = next;
+	}
+	return true;
+}
+
+} } // header_scan, served
@@ -0,0 +1,153 @@
+/*
+ * Copyright (C) 2021 QM Ltd.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef SERVED_HEADER_SCAN_HPP
+#define SERVED_HEADER_SCAN_HPP
+
+#include <cstddef>
+#include <vector>
+
+namespace served { namespace header_scan {
+
+/*
+ * Scans the header of a request with vector instructions, ahead of the request parser.
+ *
+ * Finding the end of a header tells whether it is complete without running the state machine, and
+ * the fields of a complete header are split by searching for their delimiters. The instruction
+ * set is chosen at runtime from those the CPU supports, falling back to plain C++.
+ */
+
+static const size_t npos = static_cast<size_t>(-1);
+
+/*
+ * The instruction sets that the scanner can use.
+ */
+enum class isa
+{
+	scalar = 0,
+	sse42,
+	avx2
+};
+
+/*
+ * A header field, as offsets into the buffer it was found in.
+ */
+struct field
+{
+	size_t name;
+	size_t name_len;
+	size_t value;
+	size_t value_len;
+};
+
+/*
+ * Checks whether the CPU supports an instruction set.
+ *
+ * @param set the instruction set
+ *
+ * @return true if the scanner can use it
+ */
+bool supports(isa set);
+
+/*
+ * Get the instruction set in use, the best that is supported unless overridden.
+ *
+ * @return the instruction set
+ */
+isa active_isa();
+
+/*
+ * Overrides the instruction set in use, for benchmarks and tests.
+ *
+ * @param set the instruction set
+ *
+ * @return false if the CPU does not support it, the instruction set in use is then unchanged
+ */
+bool set_isa(isa set);
+
+/*
+ * Get the name of an instruction set.
+ *
+ * @param set the instruction set
+ *
+ * @return the name, eg. "avx2"
+ */
+const char * isa_name(isa set);
+
+/*
+ * Finds the first occurrence of a character.
+ *
+ * @param begin the start of the range to search
+ * @param end the end of the range to search
+ * @param c the character to find
+ *
+ * @return a pointer to the character, or end if it is not found
+ */
+const char * find_char(const char * begin, const char * end, char c);
+
+/*
+ * Finds the first byte that cannot be part of a field value.
+ *
+ * These are the control characters other than horizontal tab, the first of which in a well formed
+ * field is the CR or LF that ends its line.
+ *
+ * @param begin the start of the range to search
+ * @param end the end of the range to search
+ *
+ * @return a pointer to the byte, or end if there is none
+ */
+const char * find_value_end(const char * begin, const char * end);
+
+/*
+ * Finds the empty line that ends a header.
+ *
+ * Searches for a line feed that is followed by an empty line, ended by either CRLF or a bare LF.
+ * To resume a search once more data has arrived, search again from two bytes before the end of
+ * the data that was searched.
+ *
+ * @param data the buffer holding the header
+ * @param len the length of the buffer
+ * @param from the offset of the first line feed to consider, the end of the line before
+ *
+ * @return the offset of the empty line, or npos if the header is incomplete
+ */
+size_t find_empty_line(const char * data, size_t len, size_t from);
+
+/*
+ * Splits the fields of a complete header.
+ *
+ * Only handles a field on a single line, of a token name, a colon, optional whitespace and a
+ * value, ended by CRLF. Anything else, such as a line ended by a bare LF, a value folded over
+ * several lines or a malformed field, is left to the request parser to accept or reject.
+ *
+ * @param data the buffer holding the header
+ * @param begin the offset of the first field
+ * @param end the offset of the empty line that ends the header
+ * @param fields the fields found are appended to this
+ *
+ * @return false if a field is not in the simple form, fields may then have been appended
+ */
+bool split_fields(const char * data, size_t begin, size_t end, std::vector<field> & fields);
+
+} } // header_scan, served
+
+#endif // SERVED_HEADER_SCAN_HPP
@@ -0,0 +1,181 @@
+/*
+ * Copyright (C) 2021 QM Ltd.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <test/catch.hpp>
+
+#include <served/header_scan.hpp>
+
+#include <string>
+#include <vector>
+
+namespace hs = served::header_scan;
+
+namespace {
+
+// Runs a test with every instruction set that the CPU supports
+template <typename F>
+void
+for_each_isa(F test)
+{
+	const hs::isa best = hs::active_isa();
+	for ( hs::isa set : { hs::isa::scalar, hs::isa::sse42, hs::isa::avx2 } )
+	{
+		if ( hs::set_isa(set) )
+		{
+			INFO("isa: " << hs::isa_name(set));
+			test();
+		}
+	}
+	hs::set_isa(best);
+}
+
+std::string
+value_of(const std::string & data, const hs::field & f)
+{
+	return data.substr(f.value, f.value_len);
+}
+
+std::string
+name_of(const std::string & data, const hs::field & f)
+{
+	return data.substr(f.name, f.name_len);
+}
+
+} // anonymous namespace
+
+TEST_CASE("header scan dispatches at runtime", "[header_scan]")
+{
+	CHECK(hs::supports(hs::isa::scalar));
+	CHECK(hs::supports(hs::active_isa()));
+	CHECK(hs::set_isa(hs::active_isa()));
+}
+
+TEST_CASE("header scan finds characters", "[header_scan]")
+{
+	for_each_isa([]() {
+		for ( size_t pos = 0; pos < 100; ++pos )
+		{
+			std::string data(100, 'a');
+			data[pos] = ':';
+			CHECK(hs::find_char(data.data(), data.data() + data.size(), ':') == data.data() + pos);
+
+			// The range ends before the character.
+			CHECK(hs::find_char(data.data(), data.data() + pos, ':') == data.data() + pos);
+		}
+	});
+}
+
+TEST_CASE("header scan finds the end of a value", "[header_scan]")
+{
+	for_each_isa([]() {
+		// Tab, space, DEL's neighbours and bytes above ASCII are all part of a value.
+		std::string allowed = "\t ~\x80\xc3\xa9\xff";
+		allowed += std::string(100, 'v');
+		CHECK(hs::find_value_end(allowed.data(), allowed.data() + allowed.size()) == allowed.data() + allowed.size());
+
+		for ( char ctl : { '\0', '\x01', '\x08', '\n', '\r', '\x1f', '\x7f' } )
+		{
+			for ( size_t pos = 0; pos < 100; ++pos )
+			{
+				std::string data(100, '\xc3');
+				data[pos] = ctl;
+				INFO("control: " << int(ctl) << " at " << pos);
+				CHECK(hs::find_value_end(data.data(), data.data() + data.size()) == data.data() + pos);
+			}
+		}
+	});
+}
+
+TEST_CASE("header scan finds the end of a header", "[header_scan]")
+{
+	for_each_isa([]() {
+		for ( const std::string & end : std::vector<std::string> { "\r\n\r\n", "\n\n", "\r\n\n", "\n\r\n" } )
+		{
+			for ( size_t pos = 1; pos < 80; ++pos )
+			{
+				// Line ends that do not end the header come before it.
+				std::string data = "GET / HTTP/1.1\r\nHost: a\nX: b\r\n" + std::string(pos, 'x') + end + "body\r\n\r\n";
+				const size_t expected = data.find(end) + ( end[0] == '\r' ? 2 : 1 );
+				INFO("end: " << end.size() << " bytes, at " << expected);
+
+				CHECK(hs::find_empty_line(data.data(), data.size(), 0) == expected);
+
+				// Every split of the data is found once the rest arrives.
+				const size_t complete = expected + ( data[expected] == '\n' ? 1 : 2 );
+				for ( size_t len = 0; len < complete; ++len )
+				{
+					CHECK(hs::find_empty_line(data.data(), len, 0) == hs::npos);
+					CHECK(hs::find_empty_line(data.data(), data.size(), len > 2 ? len - 2 : 0) == expected);
+				}
+			}
+		}
+	});
+}
+
+TEST_CASE("header scan splits simple fields", "[header_scan]")
+{
+	for_each_isa([]() {
+		const std::string data =
+			"Host: api.example.com\r\n"
+			"Accept:*/*\r\n"
+			"X-Empty:   \r\n"
+			"X-Spaced: \t a value with trailing space \r\n"
+			"User-Agent: Mozilla/5.0 (Macintosh; Intel Mac OS X 10_15_7) AppleWebKit/605.1.15 (KHTML, like Gecko)\r\n"
+			"X-Utf8: caf\xc3\xa9\r\n"
+			"\r\n";
+
+		std::vector<hs::field> fields;
+		REQUIRE(hs::split_fields(data.data(), 0, data.size() - 2, fields));
+		REQUIRE(fields.size() == 6);
+
+		CHECK(name_of(data, fields[0]) == "Host");
+		CHECK(value_of(data, fields[0]) == "api.example.com");
+		CHECK(name_of(data, fields[1]) == "Accept");
+		CHECK(value_of(data, fields[1]) == "*/*");
+		CHECK(value_of(data, fields[2]) == "");
+		CHECK(value_of(data, fields[3]) == "a value with trailing space ");
+		CHECK(value_of(data, fields[4]) == "Mozilla/5.0 (Macintosh; Intel Mac OS X 10_15_7) AppleWebKit/605.1.15 (KHTML, like Gecko)");
+		CHECK(value_of(data, fields[5]) == "caf\xc3\xa9");
+	});
+}
+
+TEST_CASE("header scan leaves other fields to the parser", "[header_scan]")
+{
+	for_each_isa([]() {
+		for ( const std::string & line : std::vector<std::string> {
+			"X-Bare-Lf: a\n",
+			"X-Folded: a\r\n b\r\n",
+			"X-Name : value\r\n",
+			": value\r\n",
+			"X-No-Colon\r\n",
+			"X-Bad(Name): value\r\n",
+			"X-Cr: a\rb\r\n",
+			"X-Nul: a" + std::string(1, '\0') + "b\r\n",
+		} )
+		{
+			const std::string data = "Host: a\r\n" + line + "\r\n";
+			std::vector<hs::field> fields;
+			INFO("line: " << line);
+			CHECK_FALSE(hs::split_fields(data.data(), 0, data.size() - 2, fields));
+		}
+	});
+}
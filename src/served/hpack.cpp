@@ -0,0 +1,670 @@
+/*
+ * Copyright (C) 2021 QM Ltd.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <served/hpack.hpp>
+
+#include <array>
+#include <memory>
+
+using namespace served::hpack;
+
+namespace {
+
+/*
+ * The static table, RFC 7541 appendix A.
+ */
+const header_field static_entries[table::static_length] =
+{
+	{ ":authority", "" },
+	{ ":method", "GET" },
+	{ ":method", "POST" },
+	{ ":path", "/" },
+	{ ":path", "/index.html" },
+	{ ":scheme", "http" },
+	{ ":scheme", "https" },
+	{ ":status", "200" },
+	{ ":status", "204" },
+	{ ":status", "206" },
+	{ ":status", "304" },
+	{ ":status", "400" },
+	{ ":status", "404" },
+	{ ":status", "500" },
+	{ "accept-charset", "" },
+	{ "accept-encoding", "gzip, deflate" },
+	{ "accept-language", "" },
+	{ "accept-ranges", "" },
+	{ "accept", "" },
+	{ "access-control-allow-origin", "" },
+	{ "age", "" },
+	{ "allow", "" },
+	{ "authorization", "" },
+	{ "cache-control", "" },
+	{ "content-disposition", "" },
+	{ "content-encoding", "" },
+	{ "content-language", "" },
+	{ "content-length", "" },
+	{ "content-location", "" },
+	{ "content-range", "" },
+	{ "content-type", "" },
+	{ "cookie", "" },
+	{ "date", "" },
+	{ "etag", "" },
+	{ "expect", "" },
+	{ "expires", "" },
+	{ "from", "" },
+	{ "host", "" },
+	{ "if-match", "" },
+	{ "if-modified-since", "" },
+	{ "if-none-match", "" },
+	{ "if-range", "" },
+	{ "if-unmodified-since", "" },
+	{ "last-modified", "" },
+	{ "link", "" },
+	{ "location", "" },
+	{ "max-forwards", "" },
+	{ "proxy-authenticate", "" },
+	{ "proxy-authorization", "" },
+	{ "range", "" },
+	{ "referer", "" },
+	{ "refresh", "" },
+	{ "retry-after", "" },
+	{ "server", "" },
+	{ "set-cookie", "" },
+	{ "strict-transport-security", "" },
+	{ "transfer-encoding", "" },
+	{ "user-agent", "" },
+	{ "vary", "" },
+	{ "via", "" },
+	{ "www-authenticate", "" },
+};
+
+/*
+ * The Huffman code, RFC 7541 appendix B, the last entry being the end of string symbol.
+ */
+const struct
+{
+	uint32_t code;
+	uint8_t  bits;
+}
+huffman_codes[257] =
+{
+	{ 0x00001ff8, 13 }, { 0x007fffd8, 23 }, { 0x0fffffe2, 28 }, { 0x0fffffe3, 28 },
+	{ 0x0fffffe4, 28 }, { 0x0fffffe5, 28 }, { 0x0fffffe6, 28 }, { 0x0fffffe7, 28 },
+	{ 0x0fffffe8, 28 }, { 0x00ffffea, 24 }, { 0x3ffffffc, 30 }, { 0x0fffffe9, 28 },
+	{ 0x0fffffea, 28 }, { 0x3ffffffd, 30 }, { 0x0fffffeb, 28 }, { 0x0fffffec, 28 },
+	{ 0x0fffffed, 28 }, { 0x0fffffee, 28 }, { 0x0fffffef, 28 }, { 0x0ffffff0, 28 },
+	{ 0x0ffffff1, 28 }, { 0x0ffffff2, 28 }, { 0x3ffffffe, 30 }, { 0x0ffffff3, 28 },
+	{ 0x0ffffff4, 28 }, { 0x0ffffff5, 28 }, { 0x0ffffff6, 28 }, { 0x0ffffff7, 28 },
+	{ 0x0ffffff8, 28 }, { 0x0ffffff9, 28 }, { 0x0ffffffa, 28 }, { 0x0ffffffb, 28 },
+	{ 0x00000014,  6 }, { 0x000003f8, 10 }, { 0x000003f9, 10 }, { 0x00000ffa, 12 },
+	{ 0x00001ff9, 13 }, { 0x00000015,  6 }, { 0x000000f8,  8 }, { 0x000007fa, 11 },
+	{ 0x000003fa, 10 }, { 0x000003fb, 10 }, { 0x000000f9,  8 }, { 0x000007fb, 11 },
+	{ 0x000000fa,  8 }, { 0x00000016,  6 }, { 0x00000017,  6 }, { 0x00000018,  6 },
+	{ 0x00000000,  5 }, { 0x00000001,  5 }, { 0x00000002,  5 }, { 0x00000019,  6 },
+	{ 0x0000001a,  6 }, { 0x0000001b,  6 }, { 0x0000001c,  6 }, { 0x0000001d,  6 },
+	{ 0x0000001e,  6 }, { 0x0000001f,  6 }, { 0x0000005c,  7 }, { 0x000000fb,  8 },
+	{ 0x00007ffc, 15 }, { 0x00000020,  6 }, { 0x00000ffb, 12 }, { 0x000003fc, 10 },
+	{ 0x00001ffa, 13 }, { 0x00000021,  6 }, { 0x0000005d,  7 }, { 0x0000005e,  7 },
+	{ 0x0000005f,  7 }, { 0x00000060,  7 }, { 0x00000061,  7 }, { 0x00000062,  7 },
+	{ 0x00000063,  7 }, { 0x00000064,  7 }, { 0x00000065,  7 }, { 0x00000066,  7 },
+	{ 0x00000067,  7 }, { 0x00000068,  7 }, { 0x00000069,  7 }, { 0x0000006a,  7 },
+	{ 0x0000006b,  7 }, { 0x0000006c,  7 }, { 0x0000006d,  7 }, { 0x0000006e,  7 },
+	{ 0x0000006f,  7 }, { 0x00000070,  7 }, { 0x00000071,  7 }, { 0x00000072,  7 },
+	{ 0x000000fc,  8 }, { 0x00000073,  7 }, { 0x000000fd,  8 }, { 0x00001ffb, 13 },
+	{ 0x0007fff0, 19 }, { 0x00001ffc, 13 }, { 0x00003ffc, 14 }, { 0x00000022,  6 },
+	{ 0x00007ffd, 15 }, { 0x00000003,  5 }, { 0x00000023,  6 }, { 0x00000004,  5 },
+	{ 0x00000024,  6 }, { 0x00000005,  5 }, { 0x00000025,  6 }, { 0x00000026,  6 },
+	{ 0x00000027,  6 }, { 0x00000006,  5 }, { 0x00000074,  7 }, { 0x00000075,  7 },
+	{ 0x00000028,  6 }, { 0x00000029,  6 }, { 0x0000002a,  6 }, { 0x00000007,  5 },
+	{ 0x0000002b,  6 }, { 0x00000076,  7 }, { 0x0000002c,  6 }, { 0x00000008,  5 },
+	{ 0x00000009,  5 }, { 0x0000002d,  6 }, { 0x00000077,  7 }, { 0x00000078,  7 },
+	{ 0x00000079,  7 }, { 0x0000007a,  7 }, { 0x0000007b,  7 }, { 0x00007ffe, 15 },
+	{ 0x000007fc, 11 }, { 0x00003ffd, 14 }, { 0x00001ffd, 13 }, { 0x0ffffffc, 28 },
+	{ 0x000fffe6, 20 }, { 0x003fffd2, 22 }, { 0x000fffe7, 20 }, { 0x000fffe8, 20 },
+	{ 0x003fffd3, 22 }, { 0x003fffd4, 22 }, { 0x003fffd5, 22 }, { 0x007fffd9, 23 },
+	{ 0x003fffd6, 22 }, { 0x007fffda, 23 }, { 0x007fffdb, 23 }, { 0x007fffdc, 23 },
+	{ 0x007fffdd, 23 }, { 0x007fffde, 23 }, { 0x00ffffeb, 24 }, { 0x007fffdf, 23 },
+	{ 0x00ffffec, 24 }, { 0x00ffffed, 24 }, { 0x003fffd7, 22 }, { 0x007fffe0, 23 },
+	{ 0x00ffffee, 24 }, { 0x007fffe1, 23 }, { 0x007fffe2, 23 }, { 0x007fffe3, 23 },
+	{ 0x007fffe4, 23 }, { 0x001fffdc, 21 }, { 0x003fffd8, 22 }, { 0x007fffe5, 23 },
+	{ 0x003fffd9, 22 }, { 0x007fffe6, 23 }, { 0x007fffe7, 23 }, { 0x00ffffef, 24 },
+	{ 0x003fffda, 22 }, { 0x001fffdd, 21 }, { 0x000fffe9, 20 }, { 0x003fffdb, 22 },
+	{ 0x003fffdc, 22 }, { 0x007fffe8, 23 }, { 0x007fffe9, 23 }, { 0x001fffde, 21 },
+	{ 0x007fffea, 23 }, { 0x003fffdd, 22 }, { 0x003fffde, 22 }, { 0x00fffff0, 24 },
+	{ 0x001fffdf, 21 }, { 0x003fffdf, 22 }, { 0x007fffeb, 23 }, { 0x007fffec, 23 },
+	{ 0x001fffe0, 21 }, { 0x001fffe1, 21 }, { 0x003fffe0, 22 }, { 0x001fffe2, 21 },
+	{ 0x007fffed, 23 }, { 0x003fffe1, 22 }, { 0x007fffee, 23 }, { 0x007fffef, 23 },
+	{ 0x000fffea, 20 }, { 0x003fffe2, 22 }, { 0x003fffe3, 22 }, { 0x003fffe4, 22 },
+	{ 0x007ffff0, 23 }, { 0x003fffe5, 22 }, { 0x003fffe6, 22 }, { 0x007ffff1, 23 },
+	{ 0x03ffffe0, 26 }, { 0x03ffffe1, 26 }, { 0x000fffeb, 20 }, { 0x0007fff1, 19 },
+	{ 0x003fffe7, 22 }, { 0x007ffff2, 23 }, { 0x003fffe8, 22 }, { 0x01ffffec, 25 },
+	{ 0x03ffffe2, 26 }, { 0x03ffffe3, 26 }, { 0x03ffffe4, 26 }, { 0x07ffffde, 27 },
+	{ 0x07ffffdf, 27 }, { 0x03ffffe5, 26 }, { 0x00fffff1, 24 }, { 0x01ffffed, 25 },
+	{ 0x0007fff2, 19 }, { 0x001fffe3, 21 }, { 0x03ffffe6, 26 }, { 0x07ffffe0, 27 },
+	{ 0x07ffffe1, 27 }, { 0x03ffffe7, 26 }, { 0x07ffffe2, 27 }, { 0x00fffff2, 24 },
+	{ 0x001fffe4, 21 }, { 0x001fffe5, 21 }, { 0x03ffffe8, 26 }, { 0x03ffffe9, 26 },
+	{ 0x0ffffffd, 28 }, { 0x07ffffe3, 27 }, { 0x07ffffe4, 27 }, { 0x07ffffe5, 27 },
+	{ 0x000fffec, 20 }, { 0x00fffff3, 24 }, { 0x000fffed, 20 }, { 0x001fffe6, 21 },
+	{ 0x003fffe9, 22 }, { 0x001fffe7, 21 }, { 0x001fffe8, 21 }, { 0x007ffff3, 23 },
+	{ 0x003fffea, 22 }, { 0x003fffeb, 22 }, { 0x01ffffee, 25 }, { 0x01ffffef, 25 },
+	{ 0x00fffff4, 24 }, { 0x00fffff5, 24 }, { 0x03ffffea, 26 }, { 0x007ffff4, 23 },
+	{ 0x03ffffeb, 26 }, { 0x07ffffe6, 27 }, { 0x03ffffec, 26 }, { 0x03ffffed, 26 },
+	{ 0x07ffffe7, 27 }, { 0x07ffffe8, 27 }, { 0x07ffffe9, 27 }, { 0x07ffffea, 27 },
+	{ 0x07ffffeb, 27 }, { 0x0ffffffe, 28 }, { 0x07ffffec, 27 }, { 0x07ffffed, 27 },
+	{ 0x07ffffee, 27 }, { 0x07ffffef, 27 }, { 0x07fffff0, 27 }, { 0x03ffffee, 26 },
+	{ 0x3fffffff, 30 },
+};
+
+/*
+ * A node in the decoding tree of the Huffman code.
+ *
+ * Codes are decoded a byte at a time, each node indexed by the next eight bits of input. A leaf
+ * holds a symbol and the number of its bits consumed at that node.
+ */
+struct huffman_node
+{
+	std::unique_ptr<std::array<std::unique_ptr<huffman_node>, 256>> children;
+	uint16_t symbol;
+	uint8_t  bits;
+
+	huffman_node()
+		: children(new std::array<std::unique_ptr<huffman_node>, 256>())
+		, symbol(0)
+		, bits(0)
+	{
+	}
+
+	huffman_node(uint16_t symbol, uint8_t bits)
+		: children()
+		, symbol(symbol)
+		, bits(bits)
+	{
+	}
+};
+
+const huffman_node &
+huffman_root()
+{
+	static const std::unique_ptr<huffman_node> root = []() {
+		std::unique_ptr<huffman_node> root(new huffman_node());
+		for ( uint16_t symbol = 0; symbol < 257; symbol++ )
+		{
+			uint32_t code = huffman_codes[symbol].code;
+			uint8_t  bits = huffman_codes[symbol].bits;
+
+			huffman_node * node = root.get();
+			while ( bits > 8 )
+			{
+				bits -= 8;
+				auto & child = ( *node->children )[( code >> bits ) & 0xff];
+				if ( ! child )
+				{
+					child.reset(new huffman_node());
+				}
+				node = child.get();
+			}
+
+			// A short code fills every slot that it prefixes.
+			const int shift = 8 - bits;
+			const int start = ( code << shift ) & 0xff;
+			for ( int i = start; i < start + ( 1 << shift ); i++ )
+			{
+				( *node->children )[i].reset(new huffman_node(symbol, bits));
+			}
+		}
+		return root;
+	}();
+	return *root;
+}
+
+/*
+ * Decodes a string literal, RFC 7541 section 5.2.
+ */
+std::string
+decode_string(const uint8_t * & p, const uint8_t * end)
+{
+	if ( p == end )
+	{
+		throw error("truncated string");
+	}
+
+	const bool     huffman = *p & 0x80;
+	const uint64_t len     = decode_integer(p, end, 7);
+	if ( len > static_cast<uint64_t>(end - p) )
+	{
+		throw error("truncated string");
+	}
+
+	std::string out;
+	if ( huffman )
+	{
+		huffman_decode(p, len, out);
+	}
+	else
+	{
+		out.assign(reinterpret_cast<const char *>(p), len);
+	}
+	p += len;
+	return out;
+}
+
+/*
+ * Appends a string literal, Huffman coded unless that is longer.
+ */
+void
+encode_string(const std::string & str, std::string & out)
+{
+	const size_t huffman_len = huffman_encoded_length(str);
+	if ( huffman_len <= str.size() )
+	{
+		encode_integer(huffman_len, 7, 0x80, out);
+		huffman_encode(str, out);
+	}
+	else
+	{
+		encode_integer(str.size(), 7, 0, out);
+		out.append(str);
+	}
+}
+
+bool
+is_sensitive(const header_field & field)
+{
+	return field.first == "authorization" || field.first == "cookie";
+}
+
+} // anonymous namespace
+
+namespace served { namespace hpack {
+
+//  -----  integers  -----
+
+void
+encode_integer(uint64_t value, int prefix_bits, uint8_t flags, std::string & out)
+{
+	const uint64_t max_prefix = ( 1u << prefix_bits ) - 1;
+	if ( value < max_prefix )
+	{
+		out.push_back(static_cast<char>(flags | value));
+		return;
+	}
+
+	out.push_back(static_cast<char>(flags | max_prefix));
+	value -= max_prefix;
+	while ( value >= 128 )
+	{
+		out.push_back(static_cast<char>(( value & 0x7f ) | 0x80));
+		value >>= 7;
+	}
+	out.push_back(static_cast<char>(value));
+}
+
+uint64_t
+decode_integer(const uint8_t * & p, const uint8_t * end, int prefix_bits)
+{
+	if ( p == end )
+	{
+		throw error("truncated integer");
+	}
+
+	const uint64_t max_prefix = ( 1u << prefix_bits ) - 1;
+	uint64_t       value      = *p++ & max_prefix;
+	if ( value < max_prefix )
+	{
+		return value;
+	}
+
+	for ( int shift = 0; ; shift += 7 )
+	{
+		// Values used by HTTP/2 fit in 32 bits, anything longer is an attack.
+		if ( p == end || shift > 28 )
+		{
+			throw error(p == end ? "truncated integer" : "integer overflow");
+		}
+
+		const uint8_t b = *p++;
+		value += static_cast<uint64_t>(b & 0x7f) << shift;
+		if ( ! ( b & 0x80 ) )
+		{
+			return value;
+		}
+	}
+}
+
+//  -----  huffman code  -----
+
+void
+huffman_encode(const std::string & data, std::string & out)
+{
+	uint64_t bits  = 0;
+	int      nbits = 0;
+	for ( unsigned char c : data )
+	{
+		bits   = ( bits << huffman_codes[c].bits ) | huffman_codes[c].code;
+		nbits += huffman_codes[c].bits;
+		while ( nbits >= 8 )
+		{
+			nbits -= 8;
+			out.push_back(static_cast<char>(bits >> nbits));
+		}
+	}
+
+	// Padded with the most significant bits of the end of string symbol, all ones.
+	if ( nbits > 0 )
+	{
+		out.push_back(static_cast<char>(( bits << ( 8 - nbits ) ) | ( 0xff >> nbits )));
+	}
+}
+
+size_t
+huffman_encoded_length(const std::string & data)
+{
+	size_t bits = 0;
+	for ( unsigned char c : data )
+	{
+		bits += huffman_codes[c].bits;
+	}
+	return ( bits + 7 ) / 8;
+}
+
+void
+huffman_decode(const uint8_t * data, size_t len, std::string & out)
+{
+	const huffman_node & root = huffman_root();
+	const huffman_node * node = &root;
+
+	uint64_t bits  = 0;
+	int      nbits = 0;
+	int      depth = 0; // bits consumed since the last complete symbol
+
+	for ( size_t i = 0; i < len; i++ )
+	{
+		bits   = ( bits << 8 ) | data[i];
+		nbits += 8;
+		while ( nbits >= 8 )
+		{
+			const huffman_node * next = ( *node->children )[( bits >> ( nbits - 8 ) ) & 0xff].get();
+			if ( ! next )
+			{
+				throw error("invalid huffman code");
+			}
+			if ( next->children )
+			{
+				node   = next;
+				nbits -= 8;
+				depth += 8;
+				continue;
+			}
+			if ( next->symbol == 256 )
+			{
+				throw error("end of string in huffman code");
+			}
+			out.push_back(static_cast<char>(next->symbol));
+			nbits -= next->bits;
+			node   = &root;
+			depth  = 0;
+		}
+	}
+
+	// Any remaining bits complete symbols shorter than a byte, or are padding.
+	while ( nbits > 0 )
+	{
+		const huffman_node * next = ( *node->children )[( bits << ( 8 - nbits ) ) & 0xff].get();
+		if ( ! next || next->children || next->bits > nbits )
+		{
+			break;
+		}
+		if ( next->symbol == 256 )
+		{
+			throw error("end of string in huffman code");
+		}
+		out.push_back(static_cast<char>(next->symbol));
+		nbits -= next->bits;
+		node   = &root;
+		depth  = 0;
+	}
+
+	// Padding must be shorter than a byte and all ones, the prefix of the end of string symbol.
+	const uint64_t mask = ( uint64_t(1) << nbits ) - 1;
+	if ( node != &root || depth + nbits > 7 || ( bits & mask ) != mask )
+	{
+		throw error("invalid huffman padding");
+	}
+}
+
+//  -----  table  -----
+
+table::table(size_t max_size /* = 4096 */)
+	: _entries()
+	, _size(0)
+	, _max_size(max_size)
+{
+}
+
+void
+table::add(header_field field)
+{
+	const size_t size = entry_size(field);
+	while ( ! _entries.empty() && _size + size > _max_size )
+	{
+		_size -= entry_size(_entries.back());
+		_entries.pop_back();
+	}
+	if ( size <= _max_size )
+	{
+		_size += size;
+		_entries.push_front(std::move(field));
+	}
+}
+
+void
+table::set_max_size(size_t max_size)
+{
+	_max_size = max_size;
+	while ( ! _entries.empty() && _size > _max_size )
+	{
+		_size -= entry_size(_entries.back());
+		_entries.pop_back();
+	}
+}
+
+const header_field &
+table::at(size_t index) const
+{
+	if ( index == 0 || index > static_length + _entries.size() )
+	{
+		throw error("invalid table index");
+	}
+	if ( index <= static_length )
+	{
+		return static_entries[index - 1];
+	}
+	return _entries[index - static_length - 1];
+}
+
+size_t
+table::find(const header_field & field, bool & name_only) const
+{
+	size_t name_index = 0;
+	for ( size_t i = 0; i < static_length; i++ )
+	{
+		if ( field.first == static_entries[i].first )
+		{
+			if ( field.second == static_entries[i].second )
+			{
+				name_only = false;
+				return i + 1;
+			}
+			if ( name_index == 0 )
+			{
+				name_index = i + 1;
+			}
+		}
+	}
+	for ( size_t i = 0; i < _entries.size(); i++ )
+	{
+		if ( field.first == _entries[i].first )
+		{
+			if ( field.second == _entries[i].second )
+			{
+				name_only = false;
+				return static_length + i + 1;
+			}
+			if ( name_index == 0 )
+			{
+				name_index = static_length + i + 1;
+			}
+		}
+	}
+	name_only = true;
+	return name_index;
+}
+
+//  -----  decoder  -----
+
+decoder::decoder(size_t max_table_size /* = 4096 */)
+	: _table(max_table_size)
+	, _max_table_size(max_table_size)
+{
+}
+
+void
+decoder::decode(const char * data, size_t len, header_fields & fields, size_t max_list_size /* = 0 */)
+{
+	const uint8_t *       p         = reinterpret_cast<const uint8_t *>(data);
+	const uint8_t * const end       = p + len;
+	bool                  first     = true;
+	size_t                list_size = 0;
+
+	// Indexed fields may expand a small block into a large list, so it is counted as it grows.
+	auto add_field = [&](header_field field) {
+		list_size += table::entry_size(field);
+		if ( max_list_size > 0 && list_size > max_list_size )
+		{
+			throw list_size_error("header list too large");
+		}
+		fields.push_back(std::move(field));
+	};
+
+	while ( p < end )
+	{
+		const uint8_t b = *p;
+		if ( b & 0x80 )
+		{
+			// Indexed header field.
+			add_field(_table.at(decode_integer(p, end, 7)));
+		}
+		else if ( ( b & 0xe0 ) == 0x20 )
+		{
+			// Dynamic table size update, only allowed at the start of a block.
+			const uint64_t size = decode_integer(p, end, 5);
+			if ( ! first || size > _max_table_size )
+			{
+				throw error("invalid table size update");
+			}
+			_table.set_max_size(size);
+			continue;
+		}
+		else
+		{
+			// Literal, with incremental indexing or not, or never indexed.
+			const bool     indexing = ( b & 0xc0 ) == 0x40;
+			const uint64_t index    = decode_integer(p, end, indexing ? 6 : 4);
+
+			header_field field;
+			field.first  = ( index == 0 ) ? decode_string(p, end) : _table.at(index).first;
+			field.second = decode_string(p, end);
+
+			if ( indexing )
+			{
+				_table.add(field);
+			}
+			add_field(std::move(field));
+		}
+		first = false;
+	}
+}
+
+//  -----  encoder  -----
+
+encoder::encoder(size_t table_size /* = 4096 */)
+	: _table(table_size)
+	, _pending_size_update(table_size)
+	, _size_update(false)
+{
+}
+
+void
+encoder::set_max_table_size(size_t table_size)
+{
+	// The smallest size set since the last block is signalled, so that the decoder evicts
+	// anything it must, followed by the final size.
+	if ( ! _size_update || table_size < _pending_size_update )
+	{
+		_pending_size_update = table_size;
+	}
+	_size_update = true;
+	_table.set_max_size(table_size);
+}
+
+void
+encoder::encode(const header_fields & fields, std::string & out)
+{
+	if ( _size_update )
+	{
+		if ( _pending_size_update < _table.max_size() )
+		{
+			encode_integer(_pending_size_update, 5, 0x20, out);
+		}
+		encode_integer(_table.max_size(), 5, 0x20, out);
+		_size_update = false;
+	}
+
+	for ( const auto & field : fields )
+	{
+		bool   name_only = false;
+		size_t index     = _table.find(field, name_only);
+
+		if ( index > 0 && ! name_only )
+		{
+			encode_integer(index, 7, 0x80, out);
+			continue;
+		}
+
+		if ( is_sensitive(field) )
+		{
+			encode_integer(index, 4, 0x10, out);
+		}
+		else
+		{
+			encode_integer(index, 6, 0x40, out);
+			_table.add(field);
+		}
+		if ( index == 0 )
+		{
+			encode_string(field.first, out);
+		}
+		encode_string(field.second, out);
+	}
+}
+
+} } // hpack, served
@@ -0,0 +1,297 @@
+/*
+ * Copyright (C) 2021 QM Ltd.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef SERVED_HPACK_HPP
+#define SERVED_HPACK_HPP
+
+#include <cstdint>
+#include <deque>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace served { namespace hpack {
+
+typedef std::pair<std::string, std::string> header_field;
+typedef std::vector<header_field>          header_fields;
+
+/*
+ * Thrown when a header block cannot be decoded, the connection must then be closed with a
+ * COMPRESSION_ERROR.
+ */
+class error
+	: public std::runtime_error
+{
+public:
+	explicit error(const std::string & what)
+		: std::runtime_error(what)
+	{
+	}
+};
+
+/*
+ * Thrown when a decoded header list is larger than allowed, the connection should then be closed
+ * as the rest of the block was not decoded.
+ */
+class list_size_error
+	: public error
+{
+public:
+	explicit list_size_error(const std::string & what)
+		: error(what)
+	{
+	}
+};
+
+/*
+ * The dynamic table of header fields shared by an encoder and its peer decoder.
+ *
+ * Entries are indexed from 1, starting with the static table of RFC 7541 followed by the dynamic
+ * entries from newest to oldest.
+ */
+class table
+{
+	std::deque<header_field> _entries;
+	size_t                   _size;
+	size_t                   _max_size;
+
+public:
+	/*
+	 * Constructs an empty table.
+	 *
+	 * @param max_size the size of the table in bytes, as counted by RFC 7541
+	 */
+	explicit table(size_t max_size = 4096);
+
+	/*
+	 * Adds an entry, evicting the oldest entries to make room for it.
+	 *
+	 * An entry larger than the table empties it.
+	 *
+	 * @param field the header field
+	 */
+	void add(header_field field);
+
+	/*
+	 * Sets the size of the table, evicting entries that no longer fit.
+	 *
+	 * @param max_size the size in bytes
+	 */
+	void set_max_size(size_t max_size);
+
+	/*
+	 * Get an entry by its index.
+	 *
+	 * @param index the index, from 1
+	 *
+	 * @return the entry
+	 *
+	 * @throws error if there is no entry with the index
+	 */
+	const header_field & at(size_t index) const;
+
+	/*
+	 * Finds the index of a header field.
+	 *
+	 * @param field the header field
+	 * @param name_only set to true if only the name of the field matched
+	 *
+	 * @return the index, or 0 if neither the field nor its name is in the table
+	 */
+	size_t find(const header_field & field, bool & name_only) const;
+
+	/*
+	 * Get the number of dynamic entries.
+	 *
+	 * @return the number of entries
+	 */
+	size_t length() const { return _entries.size(); }
+
+	/*
+	 * Get the size of the dynamic entries.
+	 *
+	 * @return the size in bytes
+	 */
+	size_t size() const { return _size; }
+
+	/*
+	 * Get the size of the table.
+	 *
+	 * @return the size in bytes
+	 */
+	size_t max_size() const { return _max_size; }
+
+	/*
+	 * The number of entries in the static table.
+	 */
+	static const size_t static_length = 61;
+
+	/*
+	 * Computes the size of an entry, its name and value plus 32 bytes of overhead.
+	 */
+	static size_t entry_size(const header_field & field)
+	{
+		return field.first.size() + field.second.size() + 32;
+	}
+};
+
+/*
+ * Decodes header blocks, see RFC 7541.
+ *
+ * A decoder is used for every header block received on one connection, in order.
+ */
+class decoder
+{
+	table  _table;
+	size_t _max_table_size;
+
+public:
+	/*
+	 * Constructs a decoder.
+	 *
+	 * @param max_table_size the largest table the peer may use, as advertised in our settings
+	 */
+	explicit decoder(size_t max_table_size = 4096);
+
+	/*
+	 * Decodes a header block.
+	 *
+	 * @param data the header block
+	 * @param len the length of the header block
+	 * @param fields the vector to append the decoded fields to
+	 * @param max_list_size the largest header list accepted, its fields counted as table entries,
+	 *                      0 is ignored
+	 *
+	 * @throws list_size_error if the decoded fields exceed max_list_size
+	 * @throws error if the header block is invalid
+	 */
+	void decode(const char * data, size_t len, header_fields & fields, size_t max_list_size = 0);
+
+	/*
+	 * Get the dynamic table.
+	 *
+	 * @return the table
+	 */
+	const table & dynamic_table() const { return _table; }
+};
+
+/*
+ * Encodes header blocks, see RFC 7541.
+ *
+ * Fields are indexed where they are found in the table, otherwise they are sent as literals and
+ * added to the table. Literals are Huffman coded unless that is longer. Credentials sent by a
+ * client, authorization and cookie fields, are never indexed.
+ */
+class encoder
+{
+	table  _table;
+	size_t _pending_size_update;
+	bool   _size_update;
+
+public:
+	/*
+	 * Constructs an encoder.
+	 *
+	 * @param table_size the size of the table, at most the size allowed by the peer
+	 */
+	explicit encoder(size_t table_size = 4096);
+
+	/*
+	 * Sets the size of the table, as allowed by the settings of the peer.
+	 *
+	 * The change is signalled at the start of the next header block.
+	 *
+	 * @param table_size the size in bytes
+	 */
+	void set_max_table_size(size_t table_size);
+
+	/*
+	 * Encodes a header block.
+	 *
+	 * @param fields the fields, names must be lower case
+	 * @param out the string to append the header block to
+	 */
+	void encode(const header_fields & fields, std::string & out);
+
+	/*
+	 * Get the dynamic table.
+	 *
+	 * @return the table
+	 */
+	const table & dynamic_table() const { return _table; }
+};
+
+/*
+ * Encodes an integer with an N-bit prefix, see RFC 7541 section 5.1.
+ *
+ * @param value the value
+ * @param prefix_bits the number of bits in the prefix
+ * @param flags the bits of the first byte above the prefix
+ * @param out the string to append to
+ */
+void encode_integer(uint64_t value, int prefix_bits, uint8_t flags, std::string & out);
+
+/*
+ * Decodes an integer with an N-bit prefix.
+ *
+ * @param p the position to decode from, advanced past the integer
+ * @param end the end of the data
+ * @param prefix_bits the number of bits in the prefix
+ *
+ * @return the value
+ *
+ * @throws error if the integer is truncated or too large
+ */
+uint64_t decode_integer(const uint8_t * & p, const uint8_t * end, int prefix_bits);
+
+/*
+ * Huffman codes a string, see RFC 7541 section 5.2.
+ *
+ * @param data the string
+ * @param out the string to append the code to
+ */
+void huffman_encode(const std::string & data, std::string & out);
+
+/*
+ * Get the length of the Huffman code of a string.
+ *
+ * @param data the string
+ *
+ * @return the length in bytes
+ */
+size_t huffman_encoded_length(const std::string & data);
+
+/*
+ * Decodes a Huffman coded string.
+ *
+ * @param data the code
+ * @param len the length of the code
+ * @param out the string to append the decoded string to
+ *
+ * @throws error if the code is invalid
+ */
+void huffman_decode(const uint8_t * data, size_t len, std::string & out);
+
+} } // hpack, served
+
+#endif // SERVED_HPACK_HPP
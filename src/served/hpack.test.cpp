@@ -0,0 +1,305 @@
+/*
+ * Copyright (C) 2021 QM Ltd.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <test/catch.hpp>
+
+#include <served/hpack.hpp>
+
+namespace {
+
+std::string
+from_hex(const std::string & hex)
+{
+	std::string bytes;
+	for ( size_t i = 0; i + 1 < hex.size(); i += 2 )
+	{
+		bytes.push_back(static_cast<char>(std::stoi(hex.substr(i, 2), nullptr, 16)));
+	}
+	return bytes;
+}
+
+std::string
+to_hex(const std::string & bytes)
+{
+	static const char digits[] = "0123456789abcdef";
+
+	std::string hex;
+	for ( unsigned char c : bytes )
+	{
+		hex.push_back(digits[c >> 4]);
+		hex.push_back(digits[c & 0xf]);
+	}
+	return hex;
+}
+
+served::hpack::header_fields
+decode(served::hpack::decoder & decoder, const std::string & hex)
+{
+	const std::string block = from_hex(hex);
+
+	served::hpack::header_fields fields;
+	decoder.decode(block.data(), block.size(), fields);
+	return fields;
+}
+
+} // anonymous namespace
+
+// Test vectors are from RFC 7541 appendix C.
+
+TEST_CASE("hpack integers", "[hpack]")
+{
+	SECTION("encode")
+	{
+		std::string out;
+		served::hpack::encode_integer(10, 5, 0, out);
+		CHECK(to_hex(out) == "0a");
+
+		out.clear();
+		served::hpack::encode_integer(1337, 5, 0, out);
+		CHECK(to_hex(out) == "1f9a0a");
+
+		out.clear();
+		served::hpack::encode_integer(42, 8, 0, out);
+		CHECK(to_hex(out) == "2a");
+	}
+	SECTION("decode")
+	{
+		const std::string bytes = from_hex("1f9a0a");
+		const uint8_t * p = reinterpret_cast<const uint8_t *>(bytes.data());
+		CHECK(served::hpack::decode_integer(p, p + bytes.size(), 5) == 1337);
+		CHECK(p == reinterpret_cast<const uint8_t *>(bytes.data()) + 3);
+	}
+	SECTION("truncated and overflowing integers are rejected")
+	{
+		const std::string truncated = from_hex("1f9a");
+		const uint8_t * p = reinterpret_cast<const uint8_t *>(truncated.data());
+		CHECK_THROWS_AS(served::hpack::decode_integer(p, p + truncated.size(), 5), const served::hpack::error &);
+
+		const std::string overflow = from_hex("1fffffffffffff01");
+		p = reinterpret_cast<const uint8_t *>(overflow.data());
+		CHECK_THROWS_AS(served::hpack::decode_integer(p, p + overflow.size(), 5), const served::hpack::error &);
+	}
+}
+
+TEST_CASE("hpack huffman code", "[hpack]")
+{
+	std::string out;
+	served::hpack::huffman_encode("www.example.com", out);
+	CHECK(to_hex(out) == "f1e3c2e5f23a6ba0ab90f4ff");
+	CHECK(served::hpack::huffman_encoded_length("www.example.com") == 12);
+
+	for ( const std::string & str : { std::string("no-cache"), std::string("custom-key"), std::string("a"),
+		std::string("Mon, 21 Oct 2013 20:13:21 GMT"), std::string("\x00\xff\x7f\x80 binary", 10) } )
+	{
+		std::string code, decoded;
+		served::hpack::huffman_encode(str, code);
+		served::hpack::huffman_decode(reinterpret_cast<const uint8_t *>(code.data()), code.size(), decoded);
+		CHECK(decoded == str);
+	}
+
+	SECTION("invalid padding is rejected")
+	{
+		// "a" is 00011, padded with zeros rather than ones.
+		const std::string zeros = from_hex("18");
+		CHECK_THROWS_AS(served::hpack::huffman_decode(reinterpret_cast<const uint8_t *>(zeros.data()), 1, out),
+		                const served::hpack::error &);
+
+		// A whole byte of padding.
+		const std::string long_padding = from_hex("1fff");
+		CHECK_THROWS_AS(served::hpack::huffman_decode(reinterpret_cast<const uint8_t *>(long_padding.data()), 2, out),
+		                const served::hpack::error &);
+	}
+}
+
+TEST_CASE("hpack decoder", "[hpack]")
+{
+	SECTION("literal with indexing")
+	{
+		served::hpack::decoder decoder;
+		auto fields = decode(decoder, "400a637573746f6d2d6b65790d637573746f6d2d686561646572");
+		REQUIRE(fields.size() == 1);
+		CHECK(fields[0].first == "custom-key");
+		CHECK(fields[0].second == "custom-header");
+		CHECK(decoder.dynamic_table().size() == 55);
+	}
+	SECTION("requests without huffman coding")
+	{
+		served::hpack::decoder decoder;
+		auto fields = decode(decoder, "828684410f7777772e6578616d706c652e636f6d");
+		REQUIRE(fields.size() == 4);
+		CHECK(fields[0] == served::hpack::header_field(":method", "GET"));
+		CHECK(fields[1] == served::hpack::header_field(":scheme", "http"));
+		CHECK(fields[2] == served::hpack::header_field(":path", "/"));
+		CHECK(fields[3] == served::hpack::header_field(":authority", "www.example.com"));
+		CHECK(decoder.dynamic_table().size() == 57);
+
+		fields = decode(decoder, "828684be58086e6f2d6361636865");
+		REQUIRE(fields.size() == 5);
+		CHECK(fields[3] == served::hpack::header_field(":authority", "www.example.com"));
+		CHECK(fields[4] == served::hpack::header_field("cache-control", "no-cache"));
+		CHECK(decoder.dynamic_table().size() == 110);
+
+		fields = decode(decoder, "828785bf400a637573746f6d2d6b65790c637573746f6d2d76616c7565");
+		REQUIRE(fields.size() == 5);
+		CHECK(fields[1] == served::hpack::header_field(":scheme", "https"));
+		CHECK(fields[2] == served::hpack::header_field(":path", "/index.html"));
+		CHECK(fields[3] == served::hpack::header_field(":authority", "www.example.com"));
+		CHECK(fields[4] == served::hpack::header_field("custom-key", "custom-value"));
+		CHECK(decoder.dynamic_table().size() == 164);
+		CHECK(decoder.dynamic_table().length() == 3);
+	}
+	SECTION("requests with huffman coding")
+	{
+		served::hpack::decoder decoder;
+		auto fields = decode(decoder, "828684418cf1e3c2e5f23a6ba0ab90f4ff");
+		REQUIRE(fields.size() == 4);
+		CHECK(fields[3] == served::hpack::header_field(":authority", "www.example.com"));
+
+		fields = decode(decoder, "828684be5886a8eb10649cbf");
+		REQUIRE(fields.size() == 5);
+		CHECK(fields[4] == served::hpack::header_field("cache-control", "no-cache"));
+
+		fields = decode(decoder, "828785bf408825a849e95ba97d7f8925a849e95bb8e8b4bf");
+		REQUIRE(fields.size() == 5);
+		CHECK(fields[4] == served::hpack::header_field("custom-key", "custom-value"));
+		CHECK(decoder.dynamic_table().size() == 164);
+	}
+	SECTION("invalid blocks are rejected")
+	{
+		served::hpack::decoder decoder;
+		served::hpack::header_fields fields;
+
+		// Index beyond the tables.
+		CHECK_THROWS_AS(decode(decoder, "ff00"), const served::hpack::error &);
+		// Index zero.
+		CHECK_THROWS_AS(decode(decoder, "80"), const served::hpack::error &);
+		// Truncated literal.
+		CHECK_THROWS_AS(decode(decoder, "400a6375"), const served::hpack::error &);
+		// Table size update after a field.
+		CHECK_THROWS_AS(decode(decoder, "8220"), const served::hpack::error &);
+		// Table size update beyond the limit.
+		CHECK_THROWS_AS(decode(decoder, "3fe21f"), const served::hpack::error &);
+	}
+	SECTION("header lists are limited as they are decoded")
+	{
+		served::hpack::decoder decoder;
+		served::hpack::header_fields fields;
+
+		// A custom field of 55 bytes, then the same field again from the dynamic table.
+		const std::string block = from_hex("400a637573746f6d2d6b65790d637573746f6d2d686561646572be");
+		decoder.decode(block.data(), block.size(), fields, 110);
+		CHECK(fields.size() == 2);
+
+		fields.clear();
+		const std::string indexed = from_hex("bebebe");
+		CHECK_THROWS_AS(decoder.decode(indexed.data(), indexed.size(), fields, 110),
+			const served::hpack::list_size_error &);
+		CHECK(fields.size() == 2);
+	}
+	SECTION("table size updates evict entries")
+	{
+		served::hpack::decoder decoder;
+		decode(decoder, "400a637573746f6d2d6b65790d637573746f6d2d686561646572");
+		CHECK(decoder.dynamic_table().length() == 1);
+
+		auto fields = decode(decoder, "2082");
+		CHECK(decoder.dynamic_table().length() == 0);
+		CHECK(fields.size() == 1);
+	}
+}
+
+TEST_CASE("hpack encoder", "[hpack]")
+{
+	SECTION("responses with huffman coding and eviction")
+	{
+		served::hpack::encoder encoder(256);
+		served::hpack::decoder decoder(256);
+
+		served::hpack::header_fields first {
+			{ ":status", "302" },
+			{ "cache-control", "private" },
+			{ "date", "Mon, 21 Oct 2013 20:13:21 GMT" },
+			{ "location", "https://www.example.com" },
+		};
+		std::string block;
+		encoder.encode(first, block);
+		CHECK(to_hex(block) == "488264025885aec3771a4b6196d07abe941054d444a8200595040b8166e082a62d1bff"
+		                       "6e919d29ad171863c78f0b97c8e9ae82ae43d3");
+		CHECK(decode(decoder, to_hex(block)) == first);
+
+		served::hpack::header_fields second {
+			{ ":status", "307" },
+			{ "cache-control", "private" },
+			{ "date", "Mon, 21 Oct 2013 20:13:21 GMT" },
+			{ "location", "https://www.example.com" },
+		};
+		block.clear();
+		encoder.encode(second, block);
+		CHECK(to_hex(block) == "4883640effc1c0bf");
+		CHECK(decode(decoder, to_hex(block)) == second);
+
+		served::hpack::header_fields third {
+			{ ":status", "200" },
+			{ "cache-control", "private" },
+			{ "date", "Mon, 21 Oct 2013 20:13:22 GMT" },
+			{ "location", "https://www.example.com" },
+			{ "content-encoding", "gzip" },
+			{ "set-cookie", "foo=ASDJKHQKBZXOQWEOPIUAXQWEOIU; max-age=3600; version=1" },
+		};
+		block.clear();
+		encoder.encode(third, block);
+		CHECK(to_hex(block) == "88c16196d07abe941054d444a8200595040b8166e084a62d1bffc05a839bd9ab77ad94e7"
+		                       "821dd7f2e6c7b335dfdfcd5b3960d5af27087f3672c1ab270fb5291f9587316065c003ed"
+		                       "4ee5b1063d5007");
+		CHECK(decode(decoder, to_hex(block)) == third);
+		CHECK(encoder.dynamic_table().size() == 215);
+		CHECK(decoder.dynamic_table().size() == 215);
+	}
+	SECTION("credentials are never indexed")
+	{
+		served::hpack::encoder encoder;
+		std::string block;
+		encoder.encode({ { "authorization", "secret" } }, block);
+		CHECK((block[0] & 0xf0) == 0x10);
+		CHECK(encoder.dynamic_table().length() == 0);
+	}
+	SECTION("table size changes are signalled")
+	{
+		served::hpack::encoder encoder;
+		served::hpack::decoder decoder;
+		served::hpack::header_fields fields { { "x-request-id", "42" } };
+
+		std::string block;
+		encoder.encode(fields, block);
+		CHECK(decode(decoder, to_hex(block)) == fields);
+		CHECK(decoder.dynamic_table().length() == 1);
+
+		encoder.set_max_table_size(0);
+		encoder.set_max_table_size(1024);
+		block.clear();
+		encoder.encode(fields, block);
+		CHECK(to_hex(block.substr(0, 1)) == "20");
+		CHECK(decode(decoder, to_hex(block)) == fields);
+		CHECK(decoder.dynamic_table().max_size() == 1024);
+		CHECK(decoder.dynamic_table().length() == 1);
+	}
+}
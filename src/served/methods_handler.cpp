@@ -22,6 +22,8 @@
 
 #include <served/methods_handler.hpp>
 
+#include <set>
+
 namespace served {
 
 //  -----  constructors  -----
@@ -29,6 +31,8 @@ namespace served {
 methods_handler::methods_handler(const std::string path, const std::string info /* = "" */)
 	: _path(path)
 	, _info(info)
+	, _executor()
+	, _body_stream_handler()
 {
 }
 
@@ -37,54 +41,142 @@ methods_handler::methods_handler(const std::string path, const std::string info
 methods_handler &
 methods_handler::get (served_req_handler handler)
 {
-	_handlers[served::method::GET] = handler;
-	return *this;
+	return method(served::method::GET, handler);
 }
 
 methods_handler &
 methods_handler::post(served_req_handler handler)
 {
-	_handlers[served::method::POST] = handler;
-	return *this;
+	return method(served::method::POST, handler);
 }
 
 methods_handler &
 methods_handler::head(served_req_handler handler)
 {
-	_handlers[served::method::HEAD] = handler;
-	return *this;
+	return method(served::method::HEAD, handler);
 }
 
 methods_handler &
 methods_handler::put (served_req_handler handler)
 {
-	_handlers[served::method::PUT] = handler;
-	return *this;
+	return method(served::method::PUT, handler);
 }
 
 methods_handler &
 methods_handler::del (served_req_handler handler)
 {
-	_handlers[served::method::DELETE] = handler;
-	return *this;
+	return method(served::method::DELETE, handler);
 }
 
 methods_handler &
 methods_handler::method(const served::method method, served_req_handler handler)
 {
+	_async_handlers.erase(method);
 	_handlers[method] = handler;
 	return *this;
 }
 
+//  -----  asynchronous method registering  -----
+
+methods_handler &
+methods_handler::get_async (served_async_req_handler handler)
+{
+	return method_async(served::method::GET, handler);
+}
+
+methods_handler &
+methods_handler::post_async(served_async_req_handler handler)
+{
+	return method_async(served::method::POST, handler);
+}
+
+methods_handler &
+methods_handler::head_async(served_async_req_handler handler)
+{
+	return method_async(served::method::HEAD, handler);
+}
+
+methods_handler &
+methods_handler::put_async (served_async_req_handler handler)
+{
+	return method_async(served::method::PUT, handler);
+}
+
+methods_handler &
+methods_handler::del_async (served_async_req_handler handler)
+{
+	return method_async(served::method::DELETE, handler);
+}
+
+methods_handler &
+methods_handler::method_async(const served::method method, served_async_req_handler handler)
+{
+	_handlers.erase(method);
+	_async_handlers[method] = handler;
+	return *this;
+}
+
+methods_handler &
+methods_handler::use_executor(handler_executor_ptr executor)
+{
+	_executor = executor;
+	return *this;
+}
+
+methods_handler &
+methods_handler::sse(served_sse_handler handler, int heartbeat_ms /* = 15000 */)
+{
+	static const stream_chunk_ptr heartbeat = sse_channel::comment_frame("");
+
+	return get([handler, heartbeat_ms](response & res, const request & req) {
+		res.set_header("Content-Type", "text/event-stream");
+		res.set_header("Cache-Control", "no-cache");
+
+		auto stream = res.stream();
+		stream.channel()->set_heartbeat(heartbeat, heartbeat_ms);
+
+		handler(sse_channel(std::move(stream)), req);
+	});
+}
+
+methods_handler &
+methods_handler::websocket(served_websocket_handler handler, size_t max_message_bytes /* = 0 */)
+{
+	return get([handler, max_message_bytes](response & res, const request & req) {
+		auto ws = std::make_shared<served::websocket>(max_message_bytes);
+		served::websocket::upgrade(res, req, ws);
+
+		handler(ws, req);
+	});
+}
+
+methods_handler &
+methods_handler::stream_body(served_body_stream_handler handler)
+{
+	_body_stream_handler = handler;
+	return *this;
+}
+
 //  -----  endpoint propagation  -----
 
 void
 methods_handler::propagate_endpoint(served_endpoint_list & endpoints) const
 {
-	std::vector<std::string> methods;
+	// Merge both kinds of handler, keeping the methods in order.
+	std::set<served::method> supported;
 	for ( const auto & m_handler : _handlers )
 	{
-		methods.push_back(served::method_to_string(m_handler.first));
+		supported.insert(m_handler.first);
+	}
+	for ( const auto & m_handler : _async_handlers )
+	{
+		supported.insert(m_handler.first);
+	}
+
+	std::vector<std::string> methods;
+	for ( const auto & m : supported )
+	{
+		methods.push_back(served::method_to_string(m));
 	}
 	endpoints[_path] = served_method_list(_info, methods);
 }
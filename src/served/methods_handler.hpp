@@ -26,15 +26,24 @@
 #include <map>
 #include <vector>
 #include <functional>
+#include <served/deferred_response.hpp>
+#include <served/handler_executor.hpp>
 #include <served/methods.hpp>
 #include <served/request.hpp>
 #include <served/response.hpp>
+#include <served/sse.hpp>
+#include <served/websocket.hpp>
 
 namespace served {
 
-typedef std::function<void(response &, const request &)>  served_req_handler;
-typedef std::tuple<std::string, std::vector<std::string>> served_method_list;
-typedef std::map<std::string, served_method_list>         served_endpoint_list;
+typedef std::function<void(response &, const request &)>                    served_req_handler;
+typedef std::function<void(response &, const request &, deferred_response)> served_async_req_handler;
+typedef std::function<void(const char *, size_t)>                           served_body_chunk_handler;
+typedef std::function<served_body_chunk_handler(const request &)>           served_body_stream_handler;
+typedef std::function<void(sse_channel, const request &)>                   served_sse_handler;
+typedef std::function<void(websocket_ptr, const request &)>                 served_websocket_handler;
+typedef std::tuple<std::string, std::vector<std::string>>                   served_method_list;
+typedef std::map<std::string, served_method_list>                           served_endpoint_list;
 
 /*
  * Represents a single endpoint with various HTTP method handlers.
@@ -47,9 +56,12 @@ typedef std::map<std::string, served_method_list>         served_endpoint_list;
  */
 class methods_handler
 {
-	std::string                                  _path;
-	std::string                                  _info;
-	std::map<served::method, served_req_handler> _handlers;
+	std::string                                        _path;
+	std::string                                        _info;
+	std::map<served::method, served_req_handler>       _handlers;
+	std::map<served::method, served_async_req_handler> _async_handlers;
+	handler_executor_ptr                               _executor;
+	served_body_stream_handler                         _body_stream_handler;
 
 public:
 	//  -----  constructors  -----
@@ -123,6 +135,152 @@ public:
 	 */
 	methods_handler & method(const served::method method, served_req_handler handler);
 
+	//  -----  asynchronous method registering  -----
+
+	/*
+	 * Used to specify an asynchronous handler for a GET HTTP method at this endpoint.
+	 *
+	 * The response is written once the handler completes its deferred_response, rather than when
+	 * the handler returns. See deferred_response.
+	 *
+	 * @param handler the handler to be called for this HTTP method
+	 *
+	 * @return chainable methods_handler reference to *this
+	 */
+	methods_handler & get_async (served_async_req_handler handler);
+
+	/*
+	 * Used to specify an asynchronous handler for a POST HTTP method at this endpoint.
+	 *
+	 * @param handler the handler to be called for this HTTP method
+	 *
+	 * @return chainable methods_handler reference to *this
+	 */
+	methods_handler & post_async(served_async_req_handler handler);
+
+	/*
+	 * Used to specify an asynchronous handler for a HEAD HTTP method at this endpoint.
+	 *
+	 * @param handler the handler to be called for this HTTP method
+	 *
+	 * @return chainable methods_handler reference to *this
+	 */
+	methods_handler & head_async(served_async_req_handler handler);
+
+	/*
+	 * Used to specify an asynchronous handler for a PUT HTTP method at this endpoint.
+	 *
+	 * @param handler the handler to be called for this HTTP method
+	 *
+	 * @return chainable methods_handler reference to *this
+	 */
+	methods_handler & put_async (served_async_req_handler handler);
+
+	/*
+	 * Used to specify an asynchronous handler for a DELETE HTTP method at this endpoint.
+	 *
+	 * @param handler the handler to be called for this HTTP method
+	 *
+	 * @return chainable methods_handler reference to *this
+	 */
+	methods_handler & del_async (served_async_req_handler handler);
+
+	/*
+	 * Used to specify an asynchronous handler for a specific HTTP method at this endpoint.
+	 *
+	 * Replaces any handler, synchronous or not, already registered for the method.
+	 *
+	 * @param method the HTTP method that a handler should be called for
+	 * @param handler the handler to be called for this HTTP method
+	 *
+	 * @return chainable methods_handler reference to *this
+	 */
+	methods_handler & method_async(const served::method method, served_async_req_handler handler);
+
+	/*
+	 * Used to specify a Server-Sent Events handler for GET requests at this endpoint.
+	 *
+	 * The handler is called with a channel that events are sent to, and the response is kept open
+	 * until the channel is closed or the last copy of it is destroyed. The channel may be kept by
+	 * the handler, or subscribed to an sse_broadcaster. A client reconnecting after a dropped
+	 * stream sends the id of the last event it received in the Last-Event-ID header.
+	 *
+	 * A heartbeat comment is sent whenever no event has been sent for an interval, keeping the
+	 * connection from being timed out by intermediaries. A client still behind the limit of
+	 * pending bytes when a heartbeat is due is disconnected.
+	 *
+	 * @param handler the handler to be called for each subscriber
+	 * @param heartbeat_ms the heartbeat interval in milliseconds, 0 disables heartbeats
+	 *
+	 * @return chainable methods_handler reference to *this
+	 */
+	methods_handler & sse(served_sse_handler handler, int heartbeat_ms = 15000);
+
+	/*
+	 * Used to specify a WebSocket handler for GET requests at this endpoint.
+	 *
+	 * Upgrade requests are answered with the 101 handshake, and the handler is called with the
+	 * websocket the connection is then handed to. The handler should set the message and close
+	 * handlers of the websocket, which may be kept to send messages from any thread. Requests
+	 * that are not a valid upgrade are rejected with 426 or 400.
+	 *
+	 * @param handler the handler to be called for each websocket
+	 * @param max_message_bytes the largest message accepted from the client, 0 uses the default of
+	 *                          16 MiB
+	 *
+	 * @return chainable methods_handler reference to *this
+	 */
+	methods_handler & websocket(served_websocket_handler handler, size_t max_message_bytes = 0);
+
+	/*
+	 * Runs the handlers of this endpoint on an executor rather than on the I/O threads.
+	 *
+	 * Use this for handlers that block or take a long time, such as disk I/O or heavy computation.
+	 * Endpoints without an executor run their handlers inline.
+	 *
+	 * @param executor the executor to run handlers on, or an empty pointer to run them inline
+	 *
+	 * @return chainable methods_handler reference to *this
+	 */
+	methods_handler & use_executor(handler_executor_ptr executor);
+
+	/*
+	 * Get the executor that the handlers of this endpoint run on.
+	 *
+	 * @return the executor, or an empty pointer if handlers run inline
+	 */
+	const handler_executor_ptr & executor() const
+	{
+		return _executor;
+	}
+
+	/*
+	 * Streams request bodies of this endpoint to a handler as they are received.
+	 *
+	 * Once the header of a request with a body has been received, the handler is called with the
+	 * request and returns a callback for that body. The callback is given each chunk of the body
+	 * in order, on the I/O thread, and the body is not stored in the request. The method handler
+	 * is called as usual once the whole body has been received.
+	 *
+	 * Bodies streamed this way are not limited by the max request size of the server. Either
+	 * handler may throw a request_error to reject the request, the connection is then closed.
+	 *
+	 * @param handler called for each request with a body, returns the callback for its chunks
+	 *
+	 * @return chainable methods_handler reference to *this
+	 */
+	methods_handler & stream_body(served_body_stream_handler handler);
+
+	/*
+	 * Get the handler that request bodies of this endpoint are streamed to.
+	 *
+	 * @return the handler, or an empty function if bodies are stored in the request
+	 */
+	const served_body_stream_handler & body_stream_handler() const
+	{
+		return _body_stream_handler;
+	}
+
 	/*
 	 * Indicates whether a specific HTTP method has a handler registered for this endpoint.
 	 *
@@ -132,7 +290,20 @@ public:
 	 */
 	bool method_supported(const served::method method) const
 	{
-		return ( _handlers.find(method) != _handlers.end() );
+		return ( _handlers.find(method) != _handlers.end() )
+		    || ( _async_handlers.find(method) != _async_handlers.end() );
+	}
+
+	/*
+	 * Indicates whether the handler registered for a method is asynchronous.
+	 *
+	 * @param method the method to check
+	 *
+	 * @return true if the method has an asynchronous handler, otherwise false.
+	 */
+	bool method_is_async(const served::method method) const
+	{
+		return ( _async_handlers.find(method) != _async_handlers.end() );
 	}
 
 	/*
@@ -147,6 +318,18 @@ public:
 		return _handlers[method];
 	}
 
+	/*
+	 * Acquires the asynchronous handler for a method.
+	 *
+	 * @param method the HTTP method we want the handler for
+	 *
+	 * @return asynchronous request handler associated with the given method
+	 */
+	served_async_req_handler async_handler(const served::method method)
+	{
+		return _async_handlers[method];
+	}
+
 	//  -----  endpoint propagation  -----
 
 	/*
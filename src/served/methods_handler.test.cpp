@@ -101,4 +101,31 @@ TEST_CASE("test methods handling", "[methods_handler]")
 		CHECK(search_method(std::get<1>(methods), "PUT"));
 		CHECK(search_method(std::get<1>(methods), "DELETE"));
 	}
+
+	SECTION("async handlers replace sync handlers")
+	{
+		auto dummy       = [](served::response &, const served::request &) {};
+		auto dummy_async = [](served::response &, const served::request &, served::deferred_response) {};
+
+		served::methods_handler h("/async");
+		h.get(dummy).post(dummy).get_async(dummy_async).method_async(served::method::PUT, dummy_async);
+
+		CHECK(h.method_supported(served::method::GET));
+		CHECK(h.method_is_async(served::method::GET));
+		CHECK(h.method_supported(served::method::PUT));
+		CHECK(h.method_is_async(served::method::PUT));
+		CHECK(h.method_supported(served::method::POST));
+		CHECK_FALSE(h.method_is_async(served::method::POST));
+
+		h.get(dummy);
+		CHECK(h.method_supported(served::method::GET));
+		CHECK_FALSE(h.method_is_async(served::method::GET));
+
+		served::served_endpoint_list list;
+		h.propagate_endpoint(list);
+
+		auto methods = std::get<1>(list["/async"]);
+		CHECK(3 == methods.size());
+		CHECK(search_method(methods, "PUT"));
+	}
 }
@@ -25,6 +25,8 @@
 #include <served/multiplexer.hpp>
 #include <served/mux/matchers.hpp>
 
+#include <atomic>
+
 namespace served {
 
 //  -----  constructors  -----
@@ -143,10 +145,8 @@ multiplexer::handle(const std::string & path, const std::string info /* = "" */)
 }
 
 void
-multiplexer::handler(served::response & res, served::request & req)
+multiplexer::handler(served::response & res, served::request & req, served_handler_completion done)
 {
-	bool pattern_matched = false;
-
 	// Default to OK empty response
 	res.set_status(status_2XX::OK);
 	res.set_body("");
@@ -158,38 +158,96 @@ multiplexer::handler(served::response & res, served::request & req)
 	}
 
 	// Split request path into segments
-	auto   request_segments = split_path(req.url().path());
-	size_t r_size           = request_segments.size();
+	auto request_segments = split_path(req.url().path());
 
 	// If a base path was specified check for a match
 	const size_t b_size = _base_path_segments.size();
 	if ( 0 != b_size )
 	{
-		if ( b_size > r_size )
+		if ( ! match_base_path(request_segments) )
 		{
 			throw served::request_error(served::status_4XX::NOT_FOUND, "Path not found");
 		}
 
-		// Check if each segment matches
-		size_t seg_index = 0;
-		for ( ; seg_index < b_size; seg_index++ )
-		{
-			if ( ! _base_path_segments[seg_index]->check_match(request_segments[seg_index]) )
-			{
-				throw served::request_error(served::status_4XX::NOT_FOUND, "Path not found");
-			}
-		}
-
 		// Collect parameters from REST path segments
-		for ( seg_index = 0; seg_index < b_size; seg_index++ )
+		for ( size_t seg_index = 0; seg_index < b_size; seg_index++ )
 		{
 			_base_path_segments[seg_index]->get_param(req.params, request_segments[seg_index]);
 		}
 
 		request_segments.erase(request_segments.begin(), request_segments.begin() + b_size);
-		r_size = request_segments.size();
 	}
 
+	// If no candidates were matched then we throw a 404
+	const path_handler_candidate * candidate = find_candidate(request_segments);
+	if ( ! candidate )
+	{
+		throw served::request_error(served::status_4XX::NOT_FOUND, "Path not found");
+	}
+
+	// Check that the request method is supported by this candidate
+	auto method_handler = std::get<1>(*candidate);
+	if ( ! method_handler.method_supported( req.method() ) )
+	{
+		throw served::request_error(served::status_4XX::METHOD_NOT_ALLOWED, "Method not allowed");
+	}
+
+	// Collect parameters from REST path segments
+	const auto & handler_segments = std::get<0>(*candidate);
+	for ( size_t seg_index = 0; seg_index < handler_segments.size(); seg_index++ )
+	{
+		handler_segments[seg_index]->get_param(req.params, request_segments[seg_index]);
+	}
+
+	if ( ! method_handler.method_is_async( req.method() ) )
+	{
+		method_handler[ req.method() ](res, req);
+		done(nullptr);
+		return;
+	}
+
+	// An exception thrown before the deferred response is completed fails the request, once it
+	// has been completed the response is already on its way.
+	deferred_response deferred(done);
+	try
+	{
+		method_handler.async_handler( req.method() )(res, req, deferred);
+	}
+	catch (...)
+	{
+		if ( ! deferred.completed() )
+		{
+			deferred.fail(std::current_exception());
+			throw;
+		}
+	}
+}
+
+bool
+multiplexer::match_base_path(const std::vector<std::string> & request_segments) const
+{
+	const size_t b_size = _base_path_segments.size();
+	if ( b_size > request_segments.size() )
+	{
+		return false;
+	}
+
+	// Check if each segment matches
+	for ( size_t seg_index = 0; seg_index < b_size; seg_index++ )
+	{
+		if ( ! _base_path_segments[seg_index]->check_match(request_segments[seg_index]) )
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+const multiplexer::path_handler_candidate *
+multiplexer::find_candidate(const std::vector<std::string> & request_segments) const
+{
+	const size_t r_size = request_segments.size();
+
 	// For each candidate
 	for ( const auto & candidate : _handler_candidates )
 	{
@@ -216,38 +274,61 @@ multiplexer::handler(served::response & res, served::request & req)
 		// If all segments were matched then we have our chosen candidate
 		if ( seg_index == h_size )
 		{
-			pattern_matched = true;
-
-			// Check that the request method is supported by this candidate
-			auto method_handler = std::get<1>(candidate);
-			if ( ! method_handler.method_supported( req.method() ) )
-			{
-				throw served::request_error(served::status_4XX::METHOD_NOT_ALLOWED, "Method not allowed");
-			}
+			return &candidate;
+		}
+	}
+	return nullptr;
+}
 
-			// Collect parameters from REST path segments
-			for ( seg_index = 0; seg_index < h_size; seg_index++ )
-			{
-				handler_segments[seg_index]->get_param(req.params, request_segments[seg_index]);
-			}
+const multiplexer::path_handler_candidate *
+multiplexer::find_route(const served::request & req, std::vector<std::string> & request_segments) const
+{
+	request_segments = split_path(req.url().path());
+	if ( ! match_base_path(request_segments) )
+	{
+		return nullptr;
+	}
+	request_segments.erase(request_segments.begin(), request_segments.begin() + _base_path_segments.size());
 
-			method_handler[ req.method() ](res, req);
+	const path_handler_candidate * candidate = find_candidate(request_segments);
+	if ( ! candidate || ! std::get<1>(*candidate).method_supported(req.method()) )
+	{
+		return nullptr;
+	}
+	return candidate;
+}
 
+handler_executor_ptr
+multiplexer::find_executor(const served::request & req) const
+{
+	// Most endpoints run inline, so avoid matching the path unless an executor is registered.
+	bool has_executor = false;
+	for ( const auto & candidate : _handler_candidates )
+	{
+		if ( std::get<1>(candidate).executor() )
+		{
+			has_executor = true;
 			break;
 		}
 	}
+	if ( ! has_executor )
+	{
+		return nullptr;
+	}
 
-	// If no candidates were matched then we throw a 404
-	if ( ! pattern_matched )
+	std::vector<std::string> request_segments;
+	const path_handler_candidate * candidate = find_route(req, request_segments);
+	if ( ! candidate )
 	{
-		throw served::request_error(served::status_4XX::NOT_FOUND, "Path not found");
+		return nullptr;
 	}
+	return std::get<1>(*candidate).executor();
 }
 
 //  -----  request forwarding  -----
 
 void
-multiplexer::forward_to_handler(served::response & res, served::request & req)
+multiplexer::forward(served::response & res, served::request & req, served_handler_completion done)
 {
 	if ( _plugin_wrappers.size() > 0 )
 	{
@@ -255,7 +336,7 @@ multiplexer::forward_to_handler(served::response & res, served::request & req)
 		std::function<void()> iterate_wrappers = [&]() {
 			if ( wrapper_index == _plugin_wrappers.size() )
 			{
-				handler(res, req);
+				handler(res, req, done);
 			}
 			else
 			{
@@ -268,8 +349,95 @@ multiplexer::forward_to_handler(served::response & res, served::request & req)
 	}
 	else
 	{
-		handler(res, req);
+		handler(res, req, done);
+	}
+}
+
+void
+multiplexer::forward_to_handler(served::response & res, served::request & req)
+{
+	forward(res, req, [](std::exception_ptr) {});
+}
+
+void
+multiplexer::forward_to_handler( served::response &        res
+                               , served::request &         req
+                               , served_handler_completion done )
+{
+	// A wrapper may throw after the handler has completed, only the first outcome is reported.
+	auto called = std::make_shared<std::atomic<bool>>(false);
+	served_handler_completion done_once = [called, done](std::exception_ptr error) {
+		if ( ! called->exchange(true) )
+		{
+			done(error);
+		}
+	};
+
+	auto run = [this, &res, &req, done_once]() {
+		try
+		{
+			forward(res, req, done_once);
+		}
+		catch (...)
+		{
+			done_once(std::current_exception());
+		}
+	};
+
+	// The executor is chosen by the request as received, before any plugins run.
+	auto executor = find_executor(req);
+	if ( ! executor )
+	{
+		run();
+	}
+	else if ( ! executor->submit(run) )
+	{
+		done_once(std::make_exception_ptr(
+			served::request_error(served::status_5XX::SERVICE_UNAVAILABLE, "Service unavailable")));
+	}
+}
+
+served_body_chunk_handler
+multiplexer::open_body_stream(served::request & req)
+{
+	// Most endpoints store their bodies, so avoid matching the path unless a stream is registered.
+	bool has_stream = false;
+	for ( const auto & candidate : _handler_candidates )
+	{
+		if ( std::get<1>(candidate).body_stream_handler() )
+		{
+			has_stream = true;
+			break;
+		}
+	}
+	if ( ! has_stream )
+	{
+		return nullptr;
+	}
+
+	std::vector<std::string> request_segments;
+	const path_handler_candidate * candidate = find_route(req, request_segments);
+	if ( ! candidate || ! std::get<1>(*candidate).body_stream_handler() )
+	{
+		return nullptr;
+	}
+
+	// Collect parameters from REST path segments, so that they are available to the stream.
+	if ( ! _base_path_segments.empty() )
+	{
+		const auto path_segments = split_path(req.url().path());
+		for ( size_t seg_index = 0; seg_index < _base_path_segments.size(); seg_index++ )
+		{
+			_base_path_segments[seg_index]->get_param(req.params, path_segments[seg_index]);
+		}
 	}
+	const auto & handler_segments = std::get<0>(*candidate);
+	for ( size_t seg_index = 0; seg_index < handler_segments.size(); seg_index++ )
+	{
+		handler_segments[seg_index]->get_param(req.params, request_segments[seg_index]);
+	}
+
+	return std::get<1>(*candidate).body_stream_handler()(req);
 }
 
 void
@@ -23,6 +23,7 @@
 #ifndef SERVED_MULTIPLEXER_HPP
 #define SERVED_MULTIPLEXER_HPP
 
+#include <exception>
 #include <map>
 #include <tuple>
 #include <vector>
@@ -149,11 +150,44 @@ public:
 	 * Based on the URI target of the request object, forwards the request and response objects to
 	 * an appropriate handler for producing a response. Always chooses the first registered match.
 	 *
+	 * Asynchronous handlers are called but not waited for, so the response may not be complete
+	 * when this returns.
+	 *
 	 * @param res object used to generate an HTTP response
 	 * @param req object containing information about the HTTP request
 	 */
 	void forward_to_handler(served::response & res, served::request & req);
 
+	/*
+	 * Forwards a response and request object to a registered handler, which may complete later.
+	 *
+	 * If the matching endpoint has an executor the handler is run on one of its threads, and the
+	 * completion is called from that thread. Otherwise the handler is run and the completion
+	 * called before this call returns. Asynchronous handlers complete whenever, and on whichever
+	 * thread, they complete their deferred_response. The completion is called exactly once and
+	 * receives any exception thrown while handling the request. A full executor completes with a
+	 * request_error of 503 Service Unavailable. The request and response objects must remain
+	 * valid until completion.
+	 *
+	 * @param res object used to generate an HTTP response
+	 * @param req object containing information about the HTTP request
+	 * @param done called once the request has been handled
+	 */
+	void forward_to_handler(served::response & res, served::request & req, served_handler_completion done);
+
+	/*
+	 * Opens a stream for the body of a request, if its endpoint streams bodies.
+	 *
+	 * Should be called once the header of a request with a body has been received. Parameters
+	 * from the path are collected into the request before calling the body stream handler of
+	 * the endpoint. Errors raised by that handler are thrown.
+	 *
+	 * @param req object containing the header of the HTTP request
+	 *
+	 * @return the callback for chunks of the body, or an empty function if the body is stored
+	 */
+	served_body_chunk_handler open_body_stream(served::request & req);
+
 	/*
 	 * Triggers any post request handling work to be done.
 	 *
@@ -190,14 +224,64 @@ public:
 private:
 	//  -----  request handling  -----
 
+	/*
+	 * Calls the plugin wrappers, the innermost of which calls handler.
+	 *
+	 * @param res object used to generate an HTTP response
+	 * @param req object containing information about the HTTP request
+	 * @param done called once the handler has completed, unless an exception is thrown
+	 */
+	 void forward(served::response & res, served::request & req, served_handler_completion done);
+
 	/*
 	 * This is the actual request handler. It searches registered handlers for a match and, if
 	 * found, calls that handler with the request and response objects.
 	 *
+	 * Synchronous handlers call done before this returns, asynchronous handlers call it when
+	 * their deferred_response is completed. Errors raised before then are thrown.
+	 *
 	 * @param res object used to generate an HTTP response
 	 * @param req object containing information about the HTTP request
+	 * @param done called once the handler has completed, unless an exception is thrown
+	 */
+	 void handler(served::response & res, served::request & req, served_handler_completion done);
+
+	/*
+	 * Checks whether request path segments begin with the base path of the multiplexer.
+	 *
+	 * @param request_segments the segments of the request path
+	 *
+	 * @return true if the base path matches
+	 */
+	 bool match_base_path(const std::vector<std::string> & request_segments) const;
+
+	/*
+	 * Finds the first registered handler candidate matching the request path segments.
+	 *
+	 * @param request_segments the segments of the request path, following the base path
+	 *
+	 * @return the matching candidate, or nullptr if there is no match
+	 */
+	 const path_handler_candidate * find_candidate(const std::vector<std::string> & request_segments) const;
+
+	/*
+	 * Finds the endpoint a request would be forwarded to, if it supports the request method.
+	 *
+	 * @param req object containing information about the HTTP request
+	 * @param request_segments set to the segments of the request path, following the base path
+	 *
+	 * @return the matching candidate, or nullptr if there is no match
+	 */
+	 const path_handler_candidate * find_route(const served::request & req, std::vector<std::string> & request_segments) const;
+
+	/*
+	 * Finds the executor of the endpoint a request would be forwarded to.
+	 *
+	 * @param req object containing information about the HTTP request
+	 *
+	 * @return the executor, or an empty pointer if the request is handled inline
 	 */
-	 void handler(served::response & res, served::request & req);
+	 handler_executor_ptr find_executor(const served::request & req) const;
 
 	//  -----  path parsing/compiling  -----
 
@@ -22,11 +22,13 @@
 
 #include <test/catch.hpp>
 
+#include <future>
 #include <vector>
 
 #include <served/status.hpp>
 #include <served/request_error.hpp>
 #include <served/multiplexer.hpp>
+#include <served/handler_executor.hpp>
 #include <served/methods.hpp>
 #include <served/parameters.hpp>
 #include <served/version.hpp>
@@ -760,3 +762,155 @@ TEST_CASE("multiplexer endpoint list YAML", "[mux]")
 		REQUIRE(expected == res.to_buffer());
 	}
 }
+
+TEST_CASE("multiplexer forwards to executor handlers", "[mux]")
+{
+	auto executor = std::make_shared<served::handler_executor>(1, 1);
+
+	std::promise<void> release;
+	auto release_future = release.get_future().share();
+
+	served::multiplexer mux;
+	mux.handle("/inline")
+		.get([](served::response & res, const served::request &) {
+			res << "inline";
+		});
+	mux.handle("/executor")
+		.use_executor(executor)
+		.get([&](served::response & res, const served::request &) {
+			release_future.wait();
+			res << "executor";
+		});
+
+	SECTION("inline handlers complete before returning")
+	{
+		served::response res;
+		served::request  req;
+		served::uri url;
+		url.set_path("/inline");
+		req.set_destination(url);
+		req.set_method(served::method::GET);
+
+		bool done = false;
+		mux.forward_to_handler(res, req, [&](std::exception_ptr error) {
+			CHECK_FALSE(error);
+			done = true;
+		});
+		CHECK(done);
+
+		release.set_value();
+	}
+
+	SECTION("a full executor completes with 503")
+	{
+		served::response res[3];
+		served::request  req[3];
+		std::promise<std::thread::id> ran;
+		served::uri url;
+		url.set_path("/executor");
+		for ( int i = 0; i < 3; i++ )
+		{
+			req[i].set_destination(url);
+			req[i].set_method(served::method::GET);
+		}
+
+		// The first request blocks the only worker and the second fills its queue.
+		mux.forward_to_handler(res[0], req[0], [&](std::exception_ptr error) {
+			CHECK_FALSE(error);
+			ran.set_value(std::this_thread::get_id());
+		});
+		mux.forward_to_handler(res[1], req[1], [](std::exception_ptr) {});
+
+		int status = 0;
+		mux.forward_to_handler(res[2], req[2], [&](std::exception_ptr error) {
+			try
+			{
+				std::rethrow_exception(error);
+			}
+			catch (const served::request_error & e)
+			{
+				status = e.get_status_code();
+			}
+		});
+		CHECK(status == served::status_5XX::SERVICE_UNAVAILABLE);
+
+		release.set_value();
+		auto thread_id = ran.get_future().get();
+		CHECK(thread_id != std::this_thread::get_id());
+		executor->stop();
+	}
+}
+
+TEST_CASE("multiplexer forwards to async handlers", "[mux]")
+{
+	std::vector<served::deferred_response> pending;
+
+	served::multiplexer mux;
+	mux.handle("/later")
+		.get_async([&](served::response & res, const served::request &, served::deferred_response deferred) {
+			res << "later";
+			pending.push_back(deferred);
+		});
+	mux.handle("/throws")
+		.get_async([](served::response &, const served::request &, served::deferred_response) {
+			throw served::request_error(served::status_4XX::CONFLICT, "Conflict");
+		});
+
+	served::uri url;
+	served::response res;
+	served::request  req;
+	req.set_method(served::method::GET);
+
+	int                calls = 0;
+	std::exception_ptr result;
+	auto done = [&](std::exception_ptr error) {
+		calls++;
+		result = error;
+	};
+
+	SECTION("completes when the deferred response is completed")
+	{
+		url.set_path("/later");
+		req.set_destination(url);
+
+		mux.forward_to_handler(res, req, done);
+		CHECK(calls == 0);
+		REQUIRE(pending.size() == 1);
+
+		pending.front().complete();
+		CHECK(calls == 1);
+		CHECK_FALSE(result);
+		CHECK(res.body_size() == 5);
+	}
+
+	SECTION("abandoned responses complete with an error")
+	{
+		url.set_path("/later");
+		req.set_destination(url);
+
+		mux.forward_to_handler(res, req, done);
+		pending.clear();
+		CHECK(calls == 1);
+		CHECK(result);
+	}
+
+	SECTION("errors thrown by the handler are reported once")
+	{
+		url.set_path("/throws");
+		req.set_destination(url);
+
+		mux.forward_to_handler(res, req, done);
+		CHECK(calls == 1);
+
+		int status = 0;
+		try
+		{
+			std::rethrow_exception(result);
+		}
+		catch (const served::request_error & e)
+		{
+			status = e.get_status_code();
+		}
+		CHECK(status == served::status_4XX::CONFLICT);
+	}
+}
@@ -0,0 +1,232 @@
+/*
+ * Copyright (C) 2021 QM Ltd.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+#include <served/net/buffer_pool.hpp>
+
+#include <utility>
+
+using namespace served;
+using namespace served::net;
+
+const size_t buffer_pool::min_buffer_size;
+const size_t buffer_pool::max_buffer_size;
+const size_t buffer_pool::num_size_classes;
+
+namespace {
+
+/*
+ * The index of a size class, or num_size_classes for sizes that are not pooled.
+ */
+size_t
+class_index(size_t size)
+{
+	size_t index = 0;
+	for ( size_t class_size = buffer_pool::min_buffer_size; class_size < size; class_size *= 2 )
+	{
+		index++;
+	}
+	return index;
+}
+
+} // anonymous namespace
+
+//  -----  stats  -----
+
+buffer_pool_stats::buffer_pool_stats()
+	: allocated(0)
+	, reused(0)
+	, discarded(0)
+	, borrowed(0)
+	, pooled(0)
+	, pooled_bytes(0)
+{}
+
+buffer_pool_stats &
+buffer_pool_stats::operator+=(const buffer_pool_stats & other)
+{
+	allocated    += other.allocated;
+	reused       += other.reused;
+	discarded    += other.discarded;
+	borrowed     += other.borrowed;
+	pooled       += other.pooled;
+	pooled_bytes += other.pooled_bytes;
+	return *this;
+}
+
+//  -----  buffer  -----
+
+buffer_pool::buffer::buffer()
+	: _pool(nullptr)
+	, _data(nullptr)
+	, _size(0)
+{}
+
+buffer_pool::buffer::buffer(buffer_pool * pool, char * data, size_t size)
+	: _pool(pool)
+	, _data(data)
+	, _size(size)
+{}
+
+buffer_pool::buffer::buffer(buffer && other)
+	: _pool(other._pool)
+	, _data(other._data)
+	, _size(other._size)
+{
+	other._pool = nullptr;
+	other._data = nullptr;
+	other._size = 0;
+}
+
+buffer_pool::buffer &
+buffer_pool::buffer::operator=(buffer && other)
+{
+	if ( this != &other )
+	{
+		release();
+		std::swap(_pool, other._pool);
+		std::swap(_data, other._data);
+		std::swap(_size, other._size);
+	}
+	return *this;
+}
+
+buffer_pool::buffer::~buffer()
+{
+	release();
+}
+
+void
+buffer_pool::buffer::release()
+{
+	if ( _data )
+	{
+		_pool->release(_data, _size);
+		_pool = nullptr;
+		_data = nullptr;
+		_size = 0;
+	}
+}
+
+//  -----  buffer pool  -----
+
+buffer_pool::buffer_pool(size_t max_bytes)
+	: _max_bytes(max_bytes)
+{}
+
+buffer_pool::~buffer_pool()
+{
+	for ( auto & free : _free )
+	{
+		for ( char * data : free )
+		{
+			delete[] data;
+		}
+	}
+}
+
+size_t
+buffer_pool::class_size(size_t size)
+{
+	if ( size > max_buffer_size )
+	{
+		return size;
+	}
+	return min_buffer_size << class_index(size);
+}
+
+buffer_pool::buffer
+buffer_pool::acquire(size_t size)
+{
+	const size_t index = class_index(size);
+	size = class_size(size);
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		_stats.borrowed++;
+		if ( index < num_size_classes && ! _free[index].empty() )
+		{
+			char * data = _free[index].back();
+			_free[index].pop_back();
+
+			_stats.reused++;
+			_stats.pooled--;
+			_stats.pooled_bytes -= size;
+			return buffer(this, data, size);
+		}
+		_stats.allocated++;
+	}
+	return buffer(this, new char[size], size);
+}
+
+void
+buffer_pool::release(char * data, size_t size)
+{
+	const size_t index = class_index(size);
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		_stats.borrowed--;
+		if ( index < num_size_classes && _stats.pooled_bytes + size <= _max_bytes )
+		{
+			_free[index].push_back(data);
+			_stats.pooled++;
+			_stats.pooled_bytes += size;
+			return;
+		}
+		_stats.discarded++;
+	}
+	delete[] data;
+}
+
+void
+buffer_pool::set_max_bytes(size_t max_bytes)
+{
+	std::vector<char*> discard;
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		_max_bytes = max_bytes;
+
+		// The largest buffers are freed first.
+		for ( size_t index = num_size_classes; index-- > 0 && _stats.pooled_bytes > _max_bytes; )
+		{
+			auto & free = _free[index];
+			while ( ! free.empty() && _stats.pooled_bytes > _max_bytes )
+			{
+				discard.push_back(free.back());
+				free.pop_back();
+
+				_stats.pooled--;
+				_stats.pooled_bytes -= min_buffer_size << index;
+			}
+		}
+	}
+	for ( char * data : discard )
+	{
+		delete[] data;
+	}
+}
+
+buffer_pool_stats
+buffer_pool::stats() const
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+	return _stats;
+}
@@ -0,0 +1,160 @@
+/*
+ * Copyright (C) 2021 QM Ltd.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+#ifndef SERVED_BUFFER_POOL_HPP
+#define SERVED_BUFFER_POOL_HPP
+
+#include <array>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace served { namespace net {
+
+/*
+ * Counters describing the activity of a buffer pool.
+ */
+struct buffer_pool_stats
+{
+	size_t allocated;    // buffers allocated because the pool had none of their size
+	size_t reused;       // buffers taken from the pool
+	size_t discarded;    // buffers freed because the pool was at its limit
+	size_t borrowed;     // buffers currently held by connections
+	size_t pooled;       // buffers currently held by the pool
+	size_t pooled_bytes; // memory currently held by the pool
+
+	buffer_pool_stats();
+
+	buffer_pool_stats & operator+=(const buffer_pool_stats & other);
+};
+
+/*
+ * Lends read buffers to connections while bytes are arriving.
+ *
+ * Buffers come in size classes, doubling from min_buffer_size up to max_buffer_size, so that a
+ * connection receiving a large request head can read in larger buffers without each read
+ * allocating. A request for more than max_buffer_size is allocated and freed on its own.
+ *
+ * The pool may be used from multiple threads. Buffers must be returned before the pool is
+ * destroyed, which connections ensure by holding a reference to the pool.
+ */
+class buffer_pool
+{
+public:
+	static const size_t min_buffer_size  = 8192;
+	static const size_t max_buffer_size  = 65536;
+	static const size_t num_size_classes = 4;
+
+	/*
+	 * A buffer borrowed from the pool, returned when released or destroyed.
+	 */
+	class buffer
+	{
+		buffer_pool * _pool;
+		char *        _data;
+		size_t        _size;
+
+		friend class buffer_pool;
+		buffer(buffer_pool * pool, char * data, size_t size);
+
+	public:
+		buffer();
+		buffer(buffer && other);
+		buffer & operator=(buffer && other);
+		~buffer();
+
+		buffer(const buffer&) = delete;
+		buffer & operator=(const buffer&) = delete;
+
+		char * data() const { return _data; }
+
+		size_t size() const { return _size; }
+
+		explicit operator bool() const { return _data != nullptr; }
+
+		/*
+		 * Returns the buffer to its pool, if one is held.
+		 */
+		void release();
+	};
+
+private:
+	mutable std::mutex                                  _mutex;
+	std::array<std::vector<char*>, num_size_classes>    _free;
+	size_t                                              _max_bytes;
+	buffer_pool_stats                                   _stats;
+
+public:
+	buffer_pool(const buffer_pool&) = delete;
+
+	buffer_pool& operator=(const buffer_pool&) = delete;
+
+	/*
+	 * Constructs a buffer pool.
+	 *
+	 * @param max_bytes the maximum memory retained by buffers that are not borrowed
+	 */
+	explicit buffer_pool(size_t max_bytes = 4 * 1024 * 1024);
+
+	~buffer_pool();
+
+	/*
+	 * Borrows a buffer of at least the given size.
+	 *
+	 * @param size the number of bytes needed
+	 * @return the buffer, whose size is rounded up to its size class
+	 */
+	buffer acquire(size_t size = min_buffer_size);
+
+	/*
+	 * Sets the maximum memory retained by buffers that are not borrowed.
+	 *
+	 * @param max_bytes the maximum number of bytes
+	 */
+	void set_max_bytes(size_t max_bytes);
+
+	/*
+	 * Get the counters of the pool.
+	 *
+	 * @return a snapshot of the pool counters
+	 */
+	buffer_pool_stats stats() const;
+
+	/*
+	 * Rounds a size up to its size class.
+	 *
+	 * @param size the number of bytes needed
+	 * @return the size of the buffer that would be borrowed
+	 */
+	static size_t class_size(size_t size);
+
+private:
+	void release(char * data, size_t size);
+};
+
+typedef std::shared_ptr<buffer_pool> buffer_pool_ptr;
+
+} } // net, served
+
+#endif // SERVED_BUFFER_POOL_HPP
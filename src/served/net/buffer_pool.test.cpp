@@ -0,0 +1,188 @@
+/*
+ * Copyright (C) 2021 QM Ltd.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+#include <test/catch.hpp>
+
+#include <served/net/buffer_pool.hpp>
+#include <served/net/server.hpp>
+
+#include <boost/asio.hpp>
+#include <thread>
+
+TEST_CASE("buffer pool lends buffers", "[buffer_pool]")
+{
+	SECTION("sizes are rounded up to their size class")
+	{
+		served::net::buffer_pool pool;
+
+		CHECK(pool.acquire(1).size() == 8192);
+		CHECK(pool.acquire(8192).size() == 8192);
+		CHECK(pool.acquire(8193).size() == 16384);
+		CHECK(pool.acquire(65536).size() == 65536);
+
+		// Larger buffers are allocated on their own and not kept.
+		CHECK(pool.acquire(70000).size() == 70000);
+		CHECK(pool.stats().discarded == 1);
+	}
+
+	SECTION("released buffers are reused")
+	{
+		served::net::buffer_pool pool;
+
+		auto b = pool.acquire(20000);
+		char * data = b.data();
+		CHECK(pool.stats().borrowed == 1);
+		b.release();
+		CHECK_FALSE(b);
+
+		auto stats = pool.stats();
+		CHECK(stats.allocated == 1);
+		CHECK(stats.borrowed == 0);
+		CHECK(stats.pooled == 1);
+		CHECK(stats.pooled_bytes == 32768);
+
+		// A buffer of another size class is allocated.
+		auto small = pool.acquire(100);
+		CHECK(pool.stats().allocated == 2);
+
+		b = pool.acquire(30000);
+		CHECK(b.data() == data);
+
+		stats = pool.stats();
+		CHECK(stats.reused == 1);
+		CHECK(stats.borrowed == 2);
+		CHECK(stats.pooled == 0);
+		CHECK(stats.pooled_bytes == 0);
+	}
+
+	SECTION("the retained memory is limited")
+	{
+		served::net::buffer_pool pool(16384);
+
+		{
+			auto b1 = pool.acquire(8192);
+			auto b2 = pool.acquire(8192);
+			auto b3 = pool.acquire(8192);
+		}
+
+		auto stats = pool.stats();
+		CHECK(stats.pooled == 2);
+		CHECK(stats.discarded == 1);
+
+		pool.set_max_bytes(8192);
+		CHECK(pool.stats().pooled == 1);
+		pool.set_max_bytes(0);
+		CHECK(pool.stats().pooled_bytes == 0);
+	}
+
+	SECTION("buffers can be moved")
+	{
+		served::net::buffer_pool pool;
+
+		auto b1 = pool.acquire();
+		served::net::buffer_pool::buffer b2(std::move(b1));
+		CHECK_FALSE(b1);
+		CHECK(b2);
+
+		b1 = std::move(b2);
+		CHECK(b1);
+		CHECK(pool.stats().borrowed == 1);
+	}
+}
+
+namespace {
+
+std::string
+read_response(boost::asio::ip::tcp::socket & socket)
+{
+	boost::asio::streambuf buf;
+	size_t header_len = boost::asio::read_until(socket, buf, "\r\n\r\n");
+	std::string response(boost::asio::buffers_begin(buf.data()), boost::asio::buffers_end(buf.data()));
+
+	size_t pos = response.find("Content-Length: ");
+	REQUIRE(pos != std::string::npos);
+	size_t length = std::stoul(response.substr(pos + 16));
+	if ( response.size() < header_len + length )
+	{
+		boost::asio::read(socket, buf, boost::asio::transfer_exactly(header_len + length - response.size()));
+	}
+	return std::string(boost::asio::buffers_begin(buf.data()), boost::asio::buffers_end(buf.data()));
+}
+
+} // anonymous namespace
+
+TEST_CASE("idle connections hold no read buffer", "[buffer_pool]")
+{
+	const std::string large(100000, 'x');
+
+	served::multiplexer mux;
+	mux.handle("/hello")
+		.get([](served::response & res, const served::request &) {
+			res << "hello";
+		});
+	mux.handle("/large")
+		.get([&](served::response & res, const served::request & req) {
+			res << ( req.header_view("x-large") == large ? "intact" : "damaged" );
+		});
+
+	served::net::server server("127.0.0.1", "42817", mux, false);
+	std::thread server_thread([&]() { server.run(); });
+
+	boost::asio::io_service io_service;
+	auto endpoint = boost::asio::ip::tcp::endpoint(boost::asio::ip::address::from_string("127.0.0.1"), 42817);
+
+	const std::string requests[] = {
+		"GET /hello HTTP/1.1\r\n\r\n",
+		"GET /hello HTTP/1.1\r\n\r\n",
+		"GET /large HTTP/1.1\r\nX-Large: " + large + "\r\n\r\n",
+	};
+
+	std::vector<std::unique_ptr<boost::asio::ip::tcp::socket>> sockets;
+	std::vector<std::string> responses;
+	for ( const auto & request : requests )
+	{
+		sockets.emplace_back(new boost::asio::ip::tcp::socket(io_service));
+		sockets.back()->connect(endpoint);
+		boost::asio::write(*sockets.back(), boost::asio::buffer(request));
+
+		responses.push_back(read_response(*sockets.back()));
+	}
+
+	CHECK(responses[0].find("HTTP/1.1 200") == 0);
+	CHECK(responses[2].find("HTTP/1.1 200") == 0);
+
+	// The head arrived over many reads, a field split between them is kept whole.
+	CHECK(responses[2].substr(responses[2].size() - 6) == "intact");
+
+	// The connections are kept alive, but none of them is reading.
+	CHECK(server.get_connection_count() == 3);
+	auto stats = server.get_buffer_pool_stats();
+	CHECK(stats.borrowed == 0);
+
+	// The large head was read in buffers of growing size, which are kept for reuse.
+	CHECK(stats.allocated > 1);
+	CHECK(stats.pooled_bytes > served::net::buffer_pool::min_buffer_size);
+
+	server.stop();
+	server_thread.join();
+}
@@ -25,9 +25,19 @@
 #include <served/net/connection_manager.hpp>
 #include <served/request_error.hpp>
 
+#include <algorithm>
+#include <cctype>
+#include <cerrno>
 #include <utility>
 #include <vector>
 
+#if defined(__linux__)
+#include <signal.h>
+#include <sys/sendfile.h>
+#else
+#include <unistd.h>
+#endif
+
 using namespace served;
 using namespace served::net;
 
@@ -35,23 +45,83 @@ connection::connection( boost::asio::io_service &    io_service
                       , boost::asio::ip::tcp::socket socket
                       , connection_manager &         manager
                       , multiplexer        &         handler
+                      , timer_wheel_ptr              timers
                       , size_t                       max_req_size_bytes
                       , int                          read_timeout
                       , int                          write_timeout
+                      , int                          keep_alive_timeout /* = 0 */
+                      , size_t                       max_requests       /* = 0 */
+                      , int                          header_timeout     /* = 0 */
+                      , size_t                       max_stream_pending_bytes /* = 1024 * 1024 */
+                      , size_t                       http2_max_streams        /* = 0 */
+                      , tls_context_ptr              tls_context              /* = nullptr */
+                      , buffer_pool_ptr              buffers                  /* = nullptr */
                       )
 	: _io_service(io_service)
 	, _status(status_type::READING)
 	, _socket(std::move(socket))
+	, _transport(_socket)
 	, _connection_manager(manager)
 	, _request_handler(handler)
+	, _timers(std::move(timers))
+	, _buffers(buffers ? std::move(buffers) : std::make_shared<buffer_pool>())
+	, _buffer()
+	, _send_buffer()
+	, _read_size(buffer_pool::min_buffer_size)
 	, _max_req_size_bytes(max_req_size_bytes)
 	, _read_timeout(read_timeout)
 	, _write_timeout(write_timeout)
+	, _keep_alive_timeout(keep_alive_timeout)
+	, _header_timeout(header_timeout)
+	, _max_requests(max_requests)
+	, _requests_handled(0)
 	, _request()
 	, _request_parser(_request, _max_req_size_bytes)
-	, _read_timer(_io_service, boost::posix_time::milliseconds(read_timeout))
-	, _write_timer(_io_service, boost::posix_time::milliseconds(write_timeout))
-{}
+	, _write_queue()
+	, _write_index(0)
+	, _request_started(false)
+	, _handler_state(handler_state::IDLE)
+	, _handler_error()
+	, _draining(false)
+	, _max_stream_pending_bytes(max_stream_pending_bytes)
+	, _stream()
+	, _stream_chunked(true)
+	, _stream_writing(false)
+	, _stream_chunks()
+	, _stream_sizes()
+	, _read_timer()
+	, _write_timer()
+	, _header_timer()
+	, _heartbeat_timer()
+	, _websocket()
+	, _http2_max_streams(http2_max_streams)
+	, _http2()
+	, _tls_context(std::move(tls_context))
+	, _registry_self()
+	, _registry_admission()
+	, _registry_prev(nullptr)
+	, _registry_next(nullptr)
+	, _registry_bucket(0)
+{
+	_request_parser.set_body_stream_handler([this](const request &) {
+		return _request_handler.open_body_stream(_request);
+	});
+}
+
+connection::~connection()
+{
+	cancel_timer(_read_timer);
+	cancel_timer(_write_timer);
+	cancel_timer(_header_timer);
+	cancel_timer(_heartbeat_timer);
+
+	// No handler is running, so the current response may also hold a stream.
+	abort_streams();
+	if ( _response.body_stream() )
+	{
+		_response.body_stream()->abort();
+	}
+}
 
 void
 connection::start()
@@ -65,114 +135,700 @@ connection::start()
 	}
 
 	_request.set_source(endpoint.address().to_string());
+
+	// Reads wait for the socket to be readable, and then read without blocking.
+	_socket.non_blocking(true, ec);
+
+	// Timeouts hold a weak reference, so that a pending timeout does not keep the connection
+	// alive and has no effect once the connection is recycled.
+	std::weak_ptr<connection> weak_self(shared_from_this());
+	auto on_timeout = [weak_self]() {
+		if ( auto self = weak_self.lock() )
+		{
+			self->_connection_manager.stop(self);
+		}
+	};
+	_read_timer.set_callback(on_timeout);
+	_write_timer.set_callback(on_timeout);
+	_header_timer.set_callback(on_timeout);
+	_heartbeat_timer.set_callback([weak_self]() {
+		if ( auto self = weak_self.lock() )
+		{
+			self->send_heartbeat();
+		}
+	});
+
+#if defined(SERVED_TLS)
+	if ( _tls_context )
+	{
+		// The handshake is bounded by the timeouts of the first request.
+		do_handshake();
+		start_request_timers();
+		return;
+	}
+#endif
+
 	do_read();
 
-	if ( _read_timeout > 0 )
+	start_request_timers();
+}
+
+void
+connection::stop()
+{
+	cancel_timer(_read_timer);
+	cancel_timer(_write_timer);
+	cancel_timer(_header_timer);
+
+	abort_streams();
+
+	boost::system::error_code ignored_ec;
+	_socket.close(ignored_ec);
+}
+
+void
+connection::recycle()
+{
+	cancel_timer(_read_timer);
+	cancel_timer(_write_timer);
+	cancel_timer(_header_timer);
+	cancel_timer(_heartbeat_timer);
+
+	// No handler is running, so the current response may also hold a stream.
+	abort_streams();
+	if ( _response.body_stream() )
+	{
+		_response.body_stream()->abort();
+	}
+
+	boost::system::error_code ignored_ec;
+	_socket.close(ignored_ec);
+
+	_request.clear();
+	_request_parser.reset();
+	_request_parser.release();
+	_response.clear();
+	_write_queue.clear();
+	_stream_chunks.clear();
+	_stream_sizes.clear();
+	_websocket.reset();
+	_http2.reset();
+	_transport.reset();
+	_buffer.release();
+	_send_buffer.release();
+}
+
+void
+connection::reset(boost::asio::ip::tcp::socket socket)
+{
+	_socket = std::move(socket);
+	_status = status_type::READING;
+	_requests_handled = 0;
+
+	_write_index = 0;
+	_request_started = false;
+	_handler_state = handler_state::IDLE;
+	_handler_error = nullptr;
+	_draining = false;
+	_stream_writing = false;
+	_read_size = buffer_pool::min_buffer_size;
+}
+
+size_t
+connection::retained_bytes() const
+{
+	size_t bytes = sizeof(connection) + _request.capacity() + _request_parser.capacity() + _response.capacity();
+
+	bytes += _write_queue.capacity() * sizeof(response);
+	for ( const auto & res : _write_queue )
+	{
+		bytes += res.capacity();
+	}
+	bytes += _stream_chunks.capacity() * sizeof(stream_chunk_ptr);
+	bytes += _stream_sizes.capacity() * sizeof(std::string);
+	for ( const auto & size : _stream_sizes )
+	{
+		bytes += size.capacity();
+	}
+	return bytes;
+}
+
+void
+connection::drain()
+{
+	_draining = true;
+
+	if ( status_type::UPGRADED == _status && _websocket )
+	{
+		// The connection is closed once the closing handshake completes.
+		_websocket->close(1001, "Going away");
+		return;
+	}
+	if ( status_type::UPGRADED == _status && _http2 )
+	{
+		// Streams in progress are completed before the connection is closed.
+		_http2->shutdown();
+		return;
+	}
+
+	boost::system::error_code ec;
+	if ( ! _request_started && _write_queue.empty() && _socket.available(ec) == 0 )
+	{
+		_connection_manager.stop(shared_from_this());
+	}
+}
+
+void
+connection::start_timer(timer_wheel::entry & timer, int timeout_ms)
+{
+	if ( timeout_ms <= 0 )
+	{
+		cancel_timer(timer);
+		return;
+	}
+
+	_timers->schedule(timer, timeout_ms);
+}
+
+void
+connection::cancel_timer(timer_wheel::entry & timer)
+{
+	_timers->cancel(timer);
+}
+
+void
+connection::start_request_timers()
+{
+	start_timer(_read_timer, _read_timeout);
+	start_timer(_header_timer, _header_timeout);
+}
+
+namespace {
+
+std::string
+to_lower(std::string str)
+{
+	std::transform(str.begin(), str.end(), str.begin(), ::tolower);
+	return str;
+}
+
+/*
+ * Checks whether a comma separated header value, such as Connection, contains a token.
+ */
+bool
+header_has_token(const std::string & value, const std::string & token)
+{
+	size_t start = 0;
+	while ( start < value.length() )
 	{
-		auto self(shared_from_this());
+		size_t end = value.find(',', start);
+		if ( end == std::string::npos )
+		{
+			end = value.length();
+		}
+
+		size_t first = value.find_first_not_of(" \t", start);
+		size_t last  = value.find_last_not_of(" \t", end - 1);
 
-		_read_timer.async_wait([this, self](const boost::system::error_code& error) {
-			if ( error.value() != boost::system::errc::operation_canceled )
+		if ( first != std::string::npos && first < end && last >= first )
+		{
+			if ( to_lower(value.substr(first, last - first + 1)) == token )
 			{
-				_connection_manager.stop(shared_from_this());
+				return true;
 			}
-		});
+		}
+		start = end + 1;
 	}
+	return false;
 }
 
+/*
+ * Answers a request with an error thrown while handling it.
+ */
 void
-connection::stop()
+set_error_response(response & res, std::exception_ptr error)
 {
-	_socket.close();
+	try
+	{
+		std::rethrow_exception(error);
+	}
+	catch (const served::request_error & e)
+	{
+		res.set_status(e.get_status_code());
+		res.set_header("Content-Type", e.get_content_type());
+		res.set_body(e.what());
+	}
+	catch (...)
+	{
+		response::stock_reply(status_5XX::INTERNAL_SERVER_ERROR, res);
+	}
+}
+
+} // anonymous namespace
+
+bool
+connection::keep_alive_requested()
+{
+	if ( _draining )
+	{
+		return false;
+	}
+	if ( _max_requests > 0 && _requests_handled >= _max_requests )
+	{
+		return false;
+	}
+
+	const std::string connection_header = _request.header("connection");
+
+	if ( header_has_token(connection_header, "close") )
+	{
+		return false;
+	}
+	if ( header_has_token(connection_header, "keep-alive") )
+	{
+		return true;
+	}
+
+	// HTTP/1.1 connections are persistent by default, HTTP/1.0 are not.
+	return _request.HTTP_version() != "HTTP/1.0";
+}
+
+void
+connection::reset_for_next_request()
+{
+	const std::string source = _request.source();
+
+	_request.clear();
+	_request.set_source(source);
+	_response.clear();
+	_request_parser.reset();
 }
 
+#if defined(SERVED_TLS)
+void
+connection::do_handshake()
+{
+	auto self(shared_from_this());
+
+	auto & stream = _transport.start_tls(_tls_context->native_context());
+	stream.async_handshake(boost::asio::ssl::stream_base::server,
+		[this, self](boost::system::error_code ec) {
+			if ( !ec )
+			{
+				if ( _http2_max_streams > 0 && _transport.alpn_protocol() == "h2" )
+				{
+					start_http2(std::string());
+					return;
+				}
+				do_read();
+			}
+			else if ( ec != boost::asio::error::operation_aborted )
+			{
+				_connection_manager.stop(shared_from_this());
+			}
+		}
+	);
+}
+#endif
+
 void
 connection::do_read()
 {
 	auto self(shared_from_this());
 
-	_socket.async_read_some(boost::asio::buffer(_buffer.data(), _buffer.size()),
-		[this, self](boost::system::error_code ec, std::size_t bytes_transferred) {
-			if (!ec)
+	if ( _transport.is_tls() )
+	{
+		_buffer = _buffers->acquire(_read_size);
+		_transport.async_read_some(boost::asio::buffer(_buffer.data(), _buffer.size()),
+			[this, self](boost::system::error_code ec, std::size_t bytes_transferred) {
+				on_read(ec, bytes_transferred);
+			}
+		);
+		return;
+	}
+
+	_socket.async_wait(boost::asio::ip::tcp::socket::wait_read,
+		[this, self](boost::system::error_code ec) {
+			if (ec)
 			{
-				request_parser_impl::status_type result;
-				result = _request_parser.parse(_buffer.data(), bytes_transferred);
+				on_read(ec, 0);
+				return;
+			}
 
-				if ( request_parser_impl::FINISHED == result )
-				{
-					// Parsing is finished, stop reading and send response.
+			// The socket is non-blocking, so the read returns what has arrived without waiting.
+			_buffer = _buffers->acquire(_read_size);
+			size_t bytes_transferred = _socket.read_some(boost::asio::buffer(_buffer.data(), _buffer.size()), ec);
+			if ( ec == boost::asio::error::would_block || ec == boost::asio::error::try_again )
+			{
+				_buffer.release();
+				do_read();
+				return;
+			}
+			on_read(ec, bytes_transferred);
+		}
+	);
+}
 
-					_read_timer.cancel();
-					_status = status_type::DONE;
+void
+connection::on_read(boost::system::error_code ec, size_t bytes_transferred)
+{
+	if (ec)
+	{
+		_buffer.release();
+		if (ec != boost::asio::error::operation_aborted)
+		{
+			_connection_manager.stop(shared_from_this());
+		}
+		return;
+	}
 
-					try
-					{
-						_request_handler.forward_to_handler(_response, _request);
-					}
-					catch (const served::request_error & e)
-					{
-						_response.set_status(e.get_status_code());
-						_response.set_header("Content-Type", e.get_content_type());
-						_response.set_body(e.what());
-					}
-					catch (...)
-					{
-						response::stock_reply(status_5XX::INTERNAL_SERVER_ERROR, _response);
-					}
+	if ( status_type::KEEP_ALIVE == _status )
+	{
+		// The next request has started arriving, swap the idle timeout for the read timeout.
+		_status = status_type::READING;
+		start_request_timers();
+	}
 
-					if ( _write_timeout > 0 )
-					{
-						_write_timer.async_wait([this, self](const boost::system::error_code& error) {
-							if ( error.value() != boost::system::errc::operation_canceled )
-							{
-								_connection_manager.stop(shared_from_this());
-							}
-						});
-					}
-					do_write();
+	if ( _http2_max_streams > 0 && ! _request_started && _requests_handled == 0
+	  && http2_session::is_preface(_buffer.data(), bytes_transferred) )
+	{
+		// The client knows that HTTP/2 is supported and starts with its preface.
+		std::string initial_bytes(_buffer.data(), bytes_transferred);
+		_buffer.release();
+		start_http2(std::move(initial_bytes));
+		return;
+	}
 
-					try
-					{
-						_request_handler.on_request_handled(_response, _request);
-					}
-					catch (...)
+	// A read that fills the buffer is likely followed by more, such as the rest of a large
+	// request head, so the next read borrows a buffer of the next size class.
+	if ( bytes_transferred == _buffer.size() )
+	{
+		_read_size = std::min(_buffer.size() * 2, buffer_pool::max_buffer_size);
+	}
+	else
+	{
+		_read_size = buffer_pool::min_buffer_size;
+	}
+
+	// The parser keeps what it needs of the bytes, so the buffer is returned straight away.
+	_request_started = true;
+	auto result = _request_parser.parse(_buffer.data(), bytes_transferred);
+	_buffer.release();
+
+	process(result);
+}
+
+void
+connection::process(request_parser_impl::status_type result)
+{
+	while ( request_parser_impl::FINISHED == result )
+	{
+		// Parsing is finished, handle the request and queue the response.
+
+		cancel_timer(_read_timer);
+		cancel_timer(_header_timer);
+
+		if ( ! handle_request() )
+		{
+			// The handler completes later, processing resumes once it does.
+			return;
+		}
+
+		if ( ! next_request(result) )
+		{
+			break;
+		}
+	}
+
+	if ( request_parser_impl::READ_HEADER != result )
+	{
+		// The header has been received in full.
+		cancel_timer(_header_timer);
+	}
+
+	if ( request_parser_impl::EXPECT_CONTINUE == result )
+	{
+		// The client is expecting a 100-continue, so we serve it and continue reading.
+
+		response::stock_reply(served::status_1XX::CONTINUE, _response);
+		queue_response();
+	}
+	else if ( request_parser_impl::REJECTED_REQUEST_SIZE == result )
+	{
+		// The request is too large and has been rejected
+
+		_status = status_type::DONE;
+
+		response::stock_reply(served::status_4XX::REQ_ENTITY_TOO_LARGE, _response);
+		_response.set_header("Connection", "close");
+		queue_response();
+	}
+	else if ( request_parser_impl::ERROR == result )
+	{
+		// Error occurred while parsing, respond with BAD_REQUEST unless a body stream failed
+
+		_status = status_type::DONE;
+
+		auto error = _request_parser.take_error();
+		if ( error )
+		{
+			set_error_response(_response, error);
+		}
+		else
+		{
+			response::stock_reply(served::status_4XX::BAD_REQUEST, _response);
+		}
+		_response.set_header("Connection", "close");
+		queue_response();
+	}
+
+	flush();
+}
+
+bool
+connection::next_request(request_parser_impl::status_type & result)
+{
+	if ( status_type::DONE == _status || status_type::UPGRADED == _status )
+	{
+		return false;
+	}
+
+	// Any bytes received beyond this request are the start of the next pipelined request.
+	std::string pipelined = _request_parser.take_pipelined_bytes();
+	reset_for_next_request();
+
+	if ( pipelined.empty() )
+	{
+		return false;
+	}
+
+	_status = status_type::READING;
+	start_request_timers();
+	result = _request_parser.parse(pipelined.data(), pipelined.length());
+	return true;
+}
+
+void
+connection::flush()
+{
+	if ( ! _write_queue.empty() )
+	{
+		// Responses for the whole batch go out in a single write.
+
+		start_timer(_write_timer, _write_timeout);
+		do_write();
+	}
+	else
+	{
+		// Not finished reading request, continue.
+
+		do_read();
+	}
+}
+
+namespace {
+
+// The io_service of the connection currently calling a handler on this thread.
+thread_local boost::asio::io_service * handler_io_service = nullptr;
+
+} // anonymous namespace
+
+boost::asio::io_service *
+connection::current_io_service()
+{
+	return handler_io_service;
+}
+
+boost::asio::io_service *
+connection::exchange_current_io_service(boost::asio::io_service * io_service)
+{
+	std::swap(io_service, handler_io_service);
+	return io_service;
+}
+
+bool
+connection::handle_request()
+{
+	_requests_handled++;
+
+	if ( upgrade_to_http2() )
+	{
+		return true;
+	}
+
+	// The client is waiting on the response from here on, so a handler that completes later is
+	// covered by the write timeout. This is started first as a late completion may be written
+	// from another thread before the handler returns.
+	start_timer(_write_timer, _write_timeout);
+
+	auto self(shared_from_this());
+
+	auto outer_io_service = handler_io_service;
+	handler_io_service    = &_io_service;
+
+	_response.set_max_stream_pending_bytes(_max_stream_pending_bytes);
+
+	_handler_error = nullptr;
+	_handler_state = handler_state::RUNNING;
+	_request_handler.forward_to_handler(_response, _request,
+		[this, self](std::exception_ptr error) {
+			_handler_error = error;
+			if ( _handler_state.exchange(handler_state::COMPLETED) == handler_state::RUNNING )
+			{
+				// Completed before the handler returned, which completes the request on return.
+				return;
+			}
+
+			// Completed later, the response is written from the I/O thread.
+			_io_service.post([this, self, error]() {
+				if ( ! _socket.is_open() )
+				{
+					// Stopped while the handler was running.
+					if ( _response.body_stream() )
 					{
+						_response.body_stream()->abort();
 					}
+					return;
 				}
-				else if ( request_parser_impl::EXPECT_CONTINUE == result )
-				{
-					// The client is expecting a 100-continue, so we serve it and continue reading.
 
-					response::stock_reply(served::status_1XX::CONTINUE, _response);
-					do_write();
-				}
-				else if ( request_parser_impl::READ_HEADER == result
-				       || request_parser_impl::READ_BODY   == result )
-				{
-					// Not finished reading response, continue.
+				complete_request(error);
 
-					do_read();
+				request_parser_impl::status_type result;
+				if ( next_request(result) )
+				{
+					process(result);
 				}
-				else if ( request_parser_impl::REJECTED_REQUEST_SIZE == result )
+				else
 				{
-					// The request is too large and has been rejected
+					flush();
+				}
+			});
+		});
 
-					_status = status_type::DONE;
+	handler_io_service = outer_io_service;
 
-					response::stock_reply(served::status_4XX::REQ_ENTITY_TOO_LARGE, _response);
-					do_write();
-				}
-				else if ( request_parser_impl::ERROR == result )
-				{
-					// Error occurred while parsing, respond with BAD_REQUEST
+	if ( _handler_state.exchange(handler_state::RETURNED) != handler_state::COMPLETED )
+	{
+		// The completion is posted to the io_service, and may run on another thread from here.
+		return false;
+	}
+
+	complete_request(_handler_error);
+	return true;
+}
+
+void
+connection::complete_request(std::exception_ptr error)
+{
+	if ( error )
+	{
+		set_error_response(_response, error);
+	}
+
+	// HTTP/1.0 clients do not support chunked encoding, a streamed body is ended by closing.
+	const bool unframed_stream = _response.body_stream() && _request.HTTP_version() == "HTTP/1.0";
+	if ( unframed_stream )
+	{
+		_response.set_stream_chunked(false);
+	}
+
+	if ( _response.upgraded_websocket() && _response.status() == status_1XX::SWITCHING_PROTOCOLS )
+	{
+		// Bytes after the upgrade request belong to the websocket.
+		_status    = status_type::UPGRADED;
+		_websocket = _response.upgraded_websocket();
+	}
+	else if ( ! unframed_stream && keep_alive_requested() )
+	{
+		_status = status_type::KEEP_ALIVE;
+		if ( _request.HTTP_version() == "HTTP/1.0" )
+		{
+			_response.set_header("Connection", "keep-alive");
+		}
+	}
+	else
+	{
+		_status = status_type::DONE;
+		_response.set_header("Connection", "close");
+	}
+
+	try
+	{
+		_request_handler.on_request_handled(_response, _request);
+	}
+	catch (...)
+	{
+	}
+
+	queue_response();
+}
+
+void
+connection::queue_response()
+{
+	_write_queue.push_back(std::move(_response));
+	_response.clear();
+}
+
+void
+connection::do_write()
+{
+	if ( _write_index == _write_queue.size() )
+	{
+		on_write_complete();
+		return;
+	}
+
+	auto self(shared_from_this());
+
+	// Headers and bodies of queued responses are written as one buffer sequence, bodies are
+	// referenced in place rather than copied.
+	std::vector<boost::asio::const_buffer> buffers;
+	buffers.reserve((_write_queue.size() - _write_index) * 2);
+
+	file_handle_ptr    file;
+	size_t             file_offset = 0;
+	size_t             file_length = 0;
+	stream_channel_ptr stream;
+
+	for ( ; _write_index < _write_queue.size(); )
+	{
+		auto & res = _write_queue[_write_index++];
+		res.to_buffers(buffers);
 
-					_status = status_type::DONE;
+		if ( res.file_body() )
+		{
+			file        = res.file_body();
+			file_offset = res.file_body_offset();
+			file_length = res.file_body_length();
+			break;
+		}
+		if ( res.body_stream() )
+		{
+			stream          = res.body_stream();
+			_stream_chunked = res.stream_chunked();
+			break;
+		}
+	}
 
-					response::stock_reply(served::status_4XX::BAD_REQUEST, _response);
+	boost::asio::async_write(_transport, buffers,
+		[this, self, file, file_offset, file_length, stream](boost::system::error_code ec, std::size_t) {
+			if ( !ec )
+			{
+				if ( file )
+				{
+					do_send_file(file, file_offset, file_length);
+				}
+				else if ( stream )
+				{
+					start_stream(stream);
+				}
+				else
+				{
 					do_write();
 				}
 			}
-			else if (ec != boost::asio::error::operation_aborted)
+			else if ( ec != boost::asio::error::operation_aborted )
 			{
 				_connection_manager.stop(shared_from_this());
 			}
@@ -180,33 +836,452 @@ connection::do_read()
 	);
 }
 
+#if defined(__linux__)
+namespace {
+
+/*
+ * Blocks SIGPIPE on the calling thread for its lifetime.
+ *
+ * Unlike send, sendfile has no flag to suppress the signal raised by writing to a socket that
+ * the peer has closed, which would otherwise terminate the process. A SIGPIPE raised while the
+ * guard is held is consumed before the signal mask is restored.
+ */
+class sigpipe_guard
+{
+	sigset_t _pipe;
+	sigset_t _previous;
+	bool     _was_pending;
+
+public:
+	sigpipe_guard(const sigpipe_guard&) = delete;
+
+	sigpipe_guard& operator=(const sigpipe_guard&) = delete;
+
+	sigpipe_guard()
+	{
+		::sigemptyset(&_pipe);
+		::sigaddset(&_pipe, SIGPIPE);
+		::pthread_sigmask(SIG_BLOCK, &_pipe, &_previous);
+		_was_pending = is_pending();
+	}
+
+	~sigpipe_guard()
+	{
+		if ( ! _was_pending && is_pending() )
+		{
+			const timespec no_wait = { 0, 0 };
+			while ( ::sigtimedwait(&_pipe, nullptr, &no_wait) < 0 && errno == EINTR ) {}
+		}
+		::pthread_sigmask(SIG_SETMASK, &_previous, nullptr);
+	}
+
+private:
+	static bool is_pending()
+	{
+		sigset_t pending;
+		::sigpending(&pending);
+		return ::sigismember(&pending, SIGPIPE) == 1;
+	}
+};
+
+} // anonymous namespace
+#endif // defined(__linux__)
+
 void
-connection::do_write()
+connection::do_send_file(file_handle_ptr file, size_t offset, size_t remaining)
 {
 	auto self(shared_from_this());
 
-	boost::asio::async_write(_socket, boost::asio::buffer(_response.to_buffer()),
-		[this, self](boost::system::error_code ec, std::size_t) {
+#if defined(__linux__)
+	if ( ! _transport.is_tls() )
+	{
+		boost::system::error_code ec;
+		_socket.native_non_blocking(true, ec);
+
+		// The signal is blocked for the whole batch of calls rather than each of them.
+		bool would_block = false;
+		{
+			sigpipe_guard guard;
+			while ( !ec && remaining > 0 )
+			{
+				off_t   off = offset;
+				ssize_t n   = ::sendfile(_socket.native_handle(), file->fd(), &off,
+				                         std::min<size_t>(remaining, 0x7ffff000));
+				if ( n > 0 )
+				{
+					offset    += n;
+					remaining -= n;
+				}
+				else if ( n < 0 && errno == EINTR )
+				{
+					continue;
+				}
+				else if ( n < 0 && ( errno == EAGAIN || errno == EWOULDBLOCK ) )
+				{
+					would_block = true;
+					break;
+				}
+				else
+				{
+					// The file was truncated or the socket failed, the response cannot be completed.
+					ec = boost::asio::error::broken_pipe;
+				}
+			}
+		}
+
+		if ( would_block )
+		{
+			// The socket buffer is full, continue once it becomes writable again.
+			_socket.async_wait(boost::asio::ip::tcp::socket::wait_write,
+				[this, self, file, offset, remaining](boost::system::error_code ec) {
+					if ( !ec )
+					{
+						do_send_file(file, offset, remaining);
+					}
+					else if ( ec != boost::asio::error::operation_aborted )
+					{
+						_connection_manager.stop(shared_from_this());
+					}
+				});
+			return;
+		}
+
+		if ( ec )
+		{
+			_connection_manager.stop(shared_from_this());
+			return;
+		}
+
+		do_write();
+		return;
+	}
+#endif // defined(__linux__)
+
+	if ( remaining == 0 )
+	{
+		_send_buffer.release();
+		do_write();
+		return;
+	}
+
+	// Without sendfile, or over TLS, the file is sent through a borrowed buffer.
+	if ( ! _send_buffer )
+	{
+		_send_buffer = _buffers->acquire(buffer_pool::max_buffer_size);
+	}
+	ssize_t n = ::pread(file->fd(), _send_buffer.data(), std::min(_send_buffer.size(), remaining), offset);
+	if ( n <= 0 )
+	{
+		_send_buffer.release();
+		_connection_manager.stop(shared_from_this());
+		return;
+	}
+
+	boost::asio::async_write(_transport, boost::asio::buffer(_send_buffer.data(), n),
+		[this, self, file, offset, remaining](boost::system::error_code ec, std::size_t bytes) {
 			if ( !ec )
 			{
-				if ( status_type::READING == _status )
+				do_send_file(file, offset + bytes, remaining - bytes);
+			}
+			else if ( ec != boost::asio::error::operation_aborted )
+			{
+				_connection_manager.stop(shared_from_this());
+			}
+		});
+}
+
+namespace {
+
+/*
+ * Formats the size line that starts a chunk of a chunked response.
+ */
+std::string
+chunk_size_line(size_t size)
+{
+	static const char digits[] = "0123456789abcdef";
+
+	char   line[2 * sizeof(size_t) + 2];
+	size_t pos = sizeof(line);
+
+	line[--pos] = '\n';
+	line[--pos] = '\r';
+	do
+	{
+		line[--pos] = digits[size & 0xf];
+		size >>= 4;
+	}
+	while ( size > 0 );
+
+	return std::string(line + pos, sizeof(line) - pos);
+}
+
+const char chunk_crlf[] = { '\r', '\n' };
+const char last_chunk[] = { '0', '\r', '\n', '\r', '\n' };
+
+} // anonymous namespace
+
+void
+connection::start_stream(stream_channel_ptr stream)
+{
+	_stream         = std::move(stream);
+	_stream_writing = false;
+
+	// Between writes the connection waits on the handler rather than the client.
+	cancel_timer(_write_timer);
+
+	// The channel may outlive the connection, so it only holds a weak reference.
+	std::weak_ptr<connection> weak_self(shared_from_this());
+	boost::asio::io_service & io_service = _io_service;
+	_stream->attach([weak_self, &io_service]() {
+		io_service.post([weak_self]() {
+			if ( auto self = weak_self.lock() )
+			{
+				self->do_write_stream();
+			}
+		});
+	});
+
+	start_timer(_heartbeat_timer, _stream->heartbeat_interval());
+}
+
+void
+connection::do_write_stream()
+{
+	if ( ! _stream || _stream_writing )
+	{
+		return;
+	}
+	if ( _stream->is_disconnected() )
+	{
+		_connection_manager.stop(shared_from_this());
+		return;
+	}
+
+	_stream_chunks.clear();
+	const bool last = _stream->take(_stream_chunks);
+	if ( _stream_chunks.empty() && ! last )
+	{
+		// Waiting for the handler to write more.
+		return;
+	}
+
+	std::vector<boost::asio::const_buffer> buffers;
+	buffers.reserve(_stream_chunks.size() * 3 + 1);
+	_stream_sizes.resize(_stream_chunks.size());
+
+	size_t bytes = 0;
+	for ( size_t i = 0; i < _stream_chunks.size(); i++ )
+	{
+		const auto & chunk = *_stream_chunks[i];
+		bytes += chunk.size();
+
+		if ( _stream_chunked )
+		{
+			_stream_sizes[i] = chunk_size_line(chunk.size());
+			buffers.push_back(boost::asio::buffer(_stream_sizes[i]));
+			buffers.push_back(boost::asio::buffer(chunk));
+			buffers.push_back(boost::asio::buffer(chunk_crlf));
+		}
+		else
+		{
+			buffers.push_back(boost::asio::buffer(chunk));
+		}
+	}
+	if ( last && _stream_chunked )
+	{
+		buffers.push_back(boost::asio::buffer(last_chunk));
+	}
+
+	auto self(shared_from_this());
+
+	_stream_writing = true;
+	start_timer(_write_timer, _write_timeout);
+
+	boost::asio::async_write(_transport, buffers,
+		[this, self, bytes, last](boost::system::error_code ec, std::size_t) {
+			_stream_writing = false;
+			if ( !ec )
+			{
+				if ( ! _stream )
 				{
-					// If we're still reading from the client then continue
-					do_read();
+					// Aborted while writing.
 					return;
 				}
+
+				cancel_timer(_write_timer);
+				_stream_chunks.clear();
+
+				// Writers waiting on the limit are resumed from here.
+				_stream->written(bytes);
+
+				if ( last )
+				{
+					cancel_timer(_heartbeat_timer);
+					_stream->attach(nullptr);
+					_stream.reset();
+					do_write();
+				}
 				else
 				{
-					// Initiate graceful connection closure.
-					boost::system::error_code ignored_ec;
-					_socket.shutdown(boost::asio::ip::tcp::socket::shutdown_both, ignored_ec);
+					do_write_stream();
 				}
 			}
-
-			if ( ec != boost::asio::error::operation_aborted )
+			else if ( ec != boost::asio::error::operation_aborted )
 			{
 				_connection_manager.stop(shared_from_this());
 			}
 		}
 	);
 }
+
+void
+connection::abort_streams()
+{
+	cancel_timer(_heartbeat_timer);
+	if ( _stream )
+	{
+		_stream->abort();
+		_stream.reset();
+	}
+	for ( const auto & res : _write_queue )
+	{
+		if ( res.body_stream() )
+		{
+			res.body_stream()->abort();
+		}
+	}
+}
+
+void
+connection::send_heartbeat()
+{
+	if ( ! _stream )
+	{
+		return;
+	}
+	if ( ! _stream->heartbeat() )
+	{
+		_connection_manager.stop(shared_from_this());
+		return;
+	}
+	start_timer(_heartbeat_timer, _stream->heartbeat_interval());
+}
+
+void
+connection::start_websocket()
+{
+	cancel_timer(_read_timer);
+	cancel_timer(_header_timer);
+
+	auto self(shared_from_this());
+	_websocket->start(_io_service, _transport, self, _request_parser.take_pipelined_bytes(), [this, self]() {
+		_websocket.reset();
+		_connection_manager.stop(self);
+	});
+}
+
+bool
+connection::upgrade_to_http2()
+{
+	// h2c is only defined for cleartext connections, TLS clients select h2 with ALPN instead.
+	if ( _http2_max_streams == 0 || _draining || _transport.is_tls() || _request.HTTP_version() != "HTTP/1.1" )
+	{
+		return false;
+	}
+
+	const std::string settings = _request.header("http2-settings");
+	if ( ! header_has_token(_request.header("upgrade"), "h2c") || settings.empty()
+	  || ! header_has_token(_request.header("connection"), "http2-settings") )
+	{
+		return false;
+	}
+
+	auto session = std::make_shared<http2_session>( _request_handler
+	                                              , _timers
+	                                              , _max_req_size_bytes
+	                                              , _http2_max_streams
+	                                              , _max_stream_pending_bytes
+	                                              , _keep_alive_timeout );
+	if ( ! session->upgrade(_request, settings) )
+	{
+		return false;
+	}
+
+	// The request is answered over HTTP/2 once the switch is written.
+	_status = status_type::UPGRADED;
+	_http2  = std::move(session);
+
+	_response.set_status(status_1XX::SWITCHING_PROTOCOLS);
+	_response.set_header("Connection", "Upgrade");
+	_response.set_header("Upgrade", "h2c");
+	queue_response();
+	return true;
+}
+
+void
+connection::start_http2(std::string initial_bytes)
+{
+	cancel_timer(_read_timer);
+	cancel_timer(_header_timer);
+	cancel_timer(_write_timer);
+
+	_status = status_type::UPGRADED;
+	if ( ! _http2 )
+	{
+		_http2 = std::make_shared<http2_session>( _request_handler
+		                                        , _timers
+		                                        , _max_req_size_bytes
+		                                        , _http2_max_streams
+		                                        , _max_stream_pending_bytes
+		                                        , _keep_alive_timeout );
+	}
+
+	auto self(shared_from_this());
+	_http2->start(_io_service, _transport, self, _request.source(), std::move(initial_bytes), [this, self]() {
+		_http2.reset();
+		_connection_manager.stop(self);
+	});
+}
+
+void
+connection::on_write_complete()
+{
+	cancel_timer(_write_timer);
+	_write_queue.clear();
+	_write_index = 0;
+
+	if ( status_type::READING == _status )
+	{
+		// If we're still reading from the client then continue
+		do_read();
+	}
+	else if ( status_type::UPGRADED == _status && _http2 )
+	{
+		start_http2(_request_parser.take_pipelined_bytes());
+	}
+	else if ( status_type::UPGRADED == _status )
+	{
+		start_websocket();
+	}
+	else if ( status_type::KEEP_ALIVE == _status && ! _draining )
+	{
+		// Persistent connection, wait for the next request on the same socket. Like the read
+		// buffer, the header buffer and a write queue grown by pipelining are not held while
+		// waiting.
+		_request_started = false;
+		_request_parser.release_header();
+		if ( _write_queue.capacity() > max_retained_responses )
+		{
+			std::vector<response>().swap(_write_queue);
+		}
+		start_timer(_read_timer, _keep_alive_timeout);
+		do_read();
+	}
+	else
+	{
+		// Initiate graceful connection closure.
+		boost::system::error_code ignored_ec;
+		_socket.shutdown(boost::asio::ip::tcp::socket::shutdown_both, ignored_ec);
+		_connection_manager.stop(shared_from_this());
+	}
+}
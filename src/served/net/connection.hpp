@@ -23,15 +23,24 @@
 #ifndef SERVED_CONNECTION_HPP
 #define SERVED_CONNECTION_HPP
 
+#include <served/boost_compat.hpp>
 #include <boost/asio.hpp>
 
 #include <served/multiplexer.hpp>
 #include <served/response.hpp>
 #include <served/request.hpp>
 #include <served/request_parser_impl.hpp>
+#include <served/net/buffer_pool.hpp>
+#include <served/net/http2_session.hpp>
+#include <served/net/timer_wheel.hpp>
+#include <served/net/tls_context.hpp>
+#include <served/net/transport.hpp>
+#include <served/websocket.hpp>
 
-#include <array>
+#include <atomic>
 #include <memory>
+#include <string>
+#include <vector>
 
 namespace served { namespace net {
 
@@ -41,28 +50,78 @@ class connection_manager;
  * Manages the lifecycle of a single HTTP connection.
  *
  * A connection is created by the server each time a new client connects.
+ *
+ * A keep-alive connection waiting for its next request holds no read or header buffer, so it costs
+ * about 2 KB: the connection object of some 1.8 KB, which embeds the request, parser and response,
+ * and a slot of its write queue.
  */
 class connection
 	: public std::enable_shared_from_this<connection>
 {
 public:
-	enum status_type { READING = 0, DONE };
+	enum status_type { READING = 0, KEEP_ALIVE, DONE, UPGRADED };
 
 private:
+	/*
+	 * The progress of a request handler. The thread that returns from the handler and the thread
+	 * that completes it each exchange the state once, and whichever is second completes the
+	 * request, so a handler completed from another thread is never completed twice.
+	 */
+	enum class handler_state { IDLE = 0, RUNNING, RETURNED, COMPLETED };
+
+	// Write queues grown by pipelined requests are freed when the connection goes idle
+	static const size_t max_retained_responses = 1;
+
 	boost::asio::io_service &    _io_service;
 	status_type                  _status;
 	boost::asio::ip::tcp::socket _socket;
+	transport                    _transport;
 	connection_manager &         _connection_manager;
 	multiplexer        &         _request_handler;
-	std::array<char, 8192>       _buffer;
+	timer_wheel_ptr              _timers;
+	buffer_pool_ptr              _buffers;
+	buffer_pool::buffer          _buffer;
+	buffer_pool::buffer          _send_buffer;
+	size_t                       _read_size;
 	size_t                       _max_req_size_bytes;
 	int                          _read_timeout;
 	int                          _write_timeout;
+	int                          _keep_alive_timeout;
+	int                          _header_timeout;
+	size_t                       _max_requests;
+	size_t                       _requests_handled;
 	request                      _request;
 	request_parser_impl          _request_parser;
 	response                     _response;
-	boost::asio::deadline_timer  _read_timer;
-	boost::asio::deadline_timer  _write_timer;
+	std::vector<response>        _write_queue;
+	size_t                       _write_index;
+	bool                         _request_started;
+	std::atomic<handler_state>   _handler_state;
+	std::exception_ptr           _handler_error;
+	std::atomic<bool>            _draining;
+	size_t                       _max_stream_pending_bytes;
+	stream_channel_ptr           _stream;
+	bool                         _stream_chunked;
+	bool                         _stream_writing;
+	std::vector<stream_chunk_ptr> _stream_chunks;
+	std::vector<std::string>     _stream_sizes;
+	timer_wheel::entry           _read_timer;
+	timer_wheel::entry           _write_timer;
+	timer_wheel::entry           _header_timer;
+	timer_wheel::entry           _heartbeat_timer;
+	websocket_ptr                _websocket;
+	size_t                       _http2_max_streams;
+	http2_session_ptr            _http2;
+	tls_context_ptr              _tls_context;
+
+	// Intrusive registration in the connection manager, guarded by the manager.
+	friend class connection_manager;
+	friend class http2_session;
+	std::shared_ptr<connection>  _registry_self;
+	std::shared_ptr<void>        _registry_admission;
+	connection *                 _registry_prev;
+	connection *                 _registry_next;
+	size_t                       _registry_bucket;
 
 public:
 	connection& operator=(const connection&) = delete;
@@ -76,17 +135,35 @@ public:
 	 * @param socket the boost::asio socket for the connection
 	 * @param manager the connection manager that oversees this connection
 	 * @param handler the multiplexer responsible for routing requests
+	 * @param timers the timer wheel used for the connection timeouts
 	 * @param max_request_size_bytes maximum permitted size of a request
 	 * @param read_timer the timeout for reading, 0 is ignored
 	 * @param write_timer the timeout for writing, 0 is ignored
+	 * @param keep_alive_timeout the idle timeout between requests, 0 is ignored
+	 * @param max_requests maximum number of requests served before closing, 0 is ignored
+	 * @param header_timeout the timeout for receiving a request header, 0 is ignored
+	 * @param max_stream_pending_bytes the bytes of a streamed response pending before writers wait
+	 * @param http2_max_streams the concurrent streams of an HTTP/2 client, 0 disables HTTP/2
+	 * @param tls_context the TLS settings of the server, or nullptr to serve plain TCP
+	 * @param buffers the pool lending read buffers, or nullptr for a pool of the connection's own
 	 */
 	explicit connection( boost::asio::io_service &    io_service
 	                   , boost::asio::ip::tcp::socket socket
 	                   , connection_manager &         manager
 	                   , multiplexer        &         handler
+	                   , timer_wheel_ptr              timers
 	                   , size_t                       max_request_size_bytes
 	                   , int                          read_timeout
-	                   , int                          write_timeout );
+	                   , int                          write_timeout
+	                   , int                          keep_alive_timeout = 0
+	                   , size_t                       max_requests = 0
+	                   , int                          header_timeout = 0
+	                   , size_t                       max_stream_pending_bytes = 1024 * 1024
+	                   , size_t                       http2_max_streams = 0
+	                   , tls_context_ptr              tls_context = nullptr
+	                   , buffer_pool_ptr              buffers = nullptr );
+
+	~connection();
 
 	/*
 	 * Prompts the connection to start reading from its TCP socket.
@@ -95,21 +172,248 @@ public:
 
 	void restart();
 
+	/*
+	 * Clears a stopped connection so that it can be kept in a pool.
+	 *
+	 * Timers are cancelled and streams aborted, the socket is closed, and queued responses along
+	 * with their files, the websocket or HTTP/2 session and the request buffers are released. Only
+	 * the response buffers keep their allocated memory. Must only be called once no asynchronous
+	 * operations of the connection remain.
+	 */
+	void recycle();
+
+	/*
+	 * Prepares a recycled connection for reuse with a newly accepted socket.
+	 *
+	 * @param socket the boost::asio socket for the new connection
+	 */
+	void reset(boost::asio::ip::tcp::socket socket);
+
+	/*
+	 * Estimates the memory held by the connection, including buffers kept for reuse.
+	 *
+	 * @return the approximate size of the connection in bytes
+	 */
+	size_t retained_bytes() const;
+
 	/*
 	 * Prompts the connection to close the TCP connection early.
 	 */
 	void stop();
 
+	/*
+	 * Prompts the connection to close once it is idle.
+	 *
+	 * A connection waiting for a request is closed immediately, otherwise the request in
+	 * progress is completed and answered with Connection: close.
+	 */
+	void drain();
+
+	/*
+	 * Get the io_service of the connection whose request is being handled by the calling thread.
+	 *
+	 * Handlers use this to start asynchronous work on the I/O thread that serves them.
+	 *
+	 * @return the io_service, or nullptr when not called from a handler on an I/O thread
+	 */
+	static boost::asio::io_service * current_io_service();
+
 private:
+#if defined(SERVED_TLS)
+	/*
+	 * An asynchronous call that performs the TLS handshake of a new connection.
+	 *
+	 * Reading starts once the handshake completes, or the connection is handed to an HTTP/2
+	 * session if the client selected "h2" with ALPN.
+	 */
+	void do_handshake();
+#endif
+
 	/*
 	 * An asynchronous call that triggers a TCP read from the socket.
+	 *
+	 * A plain TCP connection waits until the socket is readable before borrowing a read buffer,
+	 * so that idle connections hold none. Over TLS decrypted bytes may already be waiting, so the
+	 * buffer is borrowed for the duration of the read.
 	 */
 	void do_read();
 
 	/*
-	 * An asynchronous call that triggers a TCP write to the socket.
+	 * Acts on the result of a read into the read buffer, and returns the buffer to the pool.
+	 *
+	 * @param ec the error of the read, if any
+	 * @param bytes_transferred the number of bytes read
+	 */
+	void on_read(boost::system::error_code ec, size_t bytes_transferred);
+
+	/*
+	 * An asynchronous call that writes the queued responses to the socket.
+	 *
+	 * Queued responses are gathered into a single write, up to and including the header of the
+	 * first response with a file body. That file is then sent before writing the remainder.
 	 */
 	void do_write();
+
+	/*
+	 * An asynchronous call that sends a region of a file to the socket.
+	 *
+	 * Uses sendfile(2) where supported so that the file is not copied through user space. Files
+	 * sent over TLS are read into a borrowed buffer to be encrypted instead. Once the region is
+	 * sent writing continues with the remaining queued responses.
+	 *
+	 * @param file the open file
+	 * @param offset the offset of the remaining region
+	 * @param remaining the number of bytes left to send
+	 */
+	void do_send_file(file_handle_ptr file, size_t offset, size_t remaining);
+
+	/*
+	 * Starts sending the body of a streamed response, once its header has been written.
+	 *
+	 * Writing the remaining queued responses continues once the stream is closed and sent.
+	 *
+	 * @param stream the channel of the streamed body
+	 */
+	void start_stream(stream_channel_ptr stream);
+
+	/*
+	 * An asynchronous call that writes the chunks waiting in the current stream.
+	 *
+	 * Does nothing while a write of the stream is in progress, or no chunks are waiting.
+	 */
+	void do_write_stream();
+
+	/*
+	 * Aborts the streamed responses being written or queued, so that their writers stop waiting.
+	 */
+	void abort_streams();
+
+	/*
+	 * Sends the heartbeat of the current stream when it is due, see stream_channel::set_heartbeat.
+	 *
+	 * A client whose pending stream bytes are still at the limit is disconnected instead.
+	 */
+	void send_heartbeat();
+
+	/*
+	 * Hands the connection to the websocket of the last response, once its handshake is written.
+	 *
+	 * The connection is stopped once the websocket is finished.
+	 */
+	void start_websocket();
+
+	/*
+	 * Hands the connection to an HTTP/2 session, see http2_session.
+	 *
+	 * The connection is stopped once the session is finished.
+	 *
+	 * @param initial_bytes bytes already received, starting with the connection preface
+	 */
+	void start_http2(std::string initial_bytes);
+
+	/*
+	 * Answers a request that asked to upgrade to h2c, if HTTP/2 is enabled.
+	 *
+	 * The request is handed to an HTTP/2 session as its first stream, and a 101 response queued.
+	 *
+	 * @return true if the connection is upgraded
+	 */
+	bool upgrade_to_http2();
+
+	/*
+	 * Sets the io_service returned by current_io_service on the calling thread.
+	 *
+	 * @param io_service the io_service, or nullptr
+	 * @return the io_service that was set before
+	 */
+	static boost::asio::io_service * exchange_current_io_service(boost::asio::io_service * io_service);
+
+	/*
+	 * Called once every queued response has been written.
+	 */
+	void on_write_complete();
+
+	/*
+	 * Acts on the result of parsing a batch of received bytes.
+	 *
+	 * Every request completed by the batch is handled in order and its response queued, including
+	 * pipelined requests that arrived in the same batch. Queued responses are then written, or
+	 * reading continues if the current request is incomplete. Processing pauses while a handler
+	 * runs on an executor.
+	 *
+	 * @param result the status returned by the request parser
+	 */
+	void process(request_parser_impl::status_type result);
+
+	/*
+	 * Prepares for the next request and parses any pipelined bytes already received for it.
+	 *
+	 * @param result set to the status returned by the request parser
+	 * @return true if pipelined bytes were parsed
+	 */
+	bool next_request(request_parser_impl::status_type & result);
+
+	/*
+	 * Writes the queued responses, or continues reading when none are queued.
+	 */
+	void flush();
+
+	/*
+	 * Forwards a fully parsed request to the multiplexer.
+	 *
+	 * @return true if the request was handled inline and its response queued, false if the
+	 *         handler runs on an executor or is asynchronous, and completes later
+	 */
+	bool handle_request();
+
+	/*
+	 * Completes a handled request and queues its response.
+	 *
+	 * @param error an exception thrown by the handler, if any
+	 */
+	void complete_request(std::exception_ptr error);
+
+	/*
+	 * Moves the current response onto the write queue and clears it for reuse.
+	 */
+	void queue_response();
+
+	/*
+	 * Arms a timer that stops the connection once it expires.
+	 *
+	 * Any earlier schedule of the timer is replaced. A timeout of 0 only cancels the timer.
+	 *
+	 * @param timer the timer to arm
+	 * @param timeout_ms the timeout in milliseconds
+	 */
+	void start_timer(timer_wheel::entry & timer, int timeout_ms);
+
+	/*
+	 * Cancels a timer if it is armed.
+	 *
+	 * @param timer the timer to cancel
+	 */
+	void cancel_timer(timer_wheel::entry & timer);
+
+	/*
+	 * Arms the read and header timers as a new request begins.
+	 */
+	void start_request_timers();
+
+	/*
+	 * Determines whether the connection should remain open after the current request.
+	 *
+	 * Honours the Connection header of the request, falling back to the default of the HTTP
+	 * version (persistent for HTTP/1.1, close for HTTP/1.0), and the max requests limit.
+	 *
+	 * @return true if the connection should be kept alive
+	 */
+	bool keep_alive_requested();
+
+	/*
+	 * Prepares the connection for the next request on a persistent connection.
+	 */
+	void reset_for_next_request();
 };
 
 typedef std::shared_ptr<connection> connection_ptr;
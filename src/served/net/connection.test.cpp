@@ -21,3 +21,682 @@
  */
 
 #include <test/catch.hpp>
+
+#include <served/net/server.hpp>
+#include <served/handler_executor.hpp>
+#include <served/request_error.hpp>
+
+#include <boost/asio.hpp>
+#include <chrono>
+#include <cstdio>
+#include <future>
+#include <mutex>
+#include <thread>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace {
+
+/*
+ * Reads a single HTTP response from a blocking socket, using Content-Length to find the end of
+ * the body. Any bytes read beyond the response are kept in the streambuf for the next call.
+ */
+std::string
+read_response(boost::asio::ip::tcp::socket & socket, boost::asio::streambuf & buf)
+{
+	size_t header_len = boost::asio::read_until(socket, buf, "\r\n\r\n");
+
+	std::string data(boost::asio::buffers_begin(buf.data()), boost::asio::buffers_end(buf.data()));
+	std::string header = data.substr(0, header_len);
+
+	size_t content_length = 0;
+	auto pos = header.find("Content-Length: ");
+	if ( pos != std::string::npos )
+	{
+		content_length = std::stoul(header.substr(pos + 16));
+	}
+
+	if ( buf.size() < header_len + content_length )
+	{
+		boost::asio::read(socket, buf, boost::asio::transfer_exactly(header_len + content_length - buf.size()));
+	}
+
+	data = std::string(boost::asio::buffers_begin(buf.data()), boost::asio::buffers_end(buf.data()));
+	buf.consume(header_len + content_length);
+
+	return data.substr(0, header_len + content_length);
+}
+
+} // anonymous namespace
+
+TEST_CASE("connection keep alive", "[connection]")
+{
+	served::multiplexer mux;
+	mux.handle("/hello")
+		.get([](served::response & res, const served::request &) {
+			res << "hello";
+		});
+
+	served::net::server server("127.0.0.1", "42801", mux, false);
+	server.set_max_requests_per_connection(3);
+	std::thread server_thread([&]() { server.run(); });
+
+	boost::asio::io_service io_service;
+	boost::asio::ip::tcp::socket socket(io_service);
+	socket.connect(boost::asio::ip::tcp::endpoint(boost::asio::ip::address::from_string("127.0.0.1"), 42801));
+	boost::asio::streambuf buf;
+
+	SECTION("HTTP/1.1 connections are persistent by default")
+	{
+		for ( int i = 0; i < 2; i++ )
+		{
+			boost::asio::write(socket, boost::asio::buffer(std::string(
+				"GET /hello HTTP/1.1\r\nHost: localhost\r\n\r\n")));
+
+			auto res = read_response(socket, buf);
+			CHECK(res.find("HTTP/1.1 200 OK\r\n") == 0);
+			CHECK(res.find("Connection: close") == std::string::npos);
+			CHECK(res.substr(res.length() - 5) == "hello");
+		}
+		CHECK(server.get_connection_count() == 1);
+	}
+
+	SECTION("Connection: close is honoured")
+	{
+		boost::asio::write(socket, boost::asio::buffer(std::string(
+			"GET /hello HTTP/1.1\r\nConnection: close\r\n\r\n")));
+
+		auto res = read_response(socket, buf);
+		CHECK(res.find("Connection: close\r\n") != std::string::npos);
+
+		boost::system::error_code ec;
+		boost::asio::read(socket, buf, boost::asio::transfer_at_least(1), ec);
+		CHECK(ec == boost::asio::error::eof);
+	}
+
+	SECTION("HTTP/1.0 connections close unless keep-alive is requested")
+	{
+		boost::asio::write(socket, boost::asio::buffer(std::string(
+			"GET /hello HTTP/1.0\r\nConnection: Keep-Alive\r\n\r\n")));
+
+		auto res = read_response(socket, buf);
+		CHECK(res.find("Connection: keep-alive\r\n") != std::string::npos);
+
+		boost::asio::write(socket, boost::asio::buffer(std::string(
+			"GET /hello HTTP/1.0\r\n\r\n")));
+
+		res = read_response(socket, buf);
+		CHECK(res.find("Connection: close\r\n") != std::string::npos);
+	}
+
+	SECTION("connection closes after the maximum number of requests")
+	{
+		for ( int i = 0; i < 3; i++ )
+		{
+			boost::asio::write(socket, boost::asio::buffer(std::string(
+				"GET /hello HTTP/1.1\r\n\r\n")));
+
+			auto res = read_response(socket, buf);
+			CHECK((res.find("Connection: close\r\n") != std::string::npos) == (i == 2));
+		}
+	}
+
+	socket.close();
+	server.stop();
+	server_thread.join();
+}
+
+TEST_CASE("connection header timeout", "[connection]")
+{
+	served::multiplexer mux;
+	mux.handle("/hello")
+		.get([](served::response & res, const served::request &) {
+			res << "hello";
+		});
+
+	served::net::server server("127.0.0.1", "42804", mux, false);
+	server.set_read_timeout(5000);
+	server.set_header_timeout(100);
+	std::thread server_thread([&]() { server.run(); });
+
+	boost::asio::io_service io_service;
+	boost::asio::ip::tcp::socket socket(io_service);
+	socket.connect(boost::asio::ip::tcp::endpoint(boost::asio::ip::address::from_string("127.0.0.1"), 42804));
+	boost::asio::streambuf buf;
+
+	SECTION("a complete header in time is served")
+	{
+		boost::asio::write(socket, boost::asio::buffer(std::string("GET /hello HTTP/1.1\r\n\r\n")));
+
+		auto res = read_response(socket, buf);
+		CHECK(res.substr(res.length() - 5) == "hello");
+	}
+
+	SECTION("a trickled header is closed at the deadline")
+	{
+		auto start = std::chrono::steady_clock::now();
+
+		// Keep sending header bytes so that the read timeout alone would never expire.
+		boost::system::error_code ec;
+		std::string header = "GET /hello HTTP/1.1\r\nX-Slow: ";
+		for ( int i = 0; i < 50 && !ec; i++ )
+		{
+			boost::asio::write(socket, boost::asio::buffer(header), ec);
+			header = "a";
+			std::this_thread::sleep_for(std::chrono::milliseconds(20));
+		}
+
+		boost::asio::read(socket, buf, boost::asio::transfer_at_least(1), ec);
+		CHECK(ec);
+
+		auto elapsed = std::chrono::steady_clock::now() - start;
+		CHECK(elapsed < std::chrono::milliseconds(1000));
+	}
+
+	socket.close();
+	server.stop();
+	server_thread.join();
+}
+
+TEST_CASE("connection pipelining", "[connection]")
+{
+	served::multiplexer mux;
+	mux.handle("/echo/{id}")
+		.get([](served::response & res, const served::request & req) {
+			res << req.params["id"];
+		});
+
+	served::net::server server("127.0.0.1", "42802", mux, false);
+	std::thread server_thread([&]() { server.run(); });
+
+	boost::asio::io_service io_service;
+	boost::asio::ip::tcp::socket socket(io_service);
+	socket.connect(boost::asio::ip::tcp::endpoint(boost::asio::ip::address::from_string("127.0.0.1"), 42802));
+	boost::asio::streambuf buf;
+
+	boost::asio::write(socket, boost::asio::buffer(std::string(
+		"GET /echo/one HTTP/1.1\r\n\r\n"
+		"GET /echo/two HTTP/1.1\r\n\r\n"
+		"GET /echo/three HTTP/1.1\r\n\r\n"
+		"GET /echo/fo")));
+
+	for ( const std::string id : { "one", "two", "three" } )
+	{
+		auto res = read_response(socket, buf);
+		CHECK(res.substr(res.length() - id.length()) == id);
+	}
+
+	boost::asio::write(socket, boost::asio::buffer(std::string("ur HTTP/1.1\r\n\r\n")));
+
+	auto res = read_response(socket, buf);
+	CHECK(res.substr(res.length() - 4) == "four");
+
+	socket.close();
+	server.stop();
+	server_thread.join();
+}
+
+TEST_CASE("connection sends file bodies", "[connection]")
+{
+	// Large enough that the file cannot be sent without waiting for the socket to drain.
+	std::string contents;
+	for ( size_t i = 0; i < 4 * 1024 * 1024; i++ )
+	{
+		contents.push_back('a' + i % 26);
+	}
+
+	char path[] = "/tmp/served_connection_test_XXXXXX";
+	int fd = ::mkstemp(path);
+	REQUIRE(fd >= 0);
+	REQUIRE(::write(fd, contents.data(), contents.size()) == (ssize_t) contents.size());
+	auto file = std::make_shared<served::file_handle>(fd);
+
+	served::multiplexer mux;
+	mux.handle("/file")
+		.get([&](served::response & res, const served::request &) {
+			res.set_file_body(file, 10, contents.size() - 10);
+		});
+	mux.handle("/hello")
+		.get([](served::response & res, const served::request &) {
+			res << "hello";
+		});
+
+	served::net::server server("127.0.0.1", "42803", mux, false);
+	std::thread server_thread([&]() { server.run(); });
+
+	boost::asio::io_service io_service;
+	boost::asio::ip::tcp::socket socket(io_service);
+	socket.connect(boost::asio::ip::tcp::endpoint(boost::asio::ip::address::from_string("127.0.0.1"), 42803));
+	boost::asio::streambuf buf;
+
+	// The response after a file body is written once the file has been sent.
+	boost::asio::write(socket, boost::asio::buffer(std::string(
+		"GET /file HTTP/1.1\r\n\r\n"
+		"GET /hello HTTP/1.1\r\n\r\n")));
+
+	auto res = read_response(socket, buf);
+	auto body_pos = res.find("\r\n\r\n") + 4;
+	CHECK(res.find("Content-Length: " + std::to_string(contents.size() - 10) + "\r\n") != std::string::npos);
+	auto body_len = res.size() - body_pos;
+	CHECK(body_len == contents.size() - 10);
+	CHECK(res.compare(body_pos, std::string::npos, contents, 10, std::string::npos) == 0);
+
+	res = read_response(socket, buf);
+	CHECK(res.substr(res.length() - 5) == "hello");
+
+	socket.close();
+	server.stop();
+	server_thread.join();
+	::unlink(path);
+}
+
+TEST_CASE("connection runs executor handlers off the io thread", "[connection]")
+{
+	std::promise<void> release;
+	auto release_future = release.get_future().share();
+
+	served::multiplexer mux;
+	mux.handle("/slow")
+		.use_executor(std::make_shared<served::handler_executor>(2))
+		.get([&](served::response & res, const served::request &) {
+			release_future.wait();
+			res << "slow";
+		});
+	mux.handle("/hello")
+		.get([](served::response & res, const served::request &) {
+			res << "hello";
+		});
+
+	served::net::server server("127.0.0.1", "42805", mux, false);
+	std::thread server_thread([&]() { server.run(); });
+
+	boost::asio::io_service io_service;
+	auto endpoint = boost::asio::ip::tcp::endpoint(boost::asio::ip::address::from_string("127.0.0.1"), 42805);
+	boost::asio::ip::tcp::socket slow_socket(io_service);
+	boost::asio::ip::tcp::socket fast_socket(io_service);
+	slow_socket.connect(endpoint);
+	fast_socket.connect(endpoint);
+	boost::asio::streambuf slow_buf, fast_buf;
+
+	// A pipelined request waits behind the executor handler on its own connection.
+	boost::asio::write(slow_socket, boost::asio::buffer(std::string(
+		"GET /slow HTTP/1.1\r\n\r\n"
+		"GET /hello HTTP/1.1\r\n\r\n")));
+
+	// Other connections are served while the executor handler is blocked.
+	boost::asio::write(fast_socket, boost::asio::buffer(std::string("GET /hello HTTP/1.1\r\n\r\n")));
+	auto res = read_response(fast_socket, fast_buf);
+	CHECK(res.substr(res.length() - 5) == "hello");
+
+	release.set_value();
+
+	res = read_response(slow_socket, slow_buf);
+	CHECK(res.substr(res.length() - 4) == "slow");
+	res = read_response(slow_socket, slow_buf);
+	CHECK(res.substr(res.length() - 5) == "hello");
+
+	slow_socket.close();
+	fast_socket.close();
+	server.stop();
+	server_thread.join();
+}
+
+TEST_CASE("connection writes deferred responses", "[connection]")
+{
+	std::mutex                                                            mutex;
+	std::vector<std::pair<served::response *, served::deferred_response>> pending;
+
+	served::multiplexer mux;
+	mux.handle("/later")
+		.get_async([&](served::response & res, const served::request &, served::deferred_response deferred) {
+			std::lock_guard<std::mutex> lock(mutex);
+			pending.emplace_back(&res, deferred);
+		});
+	mux.handle("/abandoned")
+		.get_async([](served::response &, const served::request &, served::deferred_response) {});
+	mux.handle("/hello")
+		.get([](served::response & res, const served::request &) {
+			res << "hello";
+		});
+
+	served::net::server server("127.0.0.1", "42806", mux, false);
+	std::thread server_thread([&]() { server.run(); });
+
+	boost::asio::io_service io_service;
+	auto endpoint = boost::asio::ip::tcp::endpoint(boost::asio::ip::address::from_string("127.0.0.1"), 42806);
+	boost::asio::ip::tcp::socket later_socket(io_service);
+	boost::asio::ip::tcp::socket other_socket(io_service);
+	later_socket.connect(endpoint);
+	other_socket.connect(endpoint);
+	boost::asio::streambuf later_buf, other_buf;
+
+	boost::asio::write(later_socket, boost::asio::buffer(std::string(
+		"GET /later HTTP/1.1\r\n\r\n"
+		"GET /hello HTTP/1.1\r\n\r\n")));
+
+	// The single I/O thread keeps serving while the response is outstanding.
+	boost::asio::write(other_socket, boost::asio::buffer(std::string("GET /hello HTTP/1.1\r\n\r\n")));
+	auto res = read_response(other_socket, other_buf);
+	CHECK(res.substr(res.length() - 5) == "hello");
+
+	// An abandoned response is answered with an error.
+	boost::asio::write(other_socket, boost::asio::buffer(std::string("GET /abandoned HTTP/1.1\r\n\r\n")));
+	res = read_response(other_socket, other_buf);
+	CHECK(res.find("HTTP/1.1 500") == 0);
+
+	// Completed from another thread, followed by the pipelined request.
+	std::thread([&]() {
+		for ( ;; )
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			if ( ! pending.empty() )
+			{
+				*pending.front().first << "later";
+				pending.front().second.complete();
+				break;
+			}
+		}
+	}).join();
+
+	res = read_response(later_socket, later_buf);
+	CHECK(res.substr(res.length() - 5) == "later");
+	res = read_response(later_socket, later_buf);
+	CHECK(res.substr(res.length() - 5) == "hello");
+
+	later_socket.close();
+	other_socket.close();
+	server.stop();
+	server_thread.join();
+}
+
+TEST_CASE("connection completes deferred responses across io threads", "[connection]")
+{
+	served::multiplexer mux;
+	mux.handle("/echo/{id}")
+		.get_async([](served::response & res, const served::request & req, served::deferred_response deferred) {
+			// Completed from another thread, racing the return of the handler.
+			served::response * out = &res;
+			const std::string  id  = req.params["id"];
+			std::thread([out, id, deferred]() mutable {
+				*out << id;
+				deferred.complete();
+			}).detach();
+		});
+
+	served::net::server server("127.0.0.1", "42819", mux, false);
+	server.run(4, false);
+
+	const int n_sockets  = 4;
+	const int n_requests = 200;
+
+	std::vector<std::thread> clients;
+	std::vector<int>         in_order(n_sockets, 0);
+	for ( int s = 0; s < n_sockets; s++ )
+	{
+		clients.push_back(std::thread([s, &in_order]() {
+			boost::asio::io_service io_service;
+			boost::asio::ip::tcp::socket socket(io_service);
+			socket.connect(boost::asio::ip::tcp::endpoint(boost::asio::ip::address::from_string("127.0.0.1"), 42819));
+			boost::asio::streambuf buf;
+
+			std::string requests;
+			for ( int i = 0; i < n_requests; i++ )
+			{
+				requests += "GET /echo/" + std::to_string(i) + " HTTP/1.1\r\n\r\n";
+			}
+			boost::asio::write(socket, boost::asio::buffer(requests));
+
+			bool ordered = true;
+			for ( int i = 0; i < n_requests; i++ )
+			{
+				const std::string id  = std::to_string(i);
+				const auto        res = read_response(socket, buf);
+				ordered = ordered && res.find("HTTP/1.1 200 OK\r\n") == 0
+				                  && res.substr(res.length() - id.length()) == id;
+			}
+			in_order[s] = ordered;
+		}));
+	}
+	for ( auto & client : clients )
+	{
+		client.join();
+	}
+
+	for ( int s = 0; s < n_sockets; s++ )
+	{
+		CHECK(in_order[s]);
+	}
+
+	server.stop();
+}
+
+TEST_CASE("connection streams request bodies", "[connection]")
+{
+	auto received = std::make_shared<size_t>(0);
+
+	served::multiplexer mux;
+	mux.handle("/upload/{name}")
+		.stream_body([received](const served::request & req) -> served::served_body_chunk_handler {
+			if ( req.params["name"] == "rejected" )
+			{
+				throw served::request_error(served::status_4XX::FORBIDDEN, "Forbidden");
+			}
+			*received = 0;
+			return [received](const char *, size_t len) {
+				*received += len;
+			};
+		})
+		.post([received](served::response & res, const served::request & req) {
+			res << req.params["name"] << ":" << std::to_string(*received) << ":" << req.body();
+		});
+
+	served::net::server server("127.0.0.1", "42807", mux, false);
+	server.set_max_request_bytes(1024);
+	std::thread server_thread([&]() { server.run(); });
+
+	boost::asio::io_service io_service;
+	boost::asio::ip::tcp::socket socket(io_service);
+	socket.connect(boost::asio::ip::tcp::endpoint(boost::asio::ip::address::from_string("127.0.0.1"), 42807));
+	boost::asio::streambuf buf;
+
+	// The body is far larger than the request size limit.
+	const std::string body(256 * 1024, 'x');
+	boost::asio::write(socket, boost::asio::buffer(std::string(
+		"POST /upload/big HTTP/1.1\r\n"
+		"Content-Type: application/octet-stream\r\n"
+		"Content-Length: " + std::to_string(body.length()) + "\r\n\r\n")));
+	boost::asio::write(socket, boost::asio::buffer(body));
+
+	auto res = read_response(socket, buf);
+	CHECK(res.find("HTTP/1.1 200") == 0);
+	CHECK(res.substr(res.length() - 11) == "big:262144:");
+
+	// A stream that refuses the request answers with its error and closes the connection.
+	boost::asio::write(socket, boost::asio::buffer(std::string(
+		"POST /upload/rejected HTTP/1.1\r\n"
+		"Content-Type: text/plain\r\n"
+		"Content-Length: 5\r\n\r\nhello")));
+
+	res = read_response(socket, buf);
+	CHECK(res.find("HTTP/1.1 403") == 0);
+	CHECK(res.find("Connection: close") != std::string::npos);
+
+	socket.close();
+	server.stop();
+	server_thread.join();
+}
+
+TEST_CASE("connection streams chunked responses", "[connection]")
+{
+	std::vector<std::thread> producers;
+	std::mutex               producers_mutex;
+	std::atomic<size_t>      max_waits(0);
+
+	served::multiplexer mux;
+	mux.handle("/export")
+		.get([&](served::response & res, const served::request &) {
+			res.set_header("Content-Type", "text/plain");
+			res << "head,";
+
+			// The response is produced by another thread once the handler returns.
+			auto stream = res.stream();
+			std::lock_guard<std::mutex> lock(producers_mutex);
+			producers.emplace_back([stream, &max_waits]() mutable {
+				const std::string chunk(16 * 1024, 'x');
+				size_t waits = 0;
+				for ( int i = 0; i < 64; i++ )
+				{
+					if ( ! stream.write(chunk) )
+					{
+						waits++;
+						if ( ! stream.wait_writable() )
+						{
+							return;
+						}
+					}
+				}
+				stream.write(",tail");
+				stream.close();
+				max_waits = std::max(max_waits.load(), waits);
+			});
+		});
+	mux.handle("/hello")
+		.get([](served::response & res, const served::request &) {
+			res << "hello";
+		});
+
+	served::net::server server("127.0.0.1", "42808", mux, false);
+	server.set_max_stream_pending_bytes(32 * 1024);
+	std::thread server_thread([&]() { server.run(); });
+
+	boost::asio::io_service io_service;
+	boost::asio::ip::tcp::socket socket(io_service);
+	socket.connect(boost::asio::ip::tcp::endpoint(boost::asio::ip::address::from_string("127.0.0.1"), 42808));
+	boost::asio::streambuf buf;
+
+	SECTION("chunks are sent until the stream is closed")
+	{
+		boost::asio::write(socket, boost::asio::buffer(std::string(
+			"GET /export HTTP/1.1\r\n\r\n"
+			"GET /hello HTTP/1.1\r\n\r\n")));
+
+		size_t header_len = boost::asio::read_until(socket, buf, "\r\n\r\n");
+		std::string header(boost::asio::buffers_begin(buf.data()), boost::asio::buffers_begin(buf.data()) + header_len);
+		buf.consume(header_len);
+		CHECK(header.find("HTTP/1.1 200") == 0);
+		CHECK(header.find("Transfer-Encoding: chunked") != std::string::npos);
+		CHECK(header.find("Content-Length") == std::string::npos);
+
+		// Decode the chunked body.
+		std::string body;
+		for ( ;; )
+		{
+			size_t line_len = boost::asio::read_until(socket, buf, "\r\n");
+			std::string line(boost::asio::buffers_begin(buf.data()), boost::asio::buffers_begin(buf.data()) + line_len);
+			buf.consume(line_len);
+
+			size_t size = std::stoul(line, nullptr, 16);
+			if ( buf.size() < size + 2 )
+			{
+				boost::asio::read(socket, buf, boost::asio::transfer_exactly(size + 2 - buf.size()));
+			}
+			body.append(boost::asio::buffers_begin(buf.data()), boost::asio::buffers_begin(buf.data()) + size);
+			buf.consume(size + 2);
+
+			if ( size == 0 )
+			{
+				break;
+			}
+		}
+
+		CHECK(body.length() == 5 + 64 * 16 * 1024 + 5);
+		CHECK(body.substr(0, 5) == "head,");
+		CHECK(body.substr(body.length() - 5) == ",tail");
+
+		// The pipelined request is answered once the stream ends.
+		auto res = read_response(socket, buf);
+		CHECK(res.substr(res.length() - 5) == "hello");
+	}
+
+	SECTION("HTTP/1.0 streams are ended by closing")
+	{
+		boost::asio::write(socket, boost::asio::buffer(std::string("GET /export HTTP/1.0\r\n\r\n")));
+
+		std::string res;
+		boost::system::error_code ec;
+		boost::asio::read(socket, boost::asio::dynamic_buffer(res), ec);
+
+		CHECK(res.find("Transfer-Encoding") == std::string::npos);
+		CHECK(res.find("Connection: close") != std::string::npos);
+		CHECK(res.substr(res.length() - 5) == ",tail");
+	}
+
+	socket.close();
+	server.stop();
+	server_thread.join();
+
+	std::lock_guard<std::mutex> lock(producers_mutex);
+	for ( auto & producer : producers )
+	{
+		producer.join();
+	}
+	CHECK(max_waits.load() > 0u);
+}
+
+TEST_CASE("connection serves server-sent events", "[connection]")
+{
+	served::sse_broadcaster broadcaster;
+
+	served::multiplexer mux;
+	mux.handle("/events")
+		.sse([&](served::sse_channel channel, const served::request & req) {
+			channel.send("welcome " + req.header("last-event-id"));
+			broadcaster.subscribe(channel);
+		}, 100);
+
+	served::net::server server("127.0.0.1", "42809", mux, false);
+	std::thread server_thread([&]() { server.run(); });
+
+	boost::asio::io_service io_service;
+	boost::asio::ip::tcp::socket socket(io_service);
+	socket.connect(boost::asio::ip::tcp::endpoint(boost::asio::ip::address::from_string("127.0.0.1"), 42809));
+	boost::asio::streambuf buf;
+
+	boost::asio::write(socket, boost::asio::buffer(std::string(
+		"GET /events HTTP/1.1\r\nLast-Event-ID: 4\r\n\r\n")));
+
+	size_t header_len = boost::asio::read_until(socket, buf, "\r\n\r\n");
+	std::string header(boost::asio::buffers_begin(buf.data()), boost::asio::buffers_begin(buf.data()) + header_len);
+	buf.consume(header_len);
+	CHECK(header.find("Content-Type: text/event-stream") != std::string::npos);
+	CHECK(header.find("Transfer-Encoding: chunked") != std::string::npos);
+
+	auto read_event = [&]() {
+		size_t len = boost::asio::read_until(socket, buf, "\n\n");
+		std::string data(boost::asio::buffers_begin(buf.data()), boost::asio::buffers_begin(buf.data()) + len);
+		buf.consume(len);
+		return data;
+	};
+
+	CHECK(read_event().find("data: welcome 4\n\n") != std::string::npos);
+
+	// The stream is idle, so a heartbeat comment follows.
+	CHECK(read_event().find(": \n\n") != std::string::npos);
+
+	CHECK(broadcaster.publish("news", "update", "5") == 1);
+	auto event = read_event();
+	while ( event.find("data: ") == std::string::npos )
+	{
+		event = read_event();
+	}
+	CHECK(event.find("event: update\nid: 5\ndata: news\n\n") != std::string::npos);
+
+	// Closing the broadcaster ends the response.
+	broadcaster.close();
+	boost::asio::read_until(socket, buf, "0\r\n\r\n");
+
+	socket.close();
+	server.stop();
+	server_thread.join();
+}
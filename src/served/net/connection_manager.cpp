@@ -22,38 +22,177 @@
 
 #include <served/net/connection_manager.hpp>
 
+#include <algorithm>
+#include <thread>
+
 using namespace served::net;
 
-connection_manager::connection_manager()
+namespace {
+
+/*
+ * Returns a small number identifying the calling thread, assigned on first use.
+ */
+size_t
+thread_index()
+{
+	static std::atomic<size_t> next_index(0);
+	static thread_local size_t index = next_index++;
+	return index;
+}
+
+} // anonymous namespace
+
+connection_manager::bucket::bucket()
+	: mutex()
+	, head(nullptr)
 {}
 
+connection_manager::connection_manager(boost::asio::io_service & io_service)
+	: _io_service(io_service)
+	, _buckets()
+	, _count(0)
+{
+	size_t n_buckets = std::max(std::thread::hardware_concurrency(), 1u);
+	for ( size_t i = 0; i < n_buckets; i++ )
+	{
+		_buckets.push_back(std::unique_ptr<bucket>(new bucket()));
+	}
+}
+
+connection_manager::bucket &
+connection_manager::local_bucket(size_t & index)
+{
+	index = thread_index() % _buckets.size();
+	return *_buckets[index];
+}
+
 void
-connection_manager::start(connection_ptr c) {
+connection_manager::start(connection_ptr c, std::shared_ptr<void> admission /* = nullptr */) {
 	{
-		std::lock_guard<std::mutex> lock(_connections_mutex);
-		_connections.insert(c);
+		size_t   index;
+		bucket & b = local_bucket(index);
+
+		std::lock_guard<std::mutex> lock(b.mutex);
+
+		c->_registry_bucket = index;
+		c->_registry_prev   = nullptr;
+		c->_registry_next   = b.head;
+		if ( b.head )
+		{
+			b.head->_registry_prev = c.get();
+		}
+		b.head = c.get();
+
+		// The stack holds the reference that keeps the connection open.
+		c->_registry_self      = c;
+		c->_registry_admission = std::move(admission);
+		_count++;
 	}
 	c->start();
 }
 
 void
 connection_manager::stop(connection_ptr c) {
+	connection_ptr        registered;
+	std::shared_ptr<void> admission;
 	{
-		std::lock_guard<std::mutex> lock(_connections_mutex);
-		_connections.erase(c);
+		bucket & b = *_buckets[c->_registry_bucket];
+
+		std::lock_guard<std::mutex> lock(b.mutex);
+
+		if ( c->_registry_self )
+		{
+			if ( c->_registry_prev )
+			{
+				c->_registry_prev->_registry_next = c->_registry_next;
+			}
+			else
+			{
+				b.head = c->_registry_next;
+			}
+			if ( c->_registry_next )
+			{
+				c->_registry_next->_registry_prev = c->_registry_prev;
+			}
+			c->_registry_prev = nullptr;
+			c->_registry_next = nullptr;
+
+			registered = std::move(c->_registry_self);
+			admission  = std::move(c->_registry_admission);
+			_count--;
+		}
 	}
 	c->stop();
 }
 
 void
 connection_manager::stop_all() {
-	std::lock_guard<std::mutex> lock(_connections_mutex);
-	for (auto c: _connections)
+	std::vector<connection_ptr>        removed;
+	std::vector<std::shared_ptr<void>> admissions;
+	remove_all(removed, admissions);
+
+	for ( auto & c : removed )
 	{
-		c->stop();
+		// Connections are stopped from their own io thread, inline when already on it.
+		_io_service.dispatch([c]() {
+			c->stop();
+		});
+	}
+}
+
+void
+connection_manager::drain_all() {
+	std::vector<connection_ptr> open;
+	for ( auto & b : _buckets )
+	{
+		std::lock_guard<std::mutex> lock(b->mutex);
+
+		for ( connection * c = b->head; c != nullptr; c = c->_registry_next )
+		{
+			open.push_back(c->_registry_self);
+		}
+	}
+
+	for ( auto & c : open )
+	{
+		_io_service.dispatch([c]() {
+			c->drain();
+		});
+	}
+}
+
+size_t
+connection_manager::size() const
+{
+	return _count.load(std::memory_order_relaxed);
+}
+
+void
+connection_manager::remove_all( std::vector<connection_ptr> &        removed
+                              , std::vector<std::shared_ptr<void>> & admissions )
+{
+	for ( auto & b : _buckets )
+	{
+		std::lock_guard<std::mutex> lock(b->mutex);
+
+		for ( connection * c = b->head; c != nullptr; )
+		{
+			connection * next = c->_registry_next;
+			c->_registry_prev = nullptr;
+			c->_registry_next = nullptr;
+
+			removed.push_back(std::move(c->_registry_self));
+			admissions.push_back(std::move(c->_registry_admission));
+			_count--;
+			c = next;
+		}
+		b->head = nullptr;
 	}
-	_connections.clear();
 }
 
 connection_manager::~connection_manager()
-{}
+{
+	std::vector<connection_ptr>        removed;
+	std::vector<std::shared_ptr<void>> admissions;
+	remove_all(removed, admissions);
+}
@@ -23,8 +23,10 @@
 #ifndef SERVED_CONNECTION_MANAGER_HPP
 #define SERVED_CONNECTION_MANAGER_HPP
 
-#include <set>
+#include <atomic>
+#include <memory>
 #include <mutex>
+#include <vector>
 
 #include <served/net/connection.hpp>
 
@@ -35,25 +37,44 @@ namespace served { namespace net {
  *
  * The connection manager is used for easily tracking any remaining open HTTP connections, and
  * shutting down those connections in order to gracefully close.
+ *
+ * Connections are kept in intrusive lists split into buckets, each with its own lock. A
+ * connection is registered in the bucket of the thread that started it, so threads accepting
+ * connections concurrently do not contend with each other.
  */
 class connection_manager
 {
-	std::set<connection_ptr> _connections;
-	std::mutex               _connections_mutex;
+	struct bucket
+	{
+		std::mutex   mutex;
+		connection * head;
+
+		bucket();
+	};
+
+	boost::asio::io_service &            _io_service;
+	std::vector<std::unique_ptr<bucket>> _buckets;
+	std::atomic<size_t>                  _count;
 
 public:
 	connection_manager(const connection_manager&) = delete;
 
 	connection_manager& operator=(const connection_manager&) = delete;
 
-	connection_manager();
+	/*
+	 * Constructs a connection manager.
+	 *
+	 * @param io_service the boost::asio::io_service running the managed connections
+	 */
+	explicit connection_manager(boost::asio::io_service & io_service);
 
 	/*
 	 * Adds a new connection to the stack and prompts it to begin.
 	 *
 	 * @param c a pointer to a new connection
+	 * @param admission an optional object held until the connection is removed from the stack
 	 */
-	void start(connection_ptr c);
+	void start(connection_ptr c, std::shared_ptr<void> admission = nullptr);
 
 	/*
 	 * Stops a connection and removes it from the stack.
@@ -64,10 +85,40 @@ public:
 
 	/*
 	 * Stops all remaining open connections.
+	 *
+	 * May be called from any thread, each connection is stopped from a thread running its
+	 * io_service.
 	 */
 	void stop_all();
 
-    ~connection_manager();
+	/*
+	 * Prompts all open connections to close once idle, see connection::drain.
+	 *
+	 * May be called from any thread, each connection is drained from a thread running its
+	 * io_service.
+	 */
+	void drain_all();
+
+	/*
+	 * Get the number of open connections.
+	 *
+	 * @return the number of connections
+	 */
+	size_t size() const;
+
+	~connection_manager();
+
+private:
+	bucket & local_bucket(size_t & index);
+
+	/*
+	 * Removes all connections from the stack without stopping them.
+	 *
+	 * @param removed the removed connections
+	 * @param admissions the admission objects of the removed connections
+	 */
+	void remove_all( std::vector<connection_ptr> &        removed
+	               , std::vector<std::shared_ptr<void>> & admissions );
 };
 
 } } // net, served
@@ -21,3 +21,78 @@
  */
 
 #include <test/catch.hpp>
+
+#include <served/net/connection_manager.hpp>
+
+#include <thread>
+
+namespace {
+
+/*
+ * Accepts a loopback connection, returning the server side socket and connecting the client.
+ */
+boost::asio::ip::tcp::socket
+accept_loopback(boost::asio::ip::tcp::acceptor & acceptor, boost::asio::ip::tcp::socket & client)
+{
+	boost::asio::ip::tcp::socket server_side(acceptor.get_executor());
+	client.connect(acceptor.local_endpoint());
+	acceptor.accept(server_side);
+	return server_side;
+}
+
+} // anonymous namespace
+
+TEST_CASE("connection manager tracks open connections", "[connection_manager]")
+{
+	boost::asio::io_service         io_service;
+	served::net::connection_manager manager(io_service);
+	served::multiplexer             mux;
+	auto timers = std::make_shared<served::net::timer_wheel>(io_service);
+
+	boost::asio::ip::tcp::acceptor acceptor(io_service,
+		boost::asio::ip::tcp::endpoint(boost::asio::ip::address::from_string("127.0.0.1"), 0));
+
+	std::vector<boost::asio::ip::tcp::socket> clients;
+	std::vector<served::net::connection_ptr>  connections;
+	for ( int i = 0; i < 3; i++ )
+	{
+		clients.emplace_back(io_service);
+		auto socket = accept_loopback(acceptor, clients.back());
+		connections.push_back(std::make_shared<served::net::connection>(
+			io_service, std::move(socket), manager, mux, timers, 0, 0, 0));
+	}
+
+	// Connections may be started from different threads.
+	std::thread other([&]() { manager.start(connections[0]); });
+	other.join();
+	manager.start(connections[1]);
+	manager.start(connections[2]);
+	CHECK(manager.size() == 3);
+
+	SECTION("stopping a connection removes it")
+	{
+		manager.stop(connections[0]);
+		manager.stop(connections[0]);
+		CHECK(manager.size() == 2);
+
+		manager.stop(connections[2]);
+		CHECK(manager.size() == 1);
+	}
+
+	SECTION("stop_all closes every connection from the io thread")
+	{
+		std::thread other([&]() { manager.stop_all(); });
+		other.join();
+		CHECK(manager.size() == 0);
+
+		io_service.run();
+
+		for ( auto & client : clients )
+		{
+			char data;
+			boost::system::error_code ec;
+			client.read_some(boost::asio::buffer(&data, 1), ec);
+			CHECK(ec == boost::asio::error::eof);
+		}
+	}
+}
@@ -0,0 +1,236 @@
+/*
+ * Copyright (C) 2021 QM Ltd.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <served/net/connection_pool.hpp>
+
+using namespace served;
+using namespace served::net;
+
+//  -----  stats  -----
+
+connection_pool_stats::connection_pool_stats()
+	: allocated(0)
+	, reused(0)
+	, recycled(0)
+	, discarded(0)
+	, pooled(0)
+	, pooled_bytes(0)
+{}
+
+connection_pool_stats &
+connection_pool_stats::operator+=(const connection_pool_stats & other)
+{
+	allocated    += other.allocated;
+	reused       += other.reused;
+	recycled     += other.recycled;
+	discarded    += other.discarded;
+	pooled       += other.pooled;
+	pooled_bytes += other.pooled_bytes;
+	return *this;
+}
+
+//  -----  pool state  -----
+
+void
+connection_pool::state::release(connection * c)
+{
+	// Pooled connections hold nothing of the previous client, such as open files or sessions.
+	c->recycle();
+
+	const size_t bytes = c->retained_bytes();
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		if ( free.size() < max_size && stats.pooled_bytes + bytes <= max_bytes )
+		{
+			free.push_back(c);
+			stats.recycled++;
+			stats.pooled++;
+			stats.pooled_bytes += bytes;
+			return;
+		}
+		stats.discarded++;
+	}
+	delete c;
+}
+
+void
+connection_pool::state::trim(std::vector<connection*> & discard)
+{
+	while ( ! free.empty() && ( free.size() > max_size || stats.pooled_bytes > max_bytes ) )
+	{
+		connection * c = free.back();
+		free.pop_back();
+
+		stats.pooled--;
+		stats.pooled_bytes -= c->retained_bytes();
+		discard.push_back(c);
+	}
+}
+
+//  -----  connection pool  -----
+
+connection_pool::connection_pool(size_t max_size, size_t max_bytes)
+	: _state(std::make_shared<state>())
+	, _buffers(std::make_shared<buffer_pool>())
+{
+	_state->max_size  = max_size;
+	_state->max_bytes = max_bytes;
+}
+
+connection_pool::~connection_pool()
+{
+	clear();
+}
+
+connection_ptr
+connection_pool::acquire( boost::asio::io_service &    io_service
+                        , boost::asio::ip::tcp::socket socket
+                        , connection_manager &         manager
+                        , multiplexer        &         handler
+                        , timer_wheel_ptr              timers
+                        , size_t                       max_request_size_bytes
+                        , int                          read_timeout
+                        , int                          write_timeout
+                        , int                          keep_alive_timeout
+                        , size_t                       max_requests
+                        , int                          header_timeout
+                        , size_t                       max_stream_pending_bytes /* = 1024 * 1024 */
+                        , size_t                       http2_max_streams        /* = 0 */
+                        , tls_context_ptr              tls_context              /* = nullptr */
+                        )
+{
+	connection * c = nullptr;
+	{
+		std::lock_guard<std::mutex> lock(_state->mutex);
+		if ( ! _state->free.empty() )
+		{
+			c = _state->free.back();
+			_state->free.pop_back();
+
+			_state->stats.reused++;
+			_state->stats.pooled--;
+			_state->stats.pooled_bytes -= c->retained_bytes();
+		}
+		else
+		{
+			_state->stats.allocated++;
+		}
+	}
+
+	if ( c )
+	{
+		c->reset(std::move(socket));
+	}
+	else
+	{
+		c = new connection( io_service
+		                  , std::move(socket)
+		                  , manager
+		                  , handler
+		                  , std::move(timers)
+		                  , max_request_size_bytes
+		                  , read_timeout
+		                  , write_timeout
+		                  , keep_alive_timeout
+		                  , max_requests
+		                  , header_timeout
+		                  , max_stream_pending_bytes
+		                  , http2_max_streams
+		                  , std::move(tls_context)
+		                  , _buffers
+		                  );
+	}
+
+	// The connection is handed back to the pool once its last reference is released, unless the
+	// pool no longer exists.
+	std::weak_ptr<state> weak_state(_state);
+	return connection_ptr(c, [weak_state](connection * c) {
+		if ( auto s = weak_state.lock() )
+		{
+			s->release(c);
+		}
+		else
+		{
+			delete c;
+		}
+	});
+}
+
+void
+connection_pool::set_max_size(size_t max_size)
+{
+	std::vector<connection*> discard;
+	{
+		std::lock_guard<std::mutex> lock(_state->mutex);
+		_state->max_size = max_size;
+		_state->trim(discard);
+	}
+	for ( auto c : discard )
+	{
+		delete c;
+	}
+}
+
+void
+connection_pool::set_max_bytes(size_t max_bytes)
+{
+	std::vector<connection*> discard;
+	{
+		std::lock_guard<std::mutex> lock(_state->mutex);
+		_state->max_bytes = max_bytes;
+		_state->trim(discard);
+	}
+	for ( auto c : discard )
+	{
+		delete c;
+	}
+}
+
+void
+connection_pool::clear()
+{
+	std::vector<connection*> discard;
+	{
+		std::lock_guard<std::mutex> lock(_state->mutex);
+		discard.swap(_state->free);
+
+		_state->stats.pooled       = 0;
+		_state->stats.pooled_bytes = 0;
+	}
+	for ( auto c : discard )
+	{
+		delete c;
+	}
+}
+
+connection_pool_stats
+connection_pool::stats() const
+{
+	std::lock_guard<std::mutex> lock(_state->mutex);
+	return _state->stats;
+}
+
+const buffer_pool_ptr &
+connection_pool::buffers() const
+{
+	return _buffers;
+}
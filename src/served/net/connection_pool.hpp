@@ -0,0 +1,170 @@
+/*
+ * Copyright (C) 2021 QM Ltd.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef SERVED_CONNECTION_POOL_HPP
+#define SERVED_CONNECTION_POOL_HPP
+
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include <served/net/connection.hpp>
+
+namespace served { namespace net {
+
+/*
+ * Counters describing the activity of a connection pool.
+ */
+struct connection_pool_stats
+{
+	size_t allocated;    // connections constructed because the pool was empty
+	size_t reused;       // connections taken from the pool
+	size_t recycled;     // connections returned to the pool
+	size_t discarded;    // connections freed because the pool was at a limit
+	size_t pooled;       // connections currently held by the pool
+	size_t pooled_bytes; // approximate memory currently held by the pool
+
+	connection_pool_stats();
+
+	connection_pool_stats & operator+=(const connection_pool_stats & other);
+};
+
+/*
+ * Recycles connection objects, along with their buffers, between accepted sockets.
+ *
+ * Connections acquired from the pool are returned to it when the last reference to them is
+ * released, rather than being destroyed. They are recycled on their return, so an idle connection
+ * holds no files, sessions or request buffers of its previous client. A server keeps one pool for each of its shards, so
+ * every connection in a pool shares the same io_service and connection manager.
+ *
+ * The pool may be used from multiple threads. It is safe for connections to outlive the pool,
+ * in which case they are destroyed as usual.
+ */
+class connection_pool
+{
+	struct state
+	{
+		std::mutex               mutex;
+		std::vector<connection*> free;
+		size_t                   max_size;
+		size_t                   max_bytes;
+		connection_pool_stats    stats;
+
+		void release(connection * c);
+		void trim(std::vector<connection*> & discard);
+	};
+
+	std::shared_ptr<state> _state;
+	buffer_pool_ptr        _buffers;
+
+public:
+	connection_pool(const connection_pool&) = delete;
+
+	connection_pool& operator=(const connection_pool&) = delete;
+
+	/*
+	 * Constructs a connection pool.
+	 *
+	 * @param max_size the maximum number of idle connections retained, 0 disables pooling
+	 * @param max_bytes the maximum memory retained by idle connections
+	 */
+	explicit connection_pool(size_t max_size = 256, size_t max_bytes = 16 * 1024 * 1024);
+
+	~connection_pool();
+
+	/*
+	 * Acquires a connection for a newly accepted socket.
+	 *
+	 * An idle connection is reused when one is available, otherwise a new connection is
+	 * constructed with the given parameters.
+	 *
+	 * @param io_service the boost::asio::io_service for managing async operations
+	 * @param socket the boost::asio socket for the connection
+	 * @param manager the connection manager that oversees the connection
+	 * @param handler the multiplexer responsible for routing requests
+	 * @param timers the timer wheel used for the connection timeouts
+	 * @param max_request_size_bytes maximum permitted size of a request
+	 * @param read_timeout the timeout for reading, 0 is ignored
+	 * @param write_timeout the timeout for writing, 0 is ignored
+	 * @param keep_alive_timeout the idle timeout between requests, 0 is ignored
+	 * @param max_requests maximum number of requests served before closing, 0 is ignored
+	 * @param header_timeout the timeout for receiving a request header, 0 is ignored
+	 * @param max_stream_pending_bytes the bytes of a streamed response pending before writers wait
+	 * @param http2_max_streams the concurrent streams of an HTTP/2 client, 0 disables HTTP/2
+	 * @param tls_context the TLS settings of the server, or nullptr to serve plain TCP
+	 * @return the connection
+	 */
+	connection_ptr acquire( boost::asio::io_service &    io_service
+	                      , boost::asio::ip::tcp::socket socket
+	                      , connection_manager &         manager
+	                      , multiplexer        &         handler
+	                      , timer_wheel_ptr              timers
+	                      , size_t                       max_request_size_bytes
+	                      , int                          read_timeout
+	                      , int                          write_timeout
+	                      , int                          keep_alive_timeout
+	                      , size_t                       max_requests
+	                      , int                          header_timeout
+	                      , size_t                       max_stream_pending_bytes = 1024 * 1024
+	                      , size_t                       http2_max_streams = 0
+	                      , tls_context_ptr              tls_context = nullptr );
+
+	/*
+	 * Sets the maximum number of idle connections retained, 0 disables pooling.
+	 *
+	 * @param max_size the maximum number of connections
+	 */
+	void set_max_size(size_t max_size);
+
+	/*
+	 * Sets the maximum memory retained by idle connections.
+	 *
+	 * @param max_bytes the maximum number of bytes
+	 */
+	void set_max_bytes(size_t max_bytes);
+
+	/*
+	 * Destroys all idle connections.
+	 *
+	 * Idle connections keep the parameters they were constructed with, so the pool must be
+	 * cleared when those parameters change.
+	 */
+	void clear();
+
+	/*
+	 * Get the counters of the pool.
+	 *
+	 * @return a snapshot of the pool counters
+	 */
+	connection_pool_stats stats() const;
+
+	/*
+	 * Get the pool lending read buffers to the connections of this pool.
+	 *
+	 * @return the buffer pool
+	 */
+	const buffer_pool_ptr & buffers() const;
+};
+
+} } // net, served
+
+#endif // SERVED_CONNECTION_POOL_HPP
@@ -0,0 +1,199 @@
+/*
+ * Copyright (C) 2021 QM Ltd.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <test/catch.hpp>
+
+#include <served/net/connection_manager.hpp>
+#include <served/net/connection_pool.hpp>
+#include <served/net/server.hpp>
+
+#include <boost/asio.hpp>
+#include <thread>
+
+#include <unistd.h>
+
+namespace {
+
+served::net::connection_ptr
+acquire(served::net::connection_pool & pool, boost::asio::io_service & io_service,
+        served::net::connection_manager & manager, served::multiplexer & mux)
+{
+	auto timers = std::make_shared<served::net::timer_wheel>(io_service);
+	return pool.acquire(io_service, boost::asio::ip::tcp::socket(io_service), manager, mux, timers,
+	                    0, 0, 0, 0, 0, 0);
+}
+
+/*
+ * Waits for a closed connection of the server to be returned to its pool.
+ */
+bool
+wait_for_pooled(served::net::server & server)
+{
+	for ( int i = 0; i < 100 && server.get_connection_pool_stats().pooled == 0; i++ )
+	{
+		std::this_thread::sleep_for(std::chrono::milliseconds(10));
+	}
+	return server.get_connection_pool_stats().pooled == 1;
+}
+
+} // anonymous namespace
+
+TEST_CASE("connection pool recycles connections", "[connection_pool]")
+{
+	boost::asio::io_service         io_service;
+	served::net::connection_manager manager(io_service);
+	served::multiplexer             mux;
+
+	SECTION("released connections are reused")
+	{
+		served::net::connection_pool pool(4);
+
+		auto c = acquire(pool, io_service, manager, mux);
+		served::net::connection * first = c.get();
+		c.reset();
+
+		auto stats = pool.stats();
+		CHECK(stats.allocated == 1);
+		CHECK(stats.recycled == 1);
+		CHECK(stats.pooled == 1);
+		CHECK(stats.pooled_bytes >= sizeof(served::net::connection));
+
+		c = acquire(pool, io_service, manager, mux);
+		CHECK(c.get() == first);
+		CHECK(c->shared_from_this() == c);
+
+		stats = pool.stats();
+		CHECK(stats.allocated == 1);
+		CHECK(stats.reused == 1);
+		CHECK(stats.pooled == 0);
+		CHECK(stats.pooled_bytes == 0);
+	}
+
+	SECTION("the pool size is limited")
+	{
+		served::net::connection_pool pool(1);
+
+		auto c1 = acquire(pool, io_service, manager, mux);
+		auto c2 = acquire(pool, io_service, manager, mux);
+		c1.reset();
+		c2.reset();
+
+		auto stats = pool.stats();
+		CHECK(stats.allocated == 2);
+		CHECK(stats.recycled == 1);
+		CHECK(stats.discarded == 1);
+		CHECK(stats.pooled == 1);
+
+		pool.set_max_size(0);
+		CHECK(pool.stats().pooled == 0);
+
+		acquire(pool, io_service, manager, mux);
+		CHECK(pool.stats().discarded == 2);
+	}
+
+	SECTION("the retained memory is limited")
+	{
+		served::net::connection_pool pool(4, sizeof(served::net::connection) / 2);
+
+		acquire(pool, io_service, manager, mux);
+
+		auto stats = pool.stats();
+		CHECK(stats.discarded == 1);
+		CHECK(stats.pooled == 0);
+	}
+
+	SECTION("connections may outlive the pool")
+	{
+		served::net::connection_ptr c;
+		{
+			served::net::connection_pool pool(4);
+			c = acquire(pool, io_service, manager, mux);
+		}
+		c.reset();
+	}
+}
+
+TEST_CASE("released connections hold nothing of their client", "[connection_pool]")
+{
+	const std::string large(1024 * 1024, 'x');
+
+	// Large enough that the file cannot be sent without waiting for the socket to drain.
+	char path[] = "/tmp/served_connection_pool_test_XXXXXX";
+	int fd = ::mkstemp(path);
+	REQUIRE(fd >= 0);
+	REQUIRE(::ftruncate(fd, 16 * 1024 * 1024) == 0);
+	::unlink(path);
+
+	auto file = std::make_shared<served::file_handle>(fd);
+	std::weak_ptr<const served::file_handle> sent_file(file);
+
+	served::multiplexer mux;
+	mux.handle("/upload")
+		.post([](served::response & res, const served::request & req) {
+			res << std::to_string(req.body().size());
+		});
+	mux.handle("/file")
+		.get([&file](served::response & res, const served::request &) {
+			// Only the response holds the file once the handler returns.
+			res.set_file_body(file, 0, 16 * 1024 * 1024);
+			file.reset();
+		});
+
+	served::net::server server("127.0.0.1", "42820", mux, false);
+	std::thread server_thread([&]() { server.run(); });
+
+	boost::asio::io_service io_service;
+	boost::asio::ip::tcp::socket socket(io_service);
+	socket.connect(boost::asio::ip::tcp::endpoint(boost::asio::ip::address::from_string("127.0.0.1"), 42820));
+	boost::asio::streambuf buf;
+
+	SECTION("the body of the last request is freed")
+	{
+		boost::asio::write(socket, boost::asio::buffer("POST /upload HTTP/1.1\r\nContent-Length: "
+			+ std::to_string(large.size()) + "\r\nConnection: close\r\n\r\n" + large));
+
+		boost::system::error_code ec;
+		boost::asio::read(socket, buf, boost::asio::transfer_all(), ec);
+		std::string res(boost::asio::buffers_begin(buf.data()), boost::asio::buffers_end(buf.data()));
+		CHECK(res.substr(res.length() - 7) == "1048576");
+
+		// Nothing of the body is kept, nor counted against the pool.
+		REQUIRE(wait_for_pooled(server));
+		CHECK(server.get_connection_pool_stats().pooled_bytes < 16 * 1024);
+	}
+
+	SECTION("the file of an unfinished response is closed")
+	{
+		boost::asio::write(socket, boost::asio::buffer(std::string("GET /file HTTP/1.1\r\n\r\n")));
+		boost::asio::read_until(socket, buf, "\r\n\r\n");
+
+		// The client leaves while most of the file is still to be sent.
+		socket.set_option(boost::asio::socket_base::linger(true, 0));
+		socket.close();
+
+		REQUIRE(wait_for_pooled(server));
+		CHECK(sent_file.expired());
+	}
+
+	server.stop();
+	server_thread.join();
+}
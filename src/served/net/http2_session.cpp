@@ -0,0 +1,1691 @@
+/*
+ * Copyright (C) 2021 QM Ltd.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <served/net/http2_session.hpp>
+#include <served/net/connection.hpp>
+#include <served/request_error.hpp>
+#include <served/request_parser_impl.hpp>
+#include <served/status.hpp>
+#include <served/version.hpp>
+
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+#include <thread>
+
+#include <unistd.h>
+
+using namespace served;
+using namespace served::net;
+
+namespace {
+
+enum frame_type : uint8_t
+{
+	DATA          = 0x0,
+	HEADERS       = 0x1,
+	PRIORITY      = 0x2,
+	RST_STREAM    = 0x3,
+	SETTINGS      = 0x4,
+	PUSH_PROMISE  = 0x5,
+	PING          = 0x6,
+	GOAWAY        = 0x7,
+	WINDOW_UPDATE = 0x8,
+	CONTINUATION  = 0x9
+};
+
+const uint8_t flag_end_stream  = 0x1;
+const uint8_t flag_ack         = 0x1;
+const uint8_t flag_end_headers = 0x4;
+const uint8_t flag_padded      = 0x8;
+const uint8_t flag_priority    = 0x20;
+
+enum error_code : uint32_t
+{
+	NO_ERROR           = 0x0,
+	PROTOCOL_ERROR     = 0x1,
+	INTERNAL_ERROR     = 0x2,
+	FLOW_CONTROL_ERROR = 0x3,
+	STREAM_CLOSED      = 0x5,
+	FRAME_SIZE_ERROR   = 0x6,
+	REFUSED_STREAM     = 0x7,
+	CANCEL             = 0x8,
+	COMPRESSION_ERROR  = 0x9,
+	ENHANCE_YOUR_CALM  = 0xb
+};
+
+enum setting : uint16_t
+{
+	HEADER_TABLE_SIZE      = 0x1,
+	ENABLE_PUSH            = 0x2,
+	MAX_CONCURRENT_STREAMS = 0x3,
+	INITIAL_WINDOW_SIZE    = 0x4,
+	MAX_FRAME_SIZE         = 0x5,
+	MAX_HEADER_LIST_SIZE   = 0x6
+};
+
+const size_t  frame_header_size  = 9;
+const size_t  default_frame_size = 16384;
+const int64_t default_window     = 65535;
+const int64_t max_window         = 0x7fffffff;
+
+// The windows granted to the client, replenished once half has been used.
+const int64_t recv_stream_window     = 256 * 1024;
+const int64_t recv_connection_window = 1024 * 1024;
+
+// The largest header list accepted, as counted by RFC 7541, which also bounds the header block
+// collected from CONTINUATION frames whatever the max request size.
+const size_t max_header_list_size = 64 * 1024;
+
+// Frames are read into a buffer that holds at least one frame of the size we accept.
+const size_t read_buffer_size = 2 * ( frame_header_size + default_frame_size );
+
+// DATA frames queued for a single write, so that streams are interleaved with control frames.
+const size_t max_write_bytes = 256 * 1024;
+
+uint32_t
+read_u32(const char * p)
+{
+	const uint8_t * b = reinterpret_cast<const uint8_t *>(p);
+	return ( uint32_t(b[0]) << 24 ) | ( uint32_t(b[1]) << 16 ) | ( uint32_t(b[2]) << 8 ) | b[3];
+}
+
+void
+append_u32(std::string & out, uint32_t value)
+{
+	out.push_back(static_cast<char>(value >> 24));
+	out.push_back(static_cast<char>(( value >> 16 ) & 0xff));
+	out.push_back(static_cast<char>(( value >> 8 ) & 0xff));
+	out.push_back(static_cast<char>(value & 0xff));
+}
+
+std::string
+frame_header(size_t len, uint8_t type, uint8_t flags, uint32_t stream_id)
+{
+	std::string header;
+	header.reserve(frame_header_size);
+	header.push_back(static_cast<char>(( len >> 16 ) & 0xff));
+	header.push_back(static_cast<char>(( len >> 8 ) & 0xff));
+	header.push_back(static_cast<char>(len & 0xff));
+	header.push_back(static_cast<char>(type));
+	header.push_back(static_cast<char>(flags));
+	append_u32(header, stream_id & 0x7fffffff);
+	return header;
+}
+
+std::string
+setting_entry(uint16_t id, uint32_t value)
+{
+	std::string entry;
+	entry.push_back(static_cast<char>(id >> 8));
+	entry.push_back(static_cast<char>(id & 0xff));
+	append_u32(entry, value);
+	return entry;
+}
+
+/*
+ * Decodes the base64url value of an HTTP2-Settings header, padding is optional.
+ */
+bool
+base64url_decode(const std::string & in, std::string & out)
+{
+	uint32_t bits  = 0;
+	int      nbits = 0;
+	for ( char c : in )
+	{
+		int value;
+		if ( c >= 'A' && c <= 'Z' )      value = c - 'A';
+		else if ( c >= 'a' && c <= 'z' ) value = c - 'a' + 26;
+		else if ( c >= '0' && c <= '9' ) value = c - '0' + 52;
+		else if ( c == '-' || c == '+' ) value = 62;
+		else if ( c == '_' || c == '/' ) value = 63;
+		else if ( c == '=' )             break;
+		else                             return false;
+
+		bits   = ( bits << 6 ) | value;
+		nbits += 6;
+		if ( nbits >= 8 )
+		{
+			nbits -= 8;
+			out.push_back(static_cast<char>(( bits >> nbits ) & 0xff));
+		}
+	}
+	return true;
+}
+
+/*
+ * Header fields that are specific to an HTTP/1.1 connection, and not sent over HTTP/2.
+ */
+bool
+is_connection_header(const std::string & name)
+{
+	return name == "connection" || name == "keep-alive" || name == "proxy-connection"
+	    || name == "transfer-encoding" || name == "upgrade";
+}
+
+bool
+is_valid_field(const std::string & str)
+{
+	return str.find_first_of(std::string("\r\n\0", 3)) == std::string::npos;
+}
+
+/*
+ * Answers a request with an error thrown while handling it.
+ */
+void
+set_error_response(response & res, std::exception_ptr error)
+{
+	try
+	{
+		std::rethrow_exception(error);
+	}
+	catch (const served::request_error & e)
+	{
+		res.set_status(e.get_status_code());
+		res.set_header("Content-Type", e.get_content_type());
+		res.set_body(e.what());
+	}
+	catch (...)
+	{
+		response::stock_reply(status_5XX::INTERNAL_SERVER_ERROR, res);
+	}
+}
+
+} // anonymous namespace
+
+/*
+ * The state of a single stream, its request and the response being sent.
+ */
+struct http2_session::stream
+{
+	uint32_t                     id;
+	request                      req;
+	response                     res;
+	std::string                  body;
+	served_body_chunk_handler    body_sink;
+	size_t                       body_bytes;
+	int64_t                      send_window;
+	int64_t                      recv_window;
+	bool                         remote_closed;
+	bool                         dispatched;
+	bool                         handler_running;
+	bool                         discard_body;
+	bool                         responding;
+	bool                         local_closed;
+	bool                         closed;
+
+	// The response body, sent in order: the body in memory, then any file, then any stream.
+	std::shared_ptr<const std::string> cached;
+	const char *                 data;
+	size_t                       data_remaining;
+	file_handle_ptr              file;
+	size_t                       file_offset;
+	size_t                       file_remaining;
+	stream_channel_ptr           channel;
+	std::deque<stream_chunk_ptr> chunks;
+	size_t                       chunk_offset;
+	bool                         channel_last;
+
+	stream(uint32_t stream_id, int64_t initial_send_window)
+		: id(stream_id)
+		, req()
+		, res()
+		, body()
+		, body_sink()
+		, body_bytes(0)
+		, send_window(initial_send_window)
+		, recv_window(recv_stream_window)
+		, remote_closed(false)
+		, dispatched(false)
+		, handler_running(false)
+		, discard_body(false)
+		, responding(false)
+		, local_closed(false)
+		, closed(false)
+		, cached()
+		, data(nullptr)
+		, data_remaining(0)
+		, file()
+		, file_offset(0)
+		, file_remaining(0)
+		, channel()
+		, chunks()
+		, chunk_offset(0)
+		, channel_last(false)
+	{
+	}
+};
+
+const std::string http2_session::preface("PRI * HTTP/2.0\r\n\r\nSM\r\n\r\n");
+
+bool
+http2_session::is_preface(const char * data, size_t len)
+{
+	if ( len < 4 )
+	{
+		return false;
+	}
+	return preface.compare(0, std::min(len, preface.size()), data, std::min(len, preface.size())) == 0;
+}
+
+http2_session::http2_session( multiplexer &   handler
+                            , timer_wheel_ptr timers
+                            , size_t          max_request_size_bytes
+                            , size_t          max_concurrent_streams
+                            , size_t          max_stream_pending_bytes
+                            , int             idle_timeout )
+	: _request_handler(handler)
+	, _timers(std::move(timers))
+	, _max_req_size_bytes(max_request_size_bytes)
+	, _max_concurrent_streams(max_concurrent_streams)
+	, _max_stream_pending_bytes(max_stream_pending_bytes)
+	, _idle_timeout(idle_timeout)
+	, _io_service(nullptr)
+	, _transport(nullptr)
+	, _owner()
+	, _on_finished()
+	, _source()
+	, _buffer()
+	, _buffer_begin(0)
+	, _buffer_end(0)
+	, _preface_received(false)
+	, _settings_received(false)
+	, _decoder()
+	, _header_block()
+	, _header_stream_id(0)
+	, _header_end_stream(false)
+	, _last_stream_id(0)
+	, _recv_window(recv_connection_window)
+	, _streams()
+	, _upgraded_stream()
+	, _encoder()
+	, _write_queue()
+	, _writing()
+	, _write_in_progress(false)
+	, _send_window(default_window)
+	, _initial_send_window(default_window)
+	, _max_send_frame_size(default_frame_size)
+	, _goaway_sent(false)
+	, _goaway_received(false)
+	, _close_after_write(false)
+	, _finished(false)
+	, _idle_timer()
+{
+}
+
+http2_session::~http2_session()
+{
+	if ( _timers )
+	{
+		_timers->cancel(_idle_timer);
+	}
+	for ( const auto & s : _streams )
+	{
+		if ( s.second->channel )
+		{
+			s.second->channel->abort();
+		}
+	}
+}
+
+//  -----  starting  -----
+
+bool
+http2_session::upgrade(const request & req, const std::string & settings)
+{
+	std::string payload;
+	if ( ! base64url_decode(settings, payload) || payload.size() % 6 != 0 )
+	{
+		return false;
+	}
+	if ( apply_settings(payload.data(), payload.size()) != NO_ERROR )
+	{
+		return false;
+	}
+
+	// The request was sent over HTTP/1.1, and is answered over HTTP/2 as the half closed stream 1.
+	auto s = std::make_shared<stream>(1, _initial_send_window);
+	s->req = req;
+	s->req.set_HTTP_version("HTTP/2.0");
+	s->remote_closed = true;
+
+	_upgraded_stream = s;
+	_last_stream_id  = 1;
+	return true;
+}
+
+void
+http2_session::start( boost::asio::io_service &      io_service
+                    , transport &                    transport
+                    , std::shared_ptr<void>          owner
+                    , std::string                    source
+                    , std::string                    initial_bytes
+                    , std::function<void()>          on_finished )
+{
+	_io_service  = &io_service;
+	_transport   = &transport;
+	_owner       = std::move(owner);
+	_source      = std::move(source);
+	_on_finished = std::move(on_finished);
+
+	_buffer.resize(std::max(read_buffer_size, initial_bytes.size()));
+	std::copy(initial_bytes.begin(), initial_bytes.end(), _buffer.begin());
+	_buffer_begin = 0;
+	_buffer_end   = initial_bytes.size();
+
+	std::weak_ptr<http2_session> weak_self(shared_from_this());
+	_idle_timer.set_callback([weak_self]() {
+		if ( auto self = weak_self.lock() )
+		{
+			self->shutdown();
+		}
+	});
+
+	// The server preface, followed by the larger connection window granted to the client.
+	std::string settings = setting_entry(MAX_CONCURRENT_STREAMS, _max_concurrent_streams)
+	                     + setting_entry(INITIAL_WINDOW_SIZE, recv_stream_window)
+	                     + setting_entry(ENABLE_PUSH, 0)
+	                     + setting_entry(MAX_HEADER_LIST_SIZE, max_header_list_size);
+	queue_frame(SETTINGS, 0, 0, std::move(settings));
+
+	std::string increment;
+	append_u32(increment, recv_connection_window - default_window);
+	queue_frame(WINDOW_UPDATE, 0, 0, std::move(increment));
+
+	if ( _upgraded_stream )
+	{
+		_upgraded_stream->req.set_source(_source);
+		_streams[1] = _upgraded_stream;
+		dispatch(_upgraded_stream);
+		_upgraded_stream.reset();
+	}
+	else
+	{
+		check_idle();
+	}
+
+	process_buffer();
+}
+
+void
+http2_session::shutdown()
+{
+	if ( ! _io_service )
+	{
+		return;
+	}
+
+	auto self(shared_from_this());
+	_io_service->post([this, self]() {
+		if ( _finished )
+		{
+			return;
+		}
+		if ( ! _goaway_sent )
+		{
+			// Streams already opened by the client are still served.
+			_goaway_sent = true;
+
+			std::string payload;
+			append_u32(payload, _last_stream_id);
+			append_u32(payload, NO_ERROR);
+			queue_frame(GOAWAY, 0, 0, std::move(payload));
+		}
+		check_idle();
+		flush();
+	});
+}
+
+//  -----  reading  -----
+
+void
+http2_session::do_read()
+{
+	// A partial frame is kept at the start of the buffer.
+	if ( _buffer_begin > 0 )
+	{
+		std::memmove(_buffer.data(), _buffer.data() + _buffer_begin, _buffer_end - _buffer_begin);
+		_buffer_end  -= _buffer_begin;
+		_buffer_begin = 0;
+	}
+
+	auto self(shared_from_this());
+	auto owner(_owner);
+
+	_transport->async_read_some(boost::asio::buffer(_buffer.data() + _buffer_end, _buffer.size() - _buffer_end),
+		[this, self, owner](boost::system::error_code ec, std::size_t bytes_transferred) {
+			if ( ec )
+			{
+				finish();
+				return;
+			}
+			_buffer_end += bytes_transferred;
+			process_buffer();
+		});
+}
+
+void
+http2_session::process_buffer()
+{
+	while ( ! _finished && ! _close_after_write )
+	{
+		const char * p         = _buffer.data() + _buffer_begin;
+		const size_t available = _buffer_end - _buffer_begin;
+
+		if ( ! _preface_received )
+		{
+			const size_t n = std::min(available, preface.size());
+			if ( preface.compare(0, n, p, n) != 0 )
+			{
+				fail(PROTOCOL_ERROR);
+				break;
+			}
+			if ( n < preface.size() )
+			{
+				break;
+			}
+			_buffer_begin    += preface.size();
+			_preface_received = true;
+			continue;
+		}
+
+		if ( available < frame_header_size )
+		{
+			break;
+		}
+
+		const size_t   len       = ( uint32_t(uint8_t(p[0])) << 16 ) | ( uint32_t(uint8_t(p[1])) << 8 ) | uint8_t(p[2]);
+		const uint8_t  type      = p[3];
+		const uint8_t  flags     = p[4];
+		const uint32_t stream_id = read_u32(p + 5) & 0x7fffffff;
+
+		if ( len > default_frame_size )
+		{
+			fail(FRAME_SIZE_ERROR);
+			break;
+		}
+		if ( available < frame_header_size + len )
+		{
+			break;
+		}
+
+		_buffer_begin += frame_header_size + len;
+		if ( ! handle_frame(type, flags, stream_id, p + frame_header_size, len) )
+		{
+			break;
+		}
+	}
+
+	if ( ! _finished && ! _close_after_write )
+	{
+		do_read();
+	}
+
+	// Frames queued while handling the batch go out in a single write.
+	flush();
+}
+
+bool
+http2_session::handle_frame(uint8_t type, uint8_t flags, uint32_t stream_id, const char * payload, size_t len)
+{
+	// A header block must not be interrupted by any other frame.
+	if ( _header_stream_id != 0 && type != CONTINUATION )
+	{
+		fail(PROTOCOL_ERROR);
+		return false;
+	}
+	// The client preface ends with its settings.
+	if ( ! _settings_received && type != SETTINGS )
+	{
+		fail(PROTOCOL_ERROR);
+		return false;
+	}
+
+	switch ( type )
+	{
+	case DATA:
+		return handle_data(flags, stream_id, payload, len);
+	case HEADERS:
+	case CONTINUATION:
+		return handle_headers(type, flags, stream_id, payload, len);
+	case PRIORITY:
+		if ( stream_id == 0 )
+		{
+			fail(PROTOCOL_ERROR);
+			return false;
+		}
+		if ( len != 5 )
+		{
+			reset_stream(stream_id, FRAME_SIZE_ERROR);
+		}
+		return true;
+	case RST_STREAM:
+		if ( stream_id == 0 || stream_id > _last_stream_id )
+		{
+			fail(PROTOCOL_ERROR);
+			return false;
+		}
+		if ( len != 4 )
+		{
+			fail(FRAME_SIZE_ERROR);
+			return false;
+		}
+		close_stream(stream_id);
+		return true;
+	case SETTINGS:
+		return handle_settings(flags, stream_id, payload, len);
+	case PUSH_PROMISE:
+		// Only servers push.
+		fail(PROTOCOL_ERROR);
+		return false;
+	case PING:
+		if ( stream_id != 0 )
+		{
+			fail(PROTOCOL_ERROR);
+			return false;
+		}
+		if ( len != 8 )
+		{
+			fail(FRAME_SIZE_ERROR);
+			return false;
+		}
+		if ( ! ( flags & flag_ack ) )
+		{
+			queue_frame(PING, flag_ack, 0, std::string(payload, len));
+		}
+		return true;
+	case GOAWAY:
+		if ( stream_id != 0 )
+		{
+			fail(PROTOCOL_ERROR);
+			return false;
+		}
+		// Streams in progress are completed before closing.
+		_goaway_received = true;
+		check_idle();
+		return true;
+	case WINDOW_UPDATE:
+		return handle_window_update(stream_id, payload, len);
+	default:
+		// Unknown frame types are ignored.
+		return true;
+	}
+}
+
+bool
+http2_session::handle_settings(uint8_t flags, uint32_t stream_id, const char * payload, size_t len)
+{
+	if ( stream_id != 0 )
+	{
+		fail(PROTOCOL_ERROR);
+		return false;
+	}
+	if ( flags & flag_ack )
+	{
+		if ( len != 0 )
+		{
+			fail(FRAME_SIZE_ERROR);
+			return false;
+		}
+		return true;
+	}
+	if ( len % 6 != 0 )
+	{
+		fail(FRAME_SIZE_ERROR);
+		return false;
+	}
+
+	const uint32_t error = apply_settings(payload, len);
+	if ( error != NO_ERROR )
+	{
+		fail(error);
+		return false;
+	}
+
+	_settings_received = true;
+	queue_frame(SETTINGS, flag_ack, 0, std::string());
+	return true;
+}
+
+uint32_t
+http2_session::apply_settings(const char * payload, size_t len)
+{
+	for ( size_t i = 0; i + 6 <= len; i += 6 )
+	{
+		const uint16_t id    = ( uint16_t(uint8_t(payload[i])) << 8 ) | uint8_t(payload[i + 1]);
+		const uint32_t value = read_u32(payload + i + 2);
+
+		switch ( id )
+		{
+		case HEADER_TABLE_SIZE:
+		{
+			// The table is never larger than the default, whatever the client allows.
+			const size_t size = std::min<size_t>(value, 4096);
+			if ( size != _encoder.dynamic_table().max_size() )
+			{
+				_encoder.set_max_table_size(size);
+			}
+			break;
+		}
+		case ENABLE_PUSH:
+			if ( value > 1 )
+			{
+				return PROTOCOL_ERROR;
+			}
+			break;
+		case INITIAL_WINDOW_SIZE:
+		{
+			if ( value > max_window )
+			{
+				return FLOW_CONTROL_ERROR;
+			}
+			// The change applies to the windows of open streams.
+			const int64_t delta = int64_t(value) - _initial_send_window;
+			for ( const auto & s : _streams )
+			{
+				s.second->send_window += delta;
+				if ( s.second->send_window > max_window )
+				{
+					return FLOW_CONTROL_ERROR;
+				}
+			}
+			_initial_send_window = value;
+			break;
+		}
+		case MAX_FRAME_SIZE:
+			if ( value < default_frame_size || value > 0xffffff )
+			{
+				return PROTOCOL_ERROR;
+			}
+			_max_send_frame_size = value;
+			break;
+		default:
+			// Unknown settings, and limits that do not affect a server, are ignored.
+			break;
+		}
+	}
+	return NO_ERROR;
+}
+
+bool
+http2_session::handle_headers(uint8_t type, uint8_t flags, uint32_t stream_id, const char * payload, size_t len)
+{
+	if ( type == HEADERS )
+	{
+		if ( stream_id == 0 )
+		{
+			fail(PROTOCOL_ERROR);
+			return false;
+		}
+
+		size_t padding = 0;
+		if ( flags & flag_padded )
+		{
+			if ( len < 1 )
+			{
+				fail(PROTOCOL_ERROR);
+				return false;
+			}
+			padding = uint8_t(payload[0]);
+			payload++;
+			len--;
+		}
+		if ( flags & flag_priority )
+		{
+			// Priorities are not used.
+			if ( len < 5 )
+			{
+				fail(FRAME_SIZE_ERROR);
+				return false;
+			}
+			payload += 5;
+			len     -= 5;
+		}
+		if ( padding > len )
+		{
+			fail(PROTOCOL_ERROR);
+			return false;
+		}
+
+		_header_stream_id  = stream_id;
+		_header_end_stream = flags & flag_end_stream;
+		_header_block.assign(payload, len - padding);
+	}
+	else
+	{
+		if ( _header_stream_id == 0 || stream_id != _header_stream_id )
+		{
+			fail(PROTOCOL_ERROR);
+			return false;
+		}
+		_header_block.append(payload, len);
+	}
+
+	if ( _header_block.size() > max_header_list_size
+	  || ( _max_req_size_bytes > 0 && _header_block.size() > _max_req_size_bytes ) )
+	{
+		fail(ENHANCE_YOUR_CALM);
+		return false;
+	}
+
+	if ( ! ( flags & flag_end_headers ) )
+	{
+		return true;
+	}
+
+	const uint32_t id = _header_stream_id;
+	_header_stream_id = 0;
+	return open_stream(id, _header_end_stream);
+}
+
+bool
+http2_session::open_stream(uint32_t stream_id, bool end_stream)
+{
+	// Every block is decoded, even those that are then refused, to keep the tables in step.
+	hpack::header_fields fields;
+	try
+	{
+		_decoder.decode(_header_block.data(), _header_block.size(), fields, max_header_list_size);
+	}
+	catch (const hpack::list_size_error &)
+	{
+		// The rest of the block was not decoded, so the tables are no longer in step.
+		fail(ENHANCE_YOUR_CALM);
+		return false;
+	}
+	catch (const hpack::error &)
+	{
+		fail(COMPRESSION_ERROR);
+		return false;
+	}
+
+	auto it = _streams.find(stream_id);
+	if ( it != _streams.end() )
+	{
+		// Trailers, which end the request body. Their fields are not used.
+		stream_ptr s = it->second;
+		if ( s->remote_closed )
+		{
+			reset_stream(stream_id, STREAM_CLOSED);
+			return true;
+		}
+		if ( ! end_stream )
+		{
+			fail(PROTOCOL_ERROR);
+			return false;
+		}
+		s->remote_closed = true;
+		if ( ! s->dispatched )
+		{
+			dispatch(s);
+		}
+		return true;
+	}
+
+	if ( stream_id % 2 == 0 || stream_id <= _last_stream_id )
+	{
+		fail(stream_id % 2 == 0 ? PROTOCOL_ERROR : STREAM_CLOSED);
+		return false;
+	}
+	_last_stream_id = stream_id;
+
+	if ( _goaway_sent )
+	{
+		// Streams opened after we started closing are not served.
+		return true;
+	}
+	if ( _streams.size() >= _max_concurrent_streams )
+	{
+		reset_stream(stream_id, REFUSED_STREAM);
+		return true;
+	}
+
+	auto s = std::make_shared<stream>(stream_id, _initial_send_window);
+	if ( ! build_request(*s, fields) )
+	{
+		reset_stream(stream_id, PROTOCOL_ERROR);
+		return true;
+	}
+
+	_streams[stream_id] = s;
+	_timers->cancel(_idle_timer);
+
+	s->remote_closed = end_stream;
+	if ( end_stream )
+	{
+		dispatch(s);
+		return true;
+	}
+
+	try
+	{
+		s->body_sink = _request_handler.open_body_stream(s->req);
+	}
+	catch (...)
+	{
+		// The rest of the body is discarded once the error is answered.
+		s->discard_body = true;
+		s->dispatched   = true;
+		complete_stream(s, std::current_exception());
+	}
+	return true;
+}
+
+bool
+http2_session::build_request(stream & s, const hpack::header_fields & fields)
+{
+	std::string method, path, scheme, authority;
+	bool        regular = false;
+
+	for ( const auto & field : fields )
+	{
+		const std::string & name  = field.first;
+		const std::string & value = field.second;
+
+		if ( name.empty() || ! is_valid_field(name) || ! is_valid_field(value)
+		  || std::any_of(name.begin(), name.end(), [](unsigned char c) { return std::isupper(c); }) )
+		{
+			return false;
+		}
+
+		if ( name[0] == ':' )
+		{
+			// Pseudo-header fields come first, once each.
+			std::string * target = nullptr;
+			if ( name == ":method" )         target = &method;
+			else if ( name == ":path" )      target = &path;
+			else if ( name == ":scheme" )    target = &scheme;
+			else if ( name == ":authority" ) target = &authority;
+
+			if ( regular || ! target || ! target->empty() )
+			{
+				return false;
+			}
+			*target = value;
+			continue;
+		}
+		regular = true;
+
+		if ( is_connection_header(name) || ( name == "te" && value != "trailers" ) )
+		{
+			return false;
+		}
+
+		// Repeated fields are combined as the HTTP/1.1 parser does, cookies with their own separator.
+		std::string combined = s.req.header(name);
+		if ( ! combined.empty() )
+		{
+			combined.append(name == "cookie" ? "; " : ",");
+		}
+		combined.append(value);
+		s.req.set_header(name, combined);
+	}
+
+	if ( method.empty() || path.empty() || scheme.empty() )
+	{
+		return false;
+	}
+
+	// The request line is parsed as it would be over HTTP/1.1, for the method, path and query. The
+	// parser sees no header fields, so that it does not expect a body.
+	request             line_request;
+	request_parser_impl parser(line_request);
+	const std::string   line = method + " " + path + " HTTP/1.1\r\n\r\n";
+	if ( parser.parse(line.data(), line.size()) != request_parser_impl::FINISHED )
+	{
+		return false;
+	}
+
+	s.req.set_method(line_request.method());
+	s.req.set_destination(line_request.url());
+	s.req.set_HTTP_version("HTTP/2.0");
+	s.req.query = line_request.query;
+	s.req.set_source(_source);
+
+	if ( s.req.header("host").empty() && ! authority.empty() )
+	{
+		s.req.set_header("host", authority);
+	}
+	return true;
+}
+
+bool
+http2_session::handle_data(uint8_t flags, uint32_t stream_id, const char * payload, size_t len)
+{
+	if ( stream_id == 0 )
+	{
+		fail(PROTOCOL_ERROR);
+		return false;
+	}
+
+	// The whole frame, padding included, counts against the flow control windows.
+	const size_t frame_len = len;
+	if ( int64_t(frame_len) > _recv_window )
+	{
+		fail(FLOW_CONTROL_ERROR);
+		return false;
+	}
+
+	size_t padding = 0;
+	if ( flags & flag_padded )
+	{
+		if ( len < 1 || uint8_t(payload[0]) >= len )
+		{
+			fail(PROTOCOL_ERROR);
+			return false;
+		}
+		padding = uint8_t(payload[0]);
+		payload++;
+		len -= 1 + padding;
+	}
+
+	auto it = _streams.find(stream_id);
+	if ( it == _streams.end() )
+	{
+		if ( stream_id > _last_stream_id )
+		{
+			fail(PROTOCOL_ERROR);
+			return false;
+		}
+		// A stream that was closed or refused, frames may still be in flight.
+		consume(nullptr, frame_len);
+		return true;
+	}
+
+	stream_ptr s = it->second;
+	if ( s->remote_closed )
+	{
+		consume(nullptr, frame_len);
+		reset_stream(stream_id, STREAM_CLOSED);
+		return true;
+	}
+	if ( int64_t(frame_len) > s->recv_window )
+	{
+		fail(FLOW_CONTROL_ERROR);
+		return false;
+	}
+
+	s->remote_closed = flags & flag_end_stream;
+	s->body_bytes   += len;
+	consume(s.get(), frame_len);
+
+	if ( ! s->discard_body )
+	{
+		if ( s->body_sink )
+		{
+			try
+			{
+				s->body_sink(payload, len);
+			}
+			catch (...)
+			{
+				s->discard_body = true;
+				s->dispatched   = true;
+				s->body_sink    = nullptr;
+				complete_stream(s, std::current_exception());
+			}
+		}
+		else if ( _max_req_size_bytes > 0 && s->body.size() + len > _max_req_size_bytes )
+		{
+			s->discard_body = true;
+			s->dispatched   = true;
+			s->body.clear();
+			response::stock_reply(status_4XX::REQ_ENTITY_TOO_LARGE, s->res);
+			send_response(s);
+		}
+		else
+		{
+			s->body.append(payload, len);
+		}
+	}
+
+	if ( s->remote_closed )
+	{
+		if ( ! s->dispatched )
+		{
+			dispatch(s);
+		}
+		else if ( s->local_closed )
+		{
+			close_stream(stream_id);
+		}
+	}
+	return true;
+}
+
+void
+http2_session::consume(stream * s, size_t len)
+{
+	_recv_window -= len;
+	if ( _recv_window <= recv_connection_window / 2 )
+	{
+		std::string increment;
+		append_u32(increment, recv_connection_window - _recv_window);
+		queue_frame(WINDOW_UPDATE, 0, 0, std::move(increment));
+		_recv_window = recv_connection_window;
+	}
+
+	if ( ! s )
+	{
+		return;
+	}
+	s->recv_window -= len;
+	if ( ! s->remote_closed && s->recv_window <= recv_stream_window / 2 )
+	{
+		std::string increment;
+		append_u32(increment, recv_stream_window - s->recv_window);
+		queue_frame(WINDOW_UPDATE, 0, s->id, std::move(increment));
+		s->recv_window = recv_stream_window;
+	}
+}
+
+bool
+http2_session::handle_window_update(uint32_t stream_id, const char * payload, size_t len)
+{
+	if ( len != 4 )
+	{
+		fail(FRAME_SIZE_ERROR);
+		return false;
+	}
+
+	const uint32_t increment = read_u32(payload) & 0x7fffffff;
+	if ( stream_id == 0 )
+	{
+		if ( increment == 0 )
+		{
+			fail(PROTOCOL_ERROR);
+			return false;
+		}
+		_send_window += increment;
+		if ( _send_window > max_window )
+		{
+			fail(FLOW_CONTROL_ERROR);
+			return false;
+		}
+		return true;
+	}
+
+	auto it = _streams.find(stream_id);
+	if ( it == _streams.end() )
+	{
+		if ( stream_id > _last_stream_id )
+		{
+			fail(PROTOCOL_ERROR);
+			return false;
+		}
+		return true;
+	}
+	if ( increment == 0 )
+	{
+		reset_stream(stream_id, PROTOCOL_ERROR);
+		return true;
+	}
+	it->second->send_window += increment;
+	if ( it->second->send_window > max_window )
+	{
+		reset_stream(stream_id, FLOW_CONTROL_ERROR);
+	}
+	return true;
+}
+
+//  -----  handling  -----
+
+void
+http2_session::dispatch(const stream_ptr & s)
+{
+	s->dispatched = true;
+
+	const std::string content_length = s->req.header("content-length");
+	if ( ! content_length.empty() && content_length != std::to_string(s->body_bytes) )
+	{
+		reset_stream(s->id, PROTOCOL_ERROR);
+		return;
+	}
+	if ( ! s->body_sink )
+	{
+		s->req.set_body(std::move(s->body));
+		s->body.clear();
+	}
+	s->body_sink = nullptr;
+
+	s->res.set_max_stream_pending_bytes(_max_stream_pending_bytes);
+
+	auto self(shared_from_this());
+	const auto io_thread = std::this_thread::get_id();
+
+	auto outer_io_service = connection::exchange_current_io_service(_io_service);
+
+	s->handler_running = true;
+	_request_handler.forward_to_handler(s->res, s->req,
+		[this, self, s, io_thread](std::exception_ptr error) {
+			if ( std::this_thread::get_id() == io_thread && s->handler_running )
+			{
+				// Completed before the handler returned.
+				s->handler_running = false;
+				complete_stream(s, error);
+				return;
+			}
+
+			// Completed later or on another thread, the response is sent from the I/O thread.
+			_io_service->post([this, self, s, error]() {
+				if ( _finished )
+				{
+					if ( s->res.body_stream() )
+					{
+						s->res.body_stream()->abort();
+					}
+					return;
+				}
+				complete_stream(s, error);
+				flush();
+			});
+		});
+
+	connection::exchange_current_io_service(outer_io_service);
+	s->handler_running = false;
+}
+
+void
+http2_session::complete_stream(const stream_ptr & s, std::exception_ptr error)
+{
+	if ( error )
+	{
+		set_error_response(s->res, error);
+	}
+
+	try
+	{
+		_request_handler.on_request_handled(s->res, s->req);
+	}
+	catch (...)
+	{
+	}
+
+	if ( s->closed )
+	{
+		// Reset by the client while the handler was running.
+		if ( s->res.body_stream() )
+		{
+			s->res.body_stream()->abort();
+		}
+		return;
+	}
+
+	send_response(s);
+}
+
+void
+http2_session::send_response(const stream_ptr & s)
+{
+	response & res = s->res;
+
+	hpack::header_fields fields;
+	if ( const auto & cached = res.cached_response() )
+	{
+		// A response cached in its HTTP/1.1 form, its status line and header are translated.
+		const std::string & raw = *cached;
+		size_t header_end = raw.find("\r\n\r\n");
+		if ( header_end == std::string::npos )
+		{
+			header_end = raw.size();
+		}
+
+		size_t line_end = raw.find("\r\n");
+		fields.emplace_back(":status", raw.size() > 12 ? raw.substr(9, 3) : "500");
+		while ( line_end < header_end )
+		{
+			const size_t start = line_end + 2;
+			line_end = std::min(raw.find("\r\n", start), header_end);
+
+			const size_t colon = raw.find(':', start);
+			if ( colon >= line_end )
+			{
+				continue;
+			}
+			std::string name = raw.substr(start, colon - start);
+			std::transform(name.begin(), name.end(), name.begin(), ::tolower);
+			if ( ! is_connection_header(name) )
+			{
+				const size_t value = raw.find_first_not_of(" \t", colon + 1);
+				fields.emplace_back(name, value < line_end ? raw.substr(value, line_end - value) : "");
+			}
+		}
+
+		s->cached         = cached;
+		s->data           = raw.data() + std::min(header_end + 4, raw.size());
+		s->data_remaining = raw.data() + raw.size() - s->data;
+	}
+	else
+	{
+		const auto & headers = res.headers();
+
+		fields.emplace_back(":status", std::to_string(res.status()));
+		if ( headers.find("server") == headers.end() )
+		{
+			fields.emplace_back("server", std::string("served-v") + APPLICATION_VERSION_STRING);
+		}
+		for ( const auto & header : headers )
+		{
+			if ( ! is_connection_header(header.first) )
+			{
+				fields.emplace_back(header.first, std::get<1>(header.second));
+			}
+		}
+		if ( ! res.body_stream() && res.status() >= 200 && headers.find("content-length") == headers.end() )
+		{
+			fields.emplace_back("content-length", std::to_string(res.body_size()));
+		}
+
+		// The body is referenced in place, the stream is kept alive until it is written.
+		s->data           = res.body().data();
+		s->data_remaining = res.body().size();
+		s->file           = res.file_body();
+		s->file_offset    = res.file_body_offset();
+		s->file_remaining = res.file_body_length();
+		s->channel        = res.body_stream();
+	}
+
+	if ( s->req.method() == method::HEAD )
+	{
+		s->data_remaining = 0;
+		s->file.reset();
+		if ( s->channel )
+		{
+			s->channel->abort();
+			s->channel.reset();
+		}
+	}
+
+	const bool end = s->data_remaining == 0 && ! s->file && ! s->channel;
+
+	std::string block;
+	_encoder.encode(fields, block);
+
+	// Blocks larger than a frame continue in CONTINUATION frames.
+	size_t offset = 0;
+	do
+	{
+		const size_t  n     = std::min(block.size() - offset, _max_send_frame_size);
+		const bool    first = offset == 0;
+		const bool    last  = offset + n == block.size();
+		const uint8_t flags = ( last ? flag_end_headers : 0 ) | ( first && end ? flag_end_stream : 0 );
+
+		queue_frame(first ? HEADERS : CONTINUATION, flags, s->id, block.substr(offset, n));
+		offset += n;
+	}
+	while ( offset < block.size() );
+
+	if ( end )
+	{
+		end_stream(s);
+		return;
+	}
+
+	s->responding = true;
+	if ( s->channel )
+	{
+		// The channel may outlive the session, so it only holds a weak reference.
+		std::weak_ptr<http2_session> weak_self(shared_from_this());
+		boost::asio::io_service &    io_service = *_io_service;
+		s->channel->attach([weak_self, &io_service]() {
+			io_service.post([weak_self]() {
+				if ( auto self = weak_self.lock() )
+				{
+					self->flush();
+				}
+			});
+		});
+	}
+}
+
+//  -----  writing  -----
+
+void
+http2_session::queue_data()
+{
+	// Streams take turns, a frame each, while the connection window allows.
+	size_t queued   = 0;
+	bool   progress = true;
+	while ( progress && _send_window > 0 && queued < max_write_bytes )
+	{
+		progress = false;
+		for ( auto it = _streams.begin(); it != _streams.end(); )
+		{
+			stream_ptr s = it->second;
+			++it;
+
+			if ( ! s->responding )
+			{
+				continue;
+			}
+			const size_t budget = std::min<int64_t>(_send_window, _max_send_frame_size);
+			const size_t n      = queue_stream_data(s, budget);
+			queued  += n;
+			progress = progress || n > 0 || ! s->responding;
+		}
+	}
+}
+
+size_t
+http2_session::queue_stream_data(const stream_ptr & s, size_t budget)
+{
+	const size_t allowed = std::min<int64_t>(budget, std::max<int64_t>(s->send_window, 0));
+
+	const char *          data = nullptr;
+	size_t                n    = 0;
+	std::shared_ptr<void> owner;
+	stream_channel_ptr    channel;
+	bool                  last = false;
+
+	if ( s->data_remaining > 0 )
+	{
+		if ( allowed == 0 )
+		{
+			return 0;
+		}
+		n     = std::min(allowed, s->data_remaining);
+		data  = s->data;
+		owner = s;
+		s->data           += n;
+		s->data_remaining -= n;
+		last = s->data_remaining == 0 && ! s->file && ! s->channel;
+	}
+	else if ( s->file && s->file_remaining > 0 )
+	{
+		if ( allowed == 0 )
+		{
+			return 0;
+		}
+		auto chunk = std::make_shared<std::string>(std::min(allowed, s->file_remaining), '\0');
+		ssize_t read = ::pread(s->file->fd(), &( *chunk )[0], chunk->size(), s->file_offset);
+		if ( read <= 0 )
+		{
+			// The file was truncated, the response cannot be completed.
+			reset_stream(s->id, INTERNAL_ERROR);
+			return 0;
+		}
+		n     = read;
+		data  = chunk->data();
+		owner = chunk;
+		s->file_offset    += n;
+		s->file_remaining -= n;
+		last = s->file_remaining == 0 && ! s->channel;
+	}
+	else if ( s->channel )
+	{
+		if ( s->channel->is_disconnected() )
+		{
+			reset_stream(s->id, CANCEL);
+			return 0;
+		}
+		if ( s->chunks.empty() && ! s->channel_last )
+		{
+			std::vector<stream_chunk_ptr> taken;
+			s->channel_last = s->channel->take(taken);
+			for ( auto & chunk : taken )
+			{
+				if ( ! chunk->empty() )
+				{
+					s->chunks.push_back(std::move(chunk));
+				}
+			}
+		}
+		if ( ! s->chunks.empty() )
+		{
+			if ( allowed == 0 )
+			{
+				return 0;
+			}
+			const stream_chunk_ptr & chunk = s->chunks.front();
+			n       = std::min(allowed, chunk->size() - s->chunk_offset);
+			data    = chunk->data() + s->chunk_offset;
+			owner   = std::const_pointer_cast<std::string>(chunk);
+			channel = s->channel;
+			s->chunk_offset += n;
+			if ( s->chunk_offset == chunk->size() )
+			{
+				s->chunks.pop_front();
+				s->chunk_offset = 0;
+			}
+			last = s->chunks.empty() && s->channel_last;
+		}
+		else if ( s->channel_last )
+		{
+			last = true;
+		}
+		else
+		{
+			// Waiting for the handler to write more.
+			return 0;
+		}
+	}
+	else
+	{
+		last = true;
+	}
+
+	_write_queue.push_back(out_frame { frame_header(n, DATA, last ? flag_end_stream : 0, s->id), owner, data, n, channel });
+	_send_window   -= n;
+	s->send_window -= n;
+
+	if ( last )
+	{
+		end_stream(s);
+	}
+	return n;
+}
+
+void
+http2_session::end_stream(const stream_ptr & s)
+{
+	s->local_closed = true;
+	s->responding   = false;
+	if ( s->channel )
+	{
+		s->channel->attach(nullptr);
+	}
+
+	if ( s->remote_closed )
+	{
+		close_stream(s->id);
+	}
+	else
+	{
+		// Answered before the request body was received, the rest of it is not needed.
+		reset_stream(s->id, NO_ERROR);
+	}
+}
+
+void
+http2_session::close_stream(uint32_t stream_id)
+{
+	auto it = _streams.find(stream_id);
+	if ( it == _streams.end() )
+	{
+		return;
+	}
+
+	stream_ptr s = it->second;
+	_streams.erase(it);
+
+	s->closed = true;
+	if ( s->channel && ! s->local_closed )
+	{
+		s->channel->abort();
+	}
+	check_idle();
+}
+
+void
+http2_session::reset_stream(uint32_t stream_id, uint32_t error_code)
+{
+	std::string payload;
+	append_u32(payload, error_code);
+	queue_frame(RST_STREAM, 0, stream_id, std::move(payload));
+	close_stream(stream_id);
+}
+
+void
+http2_session::fail(uint32_t error_code)
+{
+	if ( _close_after_write )
+	{
+		return;
+	}
+
+	std::string payload;
+	append_u32(payload, _last_stream_id);
+	append_u32(payload, error_code);
+	queue_frame(GOAWAY, 0, 0, std::move(payload));
+
+	_goaway_sent       = true;
+	_close_after_write = true;
+
+	while ( ! _streams.empty() )
+	{
+		close_stream(_streams.begin()->first);
+	}
+	flush();
+}
+
+void
+http2_session::queue_frame(uint8_t type, uint8_t flags, uint32_t stream_id, std::string payload)
+{
+	auto owner = std::make_shared<std::string>(std::move(payload));
+	_write_queue.push_back(out_frame { frame_header(owner->size(), type, flags, stream_id), owner,
+	                                   owner->data(), owner->size(), nullptr });
+}
+
+void
+http2_session::flush()
+{
+	if ( _finished || _write_in_progress )
+	{
+		return;
+	}
+
+	queue_data();
+	if ( _write_queue.empty() )
+	{
+		if ( _close_after_write )
+		{
+			finish();
+		}
+		return;
+	}
+
+	_writing.swap(_write_queue);
+
+	// Queued frames go out in a single write, payloads are referenced in place.
+	std::vector<boost::asio::const_buffer> buffers;
+	buffers.reserve(_writing.size() * 2);
+	for ( const auto & f : _writing )
+	{
+		buffers.push_back(boost::asio::buffer(f.header));
+		if ( f.length > 0 )
+		{
+			buffers.push_back(boost::asio::buffer(f.data, f.length));
+		}
+	}
+
+	auto self(shared_from_this());
+	auto owner(_owner);
+
+	_write_in_progress = true;
+	boost::asio::async_write(*_transport, buffers,
+		[this, self, owner](boost::system::error_code ec, std::size_t) {
+			on_write_complete(ec);
+		});
+}
+
+void
+http2_session::on_write_complete(boost::system::error_code ec)
+{
+	_write_in_progress = false;
+
+	// Writers of streamed responses waiting on the limit are resumed from here.
+	for ( const auto & f : _writing )
+	{
+		if ( f.channel )
+		{
+			f.channel->written(f.length);
+		}
+	}
+	_writing.clear();
+
+	if ( ec )
+	{
+		finish();
+		return;
+	}
+	flush();
+}
+
+//  -----  closing  -----
+
+void
+http2_session::check_idle()
+{
+	if ( ! _streams.empty() )
+	{
+		return;
+	}
+	if ( _goaway_sent || _goaway_received )
+	{
+		_close_after_write = true;
+	}
+	else if ( _idle_timeout > 0 )
+	{
+		_timers->schedule(_idle_timer, _idle_timeout);
+	}
+}
+
+void
+http2_session::finish()
+{
+	if ( _finished )
+	{
+		return;
+	}
+	_finished = true;
+
+	_timers->cancel(_idle_timer);
+	for ( const auto & s : _streams )
+	{
+		s.second->closed = true;
+		if ( s.second->channel )
+		{
+			s.second->channel->abort();
+		}
+	}
+	_streams.clear();
+
+	boost::system::error_code ignored_ec;
+	_transport->socket().shutdown(boost::asio::ip::tcp::socket::shutdown_both, ignored_ec);
+
+	auto on_finished = std::move(_on_finished);
+	auto owner       = std::move(_owner);
+	if ( on_finished )
+	{
+		on_finished();
+	}
+}
@@ -0,0 +1,318 @@
+/*
+ * Copyright (C) 2021 QM Ltd.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef SERVED_HTTP2_SESSION_HPP
+#define SERVED_HTTP2_SESSION_HPP
+
+#include <served/boost_compat.hpp>
+#include <boost/asio.hpp>
+
+#include <served/hpack.hpp>
+#include <served/multiplexer.hpp>
+#include <served/request.hpp>
+#include <served/response.hpp>
+#include <served/net/timer_wheel.hpp>
+#include <served/net/transport.hpp>
+
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace served { namespace net {
+
+/*
+ * Serves an HTTP/2 connection over cleartext TCP (h2c), see RFC 9113.
+ *
+ * A session is handed the socket of a connection, either when the client starts with the HTTP/2
+ * connection preface (prior knowledge) or once an HTTP/1.1 request has been upgraded, and serves
+ * every stream of the connection until it is closed.
+ *
+ * Each stream is forwarded to the multiplexer as a request, so that handlers, plugins, streamed
+ * request bodies and streamed responses behave as they do over HTTP/1.1. Streams are handled
+ * concurrently, responses are sent as soon as their handler completes and their DATA frames are
+ * interleaved under the flow control windows of the client.
+ *
+ * Server push and stream priorities are not supported, PRIORITY frames are ignored.
+ *
+ * All methods other than shutdown must be called on the I/O thread of the connection.
+ */
+class http2_session
+	: public std::enable_shared_from_this<http2_session>
+{
+	struct stream;
+	typedef std::shared_ptr<stream> stream_ptr;
+
+	/*
+	 * A frame waiting to be written, its payload referenced in place until written.
+	 */
+	struct out_frame
+	{
+		std::string           header;
+		std::shared_ptr<void> owner;
+		const char *          data;
+		size_t                length;
+		stream_channel_ptr    channel;
+	};
+
+	multiplexer &                  _request_handler;
+	timer_wheel_ptr                _timers;
+	size_t                         _max_req_size_bytes;
+	size_t                         _max_concurrent_streams;
+	size_t                         _max_stream_pending_bytes;
+	int                            _idle_timeout;
+	boost::asio::io_service *      _io_service;
+	transport *                    _transport;
+	std::shared_ptr<void>          _owner;
+	std::function<void()>          _on_finished;
+	std::string                    _source;
+
+	// Reading
+	std::vector<char>              _buffer;
+	size_t                         _buffer_begin;
+	size_t                         _buffer_end;
+	bool                           _preface_received;
+	bool                           _settings_received;
+	hpack::decoder                 _decoder;
+	std::string                    _header_block;
+	uint32_t                       _header_stream_id;
+	bool                           _header_end_stream;
+	uint32_t                       _last_stream_id;
+	int64_t                        _recv_window;
+
+	// Streams
+	std::map<uint32_t, stream_ptr> _streams;
+	stream_ptr                     _upgraded_stream;
+
+	// Writing
+	hpack::encoder                 _encoder;
+	std::vector<out_frame>         _write_queue;
+	std::vector<out_frame>         _writing;
+	bool                           _write_in_progress;
+	int64_t                        _send_window;
+	int64_t                        _initial_send_window;
+	size_t                         _max_send_frame_size;
+
+	// Closing
+	bool                           _goaway_sent;
+	bool                           _goaway_received;
+	bool                           _close_after_write;
+	bool                           _finished;
+	timer_wheel::entry             _idle_timer;
+
+public:
+	http2_session(const http2_session&) = delete;
+
+	http2_session& operator=(const http2_session&) = delete;
+
+	/*
+	 * Constructs a session.
+	 *
+	 * @param handler the multiplexer responsible for routing requests
+	 * @param timers the timer wheel of the connection
+	 * @param max_request_size_bytes maximum permitted size of a request, 0 is ignored
+	 * @param max_concurrent_streams the number of streams a client may open at once
+	 * @param max_stream_pending_bytes the bytes of a streamed response pending before writers wait
+	 * @param idle_timeout the timeout while no streams are open, 0 is ignored
+	 */
+	http2_session( multiplexer &   handler
+	             , timer_wheel_ptr timers
+	             , size_t          max_request_size_bytes
+	             , size_t          max_concurrent_streams
+	             , size_t          max_stream_pending_bytes
+	             , int             idle_timeout );
+
+	~http2_session();
+
+	/*
+	 * Takes over an HTTP/1.1 request that asked to upgrade to h2c, as stream 1.
+	 *
+	 * Must be called before the session is started. The request is handled once the session
+	 * starts, and its response is the first sent over HTTP/2.
+	 *
+	 * @param req the request, its body already received
+	 * @param settings the value of its HTTP2-Settings header
+	 *
+	 * @return false if the settings are invalid, the request should then be served over HTTP/1.1
+	 */
+	bool upgrade(const request & req, const std::string & settings);
+
+	/*
+	 * Serves the connection over HTTP/2.
+	 *
+	 * @param io_service the io_service of the connection
+	 * @param transport the transport of the connection, which must outlive the session
+	 * @param owner kept alive until the session is finished
+	 * @param source the address of the client
+	 * @param initial_bytes bytes already read from the socket, starting with the connection preface
+	 * @param on_finished called once the session is finished and the socket can be closed
+	 */
+	void start( boost::asio::io_service &      io_service
+	          , transport &                    transport
+	          , std::shared_ptr<void>          owner
+	          , std::string                    source
+	          , std::string                    initial_bytes
+	          , std::function<void()>          on_finished );
+
+	/*
+	 * Stops accepting streams, the session finishes once the open streams are complete.
+	 *
+	 * May be called from any thread.
+	 */
+	void shutdown();
+
+	/*
+	 * Checks whether the first bytes of a connection are the HTTP/2 connection preface.
+	 *
+	 * @param data the bytes received
+	 * @param len the number of bytes, at least 4 are needed to tell
+	 *
+	 * @return true if the bytes are, or begin, the connection preface
+	 */
+	static bool is_preface(const char * data, size_t len);
+
+	/*
+	 * The HTTP/2 client connection preface.
+	 */
+	static const std::string preface;
+
+private:
+	void do_read();
+
+	/*
+	 * Handles every complete frame in the read buffer, then continues reading.
+	 */
+	void process_buffer();
+
+	/*
+	 * Handles a single frame.
+	 *
+	 * @return false if the connection failed
+	 */
+	bool handle_frame(uint8_t type, uint8_t flags, uint32_t stream_id, const char * payload, size_t len);
+
+	bool handle_settings(uint8_t flags, uint32_t stream_id, const char * payload, size_t len);
+
+	bool handle_headers(uint8_t type, uint8_t flags, uint32_t stream_id, const char * payload, size_t len);
+
+	bool handle_data(uint8_t flags, uint32_t stream_id, const char * payload, size_t len);
+
+	bool handle_window_update(uint32_t stream_id, const char * payload, size_t len);
+
+	/*
+	 * Applies settings sent by the client.
+	 *
+	 * @return 0, or the error code of the connection if a setting is invalid
+	 */
+	uint32_t apply_settings(const char * payload, size_t len);
+
+	/*
+	 * Opens a stream from a decoded header block.
+	 */
+	bool open_stream(uint32_t stream_id, bool end_stream);
+
+	/*
+	 * Builds the request of a stream from its header fields.
+	 *
+	 * @return false if the fields are malformed
+	 */
+	bool build_request(stream & s, const hpack::header_fields & fields);
+
+	/*
+	 * Consumes received bytes, returning them to the flow control windows of the client.
+	 */
+	void consume(stream * s, size_t len);
+
+	/*
+	 * Forwards a stream whose request is complete to the multiplexer.
+	 */
+	void dispatch(const stream_ptr & s);
+
+	/*
+	 * Completes a handled stream and sends its response.
+	 */
+	void complete_stream(const stream_ptr & s, std::exception_ptr error);
+
+	/*
+	 * Sends the header of a response, followed by its body as the windows allow.
+	 */
+	void send_response(const stream_ptr & s);
+
+	/*
+	 * Queues DATA frames for every responding stream, as the flow control windows allow.
+	 */
+	void queue_data();
+
+	/*
+	 * Queues DATA frames for a single stream.
+	 *
+	 * @param budget the bytes of the connection window the stream may use
+	 *
+	 * @return the number of bytes queued
+	 */
+	size_t queue_stream_data(const stream_ptr & s, size_t budget);
+
+	/*
+	 * Ends a stream once its response has been sent in full.
+	 */
+	void end_stream(const stream_ptr & s);
+
+	/*
+	 * Removes a stream, aborting its streamed response if any.
+	 */
+	void close_stream(uint32_t stream_id);
+
+	/*
+	 * Resets a stream.
+	 */
+	void reset_stream(uint32_t stream_id, uint32_t error_code);
+
+	/*
+	 * Sends a GOAWAY frame and closes the connection once it is written.
+	 */
+	void fail(uint32_t error_code);
+
+	void queue_frame(uint8_t type, uint8_t flags, uint32_t stream_id, std::string payload);
+
+	/*
+	 * Writes the queued frames, unless a write is in progress.
+	 */
+	void flush();
+
+	void on_write_complete(boost::system::error_code ec);
+
+	/*
+	 * Closes the connection once it is shut down and no streams remain.
+	 */
+	void check_idle();
+
+	void finish();
+};
+
+typedef std::shared_ptr<http2_session> http2_session_ptr;
+
+} } // net, served
+
+#endif // SERVED_HTTP2_SESSION_HPP
@@ -0,0 +1,424 @@
+/*
+ * Copyright (C) 2021 QM Ltd.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <test/catch.hpp>
+
+#include <served/hpack.hpp>
+#include <served/net/http2_session.hpp>
+#include <served/net/server.hpp>
+
+#include <boost/asio.hpp>
+#include <map>
+#include <thread>
+
+namespace {
+
+struct frame
+{
+	uint8_t     type;
+	uint8_t     flags;
+	uint32_t    stream_id;
+	std::string payload;
+};
+
+std::string
+encode_frame(uint8_t type, uint8_t flags, uint32_t stream_id, const std::string & payload)
+{
+	std::string bytes;
+	bytes.push_back(static_cast<char>(payload.size() >> 16));
+	bytes.push_back(static_cast<char>(( payload.size() >> 8 ) & 0xff));
+	bytes.push_back(static_cast<char>(payload.size() & 0xff));
+	bytes.push_back(static_cast<char>(type));
+	bytes.push_back(static_cast<char>(flags));
+	for ( int shift = 24; shift >= 0; shift -= 8 )
+	{
+		bytes.push_back(static_cast<char>(( stream_id >> shift ) & 0xff));
+	}
+	return bytes + payload;
+}
+
+std::string
+u32(uint32_t value)
+{
+	std::string bytes;
+	for ( int shift = 24; shift >= 0; shift -= 8 )
+	{
+		bytes.push_back(static_cast<char>(( value >> shift ) & 0xff));
+	}
+	return bytes;
+}
+
+uint32_t
+read_u32(const std::string & bytes, size_t offset = 0)
+{
+	uint32_t value = 0;
+	for ( size_t i = 0; i < 4; i++ )
+	{
+		value = ( value << 8 ) | static_cast<uint8_t>(bytes[offset + i]);
+	}
+	return value;
+}
+
+/*
+ * Reads a frame, after any bytes already buffered.
+ */
+frame
+read_frame(boost::asio::ip::tcp::socket & socket, boost::asio::streambuf & buf)
+{
+	auto read_bytes = [&](size_t len) {
+		if ( buf.size() < len )
+		{
+			boost::asio::read(socket, buf, boost::asio::transfer_exactly(len - buf.size()));
+		}
+		std::string bytes(boost::asio::buffers_begin(buf.data()), boost::asio::buffers_begin(buf.data()) + len);
+		buf.consume(len);
+		return bytes;
+	};
+
+	std::string header = read_bytes(9);
+	frame f;
+	f.type      = header[3];
+	f.flags     = header[4];
+	f.stream_id = read_u32(header, 5) & 0x7fffffff;
+	f.payload   = read_bytes(( uint32_t(uint8_t(header[0])) << 16 ) | ( uint32_t(uint8_t(header[1])) << 8 ) | uint8_t(header[2]));
+	return f;
+}
+
+/*
+ * The response to a stream, as received by a client.
+ */
+struct stream_response
+{
+	served::hpack::header_fields headers;
+	std::string                  body;
+	bool                         ended = false;
+	uint32_t                     reset = 0;
+
+	std::string header(const std::string & name) const
+	{
+		for ( const auto & field : headers )
+		{
+			if ( field.first == name )
+			{
+				return field.second;
+			}
+		}
+		return "";
+	}
+};
+
+/*
+ * A minimal HTTP/2 client over a blocking socket.
+ */
+class client
+{
+	boost::asio::ip::tcp::socket & _socket;
+	boost::asio::streambuf         _buf;
+	served::hpack::encoder         _encoder;
+	served::hpack::decoder         _decoder;
+
+public:
+	std::map<uint32_t, stream_response> streams;
+	std::vector<frame>                  other_frames;
+
+	explicit client(boost::asio::ip::tcp::socket & socket)
+		: _socket(socket)
+	{
+	}
+
+	boost::asio::streambuf & buffer() { return _buf; }
+
+	void send(uint8_t type, uint8_t flags, uint32_t stream_id, const std::string & payload)
+	{
+		boost::asio::write(_socket, boost::asio::buffer(encode_frame(type, flags, stream_id, payload)));
+	}
+
+	void request(uint32_t stream_id, const std::string & method, const std::string & path, bool end_stream = true)
+	{
+		std::string block;
+		_encoder.encode({ { ":method", method }, { ":scheme", "http" }, { ":path", path },
+		                  { ":authority", "localhost" } }, block);
+		send(0x1, 0x4 | ( end_stream ? 0x1 : 0 ), stream_id, block);
+	}
+
+	/*
+	 * Reads frames until the stream is ended or reset, answering settings along the way.
+	 */
+	stream_response & wait(uint32_t stream_id)
+	{
+		while ( ! streams[stream_id].ended && ! streams[stream_id].reset )
+		{
+			read();
+		}
+		return streams[stream_id];
+	}
+
+	frame read()
+	{
+		frame f = read_frame(_socket, _buf);
+		auto & s = streams[f.stream_id];
+		switch ( f.type )
+		{
+		case 0x0:
+			s.body += f.payload;
+			s.ended = f.flags & 0x1;
+			break;
+		case 0x1:
+			_decoder.decode(f.payload.data(), f.payload.size(), s.headers);
+			s.ended = f.flags & 0x1;
+			break;
+		case 0x3:
+			s.reset = 0x100 | read_u32(f.payload);
+			break;
+		case 0x4:
+			if ( ! ( f.flags & 0x1 ) )
+			{
+				send(0x4, 0x1, 0, "");
+			}
+			other_frames.push_back(f);
+			break;
+		default:
+			other_frames.push_back(f);
+			break;
+		}
+		return f;
+	}
+};
+
+} // anonymous namespace
+
+TEST_CASE("http2 session preface", "[http2]")
+{
+	CHECK(served::net::http2_session::is_preface("PRI * HTTP/2.0\r\n\r\nSM\r\n\r\n", 24));
+	CHECK(served::net::http2_session::is_preface("PRI ", 4));
+	CHECK_FALSE(served::net::http2_session::is_preface("PRI", 3));
+	CHECK_FALSE(served::net::http2_session::is_preface("POST / HTTP/1.1\r\n", 17));
+}
+
+TEST_CASE("http2 session serves streams", "[http2]")
+{
+	served::multiplexer mux;
+	mux.handle("/hello")
+		.get([](served::response & res, const served::request & req) {
+			res.set_header("X-Version", req.HTTP_version());
+			res << "hello " << req.query["name"];
+		});
+	mux.handle("/echo")
+		.post([](served::response & res, const served::request & req) {
+			res << req.body();
+		});
+	mux.handle("/big")
+		.get([](served::response & res, const served::request &) {
+			res << std::string(100, 'x');
+		});
+	mux.handle("/stream")
+		.get([](served::response & res, const served::request &) {
+			auto stream = res.stream();
+			std::thread([stream]() mutable {
+				stream.write("one,");
+				stream.write("two");
+				stream.close();
+			}).detach();
+		});
+
+	served::net::server server("127.0.0.1", "42815", mux, false);
+	server.set_http2_max_concurrent_streams(2);
+	std::thread server_thread([&]() { server.run(); });
+
+	boost::asio::io_service io_service;
+	auto endpoint = boost::asio::ip::tcp::endpoint(boost::asio::ip::address::from_string("127.0.0.1"), 42815);
+
+	SECTION("with prior knowledge")
+	{
+		boost::asio::ip::tcp::socket socket(io_service);
+		socket.connect(endpoint);
+		client c(socket);
+
+		boost::asio::write(socket, boost::asio::buffer(served::net::http2_session::preface));
+		c.send(0x4, 0, 0, "");
+
+		// Concurrent streams, answered independently.
+		c.request(1, "GET", "/hello?name=one");
+		c.request(3, "POST", "/echo", false);
+		c.send(0x0, 0, 3, "hello ");
+		c.send(0x0, 0x1, 3, "body");
+
+		auto & first = c.wait(1);
+		CHECK(first.header(":status") == "200");
+		CHECK(first.header("x-version") == "HTTP/2.0");
+		CHECK(first.header("content-length") == "9");
+		CHECK(first.body == "hello one");
+
+		auto & echo = c.wait(3);
+		CHECK(echo.header(":status") == "200");
+		CHECK(echo.body == "hello body");
+
+		// Streamed responses are sent as DATA frames.
+		c.request(5, "GET", "/stream");
+		auto & streamed = c.wait(5);
+		CHECK(streamed.header("content-length") == "");
+		CHECK(streamed.body == "one,two");
+
+		// The server answers pings.
+		c.send(0x6, 0, 0, "12345678");
+		frame pong = c.read();
+		while ( pong.type != 0x6 )
+		{
+			pong = c.read();
+		}
+		CHECK(pong.flags == 0x1);
+		CHECK(pong.payload == "12345678");
+
+		// Requests without a path are malformed.
+		std::string block;
+		served::hpack::encoder encoder;
+		encoder.encode({ { ":method", "GET" }, { ":scheme", "http" } }, block);
+		c.send(0x1, 0x5, 7, block);
+		CHECK(c.wait(7).reset == ( 0x100 | 0x1 ));
+
+		// Unknown routes are answered as over HTTP/1.1.
+		c.request(9, "GET", "/missing");
+		CHECK(c.wait(9).header(":status") == "404");
+	}
+	SECTION("within the flow control window of the client")
+	{
+		boost::asio::ip::tcp::socket socket(io_service);
+		socket.connect(endpoint);
+		client c(socket);
+
+		// Streams may only be sent 10 bytes until the window is updated.
+		boost::asio::write(socket, boost::asio::buffer(served::net::http2_session::preface));
+		c.send(0x4, 0, 0, std::string("\x00\x04", 2) + u32(10));
+
+		c.request(1, "GET", "/big");
+		while ( c.streams[1].body.size() < 10 )
+		{
+			c.read();
+		}
+		CHECK(c.streams[1].body.size() == 10);
+		CHECK_FALSE(c.streams[1].ended);
+
+		c.send(0x8, 0, 1, u32(90));
+		auto & big = c.wait(1);
+		CHECK(big.body == std::string(100, 'x'));
+	}
+	SECTION("with more streams than permitted")
+	{
+		boost::asio::ip::tcp::socket socket(io_service);
+		socket.connect(endpoint);
+		client c(socket);
+
+		boost::asio::write(socket, boost::asio::buffer(served::net::http2_session::preface));
+		c.send(0x4, 0, 0, "");
+
+		// Open streams awaiting their bodies count against the limit.
+		c.request(1, "POST", "/echo", false);
+		c.request(3, "POST", "/echo", false);
+		c.request(5, "POST", "/echo", false);
+		CHECK(c.wait(5).reset == ( 0x100 | 0x7 ));
+
+		c.send(0x0, 0x1, 1, "done");
+		CHECK(c.wait(1).body == "done");
+	}
+	SECTION("upgraded from HTTP/1.1")
+	{
+		boost::asio::ip::tcp::socket socket(io_service);
+		socket.connect(endpoint);
+
+		boost::asio::write(socket, boost::asio::buffer(std::string(
+			"GET /hello?name=upgraded HTTP/1.1\r\nHost: localhost\r\nConnection: Upgrade, HTTP2-Settings\r\n"
+			"Upgrade: h2c\r\nHTTP2-Settings: AAMAAABkAAQAoAAAAAIAAAAA\r\n\r\n")));
+
+		// Frames that follow the switch are left in the buffer of the client.
+		client c(socket);
+		size_t header_len = boost::asio::read_until(socket, c.buffer(), "\r\n\r\n");
+		std::string header(boost::asio::buffers_begin(c.buffer().data()),
+		                   boost::asio::buffers_begin(c.buffer().data()) + header_len);
+		c.buffer().consume(header_len);
+		CHECK(header.find("HTTP/1.1 101") == 0);
+		CHECK(header.find("Upgrade: h2c") != std::string::npos);
+
+		boost::asio::write(socket, boost::asio::buffer(served::net::http2_session::preface));
+		c.send(0x4, 0, 0, "");
+
+		auto & upgraded = c.wait(1);
+		CHECK(upgraded.header(":status") == "200");
+		CHECK(upgraded.body == "hello upgraded");
+	}
+	SECTION("failing on protocol errors")
+	{
+		boost::asio::ip::tcp::socket socket(io_service);
+		socket.connect(endpoint);
+		client c(socket);
+
+		boost::asio::write(socket, boost::asio::buffer(served::net::http2_session::preface));
+		c.send(0x4, 0, 0, "");
+
+		// Headers on the connection stream are a connection error.
+		c.send(0x1, 0x5, 0, "");
+		frame goaway = c.read();
+		while ( goaway.type != 0x7 )
+		{
+			goaway = c.read();
+		}
+		CHECK(read_u32(goaway.payload, 4) == 0x1);
+
+		boost::system::error_code ec;
+		std::array<char, 16> rest;
+		while ( ! ec )
+		{
+			socket.read_some(boost::asio::buffer(rest), ec);
+		}
+		CHECK(ec == boost::asio::error::eof);
+	}
+	SECTION("limiting header blocks")
+	{
+		boost::asio::ip::tcp::socket socket(io_service);
+		socket.connect(endpoint);
+		client c(socket);
+
+		boost::asio::write(socket, boost::asio::buffer(served::net::http2_session::preface));
+		c.send(0x4, 0, 0, "");
+
+		// The limit on the header list is advertised in the server settings.
+		frame settings = c.read();
+		REQUIRE(settings.type == 0x4);
+		CHECK(settings.payload.find(std::string("\x00\x06", 2) + u32(64 * 1024)) != std::string::npos);
+
+		// A header block continued beyond the limit is refused, without a max request size.
+		const std::string fragment(16384, '\x80');
+		c.send(0x1, 0, 1, fragment);
+		for ( int i = 0; i < 4; i++ )
+		{
+			c.send(0x9, 0, 1, fragment);
+		}
+		frame goaway = c.read();
+		while ( goaway.type != 0x7 )
+		{
+			goaway = c.read();
+		}
+		CHECK(read_u32(goaway.payload, 4) == 0xb);
+	}
+
+	server.stop();
+	server_thread.join();
+}
@@ -24,11 +24,48 @@
 #include <utility>
 #include <thread>
 
+#if defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#endif
+
 #include <served/net/server.hpp>
 
 using namespace served;
 using namespace served::net;
 
+namespace {
+
+#if defined(SO_REUSEPORT)
+typedef boost::asio::detail::socket_option::boolean<SOL_SOCKET, SO_REUSEPORT> reuse_port;
+#endif // defined(SO_REUSEPORT)
+
+} // anonymous namespace
+
+server::shard::shard(boost::asio::io_service & io_service)
+	: owned_io_service()
+	, io_service(io_service)
+	, timers(std::make_shared<timer_wheel>(io_service))
+	, acceptor(io_service)
+	, socket(io_service)
+	, connections(io_service)
+	, pool()
+	, accept_paused(false)
+	, drain_timer(io_service)
+{}
+
+server::shard::shard()
+	: owned_io_service(new boost::asio::io_service())
+	, io_service(*owned_io_service)
+	, timers(std::make_shared<timer_wheel>(io_service))
+	, acceptor(io_service)
+	, socket(io_service)
+	, connections(io_service)
+	, pool()
+	, accept_paused(false)
+	, drain_timer(io_service)
+{}
+
 server::server( const std::string & address
               , const std::string & port
               , multiplexer       & mux
@@ -36,13 +73,29 @@ server::server( const std::string & address
               )
 	: _io_service()
 	, _signals(_io_service)
-	, _acceptor(_io_service)
-	, _connection_manager()
-	, _socket(_io_service)
+	, _endpoint()
+	, _closing(false)
+	, _connection_count(0)
+	, _max_connections(0)
+	, _max_connections_per_ip(0)
+	, _listen_backlog(boost::asio::socket_base::max_listen_connections)
+	, _address_mutex()
+	, _address_connections()
+	, _shards()
+	, _threads()
+	, _drain_timeout(0)
 	, _request_handler(mux)
 	, _read_timeout(0)
 	, _write_timeout(0)
+	, _keep_alive_timeout(0)
+	, _header_timeout(0)
+	, _max_requests_per_connection(0)
 	, _req_max_bytes(0)
+	, _stream_max_pending_bytes(1024 * 1024)
+	, _http2_max_streams(0)
+	, _tls_context()
+	, _pool_size(256)
+	, _pool_max_bytes(16 * 1024 * 1024)
 {
 	/*
 	 * Register to handle the signals that indicate when the server should exit.
@@ -61,14 +114,28 @@ server::server( const std::string & address
 
 	// Open the acceptor with the option to reuse the address (i.e. SO_REUSEADDR).
 	boost::asio::ip::tcp::resolver resolver(_io_service);
-	boost::asio::ip::tcp::endpoint endpoint = *resolver.resolve({address, port});
+	_endpoint = *resolver.resolve({address, port});
 
-	_acceptor.open(endpoint.protocol());
-	_acceptor.set_option(boost::asio::ip::tcp::acceptor::reuse_address(true));
-	_acceptor.bind(endpoint);
-	_acceptor.listen();
+	_shards.push_back(shard_ptr(new shard(_io_service)));
+	shard & s = *_shards.front();
 
-	do_accept();
+	s.acceptor.open(_endpoint.protocol());
+	s.acceptor.set_option(boost::asio::ip::tcp::acceptor::reuse_address(true));
+	s.acceptor.bind(_endpoint);
+	s.acceptor.listen(_listen_backlog);
+
+	do_accept(s);
+}
+
+server::~server()
+{
+	if ( ! _threads.empty() )
+	{
+		stop();
+	}
+
+	// Connections closed while the shards are destroyed must not resume accepting.
+	_closing = true;
 }
 
 void
@@ -100,7 +167,8 @@ server::run(int n_threads /* = 1 */, bool block /* = true */)
 			}
 			else
 			{
-				thread.detach();
+				// Kept so that the threads can be joined once the server is stopped.
+				_threads.push_back(std::move(thread));
 			}
 		}
 	}
@@ -110,22 +178,296 @@ server::run(int n_threads /* = 1 */, bool block /* = true */)
 	}
 }
 
+namespace {
+
+/*
+ * Pins the calling thread to a single CPU, ignored where unsupported.
+ */
+void
+pin_to_cpu(int cpu)
+{
+#if defined(__linux__)
+	cpu_set_t cpu_set;
+	CPU_ZERO(&cpu_set);
+	CPU_SET(cpu, &cpu_set);
+	pthread_setaffinity_np(pthread_self(), sizeof(cpu_set), &cpu_set);
+#else
+	(void) cpu;
+#endif // defined(__linux__)
+}
+
+} // anonymous namespace
+
+void
+server::run_sharded(int n_threads /* = 0 */, bool pin_threads /* = false */, bool block /* = true */)
+{
+	int n_cpus = static_cast<int>(std::thread::hardware_concurrency());
+	if ( n_cpus < 1 )
+	{
+		n_cpus = 1;
+	}
+	if ( n_threads < 1 )
+	{
+		n_threads = n_cpus;
+	}
+
+#if defined(SO_REUSEPORT)
+	/*
+	 * The acceptor opened by the constructor is kept as the first shard, and further shards each
+	 * bind an acceptor to the same endpoint with SO_REUSEPORT. The first acceptor is bound
+	 * without SO_REUSEPORT, so that a second server on the same port fails to bind unless it is
+	 * run sharded, and is bound again with it here.
+	 */
+	if ( n_threads > 1 )
+	{
+		share_port(*_shards.front());
+	}
+	for ( int i = 1; i < n_threads; i++ )
+	{
+		_shards.push_back(shard_ptr(new shard()));
+		shard & s = *_shards.back();
+
+		s.pool.set_max_size(_pool_size);
+		s.pool.set_max_bytes(_pool_max_bytes);
+
+		s.acceptor.open(_endpoint.protocol());
+		s.acceptor.set_option(boost::asio::ip::tcp::acceptor::reuse_address(true));
+		s.acceptor.set_option(reuse_port(true));
+		s.acceptor.bind(_endpoint);
+		s.acceptor.listen(_listen_backlog);
+
+		do_accept(s);
+	}
+
+	// The first shard runs on the server io_service, which also listens for signals.
+	std::vector<std::thread> v_threads;
+	for ( int i = 0; i < n_threads; i++ )
+	{
+		shard & s = *_shards[i];
+		v_threads.push_back(std::thread([&s, i, n_cpus, pin_threads](){
+			if ( pin_threads )
+			{
+				pin_to_cpu(i % n_cpus);
+			}
+			s.io_service.run();
+		}));
+	}
+
+	for ( auto & thread : v_threads )
+	{
+		if ( block )
+		{
+			if ( thread.joinable() )
+			{
+				thread.join();
+			}
+		}
+		else
+		{
+			_threads.push_back(std::move(thread));
+		}
+	}
+#else
+	(void) pin_threads;
+	run(n_threads, block);
+#endif // defined(SO_REUSEPORT)
+}
+
+#if defined(SO_REUSEPORT)
+void
+server::share_port(shard & s)
+{
+	// Connections waiting in the backlog would be refused once the acceptor closes, so they are
+	// accepted first.
+	boost::system::error_code ec;
+	s.acceptor.non_blocking(true, ec);
+	while ( ! ec )
+	{
+		boost::asio::ip::tcp::socket socket(s.io_service);
+		s.acceptor.accept(socket, ec);
+		if ( ! ec )
+		{
+			start_connection(s, socket);
+		}
+	}
+
+	// The pending accept completes as aborted and then accepts from the acceptor bound again.
+	s.acceptor.close();
+	s.acceptor.open(_endpoint.protocol());
+	s.acceptor.set_option(boost::asio::ip::tcp::acceptor::reuse_address(true));
+	s.acceptor.set_option(reuse_port(true));
+	s.acceptor.bind(_endpoint);
+	s.acceptor.listen(_listen_backlog);
+}
+#endif // defined(SO_REUSEPORT)
+
 void
 server::set_read_timeout(int time_milliseconds)
 {
 	_read_timeout = time_milliseconds;
+	clear_connection_pools();
 }
 
 void
 server::set_write_timeout(int time_milliseconds)
 {
 	_write_timeout = time_milliseconds;
+	clear_connection_pools();
+}
+
+void
+server::set_keep_alive_timeout(int time_milliseconds)
+{
+	_keep_alive_timeout = time_milliseconds;
+	clear_connection_pools();
+}
+
+void
+server::set_header_timeout(int time_milliseconds)
+{
+	_header_timeout = time_milliseconds;
+	clear_connection_pools();
+}
+
+void
+server::set_max_requests_per_connection(size_t num_requests)
+{
+	_max_requests_per_connection = num_requests;
+	clear_connection_pools();
 }
 
 void
 server::set_max_request_bytes(size_t num_bytes)
 {
 	_req_max_bytes = num_bytes;
+	clear_connection_pools();
+}
+
+void
+server::set_max_stream_pending_bytes(size_t num_bytes)
+{
+	_stream_max_pending_bytes = num_bytes;
+	clear_connection_pools();
+}
+
+void
+server::set_http2_max_concurrent_streams(size_t num_streams)
+{
+	_http2_max_streams = num_streams;
+#if defined(SERVED_TLS)
+	if ( _tls_context )
+	{
+		_tls_context->set_http2(_http2_max_streams > 0);
+	}
+#endif
+	clear_connection_pools();
+}
+
+void
+server::set_tls_context(tls_context_ptr context)
+{
+	_tls_context = std::move(context);
+#if defined(SERVED_TLS)
+	if ( _tls_context )
+	{
+		_tls_context->set_http2(_http2_max_streams > 0);
+	}
+#endif
+	clear_connection_pools();
+}
+
+void
+server::set_drain_timeout(int time_milliseconds)
+{
+	_drain_timeout = time_milliseconds;
+}
+
+void
+server::set_max_connections(size_t num_connections)
+{
+	_max_connections = num_connections;
+}
+
+void
+server::set_max_connections_per_ip(size_t num_connections)
+{
+	_max_connections_per_ip = num_connections;
+}
+
+void
+server::set_listen_backlog(int num_connections)
+{
+	_listen_backlog = num_connections;
+	for ( auto & s : _shards )
+	{
+		// Listening again on a listening socket updates its backlog.
+		if ( s->acceptor.is_open() )
+		{
+			s->acceptor.listen(_listen_backlog);
+		}
+	}
+}
+
+void
+server::set_connection_pool_size(size_t num_connections)
+{
+	_pool_size = num_connections;
+	for ( auto & s : _shards )
+	{
+		s->pool.set_max_size(_pool_size);
+	}
+}
+
+void
+server::set_connection_pool_max_bytes(size_t num_bytes)
+{
+	_pool_max_bytes = num_bytes;
+	for ( auto & s : _shards )
+	{
+		s->pool.set_max_bytes(_pool_max_bytes);
+	}
+}
+
+connection_pool_stats
+server::get_connection_pool_stats() const
+{
+	connection_pool_stats stats;
+	for ( const auto & s : _shards )
+	{
+		stats += s->pool.stats();
+	}
+	return stats;
+}
+
+buffer_pool_stats
+server::get_buffer_pool_stats() const
+{
+	buffer_pool_stats stats;
+	for ( const auto & s : _shards )
+	{
+		stats += s->pool.buffers()->stats();
+	}
+	return stats;
+}
+
+size_t
+server::get_connection_count() const
+{
+	size_t count = 0;
+	for ( const auto & s : _shards )
+	{
+		count += s->connections.size();
+	}
+	return count;
+}
+
+void
+server::clear_connection_pools()
+{
+	for ( auto & s : _shards )
+	{
+		s->pool.clear();
+	}
 }
 
 void
@@ -135,46 +477,251 @@ server::stop()
 	{
 		_io_service.stop();
 	}
+	for ( auto & s : _shards )
+	{
+		if ( ! s->io_service.stopped() )
+		{
+			s->io_service.stop();
+		}
+	}
+	join_threads();
+}
+
+void
+server::drain(int time_milliseconds)
+{
+	begin_drain(time_milliseconds);
+	join_threads();
+}
+
+void
+server::begin_drain(int time_milliseconds)
+{
+	const auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(time_milliseconds);
+
+	// Without pending signal handlers the server io_service runs out of work.
+	_io_service.post([this]() {
+		boost::system::error_code ignored_ec;
+		_signals.cancel(ignored_ec);
+	});
+
+	for ( auto & s : _shards )
+	{
+		shard * target = s.get();
+		target->io_service.post([this, target, deadline]() {
+			boost::system::error_code ignored_ec;
+			target->acceptor.close(ignored_ec);
+			target->connections.drain_all();
+			await_drained(*target, deadline);
+		});
+	}
+}
+
+void
+server::await_drained(shard & s, std::chrono::steady_clock::time_point deadline)
+{
+	if ( s.connections.size() == 0 )
+	{
+		return;
+	}
+	if ( std::chrono::steady_clock::now() >= deadline )
+	{
+		s.connections.stop_all();
+		return;
+	}
+
+	s.drain_timer.expires_from_now(std::chrono::milliseconds(10));
+	s.drain_timer.async_wait([this, &s, deadline](const boost::system::error_code & error) {
+		if ( ! error )
+		{
+			await_drained(s, deadline);
+		}
+	});
 }
 
 void
-server::do_accept()
+server::join_threads()
 {
-	_acceptor.async_accept(_socket,
-		[this](boost::system::error_code ec) {
+	for ( auto & thread : _threads )
+	{
+		if ( thread.get_id() == std::this_thread::get_id() )
+		{
+			// Stopped from one of its own threads, which cannot join itself.
+			thread.detach();
+		}
+		else if ( thread.joinable() )
+		{
+			thread.join();
+		}
+	}
+	_threads.clear();
+}
+
+void
+server::do_accept(shard & s)
+{
+	s.acceptor.async_accept(s.socket,
+		[this, &s](boost::system::error_code ec) {
 			// Check whether the server was stopped by a signal before this
 			// completion handler had a chance to run.
-			if (!_acceptor.is_open())
+			if (!s.acceptor.is_open())
 			{
 				return;
 			}
 			if (!ec)
 			{
-				_connection_manager.start(
-					std::make_shared<connection>( _io_service
-					                            , std::move(_socket)
-					                            , _connection_manager
-					                            , _request_handler
-					                            , _req_max_bytes
-					                            , _read_timeout
-					                            , _write_timeout
-					                            ));
+				start_connection(s, s.socket);
+			}
+			if ( at_connection_limit() )
+			{
+				// Stop accepting until connections close, new clients wait in the listen backlog.
+				s.accept_paused = true;
+
+				// A connection may have closed before the pause was visible, in which case
+				// accepting continues unless the release already resumed it.
+				if ( at_connection_limit() || ! s.accept_paused.exchange(false) )
+				{
+					return;
+				}
 			}
-			do_accept();
+			do_accept(s);
 		}
 	);
 }
 
+void
+server::start_connection(shard & s, boost::asio::ip::tcp::socket & socket)
+{
+	std::shared_ptr<void> admission;
+	if ( admit(socket, admission) )
+	{
+		s.connections.start(
+			s.pool.acquire( s.io_service
+			              , std::move(socket)
+			              , s.connections
+			              , _request_handler
+			              , s.timers
+			              , _req_max_bytes
+			              , _read_timeout
+			              , _write_timeout
+			              , _keep_alive_timeout
+			              , _max_requests_per_connection
+			              , _header_timeout
+			              , _stream_max_pending_bytes
+			              , _http2_max_streams
+			              , _tls_context
+			              )
+			, std::move(admission));
+	}
+	else
+	{
+		boost::system::error_code ignored_ec;
+		socket.close(ignored_ec);
+	}
+}
+
+bool
+server::admit(const boost::asio::ip::tcp::socket & socket, std::shared_ptr<void> & admission)
+{
+	if ( _max_connections == 0 && _max_connections_per_ip == 0 )
+	{
+		return true;
+	}
+
+	std::string address;
+	if ( _max_connections_per_ip > 0 )
+	{
+		boost::system::error_code ec;
+		auto endpoint = socket.remote_endpoint(ec);
+		if ( ! ec )
+		{
+			address = endpoint.address().to_string();
+		}
+
+		std::lock_guard<std::mutex> lock(_address_mutex);
+
+		size_t & count = _address_connections[address];
+		if ( count >= _max_connections_per_ip )
+		{
+			return false;
+		}
+		count++;
+	}
+	_connection_count++;
+
+	// The admission is released once the connection is removed from its connection manager.
+	admission = std::shared_ptr<void>(nullptr, [this, address](void *) {
+		release_admission(address);
+	});
+	return true;
+}
+
+void
+server::release_admission(const std::string & address)
+{
+	if ( _max_connections_per_ip > 0 )
+	{
+		std::lock_guard<std::mutex> lock(_address_mutex);
+
+		auto it = _address_connections.find(address);
+		if ( it != _address_connections.end() && --it->second == 0 )
+		{
+			_address_connections.erase(it);
+		}
+	}
+	_connection_count--;
+
+	if ( _closing || at_connection_limit() )
+	{
+		return;
+	}
+	for ( auto & s : _shards )
+	{
+		if ( s->accept_paused.exchange(false) )
+		{
+			shard * target = s.get();
+			target->io_service.post([this, target]() {
+				do_accept(*target);
+			});
+		}
+	}
+}
+
+bool
+server::at_connection_limit() const
+{
+	return _max_connections > 0 && _connection_count >= _max_connections;
+}
+
 void
 server::do_await_stop()
 {
 	_signals.async_wait(
-		[this](boost::system::error_code /*ec*/, int /*signo*/) {
+		[this](boost::system::error_code ec, int /*signo*/) {
+			// Signal handling is cancelled once the server is draining.
+			if ( ec == boost::asio::error::operation_aborted )
+			{
+				return;
+			}
+			if ( _drain_timeout > 0 )
+			{
+				begin_drain(_drain_timeout);
+				return;
+			}
+
 			/* The server is stopped by cancelling all outstanding asynchronous
 			 * operations. Once all operations have finished the io_service::run()
 			 * call will exit.
+			 *
+			 * Each shard is stopped from a handler on its own io_service.
 			 */
-			_acceptor.close();
-			_connection_manager.stop_all();
+			for ( auto & s : _shards )
+			{
+				shard * target = s.get();
+				target->io_service.post([target]() {
+					target->acceptor.close();
+					target->connections.stop_all();
+				});
+			}
 		});
 }
@@ -23,9 +23,19 @@
 #ifndef SERVER_HPP
 #define SERVER_HPP
 
+#include <served/boost_compat.hpp>
 #include <boost/asio.hpp>
+#include <boost/asio/steady_timer.hpp>
+#include <atomic>
+#include <memory>
+#include <mutex>
 #include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
 #include <served/net/connection_manager.hpp>
+#include <served/net/connection_pool.hpp>
+#include <served/net/tls_context.hpp>
 #include <served/multiplexer.hpp>
 
 namespace served { namespace net {
@@ -40,21 +50,72 @@ namespace served { namespace net {
  */
 class server
 {
+	/*
+	 * Accepts and serves connections on a single io_service.
+	 *
+	 * By default the server has one shard whose io_service is shared by every thread in the pool.
+	 * When run sharded each thread owns a shard, with its own io_service, acceptor and connections.
+	 */
+	struct shard
+	{
+		std::unique_ptr<boost::asio::io_service> owned_io_service;
+		boost::asio::io_service &                io_service;
+		timer_wheel_ptr                          timers;
+		boost::asio::ip::tcp::acceptor           acceptor;
+		boost::asio::ip::tcp::socket             socket;
+		connection_manager                       connections;
+		connection_pool                          pool;
+		std::atomic<bool>                        accept_paused;
+		boost::asio::steady_timer                drain_timer;
+
+		/*
+		 * Constructs a shard that uses an existing io_service.
+		 */
+		explicit shard(boost::asio::io_service & io_service);
+
+		/*
+		 * Constructs a shard that owns its own io_service.
+		 */
+		shard();
+	};
+
+	typedef std::unique_ptr<shard> shard_ptr;
+
+	typedef std::unordered_map<std::string, size_t> address_counts;
+
 	boost::asio::io_service        _io_service;
 	boost::asio::signal_set        _signals;
-	boost::asio::ip::tcp::acceptor _acceptor;
-	connection_manager             _connection_manager;
-	boost::asio::ip::tcp::socket   _socket;
+	boost::asio::ip::tcp::endpoint _endpoint;
+	std::atomic<bool>              _closing;
+	std::atomic<size_t>            _connection_count;
+	size_t                         _max_connections;
+	size_t                         _max_connections_per_ip;
+	int                            _listen_backlog;
+	std::mutex                     _address_mutex;
+	address_counts                 _address_connections;
+	std::vector<shard_ptr>         _shards;
+	std::vector<std::thread>       _threads;
+	int                            _drain_timeout;
 	multiplexer &                  _request_handler;
 	int                            _read_timeout;
 	int                            _write_timeout;
+	int                            _keep_alive_timeout;
+	int                            _header_timeout;
+	size_t                         _max_requests_per_connection;
 	size_t                         _req_max_bytes;
+	size_t                         _stream_max_pending_bytes;
+	size_t                         _http2_max_streams;
+	tls_context_ptr                _tls_context;
+	size_t                         _pool_size;
+	size_t                         _pool_max_bytes;
 
 public:
 	server(const server&) = delete;
 
 	server& operator=(const server&) = delete;
 
+	~server();
+
 	/*
 	 * Constructs a new server.
 	 *
@@ -81,13 +142,48 @@ public:
 	 */
 	void run(int n_threads = 1, bool block = true);
 
+	/*
+	 * A call that prompts the server into listening for HTTP requests in shared-nothing mode.
+	 *
+	 * Each thread owns an io_service, an acceptor bound to the server address with SO_REUSEPORT,
+	 * and the connections it accepts, which are never moved to another thread. The kernel
+	 * distributes incoming connections across the acceptors. The first thread keeps the acceptor
+	 * opened by the server, and serves connections made before this call. The acceptor is bound
+	 * again with SO_REUSEPORT, clients connecting at that moment may be refused. Threads can
+	 * optionally be pinned to a CPU each.
+	 *
+	 * A server that is not run sharded does not set SO_REUSEPORT, so another server binding the
+	 * same port fails.
+	 *
+	 * On platforms without SO_REUSEPORT this falls back to run().
+	 *
+	 * @param n_threads the number of threads, 0 uses one per hardware thread
+	 * @param pin_threads if true each thread is pinned to a separate CPU where supported
+	 * @param block defines whether this operation is blocking or not
+	 */
+	void run_sharded(int n_threads = 0, bool pin_threads = false, bool block = true);
+
 	/*
 	 * Stops the server from accepting requests.
 	 *
-	 * This call blocks until all open connections are closed.
+	 * Open connections are dropped, including any requests in progress. This call blocks until
+	 * the threads started by a non-blocking run have finished.
 	 */
 	void stop();
 
+	/*
+	 * Stops the server gracefully.
+	 *
+	 * The server stops accepting connections and closes connections that are waiting for a
+	 * request. Requests in progress are completed and answered with Connection: close, and any
+	 * connections still open once the timeout expires are closed. This call blocks until the
+	 * threads started by a non-blocking run have finished, and must not be called from a request
+	 * handler.
+	 *
+	 * @param time_milliseconds the time in milliseconds allowed for requests in progress
+	 */
+	void drain(int time_milliseconds);
+
 	/*
 	 * Sets the maximum length of time in milliseconds to wait for a clients request to be received.
 	 * If set to 0 (default) the value is ignored and no timeout is used.
@@ -104,6 +200,34 @@ public:
 	 */
 	void set_write_timeout(int time_milliseconds);
 
+	/*
+	 * Sets the maximum length of time in milliseconds that a persistent connection may remain idle
+	 * between requests before it is closed. If set to 0 (default) the value is ignored and idle
+	 * connections are kept open until the client closes them.
+	 *
+	 * @param time_milliseconds the time in milliseconds to wait, 0 is ignored and no timeout is set
+	 */
+	void set_keep_alive_timeout(int time_milliseconds);
+
+	/*
+	 * Sets the maximum length of time in milliseconds for a client to send the header of a
+	 * request, counted from the start of the request regardless of how often data arrives. This
+	 * protects against clients that trickle a header to hold connections open. If set to 0
+	 * (default) the value is ignored and no timeout is used.
+	 *
+	 * @param time_milliseconds the time in milliseconds to wait, 0 is ignored and no timeout is set
+	 */
+	void set_header_timeout(int time_milliseconds);
+
+	/*
+	 * Sets the maximum number of requests served over a single persistent connection before the
+	 * server closes it. If set to 0 (default) the limit is ignored, a value of 1 disables
+	 * persistent connections.
+	 *
+	 * @param num_requests the number of requests permitted, 0 is ignored and no limit is used
+	 */
+	void set_max_requests_per_connection(size_t num_requests);
+
 	/*
 	 * Sets the maximum size in bytes that a request is permitted to be before a client is rejected.
 	 * If set to 0 (default) the limit is ignored.
@@ -112,11 +236,186 @@ public:
 	 */
 	void set_max_request_bytes(size_t num_bytes);
 
+	/*
+	 * Sets the number of bytes of a streamed response that may wait to be sent on a connection.
+	 * Once reached, response_stream::write returns false and handlers should wait until the
+	 * client has received more of the response. Defaults to 1 MiB, a value of 0 removes the limit.
+	 *
+	 * @param num_bytes the number of bytes permitted, 0 is ignored and no limit is used
+	 */
+	void set_max_stream_pending_bytes(size_t num_bytes);
+
+	/*
+	 * Enables HTTP/2 over cleartext TCP (h2c), with the number of streams a client may open at
+	 * once. Clients may start with the HTTP/2 connection preface or upgrade an HTTP/1.1 request.
+	 * Disabled by default, a value of 0 disables HTTP/2. The keep alive timeout closes idle HTTP/2
+	 * connections.
+	 *
+	 * @param num_streams the number of concurrent streams permitted, 0 disables HTTP/2
+	 */
+	void set_http2_max_concurrent_streams(size_t num_streams);
+
+	/*
+	 * Serves connections over TLS, see tls_context. Clients select HTTP/2 with ALPN when it is
+	 * enabled with set_http2_max_concurrent_streams. Disabled by default, requires the library to
+	 * be built with SERVED_TLS.
+	 *
+	 * @param context the certificate and TLS settings, nullptr serves plain TCP
+	 */
+	void set_tls_context(tls_context_ptr context);
+
+	/*
+	 * Sets the time in milliseconds allowed for requests in progress when the server is stopped
+	 * by a signal, see drain. If set to 0 (default) connections are closed immediately.
+	 *
+	 * @param time_milliseconds the time in milliseconds to wait, 0 closes connections immediately
+	 */
+	void set_drain_timeout(int time_milliseconds);
+
+	/*
+	 * Sets the maximum number of connections open at once. Once the limit is reached the server
+	 * stops accepting connections, leaving new clients waiting in the listen backlog, and resumes
+	 * as connections close. If set to 0 (default) the limit is ignored. Must be set before the
+	 * server is run.
+	 *
+	 * @param num_connections the number of connections permitted, 0 is ignored and no limit is used
+	 */
+	void set_max_connections(size_t num_connections);
+
+	/*
+	 * Sets the maximum number of connections open at once from a single client address. Further
+	 * connections from that address are closed as soon as they are accepted. If set to 0
+	 * (default) the limit is ignored. Must be set before the server is run.
+	 *
+	 * @param num_connections the number of connections permitted, 0 is ignored and no limit is used
+	 */
+	void set_max_connections_per_ip(size_t num_connections);
+
+	/*
+	 * Sets the length of the queue of connections waiting to be accepted, as passed to listen().
+	 * Defaults to the system maximum (SOMAXCONN).
+	 *
+	 * @param num_connections the length of the listen backlog
+	 */
+	void set_listen_backlog(int num_connections);
+
+	/*
+	 * Sets the maximum number of closed connections kept by each shard for reuse. Recycling
+	 * connections avoids allocating their buffers for every accepted client. Defaults to 256, a
+	 * value of 0 disables connection pooling.
+	 *
+	 * @param num_connections the number of connections kept for reuse per shard
+	 */
+	void set_connection_pool_size(size_t num_connections);
+
+	/*
+	 * Sets the maximum memory in bytes held by the closed connections each shard keeps for
+	 * reuse. Defaults to 16 MiB.
+	 *
+	 * @param num_bytes the number of bytes kept for reuse per shard
+	 */
+	void set_connection_pool_max_bytes(size_t num_bytes);
+
+	/*
+	 * Get the counters of the connection pools, summed over all shards.
+	 *
+	 * @return the connection pool counters
+	 */
+	connection_pool_stats get_connection_pool_stats() const;
+
+	/*
+	 * Get the counters of the read buffer pools, summed over all shards.
+	 *
+	 * Connections only borrow a read buffer while bytes are arriving, so the borrowed count stays
+	 * well below the number of open connections when most of them are idle.
+	 *
+	 * @return the buffer pool counters
+	 */
+	buffer_pool_stats get_buffer_pool_stats() const;
+
+	/*
+	 * Get the number of open connections, summed over all shards.
+	 *
+	 * @return the number of open connections
+	 */
+	size_t get_connection_count() const;
+
 private:
 	/*
-	 * An asynchronous call that triggers listening for a TCP connection or signal.
+	 * Stops accepting connections and drains the open connections of every shard.
+	 *
+	 * The io_services run out of work, and their threads return, once the connections are
+	 * closed.
+	 *
+	 * @param time_milliseconds the time in milliseconds allowed for requests in progress
+	 */
+	void begin_drain(int time_milliseconds);
+
+	/*
+	 * Waits for the drained connections of a shard to close, closing them at the deadline.
+	 *
+	 * @param s the shard
+	 * @param deadline the time at which any open connections are closed
+	 */
+	void await_drained(shard & s, std::chrono::steady_clock::time_point deadline);
+
+	/*
+	 * Joins the threads started by a non-blocking run.
+	 */
+	void join_threads();
+
+	/*
+	 * Starts serving an accepted connection on a shard, unless it exceeds a connection limit.
+	 *
+	 * @param s the shard that accepted the connection
+	 * @param socket the socket of the accepted connection, which is moved from or closed
+	 */
+	void start_connection(shard & s, boost::asio::ip::tcp::socket & socket);
+
+#if defined(SO_REUSEPORT)
+	/*
+	 * Binds the acceptor of a shard again with SO_REUSEPORT, so that further shards can bind to
+	 * the same endpoint. Connections waiting in its backlog are started on the shard first.
+	 *
+	 * @param s the shard, which must not be running
+	 */
+	void share_port(shard & s);
+#endif // defined(SO_REUSEPORT)
+
+	/*
+	 * Admits an accepted connection against the connection limits.
+	 *
+	 * @param socket the socket of the accepted connection
+	 * @param admission set to an object which releases the admission once destroyed
+	 * @return false if the connection exceeds a limit and must be refused
+	 */
+	bool admit(const boost::asio::ip::tcp::socket & socket, std::shared_ptr<void> & admission);
+
+	/*
+	 * Releases the admission of a closed connection, resuming accepting connections if paused.
+	 *
+	 * @param address the client address of the connection
+	 */
+	void release_admission(const std::string & address);
+
+	/*
+	 * Whether the number of open connections has reached the limit.
+	 *
+	 * @return true if no further connections may be accepted
+	 */
+	bool at_connection_limit() const;
+
+	/*
+	 * Discards the pooled connections of every shard, used when connection parameters change.
+	 */
+	void clear_connection_pools();
+
+	/*
+	 * An asynchronous call that triggers listening for a TCP connection on a shard.
+	 *
+	 * @param s the shard to accept connections for
 	 */
-	void do_accept();
+	void do_accept(shard & s);
 
 	/*
 	 * Stops the server from listening for new connections and closes all open connections.
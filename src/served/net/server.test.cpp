@@ -21,3 +21,228 @@
  */
 
 #include <test/catch.hpp>
+
+#include <served/net/server.hpp>
+
+#include <boost/asio.hpp>
+#include <thread>
+
+#include <poll.h>
+
+namespace {
+
+/*
+ * Sends a single request on a new connection and returns the full response, or an empty string
+ * if the connection failed.
+ */
+std::string
+request_once(const std::string & port, const std::string & request)
+{
+	boost::asio::io_service io_service;
+	boost::asio::ip::tcp::socket socket(io_service);
+	boost::system::error_code ec;
+
+	socket.connect(boost::asio::ip::tcp::endpoint(
+		boost::asio::ip::address::from_string("127.0.0.1"), std::stoi(port)), ec);
+	if ( ec )
+	{
+		return std::string();
+	}
+
+	boost::asio::write(socket, boost::asio::buffer(request), ec);
+
+	boost::asio::streambuf buf;
+	boost::asio::read(socket, buf, boost::asio::transfer_all(), ec);
+
+	return std::string(boost::asio::buffers_begin(buf.data()), boost::asio::buffers_end(buf.data()));
+}
+
+/*
+ * Waits for a socket to become readable, which includes the connection being closed.
+ */
+bool
+readable_within(boost::asio::ip::tcp::socket & socket, int timeout_ms)
+{
+	pollfd pfd = { socket.native_handle(), POLLIN, 0 };
+	return ::poll(&pfd, 1, timeout_ms) > 0;
+}
+
+} // anonymous namespace
+
+TEST_CASE("sharded server serves requests", "[server]")
+{
+	served::multiplexer mux;
+	mux.handle("/hello")
+		.get([](served::response & res, const served::request &) {
+			res << "hello";
+		});
+
+	served::net::server server("127.0.0.1", "42811", mux, false);
+
+	// A connection made before the shards start waits in the backlog of the first shard.
+	boost::asio::io_service io_service;
+	boost::asio::ip::tcp::socket early(io_service);
+	early.connect(boost::asio::ip::tcp::endpoint(boost::asio::ip::address::from_string("127.0.0.1"), 42811));
+	boost::asio::write(early, boost::asio::buffer(std::string("GET /hello HTTP/1.1\r\nConnection: close\r\n\r\n")));
+
+	std::thread server_thread([&]() { server.run_sharded(2, true); });
+
+	boost::asio::streambuf buf;
+	boost::system::error_code ec;
+	boost::asio::read(early, buf, boost::asio::transfer_all(), ec);
+	std::string res(boost::asio::buffers_begin(buf.data()), boost::asio::buffers_end(buf.data()));
+	CHECK(res.find("HTTP/1.1 200 OK\r\n") == 0);
+
+	for ( int i = 0; i < 20; i++ )
+	{
+		res = request_once("42811", "GET /hello HTTP/1.1\r\nConnection: close\r\n\r\n");
+		CHECK(res.substr(res.length() - 5) == "hello");
+	}
+
+	server.stop();
+	server_thread.join();
+}
+
+TEST_CASE("server binds its port exclusively unless sharded", "[server]")
+{
+	served::multiplexer mux;
+
+	served::net::server server("127.0.0.1", "42818", mux, false);
+	CHECK_THROWS_AS(served::net::server("127.0.0.1", "42818", mux, false), const boost::system::system_error &);
+}
+
+TEST_CASE("server limits open connections", "[server]")
+{
+	served::multiplexer mux;
+	mux.handle("/hello")
+		.get([](served::response & res, const served::request &) {
+			res << "hello";
+		});
+
+	served::net::server server("127.0.0.1", "42812", mux, false);
+	server.set_listen_backlog(16);
+
+	const auto endpoint = boost::asio::ip::tcp::endpoint(
+		boost::asio::ip::address::from_string("127.0.0.1"), 42812);
+	const std::string request = "GET /hello HTTP/1.1\r\n\r\n";
+
+	boost::asio::io_service io_service;
+	boost::asio::ip::tcp::socket a(io_service), b(io_service), c(io_service);
+
+	SECTION("accepting pauses at the connection limit")
+	{
+		server.set_max_connections(2);
+		std::thread server_thread([&]() { server.run(); });
+
+		for ( auto * socket : { &a, &b, &c } )
+		{
+			socket->connect(endpoint);
+			boost::asio::write(*socket, boost::asio::buffer(request));
+		}
+
+		CHECK(readable_within(a, 1000));
+		CHECK(readable_within(b, 1000));
+
+		// The third client waits in the listen backlog until a connection closes.
+		CHECK_FALSE(readable_within(c, 200));
+		CHECK(server.get_connection_count() == 2);
+
+		a.close();
+		CHECK(readable_within(c, 1000));
+
+		server.stop();
+		server_thread.join();
+	}
+
+	SECTION("connections over the per address limit are refused")
+	{
+		server.set_max_connections_per_ip(1);
+		std::thread server_thread([&]() { server.run(); });
+
+		a.connect(endpoint);
+		boost::asio::write(a, boost::asio::buffer(request));
+		CHECK(readable_within(a, 1000));
+
+		b.connect(endpoint);
+		REQUIRE(readable_within(b, 1000));
+
+		char data;
+		boost::system::error_code ec;
+		b.read_some(boost::asio::buffer(&data, 1), ec);
+		CHECK(ec);
+
+		// Once the first connection closes the address may connect again.
+		a.close();
+		for ( int i = 0; i < 100 && server.get_connection_count() > 0; i++ )
+		{
+			std::this_thread::sleep_for(std::chrono::milliseconds(10));
+		}
+
+		c.connect(endpoint);
+		boost::asio::write(c, boost::asio::buffer(request));
+		REQUIRE(readable_within(c, 1000));
+		c.read_some(boost::asio::buffer(&data, 1), ec);
+		CHECK_FALSE(ec);
+
+		server.stop();
+		server_thread.join();
+	}
+}
+
+TEST_CASE("server drains gracefully", "[server]")
+{
+	served::multiplexer mux;
+	mux.handle("/hello")
+		.get([](served::response & res, const served::request &) {
+			res << "hello";
+		});
+	mux.handle("/slow")
+		.get([](served::response & res, const served::request &) {
+			std::this_thread::sleep_for(std::chrono::milliseconds(300));
+			res << "slow";
+		});
+
+	served::net::server server("127.0.0.1", "42813", mux, false);
+	server.run(2, false);
+
+	const auto endpoint = boost::asio::ip::tcp::endpoint(
+		boost::asio::ip::address::from_string("127.0.0.1"), 42813);
+
+	boost::asio::io_service io_service;
+	boost::asio::ip::tcp::socket idle(io_service), busy(io_service);
+
+	// An idle keep-alive connection, which has been served and waits for its next request.
+	idle.connect(endpoint);
+	boost::asio::write(idle, boost::asio::buffer(std::string("GET /hello HTTP/1.1\r\n\r\n")));
+	REQUIRE(readable_within(idle, 1000));
+
+	char data[256];
+	boost::system::error_code ec;
+	idle.read_some(boost::asio::buffer(data), ec);
+	REQUIRE_FALSE(ec);
+
+	// A connection with a request in progress when the drain begins.
+	busy.connect(endpoint);
+	boost::asio::write(busy, boost::asio::buffer(std::string("GET /slow HTTP/1.1\r\n\r\n")));
+	std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+	auto start = std::chrono::steady_clock::now();
+	server.drain(5000);
+	auto elapsed = std::chrono::steady_clock::now() - start;
+	CHECK(elapsed < std::chrono::milliseconds(2000));
+
+	idle.read_some(boost::asio::buffer(data), ec);
+	CHECK(ec == boost::asio::error::eof);
+
+	boost::asio::streambuf buf;
+	boost::asio::read(busy, buf, boost::asio::transfer_all(), ec);
+	std::string res(boost::asio::buffers_begin(buf.data()), boost::asio::buffers_end(buf.data()));
+	CHECK(res.find("HTTP/1.1 200 OK\r\n") == 0);
+	CHECK(res.find("Connection: close\r\n") != std::string::npos);
+	CHECK(res.substr(res.length() - 4) == "slow");
+
+	// No longer accepting connections.
+	boost::asio::ip::tcp::socket late(io_service);
+	late.connect(endpoint, ec);
+	CHECK(ec);
+}
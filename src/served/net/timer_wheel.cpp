@@ -0,0 +1,207 @@
+/*
+ * Copyright (C) 2021 QM Ltd.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <served/net/timer_wheel.hpp>
+
+#include <algorithm>
+
+using namespace served::net;
+
+//  -----  entry  -----
+
+timer_wheel::entry::entry()
+	: _prev(nullptr)
+	, _next(nullptr)
+	, _rounds(0)
+	, _expired(false)
+	, _callback()
+{}
+
+void
+timer_wheel::entry::set_callback(std::function<void()> callback)
+{
+	_callback = std::move(callback);
+}
+
+//  -----  timer wheel  -----
+
+timer_wheel::timer_wheel( boost::asio::io_service & io_service
+                        , int                       tick_ms   /* = 50 */
+                        , size_t                    num_slots /* = 512 */
+                        )
+	: _timer(io_service)
+	, _tick_ms(tick_ms > 0 ? tick_ms : 1)
+	, _num_slots(num_slots > 0 ? num_slots : 1)
+	, _slots(new entry[_num_slots])
+	, _expiring()
+	, _cursor(0)
+	, _size(0)
+	, _ticking(false)
+{
+	// Each slot is the sentinel of a circular list, an empty slot points to itself.
+	for ( size_t i = 0; i < _num_slots; i++ )
+	{
+		_slots[i]._prev = &_slots[i];
+		_slots[i]._next = &_slots[i];
+	}
+	_expiring._prev = &_expiring;
+	_expiring._next = &_expiring;
+}
+
+void
+timer_wheel::schedule(entry & e, int timeout_ms)
+{
+	size_t ticks = ( std::max(timeout_ms, 1) + _tick_ms - 1 ) / _tick_ms;
+
+	std::lock_guard<std::mutex> lock(_mutex);
+
+	if ( e._next )
+	{
+		unlink(e);
+	}
+
+	e._rounds = ( ticks - 1 ) / _num_slots;
+	link(e, _slots[(_cursor + ticks) % _num_slots]);
+	_size++;
+
+	if ( ! _ticking )
+	{
+		start_ticking();
+	}
+}
+
+void
+timer_wheel::cancel(entry & e)
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+
+	if ( e._next )
+	{
+		unlink(e);
+	}
+}
+
+size_t
+timer_wheel::size()
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+	return _size;
+}
+
+void
+timer_wheel::link(entry & e, entry & list)
+{
+	e._prev = list._prev;
+	e._next = &list;
+	list._prev->_next = &e;
+	list._prev        = &e;
+}
+
+void
+timer_wheel::unlink(entry & e)
+{
+	e._prev->_next = e._next;
+	e._next->_prev = e._prev;
+	e._prev = nullptr;
+	e._next = nullptr;
+
+	// Expired timeouts waiting for their callback are no longer counted as scheduled.
+	if ( e._expired )
+	{
+		e._expired = false;
+	}
+	else
+	{
+		_size--;
+	}
+}
+
+void
+timer_wheel::start_ticking()
+{
+	_ticking = true;
+
+	auto self(shared_from_this());
+
+	_timer.expires_from_now(std::chrono::milliseconds(_tick_ms));
+	_timer.async_wait([this, self](const boost::system::error_code & error) {
+		if ( ! error )
+		{
+			on_tick();
+		}
+		else
+		{
+			std::lock_guard<std::mutex> lock(_mutex);
+			_ticking = false;
+		}
+	});
+}
+
+void
+timer_wheel::on_tick()
+{
+	std::unique_lock<std::mutex> lock(_mutex);
+
+	_cursor = ( _cursor + 1 ) % _num_slots;
+
+	// Expired timeouts are moved to a list of their own, where another thread can still
+	// reschedule or cancel them until their callback is called.
+	entry & slot = _slots[_cursor];
+	for ( entry * e = slot._next; e != &slot; )
+	{
+		entry * next = e->_next;
+		if ( e->_rounds > 0 )
+		{
+			e->_rounds--;
+		}
+		else
+		{
+			unlink(*e);
+			link(*e, _expiring);
+			e->_expired = true;
+		}
+		e = next;
+	}
+
+	// The wheel stops turning while no timeouts are scheduled.
+	_ticking = false;
+	if ( _size > 0 )
+	{
+		start_ticking();
+	}
+
+	// Each timeout is taken from the list just before its callback, which is copied so that it
+	// may cancel or reschedule entries, or destroy them.
+	while ( _expiring._next != &_expiring )
+	{
+		entry & e = *_expiring._next;
+		unlink(e);
+		std::function<void()> callback = e._callback;
+
+		lock.unlock();
+		if ( callback )
+		{
+			callback();
+		}
+		lock.lock();
+	}
+}
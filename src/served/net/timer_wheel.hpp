@@ -0,0 +1,154 @@
+/*
+ * Copyright (C) 2021 QM Ltd.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef SERVED_TIMER_WHEEL_HPP
+#define SERVED_TIMER_WHEEL_HPP
+
+#include <served/boost_compat.hpp>
+#include <boost/asio.hpp>
+#include <boost/asio/steady_timer.hpp>
+
+#include <functional>
+#include <memory>
+#include <mutex>
+
+namespace served { namespace net {
+
+/*
+ * A coarse grained timer shared by every connection of an io_service.
+ *
+ * Timeouts are kept in a hashed wheel of slots, each slot a list of the timeouts that expire on
+ * that tick of the wheel. Timeouts further away than one revolution count the remaining rounds.
+ * Scheduling, rescheduling and cancelling a timeout are constant time, and the wheel holds a
+ * single asio timer which only runs while timeouts are scheduled.
+ *
+ * A timeout expires within one tick of its deadline. The wheel may be used from multiple
+ * threads, callbacks are invoked from the io_service. A timeout that is rescheduled or cancelled
+ * once it has expired, but before its callback is called, is not called.
+ */
+class timer_wheel
+	: public std::enable_shared_from_this<timer_wheel>
+{
+public:
+	/*
+	 * A timeout that can be scheduled on the wheel.
+	 *
+	 * Entries are owned by the caller, and must be cancelled before they are destroyed.
+	 */
+	class entry
+	{
+		friend class timer_wheel;
+
+		entry *               _prev;
+		entry *               _next;
+		size_t                _rounds;
+		bool                  _expired;
+		std::function<void()> _callback;
+
+	public:
+		entry(const entry&) = delete;
+
+		entry& operator=(const entry&) = delete;
+
+		entry();
+
+		/*
+		 * Sets the function called when the timeout expires.
+		 *
+		 * Must only be called while the entry is not scheduled.
+		 *
+		 * @param callback the function to call
+		 */
+		void set_callback(std::function<void()> callback);
+	};
+
+private:
+	boost::asio::steady_timer _timer;
+	const int                 _tick_ms;
+	const size_t              _num_slots;
+	std::unique_ptr<entry[]>  _slots;
+	entry                     _expiring;
+	size_t                    _cursor;
+	size_t                    _size;
+	bool                      _ticking;
+	std::mutex                _mutex;
+
+public:
+	timer_wheel(const timer_wheel&) = delete;
+
+	timer_wheel& operator=(const timer_wheel&) = delete;
+
+	/*
+	 * Constructs a timer wheel.
+	 *
+	 * @param io_service the boost::asio::io_service that drives the wheel
+	 * @param tick_ms the resolution of the wheel in milliseconds
+	 * @param num_slots the number of ticks in one revolution of the wheel
+	 */
+	explicit timer_wheel( boost::asio::io_service & io_service
+	                    , int                       tick_ms   = 50
+	                    , size_t                    num_slots = 512 );
+
+	/*
+	 * Schedules a timeout, replacing any earlier schedule of the same entry.
+	 *
+	 * @param e the timeout entry
+	 * @param timeout_ms the time in milliseconds until the timeout expires
+	 */
+	void schedule(entry & e, int timeout_ms);
+
+	/*
+	 * Cancels a timeout if it is scheduled.
+	 *
+	 * @param e the timeout entry
+	 */
+	void cancel(entry & e);
+
+	/*
+	 * Get the number of scheduled timeouts.
+	 *
+	 * @return the number of timeouts
+	 */
+	size_t size();
+
+	/*
+	 * Get the resolution of the wheel.
+	 *
+	 * @return the tick in milliseconds
+	 */
+	int tick() const { return _tick_ms; }
+
+private:
+	void link(entry & e, entry & list);
+
+	void unlink(entry & e);
+
+	void start_ticking();
+
+	void on_tick();
+};
+
+typedef std::shared_ptr<timer_wheel> timer_wheel_ptr;
+
+} } // net, served
+
+#endif // SERVED_TIMER_WHEEL_HPP
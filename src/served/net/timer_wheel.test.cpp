@@ -0,0 +1,163 @@
+/*
+ * Copyright (C) 2021 QM Ltd.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <test/catch.hpp>
+
+#include <served/net/timer_wheel.hpp>
+
+#include <chrono>
+#include <vector>
+
+namespace {
+
+long
+elapsed_ms(std::chrono::steady_clock::time_point start)
+{
+	return std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count();
+}
+
+} // anonymous namespace
+
+TEST_CASE("timer wheel expires timeouts", "[timer_wheel]")
+{
+	boost::asio::io_service io_service;
+
+	SECTION("timeouts expire in order")
+	{
+		auto wheel = std::make_shared<served::net::timer_wheel>(io_service, 5, 8);
+
+		std::vector<int> fired;
+		served::net::timer_wheel::entry a, b, c;
+		a.set_callback([&]() { fired.push_back(1); });
+		b.set_callback([&]() { fired.push_back(2); });
+		c.set_callback([&]() { fired.push_back(3); });
+
+		auto start = std::chrono::steady_clock::now();
+		wheel->schedule(c, 100);
+		wheel->schedule(a, 10);
+		wheel->schedule(b, 30);
+		CHECK(wheel->size() == 3);
+
+		// The wheel stops once no timeouts remain, so run returns.
+		io_service.run();
+
+		CHECK(fired == std::vector<int>({ 1, 2, 3 }));
+		CHECK(elapsed_ms(start) >= 95);
+		CHECK(wheel->size() == 0);
+	}
+
+	SECTION("cancelled timeouts do not expire")
+	{
+		auto wheel = std::make_shared<served::net::timer_wheel>(io_service, 5);
+
+		bool fired = false;
+		served::net::timer_wheel::entry e;
+		e.set_callback([&]() { fired = true; });
+
+		wheel->schedule(e, 10);
+		wheel->cancel(e);
+		wheel->cancel(e);
+		CHECK(wheel->size() == 0);
+
+		io_service.run();
+		CHECK_FALSE(fired);
+	}
+
+	SECTION("rescheduling replaces the earlier timeout")
+	{
+		auto wheel = std::make_shared<served::net::timer_wheel>(io_service, 5);
+
+		int fired = 0;
+		served::net::timer_wheel::entry e;
+		e.set_callback([&]() { fired++; });
+
+		auto start = std::chrono::steady_clock::now();
+		wheel->schedule(e, 10);
+		wheel->schedule(e, 50);
+		CHECK(wheel->size() == 1);
+
+		io_service.run();
+		CHECK(fired == 1);
+		CHECK(elapsed_ms(start) >= 45);
+	}
+
+	SECTION("timeouts beyond one revolution wait for their round")
+	{
+		auto wheel = std::make_shared<served::net::timer_wheel>(io_service, 2, 4);
+
+		bool fired = false;
+		served::net::timer_wheel::entry e;
+		e.set_callback([&]() { fired = true; });
+
+		auto start = std::chrono::steady_clock::now();
+		wheel->schedule(e, 40);
+
+		io_service.run();
+		CHECK(fired);
+		CHECK(elapsed_ms(start) >= 38);
+	}
+
+	SECTION("an expired timeout rescheduled before its callback waits again")
+	{
+		auto wheel = std::make_shared<served::net::timer_wheel>(io_service, 5);
+
+		std::vector<int> fired;
+		served::net::timer_wheel::entry a, b, c;
+		a.set_callback([&]() {
+			fired.push_back(1);
+			wheel->schedule(b, 50);
+			wheel->cancel(c);
+		});
+		b.set_callback([&]() { fired.push_back(2); });
+		c.set_callback([&]() { fired.push_back(3); });
+
+		// All three expire on the same tick, the first callback runs before the others.
+		auto start = std::chrono::steady_clock::now();
+		wheel->schedule(a, 10);
+		wheel->schedule(b, 10);
+		wheel->schedule(c, 10);
+
+		io_service.run();
+		CHECK(fired == std::vector<int>({ 1, 2 }));
+		CHECK(elapsed_ms(start) >= 55);
+		CHECK(wheel->size() == 0);
+	}
+
+	SECTION("callbacks may reschedule their own timeout")
+	{
+		auto wheel = std::make_shared<served::net::timer_wheel>(io_service, 2);
+
+		int fired = 0;
+		served::net::timer_wheel::entry e;
+		e.set_callback([&]() {
+			if ( ++fired < 3 )
+			{
+				wheel->schedule(e, 4);
+			}
+		});
+
+		wheel->schedule(e, 4);
+
+		io_service.run();
+		CHECK(fired == 3);
+	}
+}
@@ -0,0 +1,149 @@
+/*
+ * Copyright (C) 2021 QM Ltd.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+#include <served/net/tls_context.hpp>
+
+#if defined(SERVED_TLS)
+
+#include <stdexcept>
+
+using namespace served::net;
+
+namespace {
+
+// ALPN protocol lists, in order of preference.
+const unsigned char protocols_http2[] = "\x02h2\x08http/1.1";
+const unsigned char protocols_http1[] = "\x08http/1.1";
+
+const unsigned char session_id_context[] = "served";
+
+} // anonymous namespace
+
+tls_context::tls_context(const std::string & certificate_chain_file, const std::string & private_key_file)
+	: _context(boost::asio::ssl::context::tls_server)
+	, _http2(false)
+{
+	_context.set_options( boost::asio::ssl::context::default_workarounds
+	                    | boost::asio::ssl::context::no_sslv2
+	                    | boost::asio::ssl::context::no_sslv3
+	                    | boost::asio::ssl::context::no_tlsv1
+	                    | boost::asio::ssl::context::no_tlsv1_1
+	                    | boost::asio::ssl::context::single_dh_use );
+
+	_context.use_certificate_chain_file(certificate_chain_file);
+	_context.use_private_key_file(private_key_file, boost::asio::ssl::context::pem);
+
+	SSL_CTX * ctx = _context.native_handle();
+	SSL_CTX_set_session_id_context(ctx, session_id_context, sizeof(session_id_context) - 1);
+	SSL_CTX_set_session_cache_mode(ctx, SSL_SESS_CACHE_SERVER);
+	SSL_CTX_set_alpn_select_cb(ctx, &tls_context::select_protocol, this);
+}
+
+void
+tls_context::set_session_cache_size(size_t num_sessions)
+{
+	SSL_CTX * ctx = _context.native_handle();
+	if ( num_sessions == 0 )
+	{
+		SSL_CTX_set_session_cache_mode(ctx, SSL_SESS_CACHE_OFF);
+		return;
+	}
+	SSL_CTX_set_session_cache_mode(ctx, SSL_SESS_CACHE_SERVER);
+	SSL_CTX_sess_set_cache_size(ctx, static_cast<long>(num_sessions));
+}
+
+void
+tls_context::set_session_timeout(long seconds)
+{
+	SSL_CTX_set_timeout(_context.native_handle(), seconds);
+}
+
+void
+tls_context::set_session_tickets(bool enabled)
+{
+	if ( enabled )
+	{
+		SSL_CTX_clear_options(_context.native_handle(), SSL_OP_NO_TICKET);
+	}
+	else
+	{
+		SSL_CTX_set_options(_context.native_handle(), SSL_OP_NO_TICKET);
+	}
+}
+
+size_t
+tls_context::required_ticket_key_bytes()
+{
+	// Asking for the keys without a buffer returns their length.
+	return static_cast<size_t>(SSL_CTX_get_tlsext_ticket_keys(_context.native_handle(), nullptr, 0));
+}
+
+void
+tls_context::set_ticket_keys(const std::string & keys)
+{
+	if ( keys.size() != required_ticket_key_bytes() )
+	{
+		throw std::invalid_argument("tls_context: session ticket keys must be "
+		                            + std::to_string(required_ticket_key_bytes()) + " bytes");
+	}
+
+	std::string copy(keys);
+	SSL_CTX_set_tlsext_ticket_keys(_context.native_handle(), &copy[0], static_cast<long>(copy.size()));
+}
+
+void
+tls_context::set_http2(bool enabled)
+{
+	_http2 = enabled;
+}
+
+boost::asio::ssl::context &
+tls_context::native_context()
+{
+	return _context;
+}
+
+int
+tls_context::select_protocol( SSL *
+                            , const unsigned char ** out
+                            , unsigned char *        out_len
+                            , const unsigned char *  in
+                            , unsigned int           in_len
+                            , void *                 arg )
+{
+	const tls_context * self = static_cast<const tls_context *>(arg);
+
+	const unsigned char * server     = self->_http2 ? protocols_http2 : protocols_http1;
+	const unsigned int    server_len = self->_http2 ? sizeof(protocols_http2) - 1 : sizeof(protocols_http1) - 1;
+
+	// The first protocol of the server list that the client also offers is selected.
+	unsigned char * selected = nullptr;
+	if ( SSL_select_next_proto(&selected, out_len, server, server_len, in, in_len) != OPENSSL_NPN_NEGOTIATED )
+	{
+		return SSL_TLSEXT_ERR_NOACK;
+	}
+	*out = selected;
+	return SSL_TLSEXT_ERR_OK;
+}
+
+#endif // SERVED_TLS
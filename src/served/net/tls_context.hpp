@@ -0,0 +1,141 @@
+/*
+ * Copyright (C) 2021 QM Ltd.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+#ifndef SERVED_TLS_CONTEXT_HPP
+#define SERVED_TLS_CONTEXT_HPP
+
+#include <memory>
+#include <string>
+
+#if defined(SERVED_TLS)
+#include <served/boost_compat.hpp>
+#include <boost/asio/ssl/context.hpp>
+#endif
+
+namespace served { namespace net {
+
+class tls_context;
+typedef std::shared_ptr<tls_context> tls_context_ptr;
+
+#if defined(SERVED_TLS)
+
+/*
+ * The certificate and TLS settings of a server, see server::set_tls_context.
+ *
+ * TLS 1.2 and newer are accepted. Resumption is enabled by default, so that returning clients
+ * skip the key exchange and certificate signature of a full handshake: TLS 1.2 sessions are kept
+ * in a server side cache, and session tickets are issued for clients that support them. Ticket
+ * keys are generated per context unless set with set_ticket_keys.
+ *
+ * ALPN selects "h2" for clients that offer it when HTTP/2 is enabled on the server, and
+ * "http/1.1" otherwise.
+ *
+ * Settings must be changed before the server is run.
+ */
+class tls_context
+{
+	boost::asio::ssl::context _context;
+	bool                      _http2;
+
+public:
+	tls_context& operator=(const tls_context&) = delete;
+	tls_context(const tls_context&) = delete;
+
+	/*
+	 * Constructs a context from PEM files.
+	 *
+	 * @param certificate_chain_file the certificate of the server, followed by its chain
+	 * @param private_key_file the private key of the certificate
+	 * @throws boost::system::system_error if a file cannot be loaded
+	 */
+	tls_context(const std::string & certificate_chain_file, const std::string & private_key_file);
+
+	/*
+	 * Set the number of sessions kept for resumption, 20480 by default.
+	 *
+	 * @param num_sessions the number of sessions, 0 disables the session cache
+	 */
+	void set_session_cache_size(size_t num_sessions);
+
+	/*
+	 * Set how long a session may be resumed, by both the cache and tickets.
+	 *
+	 * @param seconds the lifetime of a session, 7200 seconds by default
+	 */
+	void set_session_timeout(long seconds);
+
+	/*
+	 * Enable or disable session tickets, enabled by default.
+	 *
+	 * Without tickets TLS 1.2 clients can only resume from the session cache.
+	 *
+	 * @param enabled whether tickets are issued and accepted
+	 */
+	void set_session_tickets(bool enabled);
+
+	/*
+	 * Set the keys used to encrypt session tickets.
+	 *
+	 * Servers that share keys accept each other's tickets, such as the instances behind a load
+	 * balancer. Keys should be rotated regularly.
+	 *
+	 * @param keys the key material, see required_ticket_key_bytes for its length
+	 * @throws std::invalid_argument if the keys have the wrong length
+	 */
+	void set_ticket_keys(const std::string & keys);
+
+	/*
+	 * Get the length of the key material expected by set_ticket_keys.
+	 *
+	 * @return the number of bytes
+	 */
+	size_t required_ticket_key_bytes();
+
+	/*
+	 * Set whether ALPN offers HTTP/2, called by the server when it is run.
+	 *
+	 * @param enabled true to select "h2" for clients that offer it
+	 */
+	void set_http2(bool enabled);
+
+	/*
+	 * Get the underlying Boost.Asio context, for settings not covered here.
+	 *
+	 * @return the context
+	 */
+	boost::asio::ssl::context & native_context();
+
+private:
+	static int select_protocol( SSL *                  ssl
+	                          , const unsigned char ** out
+	                          , unsigned char *        out_len
+	                          , const unsigned char *  in
+	                          , unsigned int           in_len
+	                          , void *                 arg );
+};
+
+#endif // SERVED_TLS
+
+} } // net, served
+
+#endif // SERVED_TLS_CONTEXT_HPP
@@ -0,0 +1,190 @@
+/*
+ * Copyright (C) 2021 QM Ltd.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+#ifndef SERVED_TRANSPORT_HPP
+#define SERVED_TRANSPORT_HPP
+
+#include <served/boost_compat.hpp>
+#include <boost/asio/ip/tcp.hpp>
+
+#if defined(SERVED_TLS)
+#include <boost/asio/ssl/stream.hpp>
+#endif
+
+#include <memory>
+#include <string>
+
+namespace served { namespace net {
+
+/*
+ * The byte stream of a connection, either the TCP socket itself or TLS over that socket.
+ *
+ * Once start_tls has been called reads and writes are encrypted, so that connections, websockets
+ * and HTTP/2 sessions share one code path for both. A transport meets the AsyncReadStream and
+ * AsyncWriteStream requirements, and can be used with boost::asio::async_read and async_write.
+ *
+ * As with a socket, at most one read and one write may be in progress at a time.
+ */
+class transport
+{
+public:
+	typedef boost::asio::ip::tcp::socket::executor_type executor_type;
+
+#if defined(SERVED_TLS)
+	typedef boost::asio::ssl::stream<boost::asio::ip::tcp::socket &> tls_stream;
+#endif
+
+private:
+	boost::asio::ip::tcp::socket & _socket;
+#if defined(SERVED_TLS)
+	std::unique_ptr<tls_stream>    _tls;
+#endif
+
+public:
+	transport& operator=(const transport&) = delete;
+	transport(const transport&) = delete;
+
+	/*
+	 * Constructs a plain TCP transport.
+	 *
+	 * @param socket the socket of the connection, which must outlive the transport
+	 */
+	explicit transport(boost::asio::ip::tcp::socket & socket)
+		: _socket(socket)
+	{
+	}
+
+	/*
+	 * Get the underlying TCP socket.
+	 *
+	 * @return the socket
+	 */
+	boost::asio::ip::tcp::socket & socket()
+	{
+		return _socket;
+	}
+
+	executor_type get_executor()
+	{
+		return _socket.get_executor();
+	}
+
+	/*
+	 * Determines whether the transport is encrypted.
+	 *
+	 * @return true once start_tls has been called
+	 */
+	bool is_tls() const
+	{
+#if defined(SERVED_TLS)
+		return static_cast<bool>(_tls);
+#else
+		return false;
+#endif
+	}
+
+#if defined(SERVED_TLS)
+	/*
+	 * Layers TLS over the socket, the handshake must be completed before reading or writing.
+	 *
+	 * @param context the context of the server, which must outlive the transport
+	 * @return the TLS stream to handshake
+	 */
+	tls_stream & start_tls(boost::asio::ssl::context & context)
+	{
+		_tls.reset(new tls_stream(_socket, context));
+		return *_tls;
+	}
+#endif
+
+	/*
+	 * Get the protocol selected by ALPN during the TLS handshake.
+	 *
+	 * @return the protocol, such as "h2", or an empty string if none was selected
+	 */
+	std::string alpn_protocol() const
+	{
+#if defined(SERVED_TLS)
+		if ( _tls )
+		{
+			const unsigned char * data = nullptr;
+			unsigned int          len  = 0;
+			SSL_get0_alpn_selected(_tls->native_handle(), &data, &len);
+			return std::string(reinterpret_cast<const char *>(data), data ? len : 0);
+		}
+#endif
+		return std::string();
+	}
+
+	~transport()
+	{
+		reset();
+	}
+
+	/*
+	 * Returns to a plain TCP transport, once no operation is in progress.
+	 */
+	void reset()
+	{
+#if defined(SERVED_TLS)
+		if ( _tls )
+		{
+			// OpenSSL removes the session from the cache of a connection freed without a shutdown,
+			// which would prevent resumption from the cache after connections that are closed
+			// without a close_notify. The session stays resumable, as a cleanly shut down one does.
+			SSL_set_shutdown(_tls->native_handle(), SSL_SENT_SHUTDOWN | SSL_RECEIVED_SHUTDOWN);
+			_tls.reset();
+		}
+#endif
+	}
+
+	template <typename MutableBufferSequence, typename ReadHandler>
+	void async_read_some(const MutableBufferSequence & buffers, ReadHandler && handler)
+	{
+#if defined(SERVED_TLS)
+		if ( _tls )
+		{
+			_tls->async_read_some(buffers, std::forward<ReadHandler>(handler));
+			return;
+		}
+#endif
+		_socket.async_read_some(buffers, std::forward<ReadHandler>(handler));
+	}
+
+	template <typename ConstBufferSequence, typename WriteHandler>
+	void async_write_some(const ConstBufferSequence & buffers, WriteHandler && handler)
+	{
+#if defined(SERVED_TLS)
+		if ( _tls )
+		{
+			_tls->async_write_some(buffers, std::forward<WriteHandler>(handler));
+			return;
+		}
+#endif
+		_socket.async_write_some(buffers, std::forward<WriteHandler>(handler));
+	}
+};
+
+} } // net, served
+
+#endif // SERVED_TRANSPORT_HPP
@@ -38,6 +38,12 @@ parameters::set(std::string const& key, std::string const& value)
 	_list[key] = value;
 }
 
+void
+parameters::clear()
+{
+	_list.clear();
+}
+
 //  -----  parameter accessors  -----
 
 const std::string
@@ -69,6 +69,11 @@ public:
 	 */
 	void set(std::string const& key, std::string const& value);
 
+	/*
+	 * Remove all parameters.
+	 */
+	void clear();
+
 	//  -----  parameter accessors  -----
 
 	/*
@@ -41,19 +41,21 @@ namespace served { namespace plugin {
 void access_log(served::response & res, const served::request & request);
 
 /*
- * NOT IMPLEMENTED: Generates a static file handler.
+ * Generates a static file handler.
  *
  * Provide a file directory and an optional base path to trim from request resources and a static
- * file server for that directory is generated.
+ * file server for that directory is generated. Files are sent with sendfile(2) where supported,
+ * so their contents are never copied through user space. Open file descriptors are cached for a
+ * short time to live. Paths which would escape the directory are rejected, and a directory
+ * resolves to its index.html. Register the handler for both GET and HEAD.
  *
  * @param file_directory the path to search for files within
  * @param base_path an optional string to trim from the start of request resource paths
+ * @param cache_ttl_ms how long open files are cached in milliseconds, 0 disables the cache
  * @return the static file handler to register
  */
-/*
 std::function<void(served::response &, const served::request &)>
-file_server(const std::string & file_directory, const std::string & base_path = "");
-*/
+file_server(const std::string & file_directory, const std::string & base_path = "", int cache_ttl_ms = 1000);
 
 } } // plugin, served
 
@@ -0,0 +1,327 @@
+/*
+ * Copyright (C) 2021 QM Ltd.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <climits>
+#include <cstdlib>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <served/plugins.hpp>
+#include <served/request_error.hpp>
+#include <served/status.hpp>
+#include <served/uri.hpp>
+
+namespace served { namespace plugin {
+
+namespace {
+
+//  -----  content types  -----
+
+const std::string &
+content_type_for(const std::string & path)
+{
+	static const std::string default_type("application/octet-stream");
+	static const std::unordered_map<std::string, std::string> types = {
+		{ "html",  "text/html; charset=utf-8"        },
+		{ "htm",   "text/html; charset=utf-8"        },
+		{ "css",   "text/css; charset=utf-8"         },
+		{ "js",    "application/javascript"          },
+		{ "mjs",   "application/javascript"          },
+		{ "json",  "application/json"                },
+		{ "map",   "application/json"                },
+		{ "txt",   "text/plain; charset=utf-8"       },
+		{ "csv",   "text/csv; charset=utf-8"         },
+		{ "xml",   "application/xml"                 },
+		{ "svg",   "image/svg+xml"                   },
+		{ "png",   "image/png"                       },
+		{ "jpg",   "image/jpeg"                      },
+		{ "jpeg",  "image/jpeg"                      },
+		{ "gif",   "image/gif"                       },
+		{ "webp",  "image/webp"                      },
+		{ "ico",   "image/x-icon"                    },
+		{ "woff",  "font/woff"                       },
+		{ "woff2", "font/woff2"                      },
+		{ "ttf",   "font/ttf"                        },
+		{ "wasm",  "application/wasm"                },
+		{ "pdf",   "application/pdf"                 },
+		{ "zip",   "application/zip"                 },
+		{ "gz",    "application/gzip"                },
+		{ "tar",   "application/x-tar"               },
+	};
+
+	const auto slash = path.find_last_of('/');
+	const auto dot   = path.find_last_of('.');
+	if ( dot == std::string::npos || ( slash != std::string::npos && dot < slash ) )
+	{
+		return default_type;
+	}
+
+	std::string ext = path.substr(dot + 1);
+	std::transform(ext.begin(), ext.end(), ext.begin(), [](unsigned char c) {
+		return std::tolower(c);
+	});
+
+	const auto it = types.find(ext);
+	return it == types.end() ? default_type : it->second;
+}
+
+//  -----  path resolution  -----
+
+/*
+ * Returns the canonical absolute form of a path, or an empty string if it does not exist.
+ */
+std::string
+canonical_path(const std::string & path)
+{
+	char resolved[PATH_MAX];
+	if ( ::realpath(path.c_str(), resolved) == nullptr )
+	{
+		return "";
+	}
+	return resolved;
+}
+
+/*
+ * Validates a decoded request path, rejecting any path that could escape the served directory.
+ */
+bool
+is_safe_path(const std::string & path)
+{
+	if ( path.find('\0') != std::string::npos || path.find('\\') != std::string::npos )
+	{
+		return false;
+	}
+
+	size_t start = 0;
+	while ( start <= path.size() )
+	{
+		size_t end = path.find('/', start);
+		if ( end == std::string::npos )
+		{
+			end = path.size();
+		}
+		if ( path.compare(start, end - start, "..") == 0 )
+		{
+			return false;
+		}
+		start = end + 1;
+	}
+	return true;
+}
+
+//  -----  file cache  -----
+
+/*
+ * A cache of open file descriptors and their stat results, keyed by request path.
+ *
+ * Entries are kept for a short time to live so that popular files avoid the open and stat
+ * calls, while changes on disk are still picked up shortly after. File handles are shared so
+ * an evicted entry stays open until every response sending it has been written.
+ */
+class file_cache
+{
+public:
+	struct entry
+	{
+		served::file_handle_ptr               file;
+		size_t                                size;
+		std::string                           path;
+		std::chrono::steady_clock::time_point expires;
+	};
+
+private:
+	const std::string                      _root;
+	const std::chrono::milliseconds        _ttl;
+	const size_t                           _max_entries;
+	std::mutex                             _mutex;
+	std::unordered_map<std::string, entry> _entries;
+
+public:
+	file_cache(const std::string & root, int ttl_ms, size_t max_entries)
+		: _root(canonical_path(root))
+		, _ttl(ttl_ms)
+		, _max_entries(max_entries)
+	{}
+
+	/*
+	 * Finds the file for a request path, opening and caching it when not already cached.
+	 *
+	 * @param path the decoded request path relative to the served directory
+	 * @param result the entry for the file, set when found
+	 * @return true if a regular file was found within the served directory
+	 */
+	bool
+	find(const std::string & path, entry & result)
+	{
+		const auto now = std::chrono::steady_clock::now();
+
+		if ( _ttl.count() > 0 )
+		{
+			std::lock_guard<std::mutex> lock(_mutex);
+
+			auto it = _entries.find(path);
+			if ( it != _entries.end() && it->second.expires > now )
+			{
+				result = it->second;
+				return true;
+			}
+		}
+
+		if ( ! open(path, result) )
+		{
+			return false;
+		}
+		result.expires = now + _ttl;
+
+		if ( _ttl.count() > 0 )
+		{
+			std::lock_guard<std::mutex> lock(_mutex);
+
+			if ( _entries.size() >= _max_entries )
+			{
+				evict(now);
+			}
+			_entries[path] = result;
+		}
+		return true;
+	}
+
+private:
+	bool
+	open(const std::string & path, entry & result)
+	{
+		if ( _root.empty() )
+		{
+			return false;
+		}
+
+		std::string full = canonical_path(_root + "/" + path);
+
+		// Symbolic links may still lead out of the served directory, so check the resolved path.
+		if ( full.empty() || ( full != _root && full.compare(0, _root.size() + 1, _root + "/") != 0 ) )
+		{
+			return false;
+		}
+
+		struct stat st;
+		if ( ::stat(full.c_str(), &st) != 0 )
+		{
+			return false;
+		}
+		if ( S_ISDIR(st.st_mode) )
+		{
+			return ! path.empty() && path.back() == '/' ? open(path + "index.html", result)
+			                                            : open(path + "/index.html", result);
+		}
+		if ( ! S_ISREG(st.st_mode) )
+		{
+			return false;
+		}
+
+		int fd = ::open(full.c_str(), O_RDONLY | O_CLOEXEC);
+		if ( fd < 0 )
+		{
+			return false;
+		}
+
+		result.file = std::make_shared<served::file_handle>(fd);
+
+		// Stat the descriptor that will be sent in case the file was replaced in between.
+		if ( ::fstat(fd, &st) != 0 || ! S_ISREG(st.st_mode) )
+		{
+			return false;
+		}
+
+		result.size = st.st_size;
+		result.path = full;
+		return true;
+	}
+
+	void
+	evict(std::chrono::steady_clock::time_point now)
+	{
+		for ( auto it = _entries.begin(); it != _entries.end(); )
+		{
+			if ( it->second.expires <= now )
+			{
+				it = _entries.erase(it);
+			}
+			else
+			{
+				++it;
+			}
+		}
+		if ( _entries.size() >= _max_entries )
+		{
+			_entries.clear();
+		}
+	}
+};
+
+} // anonymous namespace
+
+std::function<void(served::response &, const served::request &)>
+file_server(const std::string & file_directory, const std::string & base_path, int cache_ttl_ms)
+{
+	auto cache = std::make_shared<file_cache>(file_directory, cache_ttl_ms, 1024);
+
+	return [cache, base_path](served::response & res, const served::request & req) {
+		std::string resource = req.url().path();
+
+		if ( resource.compare(0, base_path.size(), base_path) != 0 )
+		{
+			throw served::request_error(served::status_4XX::NOT_FOUND, "Not found");
+		}
+		resource = query_unescape(resource.substr(base_path.size()));
+
+		if ( ! is_safe_path(resource) )
+		{
+			throw served::request_error(served::status_4XX::NOT_FOUND, "Not found");
+		}
+
+		file_cache::entry file;
+		if ( ! cache->find(resource, file) )
+		{
+			throw served::request_error(served::status_4XX::NOT_FOUND, "Not found");
+		}
+
+		res.set_header("Content-Type", content_type_for(file.path));
+
+		if ( req.method() == served::method::HEAD )
+		{
+			res.set_header("Content-Length", std::to_string(file.size));
+			return;
+		}
+
+		res.set_file_body(file.file, 0, file.size);
+	};
+}
+
+} } // plugin, served
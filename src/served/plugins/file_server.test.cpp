@@ -0,0 +1,127 @@
+/*
+ * Copyright (C) 2021 QM Ltd.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <test/catch.hpp>
+
+#include <served/plugins.hpp>
+#include <served/request_error.hpp>
+
+#include <cstdio>
+#include <fstream>
+
+#include <stdlib.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+
+served::request
+make_request(served::method method, const std::string & path)
+{
+	served::request req;
+	req.set_method(method);
+	req.url().set_path(path);
+	return req;
+}
+
+int
+status_of(const std::function<void(served::response &, const served::request &)> & handler,
+          const served::request & req)
+{
+	served::response res;
+	try
+	{
+		handler(res, req);
+	}
+	catch (const served::request_error & e)
+	{
+		return e.get_status_code();
+	}
+	return res.status();
+}
+
+} // anonymous namespace
+
+TEST_CASE("file server plugin", "[plugins]")
+{
+	char dir_template[] = "/tmp/served_file_server_test_XXXXXX";
+	const std::string dir = ::mkdtemp(dir_template);
+	const std::string secret = dir + "_secret.txt";
+
+	::mkdir((dir + "/ui").c_str(), 0700);
+	std::ofstream(dir + "/model.json") << "{\"weights\":[1,2,3]}";
+	std::ofstream(dir + "/ui/index.html") << "<html></html>";
+	std::ofstream(secret) << "secret";
+	REQUIRE(::symlink(secret.c_str(), (dir + "/link.txt").c_str()) == 0);
+
+	auto handler = served::plugin::file_server(dir, "/static");
+
+	SECTION("serves files with their content type")
+	{
+		served::response res;
+		handler(res, make_request(served::method::GET, "/static/model.json"));
+
+		CHECK(res.status() == 200);
+		CHECK(res.body_size() == 19);
+		CHECK(res.file_body() != nullptr);
+
+		auto data = res.to_buffer();
+		CHECK(data.find("Content-Type: application/json\r\n") != std::string::npos);
+		CHECK(data.substr(data.size() - 19) == "{\"weights\":[1,2,3]}");
+	}
+
+	SECTION("serves index.html for directories")
+	{
+		served::response res;
+		handler(res, make_request(served::method::GET, "/static/ui/"));
+
+		auto data = res.to_buffer();
+		CHECK(data.find("Content-Type: text/html; charset=utf-8\r\n") != std::string::npos);
+		CHECK(data.substr(data.size() - 13) == "<html></html>");
+	}
+
+	SECTION("HEAD requests receive the length without a body")
+	{
+		served::response res;
+		handler(res, make_request(served::method::HEAD, "/static/model.json"));
+
+		CHECK(res.file_body() == nullptr);
+		CHECK(res.body_size() == 0);
+		CHECK(res.to_buffer().find("Content-Length: 19\r\n") != std::string::npos);
+	}
+
+	SECTION("paths outside of the directory are not found")
+	{
+		CHECK(status_of(handler, make_request(served::method::GET, "/static/missing.txt")) == 404);
+		CHECK(status_of(handler, make_request(served::method::GET, "/static/../" + secret.substr(5))) == 404);
+		CHECK(status_of(handler, make_request(served::method::GET, "/static/ui/%2e%2e/%2e%2e/etc/passwd")) == 404);
+		CHECK(status_of(handler, make_request(served::method::GET, "/static/link.txt")) == 404);
+		CHECK(status_of(handler, make_request(served::method::GET, "/other/model.json")) == 404);
+	}
+
+	::unlink((dir + "/link.txt").c_str());
+	::unlink((dir + "/model.json").c_str());
+	::unlink((dir + "/ui/index.html").c_str());
+	::rmdir((dir + "/ui").c_str());
+	::rmdir(dir.c_str());
+	::unlink(secret.c_str());
+}
@@ -21,24 +21,98 @@
  */
 
 #include <algorithm>
+#include <cctype>
 #include <locale>
+#include <utility>
 
 #include <served/request.hpp>
 
 namespace served {
 
+namespace {
+
+std::string
+to_lower(string_view header)
+{
+	std::string mut_header(header.data(), header.size());
+	std::transform(mut_header.begin(), mut_header.end(), mut_header.begin(), ::tolower);
+	return mut_header;
+}
+
+bool
+equals_ignore_case(string_view a, string_view b)
+{
+	if ( a.size() != b.size() )
+	{
+		return false;
+	}
+	for ( size_t i = 0; i < a.size(); ++i )
+	{
+		if ( ::tolower((unsigned char) a[i]) != ::tolower((unsigned char) b[i]) )
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+} // anonymous namespace
+
 //  -----  constructors  -----
 
+request::request()
+	: _method(served::method::GET)
+{}
+
+request::request(const request & other)
+	: _method(other._method)
+	, _destination(other._destination)
+	, _HTTP_version(other._HTTP_version)
+	, _source(other._source)
+	, _headers(other._headers)
+	, _header_views()
+	, _body(other._body)
+	, params(other.params)
+	, query(other.query)
+{
+	own_header_views(other._header_views);
+}
+
+request &
+request::operator=(const request & other)
+{
+	if ( this != &other )
+	{
+		_method       = other._method;
+		_destination  = other._destination;
+		_HTTP_version = other._HTTP_version;
+		_source       = other._source;
+		_headers      = other._headers;
+		_body         = other._body;
+		params        = other.params;
+		query         = other.query;
+
+		_header_views.clear();
+		own_header_views(other._header_views);
+	}
+	return *this;
+}
+
 //  -----  mutators  -----
 
 void
 request::clear()
 {
 	_method = served::method::GET;
-	_destination = uri();
+	_destination.clear();
 	_HTTP_version = "";
 	_source = "";
-	_body = "";
+	_headers.clear();
+	_header_views.clear();
+	// Each body is moved in from the parser, so the memory of the last is freed rather than kept.
+	std::string().swap(_body);
+	params.clear();
+	query.clear();
 }
 
 void
@@ -77,12 +151,34 @@ request::set_header(const std::string & header, const std::string & value)
 	_headers[mut_header] = value;
 }
 
+void
+request::add_header_view(string_view header, string_view value)
+{
+	_header_views.emplace_back(header, value);
+}
+
+void
+request::own_header_views(const header_view_list & views)
+{
+	for ( const auto & field : views )
+	{
+		// emplace leaves a header that is already set untouched.
+		_headers.emplace(to_lower(field.first), field.second.to_string());
+	}
+}
+
 void
 request::set_body(const std::string & body)
 {
 	_body = body;
 }
 
+void
+request::set_body(std::string && body)
+{
+	_body = std::move(body);
+}
+
 uri &
 request::url()
 {
@@ -118,21 +214,34 @@ request::source() const
 const std::string
 request::header(std::string const& header) const
 {
-	// All headers set to lower case.
-	std::string mut_header;
-	mut_header.resize(header.size());
+	return header_view(header).to_string();
+}
 
-	std::transform(header.begin(), header.end(), mut_header.begin(), ::tolower);
+string_view
+request::header_view(string_view header) const
+{
+	if ( ! _headers.empty() )
+	{
+		// All headers set to lower case.
+		header_list::const_iterator it = _headers.find(to_lower(header));
+		if ( it != _headers.end() )
+		{
+			return it->second;
+		}
+	}
 
-	header_list::const_iterator it = _headers.find(mut_header);
-	if ( it != _headers.end() )
+	// Few enough headers are sent that a scan beats hashing the name.
+	for ( const auto & field : _header_views )
 	{
-		return it->second;
+		if ( equals_ignore_case(field.first, header) )
+		{
+			return field.second;
+		}
 	}
-	return std::string();
+	return string_view();
 }
 
-const std::string
+const std::string &
 request::body() const
 {
 	return _body;
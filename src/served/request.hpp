@@ -25,10 +25,13 @@
 
 #include <string>
 #include <unordered_map>
+#include <utility>
+#include <vector>
 
 #include <served/methods.hpp>
 #include <served/uri.hpp>
 #include <served/parameters.hpp>
+#include <served/string_view.hpp>
 
 namespace served {
 
@@ -42,20 +45,43 @@ namespace served {
  * This class is typically created by the request parser when a request is
  * received. The new object is then passed to method handlers that were registered
  * by the user to the multiplexer.
+ *
+ * Headers parsed from a connection are not copied, the request refers to them in the header
+ * buffer of the connection until it is cleared. Copying a request copies these headers, so a
+ * handler that needs a request beyond the lifetime of the call should take a copy.
  */
 class request
 {
 	// Appropriate map type for request may differ from response
 	typedef std::unordered_map<std::string, std::string> header_list;
 
-	enum method _method;
-	uri         _destination;
-	std::string _HTTP_version;
-	std::string _source;
-	header_list _headers;
-	std::string _body;
+	// Headers held in a buffer owned by someone else, names are kept as received
+	typedef std::vector<std::pair<string_view, string_view>> header_view_list;
+
+	enum method      _method;
+	uri              _destination;
+	std::string      _HTTP_version;
+	std::string      _source;
+	header_list      _headers;
+	header_view_list _header_views;
+	std::string      _body;
 
 public:
+	//  -----  constructors  -----
+
+	request();
+
+	/*
+	 * Copies a request, along with its own copy of any headers that refer to a buffer.
+	 */
+	request(const request & other);
+
+	request(request && other) = default;
+
+	request & operator=(const request & other);
+
+	request & operator=(request && other) = default;
+
 	//  -----  mutators  -----
 
 	/*
@@ -106,6 +132,17 @@ public:
 	 */
 	void set_header(const std::string & header, const std::string & value);
 
+	/*
+	 * Add a header to this request without copying it.
+	 *
+	 * The name and value must remain valid until the request is cleared. Headers set with
+	 * set_header take precedence over those added here.
+	 *
+	 * @param header the key of the header, in any case
+	 * @param value the value of the header
+	 */
+	void add_header_view(string_view header, string_view value);
+
 	/*
 	 * Set the body of the request.
 	 *
@@ -113,6 +150,13 @@ public:
 	 */
 	void set_body(const std::string & body);
 
+	/*
+	 * Set the body of the request, taking ownership of the string rather than copying it.
+	 *
+	 * @param body the body of the request
+	 */
+	void set_body(std::string && body);
+
 	/*
 	 * Obtain a reference to the URL of this request.
 	 *
@@ -159,12 +203,44 @@ public:
 	 */
 	const std::string header(std::string const& header) const;
 
+	/*
+	 * Get a header value from this request without copying it.
+	 *
+	 * The view is valid until the request is cleared or the header is set again, use header() to
+	 * obtain a copy.
+	 *
+	 * @param header the key of the header to obtain
+	 *
+	 * @return either the header value, or an empty view if the header does not exist
+	 */
+	string_view header_view(string_view header) const;
+
 	/*
 	 * Get the body of the request.
 	 *
 	 * @return the body of the request
 	 */
-	const std::string body() const;
+	const std::string & body() const;
+
+	/*
+	 * Get the number of bytes allocated by the request body and header views.
+	 *
+	 * The header views keep their memory when the request is cleared, while the body is freed.
+	 *
+	 * @return the allocated capacity of the request buffers
+	 */
+	size_t capacity() const
+	{
+		return _body.capacity() + _header_views.capacity() * sizeof(header_view_list::value_type);
+	}
+
+private:
+	/*
+	 * Copy headers that refer to a buffer into the headers owned by this request.
+	 *
+	 * @param views the headers to copy, those already set take precedence
+	 */
+	void own_header_views(const header_view_list & views);
 
 public:
 	//  -----  public members  -----
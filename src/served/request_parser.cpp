@@ -24,16 +24,20 @@
 
 #include <served/request_parser.hpp>
 
-#define LEN(AT, FPC) (FPC - buffer - AT)
-#define MARK(M,FPC) (M = (FPC) - buffer)
-#define PTR_TO(F) (buffer + F)
+#include <cstddef> // ptrdiff_t
+
+// Marks are offsets into all of the input since the parser was reset, d_offset being the offset of
+// the current buffer. A mark from an earlier call resolves to memory just before the buffer.
+#define LEN(AT, FPC) (FPC - buffer + d_offset - AT)
+#define MARK(M,FPC) (M = (FPC) - buffer + d_offset)
+#define PTR_TO(F) (buffer + (static_cast<std::ptrdiff_t>(F) - static_cast<std::ptrdiff_t>(d_offset)))
 
 using namespace served;
 
 /** Machine **/
 
 
-#line 37 "/home/vagrant/src/dev/served/src/served/request_parser.cpp"
+#line 41 "/home/vagrant/src/dev/served/src/served/request_parser.cpp"
 static const int request_parser_start = 1;
 static const int request_parser_first_final = 194;
 static const int request_parser_error = 0;
@@ -41,45 +45,59 @@ static const int request_parser_error = 0;
 static const int request_parser_en_main = 1;
 
 
-#line 224 "/home/vagrant/src/dev/served/src/served/request_parser.rl"
+#line 228 "/home/vagrant/src/dev/served/src/served/request_parser.rl"
 
 
 request_parser::request_parser()
 	: cs(0)
 	, d_offset(0)
+	, mark(0)
+	, field_start(0)
+	, field_len(0)
+	, query_start(0)
 {
 	// Ragel generates an unused constant for the entry point.
 	// The following will suppress the resulting warning.
 	(void) request_parser_en_main;
 
-#line 53 "/home/vagrant/src/dev/served/src/served/request_parser.cpp"
+#line 64 "/home/vagrant/src/dev/served/src/served/request_parser.cpp"
 	{
 	cs = request_parser_start;
 	}
 
-#line 231 "/home/vagrant/src/dev/served/src/served/request_parser.rl"
+#line 242 "/home/vagrant/src/dev/served/src/served/request_parser.rl"
 }
 
 request_parser::~request_parser()
 {}
 
+void
+request_parser::reset()
+{
+	d_offset = 0;
+	mark = 0;
+	field_start = 0;
+	field_len = 0;
+	query_start = 0;
+
+#line 84 "/home/vagrant/src/dev/served/src/served/request_parser.cpp"
+	{
+	cs = request_parser_start;
+	}
+
+#line 256 "/home/vagrant/src/dev/served/src/served/request_parser.rl"
+}
+
 size_t
 request_parser::execute(const char *buffer, size_t len)
 {
-	//int    content_len;
-	size_t nread = 0;
-	size_t mark = 0;
-	size_t field_start = 0;
-	size_t field_len = 0;
-	size_t query_start = 0;
-
 	if(len == 0) return 0;
 
-	const char *p  = buffer+d_offset;
+	const char *p  = buffer;
 	const char *pe = buffer+len;
 
 
-#line 80 "/home/vagrant/src/dev/served/src/served/request_parser.cpp"
+#line 101 "/home/vagrant/src/dev/served/src/served/request_parser.cpp"
 	{
 	if ( p == pe )
 		goto _test_eof;
@@ -96,7 +114,7 @@ st0:
 cs = 0;
 	goto _out;
 tr0:
-#line 37 "/home/vagrant/src/dev/served/src/served/request_parser.rl"
+#line 41 "/home/vagrant/src/dev/served/src/served/request_parser.rl"
 	{
 		MARK(mark, p);
 	}
@@ -105,7 +123,7 @@ st2:
 	if ( ++p == pe )
 		goto _test_eof2;
 case 2:
-#line 106 "/home/vagrant/src/dev/served/src/served/request_parser.cpp"
+#line 127 "/home/vagrant/src/dev/served/src/served/request_parser.cpp"
 	if ( (*p) == 32 )
 		goto tr2;
 	if ( (*p) > 57 ) {
@@ -115,7 +133,7 @@ case 2:
 		goto st175;
 	goto st0;
 tr2:
-#line 62 "/home/vagrant/src/dev/served/src/served/request_parser.rl"
+#line 66 "/home/vagrant/src/dev/served/src/served/request_parser.rl"
 	{
 		request_method(buffer, PTR_TO(mark), LEN(mark, p));
 	}
@@ -124,7 +142,7 @@ st3:
 	if ( ++p == pe )
 		goto _test_eof3;
 case 3:
-#line 125 "/home/vagrant/src/dev/served/src/served/request_parser.cpp"
+#line 146 "/home/vagrant/src/dev/served/src/served/request_parser.cpp"
 	switch( (*p) ) {
 		case 32: goto tr4;
 		case 33: goto tr5;
@@ -148,65 +166,65 @@ case 3:
 		goto tr10;
 	goto st0;
 tr4:
-#line 37 "/home/vagrant/src/dev/served/src/served/request_parser.rl"
+#line 41 "/home/vagrant/src/dev/served/src/served/request_parser.rl"
 	{
 		MARK(mark, p);
 	}
-#line 92 "/home/vagrant/src/dev/served/src/served/request_parser.rl"
+#line 96 "/home/vagrant/src/dev/served/src/served/request_parser.rl"
 	{
 		request_path(buffer, PTR_TO(mark), LEN(mark,p));
 	}
-#line 67 "/home/vagrant/src/dev/served/src/served/request_parser.rl"
+#line 71 "/home/vagrant/src/dev/served/src/served/request_parser.rl"
 	{
 		request_uri(buffer, PTR_TO(mark), LEN(mark, p));
 	}
 	goto st4;
 tr35:
-#line 92 "/home/vagrant/src/dev/served/src/served/request_parser.rl"
+#line 96 "/home/vagrant/src/dev/served/src/served/request_parser.rl"
 	{
 		request_path(buffer, PTR_TO(mark), LEN(mark,p));
 	}
-#line 67 "/home/vagrant/src/dev/served/src/served/request_parser.rl"
+#line 71 "/home/vagrant/src/dev/served/src/served/request_parser.rl"
 	{
 		request_uri(buffer, PTR_TO(mark), LEN(mark, p));
 	}
 	goto st4;
 tr41:
-#line 37 "/home/vagrant/src/dev/served/src/served/request_parser.rl"
+#line 41 "/home/vagrant/src/dev/served/src/served/request_parser.rl"
 	{
 		MARK(mark, p);
 	}
-#line 72 "/home/vagrant/src/dev/served/src/served/request_parser.rl"
+#line 76 "/home/vagrant/src/dev/served/src/served/request_parser.rl"
 	{
 		fragment(buffer, PTR_TO(mark), LEN(mark, p));
 	}
 	goto st4;
 tr44:
-#line 72 "/home/vagrant/src/dev/served/src/served/request_parser.rl"
+#line 76 "/home/vagrant/src/dev/served/src/served/request_parser.rl"
 	{
 		fragment(buffer, PTR_TO(mark), LEN(mark, p));
 	}
 	goto st4;
 tr51:
-#line 77 "/home/vagrant/src/dev/served/src/served/request_parser.rl"
+#line 81 "/home/vagrant/src/dev/served/src/served/request_parser.rl"
 	{
 		MARK(query_start, p);
 	}
-#line 82 "/home/vagrant/src/dev/served/src/served/request_parser.rl"
+#line 86 "/home/vagrant/src/dev/served/src/served/request_parser.rl"
 	{
 		query_string(buffer, PTR_TO(query_start), LEN(query_start, p));
 	}
-#line 67 "/home/vagrant/src/dev/served/src/served/request_parser.rl"
+#line 71 "/home/vagrant/src/dev/served/src/served/request_parser.rl"
 	{
 		request_uri(buffer, PTR_TO(mark), LEN(mark, p));
 	}
 	goto st4;
 tr55:
-#line 82 "/home/vagrant/src/dev/served/src/served/request_parser.rl"
+#line 86 "/home/vagrant/src/dev/served/src/served/request_parser.rl"
 	{
 		query_string(buffer, PTR_TO(query_start), LEN(query_start, p));
 	}
-#line 67 "/home/vagrant/src/dev/served/src/served/request_parser.rl"
+#line 71 "/home/vagrant/src/dev/served/src/served/request_parser.rl"
 	{
 		request_uri(buffer, PTR_TO(mark), LEN(mark, p));
 	}
@@ -215,12 +233,12 @@ st4:
 	if ( ++p == pe )
 		goto _test_eof4;
 case 4:
-#line 216 "/home/vagrant/src/dev/served/src/served/request_parser.cpp"
+#line 237 "/home/vagrant/src/dev/served/src/served/request_parser.cpp"
 	if ( (*p) == 72 )
 		goto tr11;
 	goto st0;
 tr11:
-#line 37 "/home/vagrant/src/dev/served/src/served/request_parser.rl"
+#line 41 "/home/vagrant/src/dev/served/src/served/request_parser.rl"
 	{
 		MARK(mark, p);
 	}
@@ -229,7 +247,7 @@ st5:
 	if ( ++p == pe )
 		goto _test_eof5;
 case 5:
-#line 230 "/home/vagrant/src/dev/served/src/served/request_parser.cpp"
+#line 251 "/home/vagrant/src/dev/served/src/served/request_parser.cpp"
 	if ( (*p) == 84 )
 		goto st6;
 	goto st0;
@@ -285,23 +303,23 @@ case 12:
 	}
 	goto st0;
 tr19:
-#line 87 "/home/vagrant/src/dev/served/src/served/request_parser.rl"
+#line 91 "/home/vagrant/src/dev/served/src/served/request_parser.rl"
 	{
 		http_version(buffer, PTR_TO(mark), LEN(mark, p));
 	}
 	goto st13;
 tr28:
-#line 52 "/home/vagrant/src/dev/served/src/served/request_parser.rl"
+#line 56 "/home/vagrant/src/dev/served/src/served/request_parser.rl"
 	{
 		MARK(mark, p);
 	}
-#line 57 "/home/vagrant/src/dev/served/src/served/request_parser.rl"
+#line 61 "/home/vagrant/src/dev/served/src/served/request_parser.rl"
 	{
 		http_field(buffer, PTR_TO(field_start), field_len, PTR_TO(mark), LEN(mark, p));
 	}
 	goto st13;
 tr31:
-#line 57 "/home/vagrant/src/dev/served/src/served/request_parser.rl"
+#line 61 "/home/vagrant/src/dev/served/src/served/request_parser.rl"
 	{
 		http_field(buffer, PTR_TO(field_start), field_len, PTR_TO(mark), LEN(mark, p));
 	}
@@ -310,7 +328,7 @@ st13:
 	if ( ++p == pe )
 		goto _test_eof13;
 case 13:
-#line 311 "/home/vagrant/src/dev/served/src/served/request_parser.cpp"
+#line 332 "/home/vagrant/src/dev/served/src/served/request_parser.cpp"
 	switch( (*p) ) {
 		case 10: goto tr22;
 		case 13: goto tr23;
@@ -343,7 +361,7 @@ case 13:
 		goto tr21;
 	goto st0;
 tr21:
-#line 42 "/home/vagrant/src/dev/served/src/served/request_parser.rl"
+#line 46 "/home/vagrant/src/dev/served/src/served/request_parser.rl"
 	{
 		MARK(field_start, p);
 	}
@@ -352,7 +370,7 @@ st14:
 	if ( ++p == pe )
 		goto _test_eof14;
 case 14:
-#line 353 "/home/vagrant/src/dev/served/src/served/request_parser.cpp"
+#line 374 "/home/vagrant/src/dev/served/src/served/request_parser.cpp"
 	switch( (*p) ) {
 		case 33: goto st14;
 		case 58: goto tr25;
@@ -384,13 +402,13 @@ case 14:
 		goto st14;
 	goto st0;
 tr25:
-#line 47 "/home/vagrant/src/dev/served/src/served/request_parser.rl"
+#line 51 "/home/vagrant/src/dev/served/src/served/request_parser.rl"
 	{
 		field_len = LEN(field_start, p);
 	}
 	goto st15;
 tr27:
-#line 52 "/home/vagrant/src/dev/served/src/served/request_parser.rl"
+#line 56 "/home/vagrant/src/dev/served/src/served/request_parser.rl"
 	{
 		MARK(mark, p);
 	}
@@ -399,7 +417,7 @@ st15:
 	if ( ++p == pe )
 		goto _test_eof15;
 case 15:
-#line 400 "/home/vagrant/src/dev/served/src/served/request_parser.cpp"
+#line 421 "/home/vagrant/src/dev/served/src/served/request_parser.cpp"
 	switch( (*p) ) {
 		case 0: goto st0;
 		case 9: goto tr27;
@@ -410,7 +428,7 @@ case 15:
 	}
 	goto tr26;
 tr26:
-#line 52 "/home/vagrant/src/dev/served/src/served/request_parser.rl"
+#line 56 "/home/vagrant/src/dev/served/src/served/request_parser.rl"
 	{
 		MARK(mark, p);
 	}
@@ -419,7 +437,7 @@ st16:
 	if ( ++p == pe )
 		goto _test_eof16;
 case 16:
-#line 420 "/home/vagrant/src/dev/served/src/served/request_parser.cpp"
+#line 441 "/home/vagrant/src/dev/served/src/served/request_parser.cpp"
 	switch( (*p) ) {
 		case 0: goto st0;
 		case 10: goto tr31;
@@ -428,23 +446,23 @@ case 16:
 	}
 	goto st16;
 tr20:
-#line 87 "/home/vagrant/src/dev/served/src/served/request_parser.rl"
+#line 91 "/home/vagrant/src/dev/served/src/served/request_parser.rl"
 	{
 		http_version(buffer, PTR_TO(mark), LEN(mark, p));
 	}
 	goto st17;
 tr29:
-#line 52 "/home/vagrant/src/dev/served/src/served/request_parser.rl"
+#line 56 "/home/vagrant/src/dev/served/src/served/request_parser.rl"
 	{
 		MARK(mark, p);
 	}
-#line 57 "/home/vagrant/src/dev/served/src/served/request_parser.rl"
+#line 61 "/home/vagrant/src/dev/served/src/served/request_parser.rl"
 	{
 		http_field(buffer, PTR_TO(field_start), field_len, PTR_TO(mark), LEN(mark, p));
 	}
 	goto st17;
 tr32:
-#line 57 "/home/vagrant/src/dev/served/src/served/request_parser.rl"
+#line 61 "/home/vagrant/src/dev/served/src/served/request_parser.rl"
 	{
 		http_field(buffer, PTR_TO(field_start), field_len, PTR_TO(mark), LEN(mark, p));
 	}
@@ -453,23 +471,23 @@ st17:
 	if ( ++p == pe )
 		goto _test_eof17;
 case 17:
-#line 454 "/home/vagrant/src/dev/served/src/served/request_parser.cpp"
+#line 475 "/home/vagrant/src/dev/served/src/served/request_parser.cpp"
 	if ( (*p) == 10 )
 		goto st13;
 	goto st0;
 tr22:
-#line 42 "/home/vagrant/src/dev/served/src/served/request_parser.rl"
+#line 46 "/home/vagrant/src/dev/served/src/served/request_parser.rl"
 	{
 		MARK(field_start, p);
 	}
-#line 97 "/home/vagrant/src/dev/served/src/served/request_parser.rl"
+#line 101 "/home/vagrant/src/dev/served/src/served/request_parser.rl"
 	{
 		header_done(buffer, p + 1, pe - p - 1);
 		{p++; cs = 194; goto _out;}
 	}
 	goto st194;
 tr34:
-#line 97 "/home/vagrant/src/dev/served/src/served/request_parser.rl"
+#line 101 "/home/vagrant/src/dev/served/src/served/request_parser.rl"
 	{
 		header_done(buffer, p + 1, pe - p - 1);
 		{p++; cs = 194; goto _out;}
@@ -479,7 +497,7 @@ st194:
 	if ( ++p == pe )
 		goto _test_eof194;
 case 194:
-#line 480 "/home/vagrant/src/dev/served/src/served/request_parser.cpp"
+#line 501 "/home/vagrant/src/dev/served/src/served/request_parser.cpp"
 	switch( (*p) ) {
 		case 33: goto st14;
 		case 58: goto tr25;
@@ -511,7 +529,7 @@ case 194:
 		goto st14;
 	goto st0;
 tr23:
-#line 42 "/home/vagrant/src/dev/served/src/served/request_parser.rl"
+#line 46 "/home/vagrant/src/dev/served/src/served/request_parser.rl"
 	{
 		MARK(field_start, p);
 	}
@@ -520,7 +538,7 @@ st18:
 	if ( ++p == pe )
 		goto _test_eof18;
 case 18:
-#line 521 "/home/vagrant/src/dev/served/src/served/request_parser.cpp"
+#line 542 "/home/vagrant/src/dev/served/src/served/request_parser.cpp"
 	switch( (*p) ) {
 		case 10: goto tr34;
 		case 33: goto st14;
@@ -553,7 +571,7 @@ case 18:
 		goto st14;
 	goto st0;
 tr5:
-#line 37 "/home/vagrant/src/dev/served/src/served/request_parser.rl"
+#line 41 "/home/vagrant/src/dev/served/src/served/request_parser.rl"
 	{
 		MARK(mark, p);
 	}
@@ -562,7 +580,7 @@ st19:
 	if ( ++p == pe )
 		goto _test_eof19;
 case 19:
-#line 563 "/home/vagrant/src/dev/served/src/served/request_parser.cpp"
+#line 584 "/home/vagrant/src/dev/served/src/served/request_parser.cpp"
 	switch( (*p) ) {
 		case 32: goto tr35;
 		case 33: goto st19;
@@ -585,49 +603,49 @@ case 19:
 		goto st19;
 	goto st0;
 tr6:
-#line 37 "/home/vagrant/src/dev/served/src/served/request_parser.rl"
+#line 41 "/home/vagrant/src/dev/served/src/served/request_parser.rl"
 	{
 		MARK(mark, p);
 	}
-#line 92 "/home/vagrant/src/dev/served/src/served/request_parser.rl"
+#line 96 "/home/vagrant/src/dev/served/src/served/request_parser.rl"
 	{
 		request_path(buffer, PTR_TO(mark), LEN(mark,p));
 	}
-#line 67 "/home/vagrant/src/dev/served/src/served/request_parser.rl"
+#line 71 "/home/vagrant/src/dev/served/src/served/request_parser.rl"
 	{
 		request_uri(buffer, PTR_TO(mark), LEN(mark, p));
 	}
 	goto st20;
 tr37:
-#line 92 "/home/vagrant/src/dev/served/src/served/request_parser.rl"
+#line 96 "/home/vagrant/src/dev/served/src/served/request_parser.rl"
 	{
 		request_path(buffer, PTR_TO(mark), LEN(mark,p));
 	}
-#line 67 "/home/vagrant/src/dev/served/src/served/request_parser.rl"
+#line 71 "/home/vagrant/src/dev/served/src/served/request_parser.rl"
 	{
 		request_uri(buffer, PTR_TO(mark), LEN(mark, p));
 	}
 	goto st20;
 tr53:
-#line 77 "/home/vagrant/src/dev/served/src/served/request_parser.rl"
+#line 81 "/home/vagrant/src/dev/served/src/served/request_parser.rl"
 	{
 		MARK(query_start, p);
 	}
-#line 82 "/home/vagrant/src/dev/served/src/served/request_parser.rl"
+#line 86 "/home/vagrant/src/dev/served/src/served/request_parser.rl"
 	{
 		query_string(buffer, PTR_TO(query_start), LEN(query_start, p));
 	}
-#line 67 "/home/vagrant/src/dev/served/src/served/request_parser.rl"
+#line 71 "/home/vagrant/src/dev/served/src/served/request_parser.rl"
 	{
 		request_uri(buffer, PTR_TO(mark), LEN(mark, p));
 	}
 	goto st20;
 tr57:
-#line 82 "/home/vagrant/src/dev/served/src/served/request_parser.rl"
+#line 86 "/home/vagrant/src/dev/served/src/served/request_parser.rl"
 	{
 		query_string(buffer, PTR_TO(query_start), LEN(query_start, p));
 	}
-#line 67 "/home/vagrant/src/dev/served/src/served/request_parser.rl"
+#line 71 "/home/vagrant/src/dev/served/src/served/request_parser.rl"
 	{
 		request_uri(buffer, PTR_TO(mark), LEN(mark, p));
 	}
@@ -636,7 +654,7 @@ st20:
 	if ( ++p == pe )
 		goto _test_eof20;
 case 20:
-#line 637 "/home/vagrant/src/dev/served/src/served/request_parser.cpp"
+#line 658 "/home/vagrant/src/dev/served/src/served/request_parser.cpp"
 	switch( (*p) ) {
 		case 32: goto tr41;
 		case 33: goto tr42;
@@ -655,7 +673,7 @@ case 20:
 		goto tr42;
 	goto st0;
 tr42:
-#line 37 "/home/vagrant/src/dev/served/src/served/request_parser.rl"
+#line 41 "/home/vagrant/src/dev/served/src/served/request_parser.rl"
 	{
 		MARK(mark, p);
 	}
@@ -664,7 +682,7 @@ st21:
 	if ( ++p == pe )
 		goto _test_eof21;
 case 21:
-#line 665 "/home/vagrant/src/dev/served/src/served/request_parser.cpp"
+#line 686 "/home/vagrant/src/dev/served/src/served/request_parser.cpp"
 	switch( (*p) ) {
 		case 32: goto tr44;
 		case 33: goto st21;
@@ -683,7 +701,7 @@ case 21:
 		goto st21;
 	goto st0;
 tr43:
-#line 37 "/home/vagrant/src/dev/served/src/served/request_parser.rl"
+#line 41 "/home/vagrant/src/dev/served/src/served/request_parser.rl"
 	{
 		MARK(mark, p);
 	}
@@ -692,7 +710,7 @@ st22:
 	if ( ++p == pe )
 		goto _test_eof22;
 case 22:
-#line 693 "/home/vagrant/src/dev/served/src/served/request_parser.cpp"
+#line 714 "/home/vagrant/src/dev/served/src/served/request_parser.cpp"
 	if ( (*p) < 65 ) {
 		if ( 48 <= (*p) && (*p) <= 57 )
 			goto st23;
@@ -716,7 +734,7 @@ case 23:
 		goto st21;
 	goto st0;
 tr7:
-#line 37 "/home/vagrant/src/dev/served/src/served/request_parser.rl"
+#line 41 "/home/vagrant/src/dev/served/src/served/request_parser.rl"
 	{
 		MARK(mark, p);
 	}
@@ -725,7 +743,7 @@ st24:
 	if ( ++p == pe )
 		goto _test_eof24;
 case 24:
-#line 726 "/home/vagrant/src/dev/served/src/served/request_parser.cpp"
+#line 747 "/home/vagrant/src/dev/served/src/served/request_parser.cpp"
 	if ( (*p) < 65 ) {
 		if ( 48 <= (*p) && (*p) <= 57 )
 			goto st25;
@@ -749,7 +767,7 @@ case 25:
 		goto st19;
 	goto st0;
 tr201:
-#line 37 "/home/vagrant/src/dev/served/src/served/request_parser.rl"
+#line 41 "/home/vagrant/src/dev/served/src/served/request_parser.rl"
 	{
 		MARK(mark, p);
 	}
@@ -758,7 +776,7 @@ st26:
 	if ( ++p == pe )
 		goto _test_eof26;
 case 26:
-#line 759 "/home/vagrant/src/dev/served/src/served/request_parser.cpp"
+#line 780 "/home/vagrant/src/dev/served/src/served/request_parser.cpp"
 	switch( (*p) ) {
 		case 32: goto tr35;
 		case 33: goto st26;
@@ -779,7 +797,7 @@ case 26:
 		goto st26;
 	goto st0;
 tr202:
-#line 37 "/home/vagrant/src/dev/served/src/served/request_parser.rl"
+#line 41 "/home/vagrant/src/dev/served/src/served/request_parser.rl"
 	{
 		MARK(mark, p);
 	}
@@ -788,7 +806,7 @@ st27:
 	if ( ++p == pe )
 		goto _test_eof27;
 case 27:
-#line 789 "/home/vagrant/src/dev/served/src/served/request_parser.cpp"
+#line 810 "/home/vagrant/src/dev/served/src/served/request_parser.cpp"
 	if ( (*p) < 65 ) {
 		if ( 48 <= (*p) && (*p) <= 57 )
 			goto st28;
@@ -812,17 +830,17 @@ case 28:
 		goto st26;
 	goto st0;
 tr9:
-#line 37 "/home/vagrant/src/dev/served/src/served/request_parser.rl"
+#line 41 "/home/vagrant/src/dev/served/src/served/request_parser.rl"
 	{
 		MARK(mark, p);
 	}
-#line 92 "/home/vagrant/src/dev/served/src/served/request_parser.rl"
+#line 96 "/home/vagrant/src/dev/served/src/served/request_parser.rl"
 	{
 		request_path(buffer, PTR_TO(mark), LEN(mark,p));
 	}
 	goto st29;
 tr40:
-#line 92 "/home/vagrant/src/dev/served/src/served/request_parser.rl"
+#line 96 "/home/vagrant/src/dev/served/src/served/request_parser.rl"
 	{
 		request_path(buffer, PTR_TO(mark), LEN(mark,p));
 	}
@@ -831,7 +849,7 @@ st29:
 	if ( ++p == pe )
 		goto _test_eof29;
 case 29:
-#line 832 "/home/vagrant/src/dev/served/src/served/request_parser.cpp"
+#line 853 "/home/vagrant/src/dev/served/src/served/request_parser.cpp"
 	switch( (*p) ) {
 		case 32: goto tr51;
 		case 33: goto tr52;
@@ -851,7 +869,7 @@ case 29:
 		goto tr52;
 	goto st0;
 tr52:
-#line 77 "/home/vagrant/src/dev/served/src/served/request_parser.rl"
+#line 81 "/home/vagrant/src/dev/served/src/served/request_parser.rl"
 	{
 		MARK(query_start, p);
 	}
@@ -860,7 +878,7 @@ st30:
 	if ( ++p == pe )
 		goto _test_eof30;
 case 30:
-#line 861 "/home/vagrant/src/dev/served/src/served/request_parser.cpp"
+#line 882 "/home/vagrant/src/dev/served/src/served/request_parser.cpp"
 	switch( (*p) ) {
 		case 32: goto tr55;
 		case 33: goto st30;
@@ -880,7 +898,7 @@ case 30:
 		goto st30;
 	goto st0;
 tr54:
-#line 77 "/home/vagrant/src/dev/served/src/served/request_parser.rl"
+#line 81 "/home/vagrant/src/dev/served/src/served/request_parser.rl"
 	{
 		MARK(query_start, p);
 	}
@@ -889,7 +907,7 @@ st31:
 	if ( ++p == pe )
 		goto _test_eof31;
 case 31:
-#line 890 "/home/vagrant/src/dev/served/src/served/request_parser.cpp"
+#line 911 "/home/vagrant/src/dev/served/src/served/request_parser.cpp"
 	if ( (*p) < 65 ) {
 		if ( 48 <= (*p) && (*p) <= 57 )
 			goto st32;
@@ -913,7 +931,7 @@ case 32:
 		goto st30;
 	goto st0;
 tr8:
-#line 37 "/home/vagrant/src/dev/served/src/served/request_parser.rl"
+#line 41 "/home/vagrant/src/dev/served/src/served/request_parser.rl"
 	{
 		MARK(mark, p);
 	}
@@ -922,7 +940,7 @@ st33:
 	if ( ++p == pe )
 		goto _test_eof33;
 case 33:
-#line 923 "/home/vagrant/src/dev/served/src/served/request_parser.cpp"
+#line 944 "/home/vagrant/src/dev/served/src/served/request_parser.cpp"
 	switch( (*p) ) {
 		case 32: goto tr35;
 		case 33: goto st26;
@@ -2947,7 +2965,7 @@ case 172:
 		goto st172;
 	goto st0;
 tr10:
-#line 37 "/home/vagrant/src/dev/served/src/served/request_parser.rl"
+#line 41 "/home/vagrant/src/dev/served/src/served/request_parser.rl"
 	{
 		MARK(mark, p);
 	}
@@ -2956,7 +2974,7 @@ st173:
 	if ( ++p == pe )
 		goto _test_eof173;
 case 173:
-#line 2957 "/home/vagrant/src/dev/served/src/served/request_parser.cpp"
+#line 2978 "/home/vagrant/src/dev/served/src/served/request_parser.cpp"
 	switch( (*p) ) {
 		case 32: goto tr35;
 		case 33: goto st19;
@@ -3430,16 +3448,14 @@ case 193:
 	_out: {}
 	}
 
-#line 252 "/home/vagrant/src/dev/served/src/served/request_parser.rl"
+#line 267 "/home/vagrant/src/dev/served/src/served/request_parser.rl"
 
 	// ASSERT(p <= pe);
 
-	nread += p - (buffer + d_offset);
+	size_t nread = p - buffer;
+	d_offset += nread;
 
 	// ASSERT(nread <= len);
-	// ASSERT(mark < len);
-	// ASSERT(field_len <= len);
-	// ASSERT(field_start < len);
 
 	return(nread);
 }
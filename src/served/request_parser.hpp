@@ -54,6 +54,12 @@ class request_parser {
 	int    cs;
 	size_t d_offset;
 
+	// Offsets into the input of tokens still being matched, kept between calls to execute()
+	size_t mark;
+	size_t field_start;
+	size_t field_len;
+	size_t query_start;
+
 public:
 
 	enum status { RUNNING = 0, FINISHED, ERROR };
@@ -182,11 +188,27 @@ public:
 	 * will in turn invoke the callback methods in the order that the sequences
 	 * are identified in the input string.
 	 *
-	 * @param data input string to parse
+	 * The parser is resumable, each call continues from where the last one
+	 * stopped and every byte is scanned once. A sequence split across calls is
+	 * passed to its callback from where it began in an earlier input, so the
+	 * caller must keep the input of every call contiguous in memory, for
+	 * example by appending it to one buffer, unless a request arrives whole.
+	 *
+	 * @param data input string to parse, following the input of the last call
 	 * @param len  length of the input string in bytes
+	 *
+	 * @return the number of bytes of this input consumed by the header
 	 */
 	size_t execute(const char *data, size_t len);
 
+	/*
+	 * Reset the parser.
+	 *
+	 * Returns the parser to its initial state so that it can be used to parse
+	 * a new request, for example the next request on a persistent connection.
+	 */
+	void reset();
+
 	/*
 	 * Get the parser status.
 	 *
@@ -22,9 +22,13 @@
 
 #include <served/request_parser.hpp>
 
-#define LEN(AT, FPC) (FPC - buffer - AT)
-#define MARK(M,FPC) (M = (FPC) - buffer)
-#define PTR_TO(F) (buffer + F)
+#include <cstddef> // ptrdiff_t
+
+// Marks are offsets into all of the input since the parser was reset, d_offset being the offset of
+// the current buffer. A mark from an earlier call resolves to memory just before the buffer.
+#define LEN(AT, FPC) (FPC - buffer + d_offset - AT)
+#define MARK(M,FPC) (M = (FPC) - buffer + d_offset)
+#define PTR_TO(F) (buffer + (static_cast<std::ptrdiff_t>(F) - static_cast<std::ptrdiff_t>(d_offset)))
 
 using namespace served;
 
@@ -226,6 +230,10 @@ using namespace served;
 request_parser::request_parser()
 	: cs(0)
 	, d_offset(0)
+	, mark(0)
+	, field_start(0)
+	, field_len(0)
+	, query_start(0)
 {
 	// Ragel generates an unused constant for the entry point.
 	// The following will suppress the resulting warning.
@@ -236,31 +244,33 @@ request_parser::request_parser()
 request_parser::~request_parser()
 {}
 
+void
+request_parser::reset()
+{
+	d_offset = 0;
+	mark = 0;
+	field_start = 0;
+	field_len = 0;
+	query_start = 0;
+	%% write init;
+}
+
 size_t
 request_parser::execute(const char *buffer, size_t len)
 {
-	//int    content_len;
-	size_t nread = 0;
-	size_t mark = 0;
-	size_t field_start = 0;
-	size_t field_len = 0;
-	size_t query_start = 0;
-
 	if(len == 0) return 0;
 
-	const char *p  = buffer+d_offset;
+	const char *p  = buffer;
 	const char *pe = buffer+len;
 
 	%% write exec;
 
 	// ASSERT(p <= pe);
 
-	nread += p - (buffer + d_offset);
+	size_t nread = p - buffer;
+	d_offset += nread;
 
 	// ASSERT(nread <= len);
-	// ASSERT(mark < len);
-	// ASSERT(field_len <= len);
-	// ASSERT(field_start < len);
 
 	return(nread);
 }
@@ -24,7 +24,9 @@
 #include <served/methods.hpp>
 
 #include <algorithm>
+#include <cstring>
 #include <string>
+#include <utility>
 
 namespace served {
 
@@ -35,109 +37,247 @@ request_parser_impl::http_field( const char *
                                , const char * value
                                , size_t       vlen  )
 {
-	std::string header(field, flen), val(value, vlen);
-
-	/* If multiple matching header field names are sent these must be safe to append via comma
-	 * ref: (http://www.w3.org/Protocols/rfc2616/rfc2616-sec4.html#sec4.2)
-	 */
-	std::string existing = _request.header(header);
-	if ( !existing.empty() )
-	{
-		val = existing + "," + val;
-	}
-
-	_request.set_header(header, val);
+	// The header buffer may move as it grows, so fields are kept as offsets until it is complete.
+	_fields.push_back(header_scan::field{
+		static_cast<size_t>(field - _header.data()), flen,
+		static_cast<size_t>(value - _header.data()), vlen
+	});
 }
 
 request_parser_impl::status_type
 request_parser_impl::parse(const char *data, size_t len)
 {
-	_bytes_parsed += len;
-	if ( _max_req_size_bytes > 0 && _bytes_parsed > _max_req_size_bytes )
+	if ( _status == status_type::FINISHED )
 	{
-		_status = request_parser_impl::REJECTED_REQUEST_SIZE;
+		// The request is complete, anything else belongs to the next request.
+		_pipelined_bytes.append(data, len);
 		return _status;
 	}
 
-	std::string data_str;
-	if ( _truncated_header_bytes.length() > 0 )
+	if ( _status == status_type::EXPECT_CONTINUE
+	  || _status == status_type::READ_BODY       )
 	{
-		data_str = _truncated_header_bytes;
-		data_str.append(data, len);
-		_truncated_header_bytes = std::string();
+		// The header is complete, so no header bytes are held back.
+		return parse_body(data, len);
 	}
-	else
+
+	if ( _status != status_type::READ_HEADER )
+	{
+		return _status;
+	}
+
+	// Header bytes are kept in the header buffer, which the parsed request refers to. The parser
+	// resumes from the last read, so a field split across reads is found earlier in the buffer.
+	const size_t offset = _header.length();
+	_header.append(data, len);
+
+	size_t header_len = 0;
+	try
+	{
+		header_len = parse_header(offset);
+	}
+	catch (...)
+	{
+		_status = status_type::ERROR;
+		return _status;
+	}
+
+	request_parser::status status = get_status();
+
+	if ( request_parser::ERROR == status )
 	{
-		data_str = std::string(data, len);
+		_status = request_parser_impl::ERROR;
+		return _status;
 	}
 
-	if ( _status == status_type::READ_HEADER )
+	if ( request_parser::FINISHED != status )
 	{
-		auto last_crlf = data_str.find_last_of("\r\n");
-		if ( last_crlf != data_str.length() )
+		_bytes_parsed += len;
+		if ( exceeds_size_limit() )
 		{
-			if ( last_crlf == std::string::npos )
-			{
-				_truncated_header_bytes = data_str;
-				return _status;
-			}
-			if ( data_str.find_first_of("\r\n\r\n") == std::string::npos )
-			{
-				_truncated_header_bytes = data_str.substr(last_crlf+1);
-				data_str = data_str.substr(0, last_crlf);
-			}
+			_status = request_parser_impl::REJECTED_REQUEST_SIZE;
 		}
+		return _status;
+	}
+
+	// The bytes of this read that complete the header, the rest are read from data. Anything after
+	// the header belongs to the body or the next request.
+	const size_t extra_len = header_len - offset;
+	_header.resize(header_len);
+
+	_bytes_parsed += extra_len;
+	if ( exceeds_size_limit() )
+	{
+		_status = request_parser_impl::REJECTED_REQUEST_SIZE;
+		return _status;
+	}
+
+	// Where the body ends must be known, otherwise its bytes could be taken for another request.
+	if ( ! frame_body() )
+	{
+		_status = status_type::ERROR;
+		return _status;
+	}
+	const bool has_body = _body_chunked || 0 != _body_expected;
 
-		size_t extra_len = 0;
+	if ( has_body && _body_stream_handler )
+	{
 		try
 		{
-			extra_len = execute(data_str.data(), data_str.length());
+			_body_sink = _body_stream_handler(_request);
 		}
 		catch (...)
 		{
+			_error  = std::current_exception();
 			_status = status_type::ERROR;
 			return _status;
 		}
+	}
 
-		request_parser::status status = get_status();
+	// A stored body that cannot fit is rejected before it is read. A streamed body is not held
+	// in memory, so only the header counts against the limit.
+	if ( ! _body_sink && exceeds_size_limit(_body_expected) )
+	{
+		_status = request_parser_impl::REJECTED_REQUEST_SIZE;
+		return _status;
+	}
 
-		if ( request_parser::FINISHED == status )
-		{
-			_body_expected = expecting_body();
+	if ( requested_continue() && ! has_body )
+	{
+		_status = request_parser_impl::ERROR;
+	}
+	else if ( requested_continue() && extra_len == len )
+	{
+		_status = request_parser_impl::EXPECT_CONTINUE;
+	}
+	else if ( has_body )
+	{
+		// A client that has already sent some of its body is not waiting for a 100-continue.
+		_status = request_parser_impl::READ_BODY;
+		parse_body(data + extra_len, len - extra_len);
+	}
+	else
+	{
+		_status = request_parser_impl::FINISHED;
+		_pipelined_bytes.append(data + extra_len, len - extra_len);
+	}
 
-			if ( requested_continue() )
-			{
-				if ( 0 == _body_expected )
-				{
-					_status = request_parser_impl::ERROR;
-				}
-				else
-				{
-					_status = request_parser_impl::EXPECT_CONTINUE;
-				}
-			}
-			else if ( 0 != _body_expected )
-			{
-				_status = request_parser_impl::READ_BODY;
-				parse_body(data_str.data() + extra_len, data_str.length() - extra_len);
-			}
-			else
-			{
-				_status = request_parser_impl::FINISHED;
-			}
-		}
-		else if ( request_parser::ERROR == status )
+	return _status;
+}
+
+size_t
+request_parser_impl::parse_header(size_t offset)
+{
+	const char * data = _header.data();
+	const size_t len  = _header.length();
+
+	if ( _fields_start == 0 )
+	{
+		const char * lf       = header_scan::find_char(data + offset, data + len, '\n');
+		const size_t line_end = ( lf == data + len ) ? len : lf - data + 1;
+
+		execute(data + offset, line_end - offset);
+		if ( lf == data + len || get_status() != request_parser::RUNNING )
 		{
-			_status = request_parser_impl::ERROR;
+			return 0;
 		}
+		_fields_start = line_end;
+		_scanned      = line_end - 1;
 	}
-	else if ( _status == status_type::EXPECT_CONTINUE
-	       || _status == status_type::READ_BODY       )
+
+	const size_t empty_line = header_scan::find_empty_line(data, len, _scanned);
+	if ( empty_line == header_scan::npos )
 	{
-		parse_body(data_str.data(), data_str.length());
+		// An empty line may start in the last two bytes, and be completed by the next read.
+		_scanned = std::max(_scanned, len - 2);
+		return 0;
 	}
+	const size_t header_len = empty_line + ( data[empty_line] == '\n' ? 1 : 2 );
 
-	return _status;
+	if ( header_scan::split_fields(data, _fields_start, empty_line, _fields) )
+	{
+		// Only the empty line is left for the state machine, which then completes the header.
+		execute(data + empty_line, header_len - empty_line);
+	}
+	else
+	{
+		_fields.clear();
+		execute(data + _fields_start, header_len - _fields_start);
+	}
+	return header_len;
+}
+
+std::string
+request_parser_impl::take_pipelined_bytes()
+{
+	std::string bytes;
+	bytes.swap(_pipelined_bytes);
+	return bytes;
+}
+
+void
+request_parser_impl::reset()
+{
+	request_parser::reset();
+
+	_status = status_type::READ_HEADER;
+	_fields.clear();
+	_fields_start = 0;
+	_scanned = 0;
+	if ( _header.capacity() > max_retained_header_bytes )
+	{
+		std::string().swap(_header);
+	}
+	else
+	{
+		_header.clear();
+	}
+	_pipelined_bytes.clear();
+	_body_expected = 0;
+	_body_chunked = false;
+	_chunk_state = chunk_state::CHUNK_SIZE;
+	_chunk_remaining = 0;
+	_chunk_size_digits = 0;
+	_body.clear();
+	_bytes_parsed = 0;
+	_body_sink = nullptr;
+	_error = nullptr;
+}
+
+void
+request_parser_impl::release()
+{
+	std::string().swap(_header);
+	std::string().swap(_pipelined_bytes);
+	std::string().swap(_body);
+	std::vector<header_scan::field>().swap(_fields);
+}
+
+void
+request_parser_impl::release_header()
+{
+	std::string().swap(_header);
+}
+
+size_t
+request_parser_impl::capacity() const
+{
+	return _header.capacity() + _pipelined_bytes.capacity() + _body.capacity()
+	     + _fields.capacity() * sizeof(header_scan::field);
+}
+
+void
+request_parser_impl::set_body_stream_handler(served_body_stream_handler handler)
+{
+	_body_stream_handler = handler;
+}
+
+std::exception_ptr
+request_parser_impl::take_error()
+{
+	std::exception_ptr error;
+	std::swap(error, _error);
+	return error;
 }
 
 void
@@ -153,7 +293,7 @@ request_parser_impl::request_uri( const char *
                                 , const char * at
                                 , size_t       length )
 {
-	_request.url().set_URI(std::string(at, length));
+	_request.url().set_URI(string_view(at, length));
 }
 
 void
@@ -161,7 +301,7 @@ request_parser_impl::fragment( const char *
                              , const char * at
                              , size_t       length )
 {
-	_request.url().set_fragment(std::string(at, length));
+	_request.url().set_fragment(string_view(at, length));
 }
 
 void
@@ -169,7 +309,7 @@ request_parser_impl::request_path( const char *
                                  , const char * at
                                  , size_t       length )
 {
-	_request.url().set_path(std::string(at, length));
+	_request.url().set_path(string_view(at, length));
 }
 
 void
@@ -177,39 +317,32 @@ request_parser_impl::query_string( const char *
                                  , const char * at
                                  , size_t       length )
 {
-	std::string query = std::string(at, length);
+	const string_view query(at, length);
 	_request.url().set_query(query);
 
 	// find each pair of key / value strings delimeted by '&'
-	while ( query.length() > 0 )
+	size_t start = 0;
+	while ( start < query.length() )
 	{
-		size_t pos = query.find("&");
+		size_t pos = query.substr(start).find('&');
+		pos = ( pos == string_view::npos ) ? query.length() : start + pos;
 
-		std::string pair;
-		if ( pos != std::string::npos )
-		{
-			pair = query.substr(0, pos);
-		}
-		else
-		{
-			pair = query;
-			pos = query.length() - 1;
-		}
+		const string_view pair = query.substr(start, pos - start);
 
 		// save the key / value pair, and look for the index of the
 		// divider, delimited by '='
 		size_t div_index = pair.find('=');
 
-		if (div_index != std::string::npos)
+		if (div_index != string_view::npos)
 		{
-			std::string key = query_unescape(pair.substr(0, div_index));
-			std::string value = query_unescape(pair.substr(div_index + 1, std::string::npos));
+			std::string key = query_unescape(pair.substr(0, div_index).to_string());
+			std::string value = query_unescape(pair.substr(div_index + 1).to_string());
 
 			_request.query[key] = value;
 		}
 
-		// erase the pair we just processed from the query string
-		query.erase(0, pos + 1);
+		// move past the pair we just processed
+		start = pos + 1;
 	}
 }
 
@@ -226,63 +359,182 @@ request_parser_impl::header_done( const char *
                                 , const char *
                                 , size_t      )
 {
+	for ( const auto & field : _fields )
+	{
+		const string_view name  = header_bytes(field.name, field.name_len);
+		const string_view value = header_bytes(field.value, field.value_len);
+
+		/* If multiple matching header field names are sent these must be safe to append via comma
+		 * ref: (http://www.w3.org/Protocols/rfc2616/rfc2616-sec4.html#sec4.2)
+		 */
+		const string_view existing = _request.header_view(name);
+		if ( !existing.empty() )
+		{
+			_request.set_header(name.to_string(), existing.to_string() + "," + value.to_string());
+		}
+		else
+		{
+			_request.add_header_view(name, value);
+		}
+	}
+
 	// NOTE: Body parsing instigated in "parse"
 }
 
+string_view
+request_parser_impl::header_bytes(size_t offset, size_t len) const
+{
+	return string_view(_header.data() + offset, len);
+}
+
+bool
+request_parser_impl::exceeds_size_limit(size_t more) const
+{
+	return _max_req_size_bytes > 0
+	    && ( _bytes_parsed > _max_req_size_bytes || more > _max_req_size_bytes - _bytes_parsed );
+}
+
 bool
 request_parser_impl::requested_continue()
 {
-	return _request.header("expect") == "100-continue";
+	return _request.header_view("expect") == "100-continue";
 }
 
-size_t
-request_parser_impl::expecting_body()
+bool
+request_parser_impl::is_chunked_encoding(const std::string & encoding)
+{
+	// Chunked must be the final coding applied to a request body.
+	size_t end = encoding.find_last_not_of(" \t");
+	if ( end == std::string::npos )
+	{
+		return false;
+	}
+
+	size_t start = encoding.find_last_of(", \t", end);
+	start = ( start == std::string::npos ) ? 0 : start + 1;
+
+	std::string coding = encoding.substr(start, end - start + 1);
+	std::transform(coding.begin(), coding.end(), coding.begin(), ::tolower);
+	return coding == "chunked";
+}
+
+namespace {
+
+/*
+ * Reads a Content-Length value, which must be a single decimal number.
+ *
+ * Duplicate fields are joined with commas, so they are rejected along with signs, spaces within
+ * the number and values that do not fit a size_t.
+ *
+ * @return false if the value is not a valid length
+ */
+bool
+parse_content_length(string_view value, size_t & length)
 {
-	switch (_request.method())
+	while ( ! value.empty() && ( value.back() == ' ' || value.back() == '\t' ) )
 	{
-	case method::PUT:
-	case method::POST:
-	case method::PATCH:
+		value.remove_suffix(1);
+	}
+	if ( value.empty() )
 	{
-		std::string type   = _request.header("content-type");
-		std::string length = _request.header("content-length");
+		return false;
+	}
 
-		// TODO: Better validation here
-		if ( !type.empty() && !length.empty() )
+	length = 0;
+	for ( const char c : value )
+	{
+		if ( c < '0' || c > '9' )
 		{
-			size_t len = 0;
-			try
-			{
-				len = std::stoi(length);
-			}
-			catch (...) {}
+			return false;
+		}
+		const size_t digit = c - '0';
+		if ( length > ( static_cast<size_t>(-1) - digit ) / 10 )
+		{
+			return false;
+		}
+		length = length * 10 + digit;
+	}
+	return true;
+}
+
+} // anonymous namespace
+
+bool
+request_parser_impl::frame_body()
+{
+	_body_chunked  = false;
+	_body_expected = 0;
 
-			return len;
+	// Any request may have a body, whatever its method and content type.
+	const string_view encoding = _request.header_view("transfer-encoding");
+	const string_view length   = _request.header_view("content-length");
+
+	if ( ! encoding.empty() )
+	{
+		// Either may be used to smuggle a request past a proxy that reads the other, and the
+		// length of a body with any coding other than chunked cannot be determined.
+		if ( ! length.empty() )
+		{
+			return false;
 		}
-		break;
+		_body_chunked = is_chunked_encoding(encoding.to_string());
+		return _body_chunked;
 	}
-	default:
-		break;
+
+	if ( length.empty() )
+	{
+		return true;
 	}
-	return 0;
+	return parse_content_length(length, _body_expected);
 }
 
 request_parser_impl::status_type
 request_parser_impl::parse_body(const char *data, size_t len)
+{
+	const bool   stored    = ! _body_sink;
+	const size_t pipelined = _pipelined_bytes.length();
+
+	if ( _body_chunked )
+	{
+		parse_chunked_body(data, len);
+	}
+	else
+	{
+		parse_sized_body(data, len);
+	}
+
+	// Bytes beyond the end of the body belong to the next request, and are not counted.
+	if ( stored && _status != status_type::ERROR )
+	{
+		_bytes_parsed += len - ( _pipelined_bytes.length() - pipelined );
+		if ( exceeds_size_limit() )
+		{
+			_status = status_type::REJECTED_REQUEST_SIZE;
+		}
+	}
+
+	return _status;
+}
+
+request_parser_impl::status_type
+request_parser_impl::parse_sized_body(const char *data, size_t len)
 {
 	if ( len > _body_expected )
 	{
+		_pipelined_bytes.append(data + _body_expected, len - _body_expected);
 		len = _body_expected;
 	}
 
-	_body_stream.write(data, len);
 	_body_expected -= len;
 
+	if ( ! consume_body(data, len) )
+	{
+		return _status;
+	}
+
 	if ( 0 == _body_expected )
 	{
-		_request.set_body(_body_stream.str());
-		_body_stream.str(std::string());
-		_status = status_type::FINISHED;
+		finish_body();
 	}
 	else
 	{
@@ -292,4 +544,208 @@ request_parser_impl::parse_body(const char *data, size_t len)
 	return _status;
 }
 
+namespace {
+
+int
+hex_digit_value(char c)
+{
+	if ( c >= '0' && c <= '9' )
+	{
+		return c - '0';
+	}
+	if ( c >= 'a' && c <= 'f' )
+	{
+		return c - 'a' + 10;
+	}
+	if ( c >= 'A' && c <= 'F' )
+	{
+		return c - 'A' + 10;
+	}
+	return -1;
+}
+
+} // anonymous namespace
+
+request_parser_impl::status_type
+request_parser_impl::parse_chunked_body(const char *data, size_t len)
+{
+	const char *       p   = data;
+	const char * const end = data + len;
+
+	_status = status_type::READ_BODY;
+
+	while ( p < end )
+	{
+		switch ( _chunk_state )
+		{
+		case chunk_state::CHUNK_SIZE:
+		{
+			int digit = hex_digit_value(*p);
+			if ( digit >= 0 )
+			{
+				// Reject sizes that do not fit rather than wrapping around.
+				if ( _chunk_size_digits == 2 * sizeof(size_t) )
+				{
+					_status = status_type::ERROR;
+					return _status;
+				}
+				_chunk_remaining = _chunk_remaining * 16 + digit;
+				_chunk_size_digits++;
+			}
+			else if ( _chunk_size_digits > 0 && ( *p == ';' || *p == ' ' || *p == '\t' ) )
+			{
+				_chunk_state = chunk_state::CHUNK_EXTENSION;
+			}
+			else if ( _chunk_size_digits > 0 && *p == '\r' )
+			{
+				_chunk_state = chunk_state::CHUNK_SIZE_LF;
+			}
+			else
+			{
+				_status = status_type::ERROR;
+				return _status;
+			}
+			p++;
+			break;
+		}
+		case chunk_state::CHUNK_EXTENSION:
+		case chunk_state::CHUNK_TRAILER_LINE:
+		{
+			// Chunk extensions and trailer fields are not used, skip to the end of the line.
+			const char * cr = static_cast<const char *>(std::memchr(p, '\r', end - p));
+			if ( ! cr )
+			{
+				p = end;
+				break;
+			}
+			_chunk_state = ( _chunk_state == chunk_state::CHUNK_EXTENSION )
+				? chunk_state::CHUNK_SIZE_LF
+				: chunk_state::CHUNK_TRAILER_LF;
+			p = cr + 1;
+			break;
+		}
+		case chunk_state::CHUNK_SIZE_LF:
+			if ( *p++ != '\n' )
+			{
+				_status = status_type::ERROR;
+				return _status;
+			}
+			if ( 0 == _chunk_remaining )
+			{
+				_chunk_state = chunk_state::CHUNK_TRAILER;
+				break;
+			}
+			// A stored body is rejected as soon as a chunk would take it over the limit.
+			if ( ! _body_sink && _max_req_size_bytes > 0
+			  && ( _chunk_remaining > _max_req_size_bytes
+			    || _body.length() + _chunk_remaining > _max_req_size_bytes ) )
+			{
+				_status = status_type::REJECTED_REQUEST_SIZE;
+				return _status;
+			}
+			_chunk_state = chunk_state::CHUNK_DATA;
+			break;
+		case chunk_state::CHUNK_DATA:
+		{
+			size_t n = std::min(_chunk_remaining, static_cast<size_t>(end - p));
+			if ( ! consume_body(p, n) )
+			{
+				return _status;
+			}
+			p                += n;
+			_chunk_remaining -= n;
+			if ( 0 == _chunk_remaining )
+			{
+				_chunk_state = chunk_state::CHUNK_DATA_CR;
+			}
+			break;
+		}
+		case chunk_state::CHUNK_DATA_CR:
+		case chunk_state::CHUNK_DATA_LF:
+		case chunk_state::CHUNK_TRAILER_LF:
+		case chunk_state::CHUNK_END_LF:
+		{
+			const char expected = ( _chunk_state == chunk_state::CHUNK_DATA_CR ) ? '\r' : '\n';
+			if ( *p++ != expected )
+			{
+				_status = status_type::ERROR;
+				return _status;
+			}
+
+			if ( _chunk_state == chunk_state::CHUNK_DATA_CR )
+			{
+				_chunk_state = chunk_state::CHUNK_DATA_LF;
+			}
+			else if ( _chunk_state == chunk_state::CHUNK_DATA_LF )
+			{
+				_chunk_state       = chunk_state::CHUNK_SIZE;
+				_chunk_size_digits = 0;
+			}
+			else if ( _chunk_state == chunk_state::CHUNK_TRAILER_LF )
+			{
+				_chunk_state = chunk_state::CHUNK_TRAILER;
+			}
+			else
+			{
+				// The body is complete, anything else belongs to the next request.
+				_pipelined_bytes.append(p, end - p);
+				finish_body();
+				return _status;
+			}
+			break;
+		}
+		case chunk_state::CHUNK_TRAILER:
+			if ( *p == '\r' )
+			{
+				_chunk_state = chunk_state::CHUNK_END_LF;
+				p++;
+			}
+			else
+			{
+				_chunk_state = chunk_state::CHUNK_TRAILER_LINE;
+			}
+			break;
+		}
+	}
+
+	return _status;
+}
+
+bool
+request_parser_impl::consume_body(const char *data, size_t len)
+{
+	if ( ! _body_sink )
+	{
+		_body.append(data, len);
+		return true;
+	}
+
+	if ( len > 0 )
+	{
+		try
+		{
+			_body_sink(data, len);
+		}
+		catch (...)
+		{
+			_error  = std::current_exception();
+			_status = status_type::ERROR;
+			return false;
+		}
+	}
+	return true;
+}
+
+void
+request_parser_impl::finish_body()
+{
+	if ( ! _body_sink )
+	{
+		_request.set_body(std::move(_body));
+		_body.clear();
+	}
+	_body_sink = nullptr;
+	_status = status_type::FINISHED;
+}
+
 } // served
@@ -25,8 +25,12 @@
 
 #include <served/request_parser.hpp>
 #include <served/request.hpp>
+#include <served/header_scan.hpp>
+#include <served/methods_handler.hpp>
 
-#include <sstream>
+#include <exception>
+#include <string>
+#include <vector>
 
 namespace served {
 
@@ -39,6 +43,15 @@ namespace served {
  * Call parse for each chunk of TCP data received, the parser will return a state that declares its
  * current position through the HTTP response. If the state is EXPECT_CONTINUE then the client
  * should be waiting for a 100 CONTINUE response before it will send its body.
+ *
+ * The header of a request is kept in a buffer owned by the parser, and the header fields of the
+ * request refer to it rather than being copied, so the request must be cleared before the parser
+ * is reset. The buffer keeps its storage between requests, so parsing the typical headers of
+ * pipelined requests does not allocate. A connection that goes idle frees it with release_header.
+ *
+ * The request line is parsed as it arrives, so that a malformed request is rejected early. The
+ * fields are left until the end of the header has been found by the header scanner, then split
+ * by it, and only passed through the state machine if they are not in their simple form.
  */
 class request_parser_impl : public served::request_parser {
 public:
@@ -53,14 +66,43 @@ public:
 	};
 
 private:
+	enum class chunk_state
+	{
+		CHUNK_SIZE = 0,
+		CHUNK_EXTENSION,
+		CHUNK_SIZE_LF,
+		CHUNK_DATA,
+		CHUNK_DATA_CR,
+		CHUNK_DATA_LF,
+		CHUNK_TRAILER,
+		CHUNK_TRAILER_LINE,
+		CHUNK_TRAILER_LF,
+		CHUNK_END_LF
+	};
+
+	// Larger header buffers are released on reset rather than kept for the next request
+	static const size_t max_retained_header_bytes = 4096;
+
 	request &         _request;
 	status_type       _status;
-	std::string       _truncated_header_bytes;
+	std::string       _header;
+	size_t            _fields_start;
+	size_t            _scanned;
+	std::vector<header_scan::field> _fields;
+	std::string       _pipelined_bytes;
 	size_t            _body_expected;
-	std::stringstream _body_stream;
+	bool              _body_chunked;
+	chunk_state       _chunk_state;
+	size_t            _chunk_remaining;
+	size_t            _chunk_size_digits;
+	std::string       _body;
 	size_t            _max_req_size_bytes;
 	size_t            _bytes_parsed;
 
+	served_body_stream_handler _body_stream_handler;
+	served_body_chunk_handler  _body_sink;
+	std::exception_ptr         _error;
+
 public:
 	/*
 	 * Constructs a parser by giving it a reference to a request object to be modified.
@@ -72,11 +114,22 @@ public:
 		: served::request_parser()
 		, _request(req)
 		, _status(status_type::READ_HEADER)
-		, _truncated_header_bytes()
+		, _header()
+		, _fields_start(0)
+		, _scanned(0)
+		, _fields()
+		, _pipelined_bytes()
 		, _body_expected(0)
-		, _body_stream()
+		, _body_chunked(false)
+		, _chunk_state(chunk_state::CHUNK_SIZE)
+		, _chunk_remaining(0)
+		, _chunk_size_digits(0)
+		, _body()
 		, _max_req_size_bytes(max_req_size_bytes)
 		, _bytes_parsed(0)
+		, _body_stream_handler()
+		, _body_sink()
+		, _error()
 	{}
 
 	/*
@@ -89,6 +142,63 @@ public:
 	 */
 	status_type parse(const char *data, size_t len);
 
+	/*
+	 * Takes any bytes that were received after the end of the parsed request.
+	 *
+	 * With HTTP pipelining a client may send further requests before the first is answered, these
+	 * bytes belong to the next request and should be parsed once the parser has been reset.
+	 *
+	 * @return the bytes received beyond the end of the request, may be empty
+	 */
+	std::string take_pipelined_bytes();
+
+	/*
+	 * Sets a handler that decides whether the body of each request is streamed.
+	 *
+	 * The handler is called once the header of a request with a body is parsed. If it returns a
+	 * callback then the body is passed to that callback as it is parsed, and is not stored in the
+	 * request or counted towards the max request size.
+	 *
+	 * @param handler the handler, or an empty function to store every body in the request
+	 */
+	void set_body_stream_handler(served_body_stream_handler handler);
+
+	/*
+	 * Takes the exception that caused an ERROR status, if it was thrown by a body stream.
+	 *
+	 * @return the exception, or an empty pointer if the request was malformed
+	 */
+	std::exception_ptr take_error();
+
+	/*
+	 * Resets the parser so that it is ready to parse a new request.
+	 *
+	 * Used by persistent connections between requests, the request object itself is not cleared.
+	 */
+	void reset();
+
+	/*
+	 * Frees the buffers of a parser that has been reset, rather than keeping them for reuse.
+	 *
+	 * Used when the connection of the parser is kept in a pool.
+	 */
+	void release();
+
+	/*
+	 * Frees the header buffer of a parser that has been reset, the next request allocates another.
+	 *
+	 * Used when a persistent connection goes idle, so that it does not hold a header buffer while
+	 * waiting for the next request.
+	 */
+	void release_header();
+
+	/*
+	 * Get the number of bytes allocated by the header, body and pipelined byte buffers.
+	 *
+	 * @return the allocated capacity of the parser buffers
+	 */
+	size_t capacity() const;
+
 protected:
 	/*
 	 * Converts a block of data into an HTTP request header and stores it in the request object.
@@ -135,12 +245,34 @@ protected:
 	/*
 	 * Called when the parser has completed reading the HEADER of the request.
 	 *
-	 * Currently not used.
+	 * Adds the header fields to the request object, they refer to the header buffer.
 	 */
 	virtual void header_done(const char *data, const char *at,
 		size_t length) override;
 
 private:
+	/*
+	 * Parses the header bytes added to the header buffer by the last read.
+	 *
+	 * The request line is passed to the state machine as it arrives. After that, nothing is
+	 * parsed until the header scanner finds the end of the header, the fields are then split by
+	 * the scanner where possible, and otherwise by the state machine.
+	 *
+	 * @param offset the offset of the bytes of the last read in the header buffer
+	 *
+	 * @return the length of the header once it is complete, otherwise 0
+	 */
+	size_t parse_header(size_t offset);
+
+	/*
+	 * Checks whether the bytes parsed so far exceed the max request size.
+	 *
+	 * @param more a number of bytes still to be parsed that should be counted too
+	 *
+	 * @return true if the request should be rejected
+	 */
+	bool exceeds_size_limit(size_t more = 0) const;
+
 	/*
 	 * Checks whether the request has sent an Expect: 100-continue header.
 	 *
@@ -153,26 +285,75 @@ private:
 	bool requested_continue();
 
 	/*
-	 * Checks whether the request is sending a body.
+	 * Determines how the body of the request is framed.
 	 *
-	 * Scans the HTTP verb and headers of the request object to find out if a header should be
-	 * expected, and how long the body will be.
+	 * Any request may send a body, either in chunks or with a Content-Length, otherwise it has
+	 * none. Sets whether the body is chunked, or how long it is.
 	 *
 	 * Should be used after the HTTP header is fully parsed to determine whether to wait for more
 	 * data.
 	 *
-	 * @return the size of the expected body, or 0 if a body is not expected
+	 * @return false if the end of the body cannot be determined, the request must then be rejected
+	 *         as its body cannot be told apart from the next request
+	 */
+	bool frame_body();
+
+	/*
+	 * Checks whether a Transfer-Encoding header ends with the chunked coding.
+	 *
+	 * @param encoding the value of the Transfer-Encoding header
+	 *
+	 * @return true if the body is sent in chunks
+	 */
+	static bool is_chunked_encoding(const std::string & encoding);
+
+	/*
+	 * Resolves an offset into the header buffer.
 	 */
-	size_t expecting_body();
+	string_view header_bytes(size_t offset, size_t len) const;
 
 	/*
 	 * Parse a chunk of body.
 	 *
-	 * Continues to read the body of a request and returns the status of the parser.
+	 * Continues to read the body of a request and returns the status of the parser. Any bytes
+	 * beyond the end of the body are kept for the next request. The body is stored in the request
+	 * once complete, or passed straight to the body stream if there is one. Only the bytes of a
+	 * stored body count towards the max request size.
 	 *
 	 * @return status_type of request_parser_impl, FINISHED indicates the body is fully read
 	 */
 	status_type parse_body(const char *data, size_t len);
+
+	/*
+	 * Parse a chunk of a body sent with a Content-Length.
+	 *
+	 * @return status_type of request_parser_impl, FINISHED indicates the body is fully read
+	 */
+	status_type parse_sized_body(const char *data, size_t len);
+
+	/*
+	 * Parse a chunk of a body sent with chunked transfer encoding.
+	 *
+	 * Decodes incrementally, so chunk size lines, extensions and trailers may be split across
+	 * calls. Chunk data is appended straight to the body, or passed to the body stream, and a
+	 * stored body is rejected as soon as a chunk size would take it over the max request size.
+	 * Trailer fields are skipped.
+	 *
+	 * @return status_type of request_parser_impl, FINISHED indicates the body is fully read
+	 */
+	status_type parse_chunked_body(const char *data, size_t len);
+
+	/*
+	 * Stores bytes of the body, or passes them to the body stream.
+	 *
+	 * @return false if the body stream failed, the status is then ERROR
+	 */
+	bool consume_body(const char *data, size_t len);
+
+	/*
+	 * Completes the body once all of it has been parsed.
+	 */
+	void finish_body();
 };
 
 } // served namespace
@@ -21,17 +21,43 @@
  */
 
 #include <algorithm>
-#include <sstream>
+#include <string>
+#include <vector>
+
+#include <unistd.h>
 
 #include <served/version.hpp>
 #include <served/response.hpp>
 
 namespace served {
 
+//  -----  file handle  -----
+
+file_handle::file_handle(int fd)
+	: _fd(fd)
+{
+}
+
+file_handle::~file_handle()
+{
+	if ( _fd >= 0 )
+	{
+		::close(_fd);
+	}
+}
+
 //  -----  constructors  -----
 
 response::response()
 	: _status(status_2XX::OK)
+	, _file()
+	, _file_offset(0)
+	, _file_length(0)
+	, _stream()
+	, _stream_writer()
+	, _max_stream_pending_bytes(1024 * 1024)
+	, _stream_chunked(true)
+	, _websocket()
 {
 }
 
@@ -43,7 +69,17 @@ response::clear()
 	_status = status_2XX::OK;
 	_headers.clear();
 	_body.clear();
-	_buffer = "";
+	_buffer.clear();
+	respond_with_cache = false;
+	cache.reset();
+	_file.reset();
+	_file_offset = 0;
+	_file_length = 0;
+	_stream.reset();
+	_stream_writer.reset();
+	_max_stream_pending_bytes = 1024 * 1024;
+	_stream_chunked = true;
+	_websocket.reset();
 }
 
 void
@@ -67,8 +103,8 @@ response::set_status(int status_code)
 void
 response::set_body(const std::string & body)
 {
-	_body.clear();
-	_body.str(body);
+	_body = body;
+	_file.reset();
 }
 
 void response::set_response(const std::shared_ptr<const std::string> &res)
@@ -77,10 +113,54 @@ void response::set_response(const std::shared_ptr<const std::string> &res)
 	cache = res;
 }
 
+void
+response::set_file_body(const file_handle_ptr & file, size_t offset, size_t length)
+{
+	_body.clear();
+	_file        = file;
+	_file_offset = offset;
+	_file_length = length;
+}
+
+response_stream
+response::stream()
+{
+	if ( auto writer = _stream_writer.lock() )
+	{
+		return response_stream(writer);
+	}
+
+	if ( ! _stream )
+	{
+		_stream = std::make_shared<stream_channel>(_max_stream_pending_bytes);
+	}
+	response_stream stream(_stream);
+	_stream_writer = stream._writer;
+	return stream;
+}
+
+void
+response::set_max_stream_pending_bytes(size_t num_bytes)
+{
+	_max_stream_pending_bytes = num_bytes;
+}
+
+void
+response::set_stream_chunked(bool chunked)
+{
+	_stream_chunked = chunked;
+}
+
+void
+response::set_websocket(std::shared_ptr<websocket> ws)
+{
+	_websocket = std::move(ws);
+}
+
 response&
 response::operator<<(std::string const& rhs)
 {
-	_body << rhs;
+	_body.append(rhs);
 	return (*this);
 }
 
@@ -95,42 +175,111 @@ response::status()
 size_t
 response::body_size()
 {
-	_body.seekp(0, std::ios::end);
-	return _body.tellp();
+	if ( _file )
+	{
+		return _file_length;
+	}
+	return _body.size();
 }
 
 //  -----  serialization  -----
 
-const std::string &
-response::to_buffer()
+void
+response::to_buffers(std::vector<boost::asio::const_buffer> & buffers)
 {
-
 	if (respond_with_cache)
-		return *cache;
+	{
+		buffers.push_back(boost::asio::buffer(*cache));
+		return;
+	}
 
-	std::stringstream ss;
+	_buffer.clear();
 
-	ss << "HTTP/1.1 " << _status << " " << status::status_to_reason(_status) << "\r\n";
+	_buffer.append("HTTP/1.1 ")
+	       .append(std::to_string(_status))
+	       .append(" ")
+	       .append(status::status_to_reason(_status))
+	       .append("\r\n");
 
 	// If server header not specified we add served version stamp
 	if ( _headers.find("server") == _headers.end() )
 	{
-		ss << "Server: served-v" << APPLICATION_VERSION_STRING << "\r\n";
+		_buffer.append("Server: served-v").append(APPLICATION_VERSION_STRING).append("\r\n");
 	}
 	for ( const auto & header : _headers )
 	{
-		ss << std::get<0>(header.second) << ": " << std::get<1>(header.second) << "\r\n";
+		_buffer.append(std::get<0>(header.second))
+		       .append(": ")
+		       .append(std::get<1>(header.second))
+		       .append("\r\n");
+	}
+	if ( _stream )
+	{
+		// A streamed body has no known length, it is framed in chunks or ended by closing.
+		if ( _stream_chunked && _headers.find("transfer-encoding") == _headers.end() )
+		{
+			_buffer.append("Transfer-Encoding: chunked\r\n");
+		}
+	}
+	// If content length not specified we check body size, informational responses have no body
+	else if ( _status >= 200 && _headers.find("content-length") == _headers.end() )
+	{
+		_buffer.append("Content-Length: ").append(std::to_string(body_size())).append("\r\n");
+	}
+
+	_buffer.append("\r\n");
+
+	const bool chunk_body = _stream && _stream_chunked && ! _body.empty();
+	if ( chunk_body )
+	{
+		std::ostringstream size;
+		size << std::hex << _body.size() << "\r\n";
+		_buffer.append(size.str());
+	}
+
+	buffers.push_back(boost::asio::buffer(_buffer));
+	if ( ! _body.empty() )
+	{
+		buffers.push_back(boost::asio::buffer(_body));
 	}
-	// If content length not specified we check body size
-	if ( _headers.find("content-length") == _headers.end() )
+	if ( chunk_body )
 	{
-		ss << "Content-Length: " << body_size() << "\r\n";
+		static const char crlf[] = { '\r', '\n' };
+		buffers.push_back(boost::asio::buffer(crlf));
 	}
+}
 
-	ss << "\r\n";
-	ss << _body.str();
+const std::string &
+response::to_buffer()
+{
+	if (respond_with_cache)
+		return *cache;
+
+	std::vector<boost::asio::const_buffer> buffers;
+	to_buffers(buffers);
+
+	_buffer.append(_body);
+	if ( _stream && _stream_chunked && ! _body.empty() )
+	{
+		_buffer.append("\r\n");
+	}
 
-	_buffer = ss.str();
+	if ( _file )
+	{
+		std::vector<char> chunk(8192);
+		size_t offset = _file_offset, remaining = _file_length;
+		while ( remaining > 0 )
+		{
+			ssize_t n = ::pread(_file->fd(), chunk.data(), std::min(chunk.size(), remaining), offset);
+			if ( n <= 0 )
+			{
+				break;
+			}
+			_buffer.append(chunk.data(), n);
+			offset    += n;
+			remaining -= n;
+		}
+	}
 	return _buffer;
 }
 
@@ -28,11 +28,51 @@
 #include <map>
 #include <memory>
 #include <string>
+#include <vector>
+
+#include <boost/asio/buffer.hpp>
 
 #include <served/status.hpp>
+#include <served/response_stream.hpp>
 
 namespace served {
 
+class websocket;
+
+/*
+ * An open file descriptor that is closed once the last reference to it is released.
+ *
+ * Used for response bodies that are sent straight from a file, so that a descriptor can be shared
+ * by a cache and any responses still being written.
+ */
+class file_handle
+{
+	int _fd;
+
+public:
+	file_handle(const file_handle&) = delete;
+
+	file_handle& operator=(const file_handle&) = delete;
+
+	/*
+	 * Takes ownership of an open file descriptor.
+	 *
+	 * @param fd the file descriptor
+	 */
+	explicit file_handle(int fd);
+
+	~file_handle();
+
+	/*
+	 * Get the file descriptor.
+	 *
+	 * @return the file descriptor
+	 */
+	int fd() const { return _fd; }
+};
+
+typedef std::shared_ptr<const file_handle> file_handle_ptr;
+
 /*
  * Represents a HTTP response.
  *
@@ -46,17 +86,30 @@ namespace served {
  */
 class response
 {
+public:
 	typedef std::tuple<std::string, std::string> header_pair;
 	typedef std::map<std::string, header_pair>   header_list;
 
+private:
 	int               _status;
 	header_list       _headers;
-	std::stringstream _body;
+	std::string       _body;
 	std::string       _buffer;
 
 	bool respond_with_cache{false};
 	std::shared_ptr<const std::string> cache;
 
+	file_handle_ptr   _file;
+	size_t            _file_offset;
+	size_t            _file_length;
+
+	stream_channel_ptr                       _stream;
+	std::weak_ptr<response_stream::writer>   _stream_writer;
+	size_t                                   _max_stream_pending_bytes;
+	bool                                     _stream_chunked;
+
+	std::shared_ptr<websocket>               _websocket;
+
 
 public:
 	//  -----  constructors  -----
@@ -109,6 +162,58 @@ public:
 	 */
 	void set_response(const std::shared_ptr<const std::string> &res);
 
+	/*
+	 * Set the body of the response to a region of an open file.
+	 *
+	 * The file region replaces any other body. Rather than being copied into the response, it is
+	 * sent from the file to the socket when the response is written, using sendfile(2) where
+	 * supported.
+	 *
+	 * @param file the open file
+	 * @param offset the offset of the region within the file
+	 * @param length the length of the region in bytes
+	 */
+	void set_file_body(const file_handle_ptr & file, size_t offset, size_t length);
+
+	/*
+	 * Streams the body of the response, see response_stream.
+	 *
+	 * The response header is sent once the handler has completed, without a Content-Length, and
+	 * the body set so far is sent as the first chunk. Every call returns a handle to the same
+	 * stream, which is closed once no handles remain.
+	 *
+	 * @return the stream
+	 */
+	response_stream stream();
+
+	/*
+	 * Sets the number of pending bytes at which writers of a stream should wait.
+	 *
+	 * Set by the connection before a request is handled, see server::set_max_stream_pending_bytes.
+	 *
+	 * @param num_bytes the number of bytes, 0 is ignored and no limit is used
+	 */
+	void set_max_stream_pending_bytes(size_t num_bytes);
+
+	/*
+	 * Selects whether a streamed body uses chunked transfer encoding.
+	 *
+	 * Clients that do not support chunked encoding, such as HTTP/1.0 clients, are instead sent the
+	 * body as is and the end of the body is marked by closing the connection.
+	 *
+	 * @param chunked true to use chunked transfer encoding, the default
+	 */
+	void set_stream_chunked(bool chunked);
+
+	/*
+	 * Hands the connection to a websocket once this response has been written.
+	 *
+	 * Only takes effect with a 101 status, see websocket::upgrade.
+	 *
+	 * @param ws the websocket
+	 */
+	void set_websocket(std::shared_ptr<websocket> ws);
+
 	/*
 	 * Pipe data to the body of the response.
 	 *
@@ -134,18 +239,107 @@ public:
 	 */
 	size_t body_size();
 
+	/*
+	 * Get the header fields of the response.
+	 *
+	 * @return the fields, keyed by their lower case name, each holding its name as written and value
+	 */
+	const header_list & headers() const { return _headers; }
+
+	/*
+	 * Get the body of the response set so far.
+	 *
+	 * @return the body
+	 */
+	const std::string & body() const { return _body; }
+
+	/*
+	 * Get the complete response set with set_response, if any.
+	 *
+	 * @return the response, or an empty pointer if the response is built from its fields
+	 */
+	std::shared_ptr<const std::string> cached_response() const
+	{
+		return respond_with_cache ? cache : nullptr;
+	}
+
+	/*
+	 * Get the number of bytes allocated by the response body and serialization buffers.
+	 *
+	 * The buffers keep their memory when the response is cleared so that it can be reused.
+	 *
+	 * @return the allocated capacity of the response buffers
+	 */
+	size_t capacity() const { return _body.capacity() + _buffer.capacity(); }
+
+	/*
+	 * Get the file that is sent as the body of the response, if any.
+	 *
+	 * @return the file, or an empty pointer if the body is not a file
+	 */
+	const file_handle_ptr & file_body() const { return _file; }
+
+	/*
+	 * Get the offset of the file region sent as the body of the response.
+	 *
+	 * @return the offset within the file
+	 */
+	size_t file_body_offset() const { return _file_offset; }
+
+	/*
+	 * Get the length of the file region sent as the body of the response.
+	 *
+	 * @return the length in bytes
+	 */
+	size_t file_body_length() const { return _file_length; }
+
+	/*
+	 * Get the channel of the streamed body of the response, if any.
+	 *
+	 * @return the channel, or an empty pointer if the body is not streamed
+	 */
+	const stream_channel_ptr & body_stream() const { return _stream; }
+
+	/*
+	 * Indicates whether a streamed body uses chunked transfer encoding.
+	 *
+	 * @return true if chunks are framed with chunked transfer encoding
+	 */
+	bool stream_chunked() const { return _stream_chunked; }
+
+	/*
+	 * Get the websocket the connection is handed to, if any.
+	 *
+	 * @return the websocket, or an empty pointer if the connection is not upgraded
+	 */
+	const std::shared_ptr<websocket> & upgraded_websocket() const { return _websocket; }
+
 	//  -----  serializer  -----
 
 	/*
 	 * Generate an HTTP response from this object.
 	 *
 	 * Uses the configured parameters to generate a full HTTP response and returns it as a
-	 * std::string.
+	 * std::string. This copies the body, to_buffers() should be preferred for writing to a socket.
 	 *
 	 * @return the HTTP response
 	 */
 	const std::string & to_buffer();
 
+	/*
+	 * Generate an HTTP response from this object as a sequence of buffers.
+	 *
+	 * Serializes the status line and headers into a header block, and appends buffers for the
+	 * header block followed by the body to the given sequence. The body is referenced rather than
+	 * copied, so the buffers are only valid while this response is unmodified.
+	 *
+	 * A file body is not included, it must be sent after the buffers. Nor is a streamed body, the
+	 * buffers end with the body set so far as its first chunk.
+	 *
+	 * @param buffers the buffer sequence to append to
+	 */
+	void to_buffers(std::vector<boost::asio::const_buffer> & buffers);
+
 	//  -----  stock reply  -----
 
 	/*
@@ -43,3 +43,28 @@ TEST_CASE("generates compliant HTTP response", "[response]") {
 	served::response::stock_reply(200, res);
 	REQUIRE(res.to_buffer() == response);
 }
+
+TEST_CASE("serializes response as header and body buffers", "[response]") {
+	served::response res;
+	res.set_header("Content-Type", "text/plain");
+	res << "Hello" << " " << "World!";
+
+	std::vector<boost::asio::const_buffer> buffers;
+	res.to_buffers(buffers);
+
+	REQUIRE(buffers.size() == 2);
+
+	std::string header(boost::asio::buffer_cast<const char*>(buffers[0]), boost::asio::buffer_size(buffers[0]));
+	std::string body(boost::asio::buffer_cast<const char*>(buffers[1]), boost::asio::buffer_size(buffers[1]));
+
+	CHECK(header ==
+		"HTTP/1.1 200 OK\r\n"
+		"Server: served-v" + std::string(APPLICATION_VERSION_STRING) + "\r\n"
+		"Content-Type: text/plain\r\n"
+		"Content-Length: 12\r\n"
+		"\r\n");
+	CHECK(body == "Hello World!");
+
+	const std::string full = header + body;
+	CHECK(full == res.to_buffer());
+}
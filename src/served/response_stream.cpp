@@ -0,0 +1,399 @@
+/*
+ * Copyright (C) 2021 QM Ltd.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <served/response_stream.hpp>
+
+#include <algorithm>
+#include <utility>
+
+using namespace served;
+
+//  -----  stream channel  -----
+
+stream_channel::stream_channel(size_t max_pending_bytes)
+	: _mutex()
+	, _writable()
+	, _chunks()
+	, _pending_bytes(0)
+	, _max_pending_bytes(max_pending_bytes)
+	, _closed(false)
+	, _aborted(false)
+	, _disconnected(false)
+	, _notified(false)
+	, _active(false)
+	, _heartbeat()
+	, _heartbeat_ms(0)
+	, _notify()
+	, _writable_callbacks()
+{
+}
+
+bool
+stream_channel::push(stream_chunk_ptr chunk)
+{
+	std::function<void()> notify;
+	bool                  writable;
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		if ( _closed || _aborted )
+		{
+			return false;
+		}
+		if ( chunk && ! chunk->empty() )
+		{
+			_active = true;
+			notify  = queue(std::move(chunk));
+		}
+		writable = _max_pending_bytes == 0 || _pending_bytes < _max_pending_bytes;
+	}
+
+	if ( notify )
+	{
+		notify();
+	}
+	return writable;
+}
+
+void
+stream_channel::close()
+{
+	std::function<void()> notify;
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		if ( _closed || _aborted )
+		{
+			return;
+		}
+		_closed = true;
+
+		if ( _notify && ! _notified )
+		{
+			_notified = true;
+			notify    = _notify;
+		}
+	}
+	_writable.notify_all();
+
+	if ( notify )
+	{
+		notify();
+	}
+}
+
+bool
+stream_channel::wait_writable()
+{
+	std::unique_lock<std::mutex> lock(_mutex);
+	_writable.wait(lock, [this]() {
+		return _closed || _aborted || _max_pending_bytes == 0 || _pending_bytes < _max_pending_bytes;
+	});
+	return ! ( _closed || _aborted );
+}
+
+void
+stream_channel::on_writable(std::function<void()> callback)
+{
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		if ( ! _aborted && _max_pending_bytes > 0 && _pending_bytes >= _max_pending_bytes )
+		{
+			_writable_callbacks.push_back(std::move(callback));
+			return;
+		}
+	}
+	callback();
+}
+
+bool
+stream_channel::is_open() const
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+	return ! ( _closed || _aborted );
+}
+
+void
+stream_channel::disconnect()
+{
+	std::function<void()>              notify;
+	std::vector<std::function<void()>> callbacks;
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		if ( _aborted )
+		{
+			return;
+		}
+		_aborted      = true;
+		_disconnected = true;
+		notify        = std::move(_notify);
+		_notify       = nullptr;
+		_chunks.clear();
+		callbacks = take_writable_callbacks();
+	}
+	_writable.notify_all();
+
+	for ( auto & callback : callbacks )
+	{
+		callback();
+	}
+	if ( notify )
+	{
+		notify();
+	}
+}
+
+void
+stream_channel::set_heartbeat(stream_chunk_ptr frame, int interval_ms)
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+	_heartbeat    = std::move(frame);
+	_heartbeat_ms = ( _heartbeat && ! _heartbeat->empty() ) ? interval_ms : 0;
+}
+
+void
+stream_channel::attach(std::function<void()> notify)
+{
+	bool pending;
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		if ( _disconnected )
+		{
+			// Disconnected before the response was written, the connection is closed at once.
+			pending = static_cast<bool>(notify);
+		}
+		else
+		{
+			_notify   = _aborted ? nullptr : std::move(notify);
+			_notified = false;
+			pending   = _notify && ( ! _chunks.empty() || _closed );
+		}
+		if ( pending && _notify )
+		{
+			_notified = true;
+			notify    = _notify;
+		}
+	}
+
+	if ( pending )
+	{
+		notify();
+	}
+}
+
+bool
+stream_channel::take(std::vector<stream_chunk_ptr> & chunks)
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+	_notified = false;
+
+	if ( chunks.empty() )
+	{
+		chunks.swap(_chunks);
+	}
+	else
+	{
+		chunks.insert(chunks.end(), _chunks.begin(), _chunks.end());
+		_chunks.clear();
+	}
+	return _closed;
+}
+
+void
+stream_channel::written(size_t bytes)
+{
+	std::vector<std::function<void()>> callbacks;
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		const bool was_writable = _max_pending_bytes == 0 || _pending_bytes < _max_pending_bytes;
+
+		_pending_bytes -= std::min(bytes, _pending_bytes);
+
+		if ( was_writable || _pending_bytes >= _max_pending_bytes )
+		{
+			return;
+		}
+		callbacks = take_writable_callbacks();
+	}
+	_writable.notify_all();
+
+	for ( auto & callback : callbacks )
+	{
+		callback();
+	}
+}
+
+void
+stream_channel::abort()
+{
+	std::vector<std::function<void()>> callbacks;
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		if ( _aborted )
+		{
+			return;
+		}
+		_aborted = true;
+		_notify  = nullptr;
+		_chunks.clear();
+		callbacks = take_writable_callbacks();
+	}
+	_writable.notify_all();
+
+	for ( auto & callback : callbacks )
+	{
+		callback();
+	}
+}
+
+bool
+stream_channel::is_disconnected() const
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+	return _disconnected;
+}
+
+int
+stream_channel::heartbeat_interval() const
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+	return _heartbeat_ms;
+}
+
+bool
+stream_channel::heartbeat()
+{
+	std::function<void()> notify;
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		if ( _closed || _aborted || ! _heartbeat )
+		{
+			return true;
+		}
+		if ( _max_pending_bytes > 0 && _pending_bytes >= _max_pending_bytes )
+		{
+			return false;
+		}
+		if ( _active )
+		{
+			// The stream is not idle, the next heartbeat is skipped.
+			_active = false;
+			return true;
+		}
+		notify = queue(_heartbeat);
+	}
+
+	if ( notify )
+	{
+		notify();
+	}
+	return true;
+}
+
+std::function<void()>
+stream_channel::queue(stream_chunk_ptr chunk)
+{
+	_pending_bytes += chunk->size();
+	_chunks.push_back(std::move(chunk));
+
+	if ( _notify && ! _notified )
+	{
+		_notified = true;
+		return _notify;
+	}
+	return nullptr;
+}
+
+std::vector<std::function<void()>>
+stream_channel::take_writable_callbacks()
+{
+	std::vector<std::function<void()>> callbacks;
+	callbacks.swap(_writable_callbacks);
+	return callbacks;
+}
+
+//  -----  response stream  -----
+
+struct response_stream::writer
+{
+	stream_channel_ptr channel;
+
+	explicit writer(stream_channel_ptr channel)
+		: channel(std::move(channel))
+	{
+	}
+
+	~writer()
+	{
+		channel->close();
+	}
+};
+
+response_stream::response_stream(stream_channel_ptr channel)
+	: _writer(std::make_shared<writer>(std::move(channel)))
+{
+}
+
+response_stream::response_stream(std::shared_ptr<writer> writer)
+	: _writer(std::move(writer))
+{
+}
+
+bool
+response_stream::write(const std::string & chunk)
+{
+	return _writer->channel->push(std::make_shared<const std::string>(chunk));
+}
+
+bool
+response_stream::write(stream_chunk_ptr chunk)
+{
+	return _writer->channel->push(std::move(chunk));
+}
+
+void
+response_stream::close()
+{
+	_writer->channel->close();
+}
+
+bool
+response_stream::wait_writable()
+{
+	return _writer->channel->wait_writable();
+}
+
+void
+response_stream::on_writable(std::function<void()> callback)
+{
+	_writer->channel->on_writable(std::move(callback));
+}
+
+bool
+response_stream::is_open() const
+{
+	return _writer->channel->is_open();
+}
+
+const stream_channel_ptr &
+response_stream::channel() const
+{
+	return _writer->channel;
+}
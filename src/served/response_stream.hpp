@@ -0,0 +1,297 @@
+/*
+ * Copyright (C) 2021 QM Ltd.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef SERVED_RESPONSE_STREAM_HPP
+#define SERVED_RESPONSE_STREAM_HPP
+
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace served {
+
+typedef std::shared_ptr<const std::string> stream_chunk_ptr;
+
+/*
+ * The chunks of a streamed response that are waiting to be written.
+ *
+ * A channel is shared by the response_stream handles of a handler and the connection writing the
+ * response. Chunks are counted as pending from the moment they are written by the handler until
+ * the connection has sent them, and the handler is expected to wait while the pending bytes are
+ * at the limit of the channel.
+ */
+class stream_channel
+{
+	mutable std::mutex                 _mutex;
+	std::condition_variable            _writable;
+	std::vector<stream_chunk_ptr>      _chunks;
+	size_t                             _pending_bytes;
+	size_t                             _max_pending_bytes;
+	bool                               _closed;
+	bool                               _aborted;
+	bool                               _disconnected;
+	bool                               _notified;
+	bool                               _active;
+	stream_chunk_ptr                   _heartbeat;
+	int                                _heartbeat_ms;
+	std::function<void()>              _notify;
+	std::vector<std::function<void()>> _writable_callbacks;
+
+public:
+	stream_channel(const stream_channel&) = delete;
+
+	stream_channel& operator=(const stream_channel&) = delete;
+
+	/*
+	 * Constructs an open channel.
+	 *
+	 * @param max_pending_bytes the number of pending bytes at which writers should wait, 0 is ignored
+	 */
+	explicit stream_channel(size_t max_pending_bytes);
+
+	//  -----  writer side  -----
+
+	/*
+	 * Queues a chunk to be written.
+	 *
+	 * Empty chunks are ignored, as an empty chunk ends a chunked response.
+	 *
+	 * @param chunk the chunk
+	 *
+	 * @return false if the pending bytes are now at the limit, or the channel is not open
+	 */
+	bool push(stream_chunk_ptr chunk);
+
+	/*
+	 * Marks the end of the stream, once the pending chunks are written the response is complete.
+	 */
+	void close();
+
+	/*
+	 * Blocks until the pending bytes are below the limit, or the channel is no longer open.
+	 *
+	 * @return true if the channel is open
+	 */
+	bool wait_writable();
+
+	/*
+	 * Calls a callback once the pending bytes are below the limit, or the channel is aborted.
+	 *
+	 * The callback is called immediately if that is already the case, and otherwise from the
+	 * thread writing the response.
+	 *
+	 * @param callback the callback
+	 */
+	void on_writable(std::function<void()> callback);
+
+	/*
+	 * Indicates whether more chunks can be written.
+	 *
+	 * @return false once the channel is closed or aborted
+	 */
+	bool is_open() const;
+
+	/*
+	 * Aborts the stream and closes its connection, used to drop a client that is not keeping up.
+	 */
+	void disconnect();
+
+	/*
+	 * Sets a frame to send whenever the stream has been idle for an interval.
+	 *
+	 * Heartbeats keep intermediaries from timing out a quiet stream. Must be set before the
+	 * response is written.
+	 *
+	 * @param frame the frame to send, it must be valid in the body of the stream
+	 * @param interval_ms the interval in milliseconds, 0 disables heartbeats
+	 */
+	void set_heartbeat(stream_chunk_ptr frame, int interval_ms);
+
+	//  -----  connection side  -----
+
+	/*
+	 * Sets the callback made when chunks, or the end of the stream, are waiting to be taken.
+	 *
+	 * The callback may be called from any thread and is called at most once per take. An empty
+	 * function detaches the channel from its connection.
+	 *
+	 * @param notify the callback
+	 */
+	void attach(std::function<void()> notify);
+
+	/*
+	 * Takes the chunks waiting to be written.
+	 *
+	 * @param chunks the vector to append the chunks to
+	 *
+	 * @return true if the stream is closed, and the taken chunks are the last
+	 */
+	bool take(std::vector<stream_chunk_ptr> & chunks);
+
+	/*
+	 * Releases bytes once they have been written, waking writers below the limit.
+	 *
+	 * @param bytes the number of bytes written
+	 */
+	void written(size_t bytes);
+
+	/*
+	 * Aborts the stream when the connection is lost, waking all writers.
+	 */
+	void abort();
+
+	/*
+	 * Indicates whether the writer has disconnected the stream.
+	 *
+	 * @return true if the connection should be closed
+	 */
+	bool is_disconnected() const;
+
+	/*
+	 * Get the heartbeat interval of the stream.
+	 *
+	 * @return the interval in milliseconds, 0 if heartbeats are disabled
+	 */
+	int heartbeat_interval() const;
+
+	/*
+	 * Queues the heartbeat frame unless a chunk has been written since the last heartbeat.
+	 *
+	 * @return false if the pending bytes are at the limit, the client is not keeping up
+	 */
+	bool heartbeat();
+
+private:
+	/*
+	 * Queues a chunk with the mutex held.
+	 *
+	 * @return the callback to make once the mutex is released, if any
+	 */
+	std::function<void()> queue(stream_chunk_ptr chunk);
+
+	/*
+	 * Takes the callbacks to run once writers may continue, with the mutex held.
+	 */
+	std::vector<std::function<void()>> take_writable_callbacks();
+};
+
+typedef std::shared_ptr<stream_channel> stream_channel_ptr;
+
+/*
+ * A handle used by a request handler to stream the body of its response.
+ *
+ * A stream is obtained from response::stream(). Once the handler has returned, or completed its
+ * deferred_response, the response header is sent with Transfer-Encoding: chunked, followed by any
+ * body already set on the response. Chunks written to the stream are then sent as they arrive,
+ * and the response ends once the stream is closed. Copies of the stream may be written from any
+ * thread, the response is closed once every copy is destroyed.
+ *
+ * The bytes waiting to be sent are limited per connection, see
+ * server::set_max_stream_pending_bytes. Writers should wait, using wait_writable or on_writable,
+ * whenever write returns false.
+ */
+class response_stream
+{
+	// Closes the channel once the last handle is destroyed.
+	struct writer;
+
+	friend class response;
+
+	std::shared_ptr<writer> _writer;
+
+	explicit response_stream(std::shared_ptr<writer> writer);
+
+public:
+	//  -----  constructors  -----
+
+	/*
+	 * Constructs a stream writing to a channel.
+	 *
+	 * @param channel the channel of the response
+	 */
+	explicit response_stream(stream_channel_ptr channel);
+
+	//  -----  writing  -----
+
+	/*
+	 * Writes a chunk of the body.
+	 *
+	 * @param chunk the data to write
+	 *
+	 * @return false if the writer should wait before writing more, or the stream is not open
+	 */
+	bool write(const std::string & chunk);
+
+	/*
+	 * Writes a chunk of the body without copying it.
+	 *
+	 * The same chunk may be shared by many streams.
+	 *
+	 * @param chunk the data to write
+	 *
+	 * @return false if the writer should wait before writing more, or the stream is not open
+	 */
+	bool write(stream_chunk_ptr chunk);
+
+	/*
+	 * Ends the response once the chunks already written have been sent.
+	 */
+	void close();
+
+	/*
+	 * Blocks until more chunks may be written.
+	 *
+	 * Must not be called from a handler running on an I/O thread, as that thread sends the
+	 * pending chunks.
+	 *
+	 * @return true if the stream is open, false if it is closed or the client disconnected
+	 */
+	bool wait_writable();
+
+	/*
+	 * Calls a callback once more chunks may be written, or the client has disconnected.
+	 *
+	 * @param callback called once, immediately or from the I/O thread of the connection
+	 */
+	void on_writable(std::function<void()> callback);
+
+	/*
+	 * Indicates whether the stream is open.
+	 *
+	 * @return false once the stream is closed or the client disconnected
+	 */
+	bool is_open() const;
+
+	/*
+	 * Get the channel the stream writes to.
+	 *
+	 * @return the channel
+	 */
+	const stream_channel_ptr & channel() const;
+};
+
+} // served
+
+#endif // SERVED_RESPONSE_STREAM_HPP
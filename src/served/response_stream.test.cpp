@@ -0,0 +1,118 @@
+/*
+ * Copyright (C) 2021 QM Ltd.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <test/catch.hpp>
+
+#include <served/response.hpp>
+#include <served/response_stream.hpp>
+
+#include <atomic>
+#include <thread>
+
+TEST_CASE("response stream back pressure", "[response_stream]")
+{
+	auto channel = std::make_shared<served::stream_channel>(10);
+	served::response_stream stream(channel);
+
+	int notified = 0;
+	channel->attach([&]() { notified++; });
+
+	SECTION("writes until the limit")
+	{
+		CHECK(stream.write("12345"));
+		CHECK_FALSE(stream.write("67890"));
+		CHECK(notified == 1);
+
+		std::vector<served::stream_chunk_ptr> chunks;
+		CHECK_FALSE(channel->take(chunks));
+		REQUIRE(chunks.size() == 2);
+		CHECK(*chunks[1] == "67890");
+
+		int resumed = 0;
+		stream.on_writable([&]() { resumed++; });
+		CHECK(resumed == 0);
+
+		channel->written(4);
+		CHECK(resumed == 1);
+		CHECK(stream.write("x"));
+		CHECK(notified == 2);
+	}
+
+	SECTION("waiting writers resume once written")
+	{
+		CHECK_FALSE(stream.write(std::string(20, 'x')));
+
+		std::atomic<bool> resumed(false);
+		std::thread writer([&]() {
+			resumed = stream.wait_writable();
+		});
+
+		channel->written(20);
+		writer.join();
+		CHECK(resumed);
+	}
+
+	SECTION("aborted streams release writers")
+	{
+		CHECK_FALSE(stream.write(std::string(20, 'x')));
+
+		bool called = false;
+		stream.on_writable([&]() { called = true; });
+		channel->abort();
+
+		CHECK(called);
+		CHECK_FALSE(stream.is_open());
+		CHECK_FALSE(stream.wait_writable());
+		CHECK_FALSE(stream.write("more"));
+	}
+
+	SECTION("closed once every handle is destroyed")
+	{
+		{
+			auto copy = stream;
+			copy.write("last");
+		}
+		CHECK(stream.is_open());
+
+		stream = served::response_stream(std::make_shared<served::stream_channel>(0));
+
+		std::vector<served::stream_chunk_ptr> chunks;
+		CHECK(channel->take(chunks));
+		CHECK(chunks.size() == 1);
+	}
+}
+
+TEST_CASE("response streams use chunked encoding", "[response_stream]")
+{
+	served::response res;
+	res << "first";
+	{
+		auto stream = res.stream();
+		CHECK(res.stream().channel() == stream.channel());
+	}
+	CHECK_FALSE(res.body_stream()->is_open());
+
+	const std::string & buffer = res.to_buffer();
+	CHECK(buffer.find("Transfer-Encoding: chunked\r\n") != std::string::npos);
+	CHECK(buffer.find("Content-Length") == std::string::npos);
+	CHECK(buffer.substr(buffer.length() - 12) == "\r\n5\r\nfirst\r\n");
+}
@@ -0,0 +1,217 @@
+/*
+ * Copyright (C) 2021 QM Ltd.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <served/sse.hpp>
+
+#include <utility>
+
+using namespace served;
+
+namespace {
+
+/*
+ * Appends a field to a frame, with a line of the field for each line of the value.
+ */
+void
+append_field(std::string & frame, const char * name, const std::string & value)
+{
+	size_t start = 0;
+	do
+	{
+		size_t end = value.find('\n', start);
+		if ( end == std::string::npos )
+		{
+			end = value.length();
+		}
+
+		size_t line_end = end;
+		if ( line_end > start && value[line_end - 1] == '\r' )
+		{
+			line_end--;
+		}
+
+		frame.append(name);
+		frame.append(value, start, line_end - start);
+		frame.push_back('\n');
+		start = end + 1;
+	}
+	while ( start <= value.length() );
+}
+
+} // anonymous namespace
+
+//  -----  sse channel  -----
+
+sse_channel::sse_channel(response_stream stream)
+	: _stream(std::move(stream))
+{
+}
+
+stream_chunk_ptr
+sse_channel::frame(const std::string & data, const std::string & event, const std::string & id)
+{
+	std::string frame;
+	frame.reserve(data.length() + event.length() + id.length() + 24);
+
+	if ( ! event.empty() )
+	{
+		append_field(frame, "event: ", event);
+	}
+	if ( ! id.empty() )
+	{
+		append_field(frame, "id: ", id);
+	}
+	append_field(frame, "data: ", data);
+	frame.push_back('\n');
+
+	return std::make_shared<const std::string>(std::move(frame));
+}
+
+stream_chunk_ptr
+sse_channel::comment_frame(const std::string & text)
+{
+	std::string frame;
+	append_field(frame, ": ", text);
+	frame.push_back('\n');
+
+	return std::make_shared<const std::string>(std::move(frame));
+}
+
+bool
+sse_channel::send(const std::string & data, const std::string & event, const std::string & id)
+{
+	return send(frame(data, event, id));
+}
+
+bool
+sse_channel::send(stream_chunk_ptr frame)
+{
+	if ( _stream.write(std::move(frame)) )
+	{
+		return true;
+	}
+
+	// Pending bytes at the limit, the client is not keeping up.
+	if ( _stream.is_open() )
+	{
+		_stream.channel()->disconnect();
+	}
+	return false;
+}
+
+bool
+sse_channel::comment(const std::string & text)
+{
+	return send(comment_frame(text));
+}
+
+void
+sse_channel::close()
+{
+	_stream.close();
+}
+
+bool
+sse_channel::is_open() const
+{
+	return _stream.is_open();
+}
+
+//  -----  sse broadcaster  -----
+
+sse_broadcaster::sse_broadcaster()
+	: _mutex()
+	, _subscribers()
+{
+}
+
+void
+sse_broadcaster::subscribe(sse_channel channel)
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+	_subscribers.push_back(std::move(channel));
+}
+
+size_t
+sse_broadcaster::publish(const std::string & data, const std::string & event, const std::string & id)
+{
+	return publish(sse_channel::frame(data, event, id));
+}
+
+size_t
+sse_broadcaster::publish(stream_chunk_ptr frame)
+{
+	// Dropped subscribers are released outside of the lock, as that may call back into writers.
+	std::vector<sse_channel> dropped;
+	size_t                   sent = 0;
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		for ( size_t i = 0; i < _subscribers.size(); )
+		{
+			if ( _subscribers[i].stream().channel()->push(frame) )
+			{
+				sent++;
+				i++;
+				continue;
+			}
+
+			dropped.push_back(std::move(_subscribers[i]));
+			if ( i + 1 < _subscribers.size() )
+			{
+				_subscribers[i] = std::move(_subscribers.back());
+			}
+			_subscribers.pop_back();
+		}
+	}
+
+	for ( auto & subscriber : dropped )
+	{
+		if ( subscriber.is_open() )
+		{
+			// Queued, but the pending bytes are now at the limit.
+			subscriber.stream().channel()->disconnect();
+		}
+	}
+	return sent;
+}
+
+void
+sse_broadcaster::close()
+{
+	std::vector<sse_channel> subscribers;
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		subscribers.swap(_subscribers);
+	}
+
+	for ( auto & subscriber : subscribers )
+	{
+		subscriber.close();
+	}
+}
+
+size_t
+sse_broadcaster::size() const
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+	return _subscribers.size();
+}
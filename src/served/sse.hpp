@@ -0,0 +1,200 @@
+/*
+ * Copyright (C) 2021 QM Ltd.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef SERVED_SSE_HPP
+#define SERVED_SSE_HPP
+
+#include <mutex>
+#include <string>
+#include <vector>
+#include <served/response_stream.hpp>
+
+namespace served {
+
+/*
+ * A Server-Sent Events stream to a single client.
+ *
+ * A channel is given to the handler of an SSE endpoint, see methods_handler::sse. The response is
+ * kept open while any copy of the channel remains, and ends once the last copy is destroyed or
+ * the channel is closed. Events may be sent from any thread.
+ *
+ * Events are not waited on. A client whose pending bytes reach the limit of the connection, see
+ * server::set_max_stream_pending_bytes, is disconnected rather than holding up the sender.
+ */
+class sse_channel
+{
+	response_stream _stream;
+
+public:
+	//  -----  constructors  -----
+
+	/*
+	 * Constructs a channel sending events to a response stream.
+	 *
+	 * @param stream the stream of the response
+	 */
+	explicit sse_channel(response_stream stream);
+
+	//  -----  framing  -----
+
+	/*
+	 * Serializes an event into a frame.
+	 *
+	 * Each line of the data is sent as a data field. A frame may be sent to any number of
+	 * channels without being copied.
+	 *
+	 * @param data the data of the event
+	 * @param event the type of the event, omitted if empty
+	 * @param id the id of the event, omitted if empty
+	 *
+	 * @return the frame
+	 */
+	static stream_chunk_ptr frame( const std::string & data
+	                             , const std::string & event = ""
+	                             , const std::string & id    = "" );
+
+	/*
+	 * Serializes a comment into a frame, comments are ignored by clients.
+	 *
+	 * @param text the text of the comment
+	 *
+	 * @return the frame
+	 */
+	static stream_chunk_ptr comment_frame(const std::string & text);
+
+	//  -----  sending  -----
+
+	/*
+	 * Sends an event.
+	 *
+	 * @param data the data of the event
+	 * @param event the type of the event, omitted if empty
+	 * @param id the id of the event, omitted if empty
+	 *
+	 * @return false if the client has disconnected, or was disconnected for being too slow
+	 */
+	bool send( const std::string & data
+	         , const std::string & event = ""
+	         , const std::string & id    = "" );
+
+	/*
+	 * Sends a frame that has already been serialized.
+	 *
+	 * @param frame the frame, see frame and comment_frame
+	 *
+	 * @return false if the client has disconnected, or was disconnected for being too slow
+	 */
+	bool send(stream_chunk_ptr frame);
+
+	/*
+	 * Sends a comment.
+	 *
+	 * @param text the text of the comment
+	 *
+	 * @return false if the client has disconnected, or was disconnected for being too slow
+	 */
+	bool comment(const std::string & text);
+
+	/*
+	 * Ends the response once the events already sent have been written.
+	 */
+	void close();
+
+	/*
+	 * Indicates whether events can be sent.
+	 *
+	 * @return false once the channel is closed or the client disconnected
+	 */
+	bool is_open() const;
+
+	/*
+	 * Get the stream the channel sends events to.
+	 *
+	 * @return the stream
+	 */
+	const response_stream & stream() const { return _stream; }
+};
+
+/*
+ * Sends events to many SSE channels.
+ *
+ * Each event is serialized once and the same frame is queued on every subscriber. Subscribers
+ * that have disconnected, or that are too slow to keep up, are dropped as events are published.
+ * A broadcaster may be used from any thread.
+ */
+class sse_broadcaster
+{
+	mutable std::mutex       _mutex;
+	std::vector<sse_channel> _subscribers;
+
+public:
+	sse_broadcaster(const sse_broadcaster&) = delete;
+
+	sse_broadcaster& operator=(const sse_broadcaster&) = delete;
+
+	sse_broadcaster();
+
+	/*
+	 * Adds a channel to the subscribers.
+	 *
+	 * @param channel the channel
+	 */
+	void subscribe(sse_channel channel);
+
+	/*
+	 * Publishes an event to all subscribers.
+	 *
+	 * @param data the data of the event
+	 * @param event the type of the event, omitted if empty
+	 * @param id the id of the event, omitted if empty
+	 *
+	 * @return the number of subscribers the event was queued for
+	 */
+	size_t publish( const std::string & data
+	              , const std::string & event = ""
+	              , const std::string & id    = "" );
+
+	/*
+	 * Publishes a frame that has already been serialized to all subscribers.
+	 *
+	 * @param frame the frame, see sse_channel::frame
+	 *
+	 * @return the number of subscribers the frame was queued for
+	 */
+	size_t publish(stream_chunk_ptr frame);
+
+	/*
+	 * Closes and drops all subscribers.
+	 */
+	void close();
+
+	/*
+	 * Get the number of subscribers.
+	 *
+	 * @return the number of subscribers, including any that have disconnected since the last publish
+	 */
+	size_t size() const;
+};
+
+} // served
+
+#endif // SERVED_SSE_HPP
@@ -0,0 +1,157 @@
+/*
+ * Copyright (C) 2021 QM Ltd.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <test/catch.hpp>
+
+#include <served/sse.hpp>
+
+#include <memory>
+#include <vector>
+
+TEST_CASE("sse frames", "[sse]")
+{
+	SECTION("data lines are split")
+	{
+		CHECK(*served::sse_channel::frame("hello") == "data: hello\n\n");
+		CHECK(*served::sse_channel::frame("a\nb\r\nc", "progress", "7")
+			== "event: progress\nid: 7\ndata: a\ndata: b\ndata: c\n\n");
+		CHECK(*served::sse_channel::frame("") == "data: \n\n");
+	}
+
+	SECTION("comments")
+	{
+		CHECK(*served::sse_channel::comment_frame("ping") == ": ping\n\n");
+	}
+}
+
+TEST_CASE("sse broadcaster", "[sse]")
+{
+	auto fast = std::make_shared<served::stream_channel>(64);
+	auto slow = std::make_shared<served::stream_channel>(64);
+
+	served::sse_broadcaster broadcaster;
+	broadcaster.subscribe(served::sse_channel(served::response_stream(fast)));
+	broadcaster.subscribe(served::sse_channel(served::response_stream(slow)));
+	REQUIRE(broadcaster.size() == 2);
+
+	SECTION("frames are shared by subscribers")
+	{
+		CHECK(broadcaster.publish("tick") == 2);
+
+		std::vector<served::stream_chunk_ptr> fast_chunks, slow_chunks;
+		fast->take(fast_chunks);
+		slow->take(slow_chunks);
+		REQUIRE(fast_chunks.size() == 1);
+		REQUIRE(slow_chunks.size() == 1);
+		CHECK(fast_chunks[0].get() == slow_chunks[0].get());
+		CHECK(*fast_chunks[0] == "data: tick\n\n");
+	}
+
+	SECTION("slow subscribers are disconnected")
+	{
+		int disconnected = 0;
+		slow->attach([&]() {
+			if ( slow->is_disconnected() )
+			{
+				disconnected++;
+			}
+		});
+
+		const std::string event(20, 'x');
+		size_t published = 0;
+		for ( int i = 0; i < 4; i++ )
+		{
+			published += broadcaster.publish(event);
+
+			std::vector<served::stream_chunk_ptr> chunks;
+			fast->take(chunks);
+			for ( const auto & chunk : chunks )
+			{
+				fast->written(chunk->size());
+			}
+		}
+
+		// Each frame is 28 bytes, the third takes the slow subscriber over the limit.
+		CHECK(published == 2 + 2 + 1 + 1);
+		CHECK(broadcaster.size() == 1);
+		CHECK(slow->is_disconnected());
+		CHECK(disconnected == 1);
+		CHECK(fast->is_open());
+	}
+
+	SECTION("closed subscribers are dropped")
+	{
+		fast->abort();
+		CHECK(broadcaster.publish("tick") == 1);
+		CHECK(broadcaster.size() == 1);
+
+		broadcaster.close();
+		CHECK(broadcaster.size() == 0);
+		CHECK_FALSE(slow->is_open());
+	}
+}
+
+TEST_CASE("sse heartbeats", "[sse]")
+{
+	auto channel = std::make_shared<served::stream_channel>(16);
+	served::sse_channel sse { served::response_stream(channel) };
+
+	auto ping = served::sse_channel::comment_frame("");
+	channel->set_heartbeat(ping, 1000);
+	CHECK(channel->heartbeat_interval() == 1000);
+
+	std::vector<served::stream_chunk_ptr> chunks;
+
+	SECTION("idle streams send heartbeats")
+	{
+		CHECK(channel->heartbeat());
+		channel->take(chunks);
+		REQUIRE(chunks.size() == 1);
+		CHECK(chunks[0] == ping);
+	}
+
+	SECTION("heartbeats are skipped after events")
+	{
+		CHECK(sse.send("a"));
+		CHECK(channel->heartbeat());
+		channel->take(chunks);
+		CHECK(chunks.size() == 1);
+
+		chunks.clear();
+		CHECK(channel->heartbeat());
+		channel->take(chunks);
+		CHECK(chunks.size() == 1);
+	}
+
+	SECTION("stalled clients fail the heartbeat")
+	{
+		channel->push(std::make_shared<const std::string>(16, 'x'));
+		CHECK_FALSE(channel->heartbeat());
+	}
+
+	SECTION("slow clients are disconnected on send")
+	{
+		CHECK_FALSE(sse.send("0123456789"));
+		CHECK(channel->is_disconnected());
+		CHECK_FALSE(sse.is_open());
+	}
+}
@@ -116,27 +116,36 @@ query_unescape(const std::string& s) {
 //  -----  URI component mutators  -----
 
 void
-uri::set_URI(std::string const& uri)
+uri::clear()
 {
-	_uri = uri;
+	_uri.clear();
+	_path.clear();
+	_query.clear();
+	_fragment.clear();
 }
 
 void
-uri::set_path(std::string const& path)
+uri::set_URI(string_view uri)
 {
-	_path = path;
+	_uri.assign(uri.data(), uri.size());
 }
 
 void
-uri::set_query(std::string const& query)
+uri::set_path(string_view path)
 {
-	_query = query;
+	_path.assign(path.data(), path.size());
 }
 
 void
-uri::set_fragment(std::string const& fragment)
+uri::set_query(string_view query)
 {
-	_fragment = fragment;
+	_query.assign(query.data(), query.size());
+}
+
+void
+uri::set_fragment(string_view fragment)
+{
+	_fragment.assign(fragment.data(), fragment.size());
 }
 
 //  -----  URI component selectors  -----
@@ -25,6 +25,8 @@
 
 #include <string>
 
+#include <served/string_view.hpp>
+
 namespace served {
 
 /*
@@ -45,33 +47,38 @@ class uri
 public:
 	//  -----  URI component mutators  -----
 
+	/*
+	 * Clear every component, keeping the storage so that the URI can be reused.
+	 */
+	void clear();
+
 	/*
 	 * Set the full URI string
 	 *
 	 * @param uri the full uri as a string
 	 */
-	void set_URI(std::string const& uri);
+	void set_URI(string_view uri);
 
 	/*
 	 * Set the URI path string
 	 *
 	 * @param the uri path string
 	 */
-	void set_path(std::string const& path);
+	void set_path(string_view path);
 
 	/*
 	 * Set the URI query string
 	 *
 	 * @param query the uri query string
 	 */
-	void set_query(std::string const& query);
+	void set_query(string_view query);
 
 	/*
 	 * Set the URI fragment string
 	 *
 	 * @param fragment the uri fragment string
 	 */
-	void set_fragment(std::string const& fragment);
+	void set_fragment(string_view fragment);
 
 	//  -----  URI component selectors  -----
 
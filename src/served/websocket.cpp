@@ -0,0 +1,804 @@
+/*
+ * Copyright (C) 2021 QM Ltd.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <served/websocket.hpp>
+#include <served/request.hpp>
+#include <served/request_error.hpp>
+#include <served/response.hpp>
+#include <served/status.hpp>
+
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+#include <new>
+
+#include <boost/asio/post.hpp>
+#include <boost/asio/read.hpp>
+#include <boost/asio/write.hpp>
+#include <boost/uuid/detail/sha1.hpp>
+#include <boost/version.hpp>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
+#if defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
+using namespace served;
+
+namespace {
+
+const size_t read_buffer_size = 8192;
+
+// The most a message is grown by for each read of its payload, beyond the size it has reached.
+const size_t payload_read_size = 64 * 1024;
+
+/*
+ * Checks whether a comma separated header value contains a token, ignoring case.
+ */
+bool
+header_has_token(std::string value, const std::string & token)
+{
+	std::transform(value.begin(), value.end(), value.begin(), ::tolower);
+
+	size_t start = 0;
+	for ( ;; )
+	{
+		size_t end   = value.find(',', start);
+		size_t stop  = ( end == std::string::npos ) ? value.length() : end;
+		size_t first = value.find_first_not_of(" \t", start);
+		size_t last  = value.find_last_not_of(" \t", stop - 1);
+
+		if ( first < stop && last != std::string::npos && last >= first
+		  && value.compare(first, last - first + 1, token) == 0 )
+		{
+			return true;
+		}
+		if ( end == std::string::npos )
+		{
+			return false;
+		}
+		start = end + 1;
+	}
+}
+
+std::string
+base64_encode(const unsigned char * data, size_t len)
+{
+	static const char alphabet[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+	std::string out;
+	out.reserve(( len + 2 ) / 3 * 4);
+	for ( size_t i = 0; i < len; i += 3 )
+	{
+		uint32_t n = uint32_t(data[i]) << 16;
+		if ( i + 1 < len ) n |= uint32_t(data[i + 1]) << 8;
+		if ( i + 2 < len ) n |= uint32_t(data[i + 2]);
+
+		out.push_back(alphabet[( n >> 18 ) & 0x3f]);
+		out.push_back(alphabet[( n >> 12 ) & 0x3f]);
+		out.push_back(i + 1 < len ? alphabet[( n >> 6 ) & 0x3f] : '=');
+		out.push_back(i + 2 < len ? alphabet[n & 0x3f] : '=');
+	}
+	return out;
+}
+
+/*
+ * Formats the header of an unmasked frame, as sent by a server.
+ */
+std::string
+frame_header(websocket::opcode op, size_t len)
+{
+	std::string header;
+	header.push_back(static_cast<char>(0x80 | static_cast<uint8_t>(op)));
+	if ( len < 126 )
+	{
+		header.push_back(static_cast<char>(len));
+	}
+	else if ( len <= 0xffff )
+	{
+		header.push_back(static_cast<char>(126));
+		header.push_back(static_cast<char>(len >> 8));
+		header.push_back(static_cast<char>(len & 0xff));
+	}
+	else
+	{
+		header.push_back(static_cast<char>(127));
+		for ( int shift = 56; shift >= 0; shift -= 8 )
+		{
+			header.push_back(static_cast<char>(( static_cast<uint64_t>(len) >> shift ) & 0xff));
+		}
+	}
+	return header;
+}
+
+bool
+is_close_frame(const std::string & header)
+{
+	return ( static_cast<uint8_t>(header[0]) & 0x0f ) == static_cast<uint8_t>(websocket::opcode::CLOSE);
+}
+
+} // anonymous namespace
+
+const size_t websocket::default_max_message_bytes;
+
+websocket::websocket(size_t max_message_bytes)
+	: _max_message_bytes(max_message_bytes > 0 ? max_message_bytes : default_max_message_bytes)
+	, _on_message()
+	, _on_close()
+	, _io_service(nullptr)
+	, _transport(nullptr)
+	, _owner()
+	, _on_finished()
+	, _buffer()
+	, _buffer_begin(0)
+	, _buffer_end(0)
+	, _frame_started(false)
+	, _frame_opcode(opcode::CONTINUATION)
+	, _frame_fin(false)
+	, _frame_remaining(0)
+	, _frame_offset(0)
+	, _frame_mask()
+	, _frame_target(nullptr)
+	, _in_message(false)
+	, _message_opcode(opcode::TEXT)
+	, _message()
+	, _control()
+	, _read_stopped(false)
+	, _close_written(false)
+	, _close_code(1005)
+	, _close_reason()
+	, _mutex()
+	, _write_queue()
+	, _writing()
+	, _started(false)
+	, _write_scheduled(false)
+	, _close_sent(false)
+	, _finished(false)
+{
+}
+
+//  -----  handlers  -----
+
+void
+websocket::on_message(message_handler handler)
+{
+	_on_message = std::move(handler);
+}
+
+void
+websocket::on_close(close_handler handler)
+{
+	_on_close = std::move(handler);
+}
+
+//  -----  sending  -----
+
+bool
+websocket::send(const std::string & message, bool binary /* = false */)
+{
+	return send(std::make_shared<const std::string>(message), binary);
+}
+
+bool
+websocket::send(stream_chunk_ptr message, bool binary /* = false */)
+{
+	return queue_frame(binary ? opcode::BINARY : opcode::TEXT, std::move(message));
+}
+
+bool
+websocket::ping(const std::string & payload /* = "" */)
+{
+	return queue_frame(opcode::PING, std::make_shared<const std::string>(payload.substr(0, 125)));
+}
+
+void
+websocket::close(uint16_t code /* = 1000 */, const std::string & reason /* = "" */)
+{
+	std::string payload;
+	payload.push_back(static_cast<char>(code >> 8));
+	payload.push_back(static_cast<char>(code & 0xff));
+	payload.append(reason, 0, 123);
+
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		if ( _close_sent || _finished )
+		{
+			return;
+		}
+		_close_sent = true;
+		_write_queue.push_back(frame { frame_header(opcode::CLOSE, payload.size()),
+		                               std::make_shared<const std::string>(std::move(payload)) });
+	}
+	schedule_write();
+}
+
+bool
+websocket::is_open() const
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+	return ! ( _close_sent || _finished );
+}
+
+bool
+websocket::queue_frame(opcode op, stream_chunk_ptr payload)
+{
+	static const stream_chunk_ptr empty = std::make_shared<const std::string>();
+	if ( ! payload )
+	{
+		payload = empty;
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		if ( _close_sent || _finished )
+		{
+			return false;
+		}
+		_write_queue.push_back(frame { frame_header(op, payload->size()), std::move(payload) });
+	}
+	schedule_write();
+	return true;
+}
+
+void
+websocket::schedule_write()
+{
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		if ( ! _started || _write_scheduled || _finished )
+		{
+			return;
+		}
+		_write_scheduled = true;
+	}
+
+	auto self(shared_from_this());
+	boost::asio::post(*_io_service, [this, self]() {
+		do_write();
+	});
+}
+
+void
+websocket::do_write()
+{
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		if ( _finished || _write_queue.empty() )
+		{
+			_write_scheduled = false;
+			return;
+		}
+		_writing.assign(std::make_move_iterator(_write_queue.begin()),
+		                std::make_move_iterator(_write_queue.end()));
+		_write_queue.clear();
+	}
+
+	// Queued frames go out in a single write, payloads are referenced in place.
+	std::vector<boost::asio::const_buffer> buffers;
+	buffers.reserve(_writing.size() * 2);
+
+	bool close_written = false;
+	for ( const auto & f : _writing )
+	{
+		buffers.push_back(boost::asio::buffer(f.header));
+		if ( ! f.payload->empty() )
+		{
+			buffers.push_back(boost::asio::buffer(*f.payload));
+		}
+		close_written = close_written || is_close_frame(f.header);
+	}
+
+	auto self(shared_from_this());
+	auto owner(_owner);
+
+	boost::asio::async_write(*_transport, buffers,
+		[this, self, owner, close_written](boost::system::error_code ec, std::size_t) {
+			_writing.clear();
+			if ( ec )
+			{
+				finish(1006, "");
+				return;
+			}
+			if ( close_written )
+			{
+				_close_written = true;
+				if ( _read_stopped )
+				{
+					finish(_close_code, _close_reason);
+					return;
+				}
+			}
+			do_write();
+		});
+}
+
+//  -----  reading  -----
+
+void
+websocket::start( boost::asio::io_service &      io_service
+                , net::transport &               transport
+                , std::shared_ptr<void>          owner
+                , std::string                    initial_bytes
+                , std::function<void()>          on_finished )
+{
+	_io_service  = &io_service;
+	_transport   = &transport;
+	_owner       = std::move(owner);
+	_on_finished = std::move(on_finished);
+
+	_buffer.resize(std::max(read_buffer_size, initial_bytes.size()));
+	std::copy(initial_bytes.begin(), initial_bytes.end(), _buffer.begin());
+	_buffer_begin = 0;
+	_buffer_end   = initial_bytes.size();
+
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		_started = true;
+	}
+
+	// Messages sent by the handler before the upgrade are written first.
+	schedule_write();
+	process_buffer();
+}
+
+void
+websocket::do_read()
+{
+	// A partial frame header is kept at the start of the buffer.
+	if ( _buffer_begin > 0 )
+	{
+		std::memmove(_buffer.data(), _buffer.data() + _buffer_begin, _buffer_end - _buffer_begin);
+		_buffer_end  -= _buffer_begin;
+		_buffer_begin = 0;
+	}
+
+	auto self(shared_from_this());
+	auto owner(_owner);
+
+	_transport->async_read_some(boost::asio::buffer(_buffer.data() + _buffer_end, _buffer.size() - _buffer_end),
+		[this, self, owner](boost::system::error_code ec, std::size_t bytes_transferred) {
+			if ( ec )
+			{
+				finish(1006, "");
+				return;
+			}
+			_buffer_end += bytes_transferred;
+			process_buffer();
+		});
+}
+
+void
+websocket::process_buffer()
+{
+	while ( ! _finished && ! _read_stopped )
+	{
+		if ( ! _frame_started && ! parse_header() )
+		{
+			if ( ! _finished && ! _read_stopped )
+			{
+				do_read();
+			}
+			return;
+		}
+
+		// The payload is unmasked where it is reassembled, rather than in the read buffer.
+		size_t n = static_cast<size_t>(std::min<uint64_t>(_buffer_end - _buffer_begin, _frame_remaining));
+		if ( n > 0 )
+		{
+			char * dest = grow_frame_target(n);
+			if ( ! dest )
+			{
+				return;
+			}
+			std::memcpy(dest, _buffer.data() + _buffer_begin, n);
+			apply_mask(dest, n, _frame_mask, _frame_offset);
+
+			_buffer_begin    += n;
+			_frame_offset    += n;
+			_frame_remaining -= n;
+		}
+
+		if ( _frame_remaining > 0 )
+		{
+			read_payload();
+			return;
+		}
+		frame_complete();
+	}
+}
+
+bool
+websocket::parse_header()
+{
+	const uint8_t * p         = reinterpret_cast<const uint8_t *>(_buffer.data()) + _buffer_begin;
+	const size_t    available = _buffer_end - _buffer_begin;
+	if ( available < 2 )
+	{
+		return false;
+	}
+
+	const bool   fin    = p[0] & 0x80;
+	const opcode op     = static_cast<opcode>(p[0] & 0x0f);
+	uint64_t     len    = p[1] & 0x7f;
+	size_t       length = 2 + ( len == 126 ? 2 : len == 127 ? 8 : 0 ) + 4;
+
+	// Clients must mask every frame, and no extensions are negotiated.
+	if ( ( p[0] & 0x70 ) || ! ( p[1] & 0x80 ) )
+	{
+		fail(1002);
+		return false;
+	}
+	if ( available < length )
+	{
+		return false;
+	}
+
+	if ( len == 126 )
+	{
+		len = ( uint64_t(p[2]) << 8 ) | p[3];
+	}
+	else if ( len == 127 )
+	{
+		len = 0;
+		for ( int i = 0; i < 8; i++ )
+		{
+			len = ( len << 8 ) | p[2 + i];
+		}
+	}
+	std::memcpy(_frame_mask.data(), p + length - 4, 4);
+
+	switch ( op )
+	{
+	case opcode::CLOSE:
+	case opcode::PING:
+	case opcode::PONG:
+		if ( ! fin || len > 125 )
+		{
+			fail(1002);
+			return false;
+		}
+		_control.clear();
+		_frame_target = &_control;
+		break;
+	case opcode::TEXT:
+	case opcode::BINARY:
+	case opcode::CONTINUATION:
+		if ( _in_message == ( op != opcode::CONTINUATION ) )
+		{
+			// A new message before the last was finished, or a fragment of no message.
+			fail(1002);
+			return false;
+		}
+		if ( op != opcode::CONTINUATION )
+		{
+			_in_message     = true;
+			_message_opcode = op;
+			_message.clear();
+		}
+		if ( len > _max_message_bytes - _message.size() )
+		{
+			fail(1009);
+			return false;
+		}
+
+		// Fragments are read straight onto the end of the message, which grows as they arrive.
+		_frame_target = &_message;
+		break;
+	default:
+		fail(1002);
+		return false;
+	}
+
+	_buffer_begin   += length;
+	_frame_started   = true;
+	_frame_opcode    = op;
+	_frame_fin       = fin;
+	_frame_remaining = len;
+	_frame_offset    = 0;
+	return true;
+}
+
+void
+websocket::read_payload()
+{
+	auto self(shared_from_this());
+	auto owner(_owner);
+
+	// The read buffer is empty, so the rest of the payload bypasses it. The length of a frame is
+	// only trusted as far as it has arrived, so the message at most doubles with each read.
+	const size_t n = static_cast<size_t>(std::min<uint64_t>(
+		_frame_remaining, std::max(payload_read_size, _frame_target->size())));
+	char * dest = grow_frame_target(n);
+	if ( ! dest )
+	{
+		return;
+	}
+	_buffer_begin = 0;
+	_buffer_end   = 0;
+
+	_transport->async_read_some(boost::asio::buffer(dest, n),
+		[this, self, owner, dest, n](boost::system::error_code ec, std::size_t bytes_transferred) {
+			if ( ec )
+			{
+				finish(1006, "");
+				return;
+			}
+			_frame_target->resize(_frame_target->size() - ( n - bytes_transferred ));
+			apply_mask(dest, bytes_transferred, _frame_mask, _frame_offset);
+			_frame_offset    += bytes_transferred;
+			_frame_remaining -= bytes_transferred;
+
+			if ( _frame_remaining > 0 )
+			{
+				read_payload();
+				return;
+			}
+			frame_complete();
+			process_buffer();
+		});
+}
+
+char *
+websocket::grow_frame_target(size_t n)
+{
+	const size_t offset = _frame_target->size();
+	try
+	{
+		_frame_target->resize(offset + n);
+	}
+	catch (const std::bad_alloc &)
+	{
+		fail(1009);
+		return nullptr;
+	}
+	return &(*_frame_target)[offset];
+}
+
+void
+websocket::frame_complete()
+{
+	_frame_started = false;
+
+	switch ( _frame_opcode )
+	{
+	case opcode::PING:
+		queue_frame(opcode::PONG, std::make_shared<const std::string>(_control));
+		break;
+	case opcode::PONG:
+		break;
+	case opcode::CLOSE:
+		if ( _control.size() == 1 )
+		{
+			fail(1002);
+		}
+		else if ( _control.size() >= 2 )
+		{
+			const uint16_t code = ( uint16_t(uint8_t(_control[0])) << 8 ) | uint8_t(_control[1]);
+			stop_reading(code, _control.substr(2));
+		}
+		else
+		{
+			stop_reading(1005, "");
+		}
+		break;
+	default:
+		if ( ! _frame_fin )
+		{
+			break;
+		}
+		_in_message = false;
+		try
+		{
+			if ( _on_message )
+			{
+				_on_message(_message, _message_opcode == opcode::BINARY);
+			}
+		}
+		catch (...)
+		{
+			fail(1011);
+		}
+		_message.clear();
+		break;
+	}
+}
+
+void
+websocket::stop_reading(uint16_t code, const std::string & reason)
+{
+	_read_stopped = true;
+	_close_code   = code;
+	_close_reason = reason;
+
+	bool close_sent;
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		close_sent = _close_sent;
+	}
+
+	if ( ! close_sent )
+	{
+		// Echo the close, the connection is closed once it is written.
+		close(code == 1005 ? 1000 : code, "");
+	}
+	else if ( _close_written )
+	{
+		finish(code, reason);
+	}
+}
+
+void
+websocket::fail(uint16_t code)
+{
+	stop_reading(code, "");
+}
+
+void
+websocket::finish(uint16_t code, const std::string & reason)
+{
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		if ( _finished )
+		{
+			return;
+		}
+		_finished = true;
+		_write_queue.clear();
+	}
+
+	auto on_close    = std::move(_on_close);
+	auto on_finished = std::move(_on_finished);
+	auto owner       = std::move(_owner);
+	_on_close    = nullptr;
+	_on_finished = nullptr;
+	_on_message  = nullptr;
+
+	if ( on_close )
+	{
+		try
+		{
+			on_close(code, reason);
+		}
+		catch (...)
+		{
+		}
+	}
+
+	boost::system::error_code ignored_ec;
+	_transport->socket().shutdown(boost::asio::ip::tcp::socket::shutdown_both, ignored_ec);
+
+	if ( on_finished )
+	{
+		on_finished();
+	}
+}
+
+//  -----  upgrading  -----
+
+void
+websocket::upgrade(response & res, const request & req, std::shared_ptr<websocket> ws)
+{
+	if ( ! header_has_token(req.header("upgrade"), "websocket")
+	  || ! header_has_token(req.header("connection"), "upgrade") )
+	{
+		throw served::request_error(served::status_4XX::UPGRADE_REQUIRED, "WebSocket upgrade required");
+	}
+	if ( req.header("sec-websocket-version") != "13" )
+	{
+		throw served::request_error(served::status_4XX::UPGRADE_REQUIRED, "Unsupported WebSocket version");
+	}
+
+	const std::string key = req.header("sec-websocket-key");
+	if ( key.empty() )
+	{
+		throw served::request_error(served::status_4XX::BAD_REQUEST, "Missing Sec-WebSocket-Key");
+	}
+
+	res.set_status(served::status_1XX::SWITCHING_PROTOCOLS);
+	res.set_header("Upgrade", "websocket");
+	res.set_header("Connection", "Upgrade");
+	res.set_header("Sec-WebSocket-Accept", accept_key(key));
+	res.set_websocket(std::move(ws));
+}
+
+std::string
+websocket::accept_key(const std::string & key)
+{
+	const std::string input = key + "258EAFA5-E914-47DA-95CA-C5AB0DC85B11";
+
+	boost::uuids::detail::sha1 sha;
+	sha.process_bytes(input.data(), input.size());
+
+	boost::uuids::detail::sha1::digest_type digest;
+	sha.get_digest(digest);
+
+#if BOOST_VERSION >= 108600
+	return base64_encode(digest, sizeof(digest));
+#else
+	unsigned char bytes[20];
+	for ( int i = 0; i < 5; i++ )
+	{
+		bytes[i * 4]     = static_cast<unsigned char>(digest[i] >> 24);
+		bytes[i * 4 + 1] = static_cast<unsigned char>(digest[i] >> 16);
+		bytes[i * 4 + 2] = static_cast<unsigned char>(digest[i] >> 8);
+		bytes[i * 4 + 3] = static_cast<unsigned char>(digest[i]);
+	}
+	return base64_encode(bytes, sizeof(bytes));
+#endif
+}
+
+void
+websocket::apply_mask(char * data, size_t len, const std::array<uint8_t, 4> & key, size_t offset /* = 0 */)
+{
+	// Rotate the key to line up with the start of the data, every vector below then starts on a
+	// multiple of four bytes and uses the key as it is.
+	uint8_t k[4];
+	for ( size_t i = 0; i < 4; i++ )
+	{
+		k[i] = key[( offset + i ) & 3];
+	}
+	uint32_t k32;
+	std::memcpy(&k32, k, sizeof(k32));
+
+	size_t i = 0;
+#if defined(__AVX2__)
+	const __m256i k256 = _mm256_set1_epi32(static_cast<int>(k32));
+	for ( ; i + 32 <= len; i += 32 )
+	{
+		__m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(data + i));
+		_mm256_storeu_si256(reinterpret_cast<__m256i *>(data + i), _mm256_xor_si256(v, k256));
+	}
+#endif
+#if defined(__SSE2__)
+	const __m128i k128 = _mm_set1_epi32(static_cast<int>(k32));
+	for ( ; i + 16 <= len; i += 16 )
+	{
+		__m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(data + i));
+		_mm_storeu_si128(reinterpret_cast<__m128i *>(data + i), _mm_xor_si128(v, k128));
+	}
+#elif defined(__ARM_NEON)
+	const uint8x16_t k128 = vreinterpretq_u8_u32(vdupq_n_u32(k32));
+	for ( ; i + 16 <= len; i += 16 )
+	{
+		uint8_t * p = reinterpret_cast<uint8_t *>(data + i);
+		vst1q_u8(p, veorq_u8(vld1q_u8(p), k128));
+	}
+#endif
+
+	const uint64_t k64 = ( uint64_t(k32) << 32 ) | k32;
+	for ( ; i + 8 <= len; i += 8 )
+	{
+		uint64_t v;
+		std::memcpy(&v, data + i, sizeof(v));
+		v ^= k64;
+		std::memcpy(data + i, &v, sizeof(v));
+	}
+	for ( ; i < len; i++ )
+	{
+		data[i] ^= k[i & 3];
+	}
+}
@@ -0,0 +1,318 @@
+/*
+ * Copyright (C) 2021 QM Ltd.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef SERVED_WEBSOCKET_HPP
+#define SERVED_WEBSOCKET_HPP
+
+#include <array>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include <served/boost_compat.hpp>
+#include <boost/asio/io_service.hpp>
+#include <boost/asio/ip/tcp.hpp>
+
+#include <served/net/transport.hpp>
+#include <served/response_stream.hpp>
+
+namespace served {
+
+class request;
+class response;
+
+/*
+ * A WebSocket session, upgraded from a HTTP request.
+ *
+ * A websocket is created for an upgrade request and given to the handler of the endpoint, see
+ * methods_handler::websocket. Once the 101 handshake has been written the connection is handed
+ * to the websocket, which reads frames and passes whole messages to the message handler.
+ * Fragmented messages are reassembled in place as they are read. Ping frames are answered, and
+ * a close frame from the client is echoed before the connection is closed.
+ *
+ * Messages may be sent from any thread. Text messages are not validated as UTF-8.
+ */
+class websocket
+	: public std::enable_shared_from_this<websocket>
+{
+public:
+	enum class opcode : uint8_t
+	{
+		CONTINUATION = 0x0,
+		TEXT         = 0x1,
+		BINARY       = 0x2,
+		CLOSE        = 0x8,
+		PING         = 0x9,
+		PONG         = 0xA
+	};
+
+	typedef std::function<void(const std::string & message, bool binary)> message_handler;
+	typedef std::function<void(uint16_t code, const std::string & reason)> close_handler;
+
+	// The largest message accepted from a client when no other limit is given
+	static const size_t default_max_message_bytes = 16 * 1024 * 1024;
+
+private:
+	struct frame
+	{
+		std::string      header;
+		stream_chunk_ptr payload;
+	};
+
+	const size_t                   _max_message_bytes;
+	message_handler                _on_message;
+	close_handler                  _on_close;
+
+	boost::asio::io_service *      _io_service;
+	net::transport *               _transport;
+	std::shared_ptr<void>          _owner;
+	std::function<void()>          _on_finished;
+	std::vector<char>              _buffer;
+	size_t                         _buffer_begin;
+	size_t                         _buffer_end;
+
+	// The frame being read.
+	bool                           _frame_started;
+	opcode                         _frame_opcode;
+	bool                           _frame_fin;
+	uint64_t                       _frame_remaining;
+	size_t                         _frame_offset;
+	std::array<uint8_t, 4>         _frame_mask;
+	std::string *                  _frame_target;
+
+	// The data message being reassembled, and the payload of the last control frame.
+	bool                           _in_message;
+	opcode                         _message_opcode;
+	std::string                    _message;
+	std::string                    _control;
+
+	// The closing handshake, the connection is closed once reading has stopped and a close frame
+	// has been written.
+	bool                           _read_stopped;
+	bool                           _close_written;
+	uint16_t                       _close_code;
+	std::string                    _close_reason;
+
+	mutable std::mutex             _mutex;
+	std::deque<frame>              _write_queue;
+	std::vector<frame>             _writing;
+	bool                           _started;
+	bool                           _write_scheduled;
+	bool                           _close_sent;
+	bool                           _finished;
+
+public:
+	websocket(const websocket&) = delete;
+
+	websocket& operator=(const websocket&) = delete;
+
+	/*
+	 * Constructs a websocket that has not yet been upgraded.
+	 *
+	 * @param max_message_bytes the largest message accepted from the client, larger messages close
+	 *                          the websocket with status 1009, 0 uses default_max_message_bytes
+	 */
+	explicit websocket(size_t max_message_bytes);
+
+	//  -----  handlers  -----
+
+	/*
+	 * Sets the handler called with each message from the client, on the I/O thread.
+	 *
+	 * Should be set by the endpoint handler, before the websocket is started.
+	 *
+	 * @param handler the handler
+	 */
+	void on_message(message_handler handler);
+
+	/*
+	 * Sets the handler called once the websocket is closed, on the I/O thread.
+	 *
+	 * The code is 1006 if the connection was lost without a close frame.
+	 *
+	 * @param handler the handler
+	 */
+	void on_close(close_handler handler);
+
+	//  -----  sending  -----
+
+	/*
+	 * Sends a message.
+	 *
+	 * @param message the message
+	 * @param binary true to send a binary message, otherwise a text message
+	 *
+	 * @return false if the websocket is closing or closed
+	 */
+	bool send(const std::string & message, bool binary = false);
+
+	/*
+	 * Sends a message without copying it.
+	 *
+	 * The same message may be shared by many websockets.
+	 *
+	 * @param message the message
+	 * @param binary true to send a binary message, otherwise a text message
+	 *
+	 * @return false if the websocket is closing or closed
+	 */
+	bool send(stream_chunk_ptr message, bool binary = false);
+
+	/*
+	 * Sends a ping, the client answers with a pong.
+	 *
+	 * @param payload the payload of the ping, at most 125 bytes
+	 *
+	 * @return false if the websocket is closing or closed
+	 */
+	bool ping(const std::string & payload = "");
+
+	/*
+	 * Starts the closing handshake, the connection is closed once the client answers.
+	 *
+	 * @param code the status code of the close frame
+	 * @param reason the reason, at most 123 bytes
+	 */
+	void close(uint16_t code = 1000, const std::string & reason = "");
+
+	/*
+	 * Indicates whether messages can be sent.
+	 *
+	 * @return false once the websocket is closing or closed
+	 */
+	bool is_open() const;
+
+	//  -----  upgrading  -----
+
+	/*
+	 * Answers an upgrade request with the 101 handshake.
+	 *
+	 * @param res the response to the request
+	 * @param req the upgrade request
+	 * @param ws the websocket that the connection is handed to
+	 *
+	 * @throws request_error if the request is not a valid websocket upgrade
+	 */
+	static void upgrade(response & res, const request & req, std::shared_ptr<websocket> ws);
+
+	/*
+	 * Computes the Sec-WebSocket-Accept value for a Sec-WebSocket-Key.
+	 *
+	 * @param key the key sent by the client
+	 *
+	 * @return the accept value
+	 */
+	static std::string accept_key(const std::string & key);
+
+	/*
+	 * Masks or unmasks a payload in place.
+	 *
+	 * Runs over vector registers where available.
+	 *
+	 * @param data the payload
+	 * @param len the length of the payload
+	 * @param key the masking key of the frame
+	 * @param offset the offset of data within the payload of the frame
+	 */
+	static void apply_mask(char * data, size_t len, const std::array<uint8_t, 4> & key, size_t offset = 0);
+
+	/*
+	 * Starts reading frames from an upgraded connection, on its I/O thread.
+	 *
+	 * @param io_service the io_service of the connection
+	 * @param transport the transport of the connection
+	 * @param owner kept alive until the websocket is finished, it must own the transport
+	 * @param initial_bytes bytes received after the upgrade request
+	 * @param on_finished called once the websocket is finished, the connection should be stopped
+	 */
+	void start( boost::asio::io_service &      io_service
+	          , net::transport &               transport
+	          , std::shared_ptr<void>          owner
+	          , std::string                    initial_bytes
+	          , std::function<void()>          on_finished );
+
+private:
+	bool queue_frame(opcode op, stream_chunk_ptr payload);
+
+	void schedule_write();
+
+	void do_write();
+
+	void do_read();
+
+	/*
+	 * Processes the frames in the read buffer, reading more once it is empty.
+	 */
+	void process_buffer();
+
+	/*
+	 * Parses a frame header from the read buffer.
+	 *
+	 * @return false if the header is incomplete, or the websocket was failed
+	 */
+	bool parse_header();
+
+	/*
+	 * Reads the rest of the payload of the frame straight into its message, which is grown as the
+	 * payload arrives rather than by the length the frame declares.
+	 */
+	void read_payload();
+
+	/*
+	 * Grows the message, or control payload, the frame is read into.
+	 *
+	 * @param n the number of bytes to add
+	 *
+	 * @return the first added byte, or nullptr if the memory could not be allocated, the
+	 *         websocket is then failed with status 1009
+	 */
+	char * grow_frame_target(size_t n);
+
+	void frame_complete();
+
+	/*
+	 * Stops reading once a close frame has been received, or the client has failed the protocol.
+	 *
+	 * @param code the status code to close with
+	 * @param reason the reason to close with
+	 */
+	void stop_reading(uint16_t code, const std::string & reason);
+
+	/*
+	 * Closes the websocket after a protocol error.
+	 *
+	 * @param code the status code sent to the client
+	 */
+	void fail(uint16_t code);
+
+	void finish(uint16_t code, const std::string & reason);
+};
+
+typedef std::shared_ptr<websocket> websocket_ptr;
+
+} // served
+
+#endif // SERVED_WEBSOCKET_HPP
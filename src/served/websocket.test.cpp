@@ -0,0 +1,288 @@
+/*
+ * Copyright (C) 2021 QM Ltd.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <test/catch.hpp>
+
+#include <served/websocket.hpp>
+#include <served/net/server.hpp>
+
+#include <boost/asio.hpp>
+#include <thread>
+
+namespace {
+
+/*
+ * Formats a masked frame, as sent by a client.
+ */
+std::string
+client_frame(uint8_t first_byte, const std::string & payload)
+{
+	const std::array<uint8_t, 4> mask {{ 0x37, 0xfa, 0x21, 0x3d }};
+
+	std::string frame;
+	frame.push_back(static_cast<char>(first_byte));
+	if ( payload.size() < 126 )
+	{
+		frame.push_back(static_cast<char>(0x80 | payload.size()));
+	}
+	else if ( payload.size() < 65536 )
+	{
+		frame.push_back(static_cast<char>(0x80 | 126));
+		frame.push_back(static_cast<char>(payload.size() >> 8));
+		frame.push_back(static_cast<char>(payload.size() & 0xff));
+	}
+	else
+	{
+		frame.push_back(static_cast<char>(0x80 | 127));
+		for ( int shift = 56; shift >= 0; shift -= 8 )
+		{
+			frame.push_back(static_cast<char>(uint64_t(payload.size()) >> shift));
+		}
+	}
+	frame.append(reinterpret_cast<const char *>(mask.data()), mask.size());
+
+	std::string masked = payload;
+	served::websocket::apply_mask(&masked[0], masked.size(), mask);
+	return frame + masked;
+}
+
+/*
+ * Reads bytes from the socket, after any already buffered.
+ */
+std::string
+read_bytes(boost::asio::ip::tcp::socket & socket, boost::asio::streambuf & buf, size_t len)
+{
+	if ( buf.size() < len )
+	{
+		boost::asio::read(socket, buf, boost::asio::transfer_exactly(len - buf.size()));
+	}
+	std::string bytes(boost::asio::buffers_begin(buf.data()), boost::asio::buffers_begin(buf.data()) + len);
+	buf.consume(len);
+	return bytes;
+}
+
+/*
+ * Reads an unmasked frame, as sent by the server.
+ */
+std::pair<uint8_t, std::string>
+read_frame(boost::asio::ip::tcp::socket & socket, boost::asio::streambuf & buf)
+{
+	const std::string header = read_bytes(socket, buf, 2);
+
+	size_t len = uint8_t(header[1]) & 0x7f;
+	if ( len == 126 || len == 127 )
+	{
+		const std::string ext = read_bytes(socket, buf, len == 126 ? 2 : 8);
+		len = 0;
+		for ( const char c : ext )
+		{
+			len = ( len << 8 ) | uint8_t(c);
+		}
+	}
+	return std::make_pair(uint8_t(header[0]), read_bytes(socket, buf, len));
+}
+
+/*
+ * Waits for the server to close the connection.
+ */
+bool
+closed_by_server(boost::asio::ip::tcp::socket & socket, boost::asio::streambuf & buf)
+{
+	boost::system::error_code ec;
+	boost::asio::read(socket, buf, ec);
+	return ec == boost::asio::error::eof;
+}
+
+} // anonymous namespace
+
+TEST_CASE("websocket handshake", "[websocket]")
+{
+	// The sample handshake of RFC 6455.
+	CHECK(served::websocket::accept_key("dGhlIHNhbXBsZSBub25jZQ==") == "s3pPLMBiTxaQ9kYGzzhZRbK+xOo=");
+}
+
+TEST_CASE("websocket masking", "[websocket]")
+{
+	const std::array<uint8_t, 4> key {{ 0x12, 0x34, 0x56, 0x78 }};
+
+	std::string original;
+	for ( int i = 0; i < 301; i++ )
+	{
+		original.push_back(static_cast<char>(i * 7));
+	}
+
+	for ( size_t offset : { 0, 1, 2, 3, 6 } )
+	{
+		for ( size_t len : { 0, 1, 5, 15, 16, 17, 33, 64, 100, 301 } )
+		{
+			std::string masked = original.substr(0, len);
+			served::websocket::apply_mask(&masked[0], masked.size(), key, offset);
+
+			std::string expected = original.substr(0, len);
+			for ( size_t i = 0; i < len; i++ )
+			{
+				expected[i] ^= key[( offset + i ) & 3];
+			}
+			INFO("offset " << offset << " length " << len);
+			CHECK(masked == expected);
+		}
+	}
+}
+
+TEST_CASE("websocket sessions", "[websocket]")
+{
+	std::vector<std::string> received;
+	std::pair<uint16_t, std::string> closed;
+
+	served::multiplexer mux;
+	mux.handle("/ws")
+		.websocket([&](served::websocket_ptr ws, const served::request &) {
+			ws->send("hello");
+			ws->on_message([ws, &received](const std::string & message, bool binary) {
+				received.push_back(message);
+				ws->send(binary ? "binary:" + message : "echo:" + message, binary);
+			});
+			ws->on_close([&closed](uint16_t code, const std::string & reason) {
+				closed = std::make_pair(code, reason);
+			});
+		}, 1024);
+	mux.handle("/large")
+		.websocket([](served::websocket_ptr ws, const served::request &) {
+			ws->on_message([ws](const std::string & message, bool) {
+				ws->send(std::to_string(message.size()));
+			});
+		});
+
+	served::net::server server("127.0.0.1", "42810", mux, false);
+	std::thread server_thread([&]() { server.run(); });
+
+	boost::asio::io_service io_service;
+	boost::asio::ip::tcp::socket socket(io_service);
+	socket.connect(boost::asio::ip::tcp::endpoint(boost::asio::ip::address::from_string("127.0.0.1"), 42810));
+	boost::asio::streambuf buf;
+
+	SECTION("requests without an upgrade are rejected")
+	{
+		boost::asio::write(socket, boost::asio::buffer(std::string("GET /ws HTTP/1.1\r\n\r\n")));
+		boost::asio::read_until(socket, buf, "\r\n\r\n");
+		std::string res(boost::asio::buffers_begin(buf.data()), boost::asio::buffers_end(buf.data()));
+		CHECK(res.find("HTTP/1.1 426") == 0);
+	}
+
+	SECTION("messages are exchanged until closed")
+	{
+		// The first frame arrives with the upgrade request.
+		boost::asio::write(socket, boost::asio::buffer(
+			"GET /ws HTTP/1.1\r\n"
+			"Upgrade: websocket\r\n"
+			"Connection: keep-alive, Upgrade\r\n"
+			"Sec-WebSocket-Key: dGhlIHNhbXBsZSBub25jZQ==\r\n"
+			"Sec-WebSocket-Version: 13\r\n\r\n" + client_frame(0x81, "first")));
+
+		size_t header_len = boost::asio::read_until(socket, buf, "\r\n\r\n");
+		std::string header(boost::asio::buffers_begin(buf.data()), boost::asio::buffers_begin(buf.data()) + header_len);
+		buf.consume(header_len);
+		CHECK(header.find("HTTP/1.1 101") == 0);
+		CHECK(header.find("Sec-WebSocket-Accept: s3pPLMBiTxaQ9kYGzzhZRbK+xOo=\r\n") != std::string::npos);
+		CHECK(header.find("Content-Length") == std::string::npos);
+
+		CHECK(read_frame(socket, buf) == std::make_pair(uint8_t(0x81), std::string("hello")));
+		CHECK(read_frame(socket, buf) == std::make_pair(uint8_t(0x81), std::string("echo:first")));
+
+		// A fragmented binary message, interleaved with a ping.
+		const std::string part(200, 'x');
+		boost::asio::write(socket, boost::asio::buffer(
+			client_frame(0x02, part) + client_frame(0x89, "ping") + client_frame(0x00, part)));
+		CHECK(read_frame(socket, buf) == std::make_pair(uint8_t(0x8A), std::string("ping")));
+		boost::asio::write(socket, boost::asio::buffer(client_frame(0x80, "end")));
+		CHECK(read_frame(socket, buf) == std::make_pair(uint8_t(0x82), "binary:" + part + part + "end"));
+
+		// The close is echoed and the connection closed.
+		boost::asio::write(socket, boost::asio::buffer(client_frame(0x88, std::string("\x03\xe8" "bye", 5))));
+		auto close = read_frame(socket, buf);
+		CHECK(close.first == 0x88);
+		CHECK(close.second.substr(0, 2) == std::string("\x03\xe8", 2));
+
+		CHECK(closed_by_server(socket, buf));
+
+		CHECK(received.size() == 2);
+		CHECK(closed == std::make_pair(uint16_t(1000), std::string("bye")));
+	}
+
+	SECTION("oversized messages close the websocket")
+	{
+		boost::asio::write(socket, boost::asio::buffer(std::string(
+			"GET /ws HTTP/1.1\r\n"
+			"Upgrade: websocket\r\n"
+			"Connection: Upgrade\r\n"
+			"Sec-WebSocket-Key: dGhlIHNhbXBsZSBub25jZQ==\r\n"
+			"Sec-WebSocket-Version: 13\r\n\r\n")));
+
+		size_t header_len = boost::asio::read_until(socket, buf, "\r\n\r\n");
+		buf.consume(header_len);
+		CHECK(read_frame(socket, buf).second == "hello");
+
+		boost::asio::write(socket, boost::asio::buffer(client_frame(0x01, std::string(600, 'x'))));
+		boost::asio::write(socket, boost::asio::buffer(client_frame(0x80, std::string(600, 'x'))));
+
+		auto close = read_frame(socket, buf);
+		CHECK(close.first == 0x88);
+		CHECK(close.second == std::string("\x03\xf1", 2));
+		CHECK(closed_by_server(socket, buf));
+		CHECK(closed.first == 1009);
+	}
+
+	SECTION("declared lengths are not allocated before the payload arrives")
+	{
+		boost::asio::write(socket, boost::asio::buffer(std::string(
+			"GET /large HTTP/1.1\r\n"
+			"Upgrade: websocket\r\n"
+			"Connection: Upgrade\r\n"
+			"Sec-WebSocket-Key: dGhlIHNhbXBsZSBub25jZQ==\r\n"
+			"Sec-WebSocket-Version: 13\r\n\r\n")));
+
+		size_t header_len = boost::asio::read_until(socket, buf, "\r\n\r\n");
+		buf.consume(header_len);
+
+		// A large message is read as it arrives, in pieces.
+		const std::string message = client_frame(0x82, std::string(300000, 'x'));
+		boost::asio::write(socket, boost::asio::buffer(message.data(), 100000));
+		std::this_thread::sleep_for(std::chrono::milliseconds(20));
+		boost::asio::write(socket, boost::asio::buffer(message.data() + 100000, message.size() - 100000));
+		CHECK(read_frame(socket, buf).second == "300000");
+
+		// A frame declaring far more than the default limit is refused from its header alone.
+		std::string header("\x82\xff", 2);
+		header.append(std::string("\x00\x00\x40\x00\x00\x00\x00\x00", 8));
+		header.append(std::string("\x37\xfa\x21\x3d", 4));
+		boost::asio::write(socket, boost::asio::buffer(header));
+
+		auto close = read_frame(socket, buf);
+		CHECK(close.first == 0x88);
+		CHECK(close.second == std::string("\x03\xf1", 2));
+		CHECK(closed_by_server(socket, buf));
+	}
+
+	socket.close();
+	server.stop();
+	server_thread.join();
+}